@@ -602,6 +602,131 @@ namespace hpc
                             "Make the JobId part of the task execution id",
                         }
                     },
+                    { "3.1.3.0",
+                        {
+                            "Manage the task cgroups natively instead of through the scripts",
+                        }
+                    },
+                    { "3.1.4.0",
+                        {
+                            "Sample the node metrics from /proc instead of vmstat, iostat, df and ip",
+                        }
+                    },
+                    { "3.1.5.0",
+                        {
+                            "Collect the node inventory at its own period and on network changes",
+                        }
+                    },
+                    { "3.1.6.0",
+                        {
+                            "Cache the CPU topology from sysfs and count the cores in use over all the affinity words",
+                        }
+                    },
+                    { "3.1.7.0",
+                        {
+                            "Reuse the keep-alive http clients per origin through a bounded pool",
+                        }
+                    },
+                    { "3.1.8.0",
+                        {
+                            "Optionally batch the task completion reports within a coalescing window",
+                        }
+                    },
+                    { "3.1.9.0",
+                        {
+                            "Watch the task processes, pipes and grace period timers from one epoll reactor with a worker pool",
+                        }
+                    },
+                    { "3.1.10.0",
+                        {
+                            "Optionally launch the tasks by clone(CLONE_VM | CLONE_VFORK) instead of fork",
+                        }
+                    },
+                    { "3.1.11.0",
+                        {
+                            "Stream the task output through a bounded ring in coalesced chunks with block or drop-oldest backpressure",
+                        }
+                    },
+                    { "3.1.12.0",
+                        {
+                            "Serve the output peeks and the exit snippets by pread or from the streamed output ring instead of tail and head",
+                        }
+                    },
+                    { "3.1.13.0",
+                        {
+                            "Lock the executor per job and per user, look up the processes in a snapshot",
+                        }
+                    },
+                    { "3.1.14.0",
+                        {
+                            "Cache the provisioned job users and ssh keys, write the key files atomically without subprocesses",
+                        }
+                    },
+                    { "3.1.15.0",
+                        {
+                            "Add the delta heartbeat mode reporting the task changes since the last acknowledged report",
+                        }
+                    },
+                    { "3.1.16.0",
+                        {
+                            "Add the version 2 metric packet with varint umids, delta values and fragmentation",
+                        }
+                    },
+                    { "3.1.17.0",
+                        {
+                            "Compile the enabled metric counters into a flat plan collected without allocations",
+                        }
+                    },
+                    { "3.1.18.0",
+                        {
+                            "Write the logs asynchronously through a lock free ring, check the level first",
+                        }
+                    },
+                    { "3.1.19.0",
+                        {
+                            "Parse the configuration into a typed snapshot and reload it when the file changes",
+                        }
+                    },
+                    { "3.1.20.0",
+                        {
+                            "Cache the naming service locations with a ttl, resolve each service once in flight and refresh stale locations in background",
+                        }
+                    },
+                    { "3.1.21.0",
+                        {
+                            "Update the HPC entries of the hosts file by diff and replace it atomically only when changed",
+                        }
+                    },
+                    { "3.1.22.0",
+                        {
+                            "Run the execution filters as persistent co-processes with FilterMode persistent",
+                        }
+                    },
+                    { "3.1.23.0",
+                        {
+                            "Add the starttasks call to start a batch of tasks",
+                        }
+                    },
+                    { "3.1.24.0",
+                        {
+                            "Stream the proxied requests through pooled clients with a concurrency limit per target",
+                        }
+                    },
+                    { "3.1.25.0",
+                        {
+                            "Wait for the killed tasks through cgroup.events and pidfd instead of polling the statistics",
+                        }
+                    },
+                    { "3.1.26.0",
+                        {
+                            "Sample the cgroup usage of the running tasks, add the taskmetrics call and the telemetry summary in the completion event",
+                        }
+                    },
+                    { "3.1.27.0",
+                        {
+                            "Keep the history of the reported metric values with 1 minute and 1 hour rollups, add the metrichistory call",
+                        }
+                    },
                 };
 
                 return versionHistory;
@@ -0,0 +1,26 @@
+#include <time.h>
+
+#include "MetricHistoryArgs.h"
+#include "../utils/JsonHelper.h"
+
+using namespace hpc::arguments;
+using namespace hpc::utils;
+
+MetricHistoryArgs::MetricHistoryArgs(int metricId, int instanceId, long from, long to, int resolution, int maxPoints)
+    : MetricId(metricId), InstanceId(instanceId), From(from), To(to), Resolution(resolution), MaxPoints(maxPoints)
+{
+    //ctor
+}
+
+MetricHistoryArgs MetricHistoryArgs::FromJson(const json::value& j)
+{
+    MetricHistoryArgs args(
+        JsonHelper<int>::Read("MetricId", j),
+        j.has_field("InstanceId") ? JsonHelper<int>::Read("InstanceId", j) : -1,
+        JsonHelper<long>::Read("From", j),
+        j.has_field("To") ? JsonHelper<long>::Read("To", j) : (long)time(nullptr),
+        j.has_field("Resolution") ? JsonHelper<int>::Read("Resolution", j) : 0,
+        j.has_field("MaxPoints") ? JsonHelper<int>::Read("MaxPoints", j) : DefaultMaxPoints);
+
+    return std::move(args);
+}
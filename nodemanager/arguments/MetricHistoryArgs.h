@@ -0,0 +1,38 @@
+#ifndef METRICHISTORYARGS_H
+#define METRICHISTORYARGS_H
+
+#include <cpprest/json.h>
+
+namespace hpc
+{
+    namespace arguments
+    {
+        struct MetricHistoryArgs
+        {
+            public:
+                MetricHistoryArgs(int metricId, int instanceId, long from, long to, int resolution, int maxPoints);
+
+                int MetricId;
+
+                // all the instances when not specified.
+                int InstanceId;
+
+                // seconds since epoch, to is now when not specified.
+                long From;
+                long To;
+
+                // 1, 60 or 3600 seconds, chosen by the range when not specified.
+                int Resolution;
+                int MaxPoints;
+
+                static MetricHistoryArgs FromJson(const web::json::value& jsonValue);
+
+                static const int DefaultMaxPoints = 3600;
+
+             protected:
+            private:
+        };
+    }
+}
+
+#endif // METRICHISTORYARGS_H
@@ -0,0 +1,34 @@
+#include "StartTasksArgs.h"
+#include "../utils/JsonHelper.h"
+
+using namespace hpc::arguments;
+using namespace hpc::utils;
+using namespace web;
+
+const std::string StartTasksArgs::ErrorField = "Error";
+
+StartTasksArgs::StartTasksArgs(std::vector<StartTaskArgs>&& tasks) : Tasks(std::move(tasks)), Errors(Tasks.size())
+{
+    //ctor
+}
+
+StartTasksArgs StartTasksArgs::FromJson(const json::value& j)
+{
+    std::vector<StartTaskArgs> tasks;
+    std::vector<std::string> errors;
+
+    const auto& values = j.as_array();
+    tasks.reserve(values.size());
+    errors.reserve(values.size());
+
+    for (const auto& v : values)
+    {
+        tasks.push_back(StartTaskArgs::FromJson(v));
+        errors.push_back(JsonHelper<std::string>::Read(ErrorField, v));
+    }
+
+    StartTasksArgs args(std::move(tasks));
+    args.Errors = std::move(errors);
+
+    return std::move(args);
+}
@@ -0,0 +1,36 @@
+#ifndef STARTTASKSARGS_H
+#define STARTTASKSARGS_H
+
+#include <string>
+#include <vector>
+#include <cpprest/json.h>
+
+#include "StartTaskArgs.h"
+
+namespace hpc
+{
+    namespace arguments
+    {
+        // The tasks started by one starttasks call, a json array of StartTaskArgs.
+        struct StartTasksArgs
+        {
+            public:
+                StartTasksArgs(std::vector<StartTaskArgs>&& tasks);
+
+                std::vector<StartTaskArgs> Tasks;
+                // by the index of the task, the reason it failed before the start,
+                // e.g. in the TaskStartFilter, empty for the tasks to start.
+                std::vector<std::string> Errors;
+
+                static StartTasksArgs FromJson(const web::json::value& jsonValue);
+
+                // The field of a task in the json carrying its error.
+                static const std::string ErrorField;
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // STARTTASKSARGS_H
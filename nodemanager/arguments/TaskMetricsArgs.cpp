@@ -0,0 +1,21 @@
+#include "TaskMetricsArgs.h"
+#include "../utils/JsonHelper.h"
+
+using namespace hpc::arguments;
+using namespace hpc::utils;
+
+TaskMetricsArgs::TaskMetricsArgs(int jobId, int taskId, int maxSamples)
+    : JobId(jobId), TaskId(taskId), MaxSamples(maxSamples)
+{
+    //ctor
+}
+
+TaskMetricsArgs TaskMetricsArgs::FromJson(const json::value& j)
+{
+    TaskMetricsArgs args(
+        JsonHelper<int>::Read("JobId", j),
+        JsonHelper<int>::Read("TaskId", j),
+        j.has_field("MaxSamples") ? JsonHelper<int>::Read("MaxSamples", j) : 0);
+
+    return std::move(args);
+}
@@ -0,0 +1,29 @@
+#ifndef TASKMETRICSARGS_H
+#define TASKMETRICSARGS_H
+
+#include <cpprest/json.h>
+
+namespace hpc
+{
+    namespace arguments
+    {
+        struct TaskMetricsArgs
+        {
+            public:
+                TaskMetricsArgs(int jobId, int taskId, int maxSamples);
+
+                int JobId;
+                int TaskId;
+
+                // all the samples kept when not specified.
+                int MaxSamples;
+
+                static TaskMetricsArgs FromJson(const web::json::value& jsonValue);
+
+             protected:
+            private:
+        };
+    }
+}
+
+#endif // TASKMETRICSARGS_H
@@ -0,0 +1,695 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <fcntl.h>
+#include <dirent.h>
+#include <signal.h>
+#include <poll.h>
+#include <chrono>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "CGroupController.h"
+#include "../utils/String.h"
+#include "../utils/Logger.h"
+#include "../utils/System.h"
+
+using namespace hpc::core;
+using namespace hpc::utils;
+using namespace hpc::data;
+
+const std::string CGroupController::GroupPrefix = "nmgroup_";
+
+constexpr int CGroupController::MaxRetry;
+constexpr int CGroupController::RetryIntervalMs;
+constexpr int CGroupController::StateCheckCount;
+constexpr int CGroupController::StateCheckIntervalMs;
+
+CGroupController::CGroupController()
+{
+    const std::vector<std::string> subsystems = { "cpuset", "cpuacct", "memory", "freezer", "blkio" };
+
+    std::ifstream fs("/proc/self/mounts", std::ios::in);
+    std::string line;
+    while (getline(fs, line))
+    {
+        std::istringstream lineStream(line);
+        std::string device, mountPoint, type, options;
+        lineStream >> device >> mountPoint >> type >> options;
+
+        if (type == "cgroup2")
+        {
+            this->unifiedRoot = mountPoint;
+        }
+        else if (type == "cgroup")
+        {
+            for (const auto& option : String::Split(options, ','))
+            {
+                if (std::find(subsystems.cbegin(), subsystems.cend(), option) != subsystems.cend())
+                {
+                    this->hierarchies[option] = mountPoint;
+                }
+            }
+        }
+    }
+
+    fs.close();
+
+    // The controllers stay in v1 on a hybrid system, the unified hierarchy is used only
+    // when no v1 controller is mounted.
+    if (!this->hierarchies.empty())
+    {
+        this->version = CGroupVersion::V1;
+    }
+    else if (!this->unifiedRoot.empty() && FileExists(this->unifiedRoot + "/cgroup.controllers"))
+    {
+        this->version = CGroupVersion::V2;
+
+        std::string controllers;
+        ReadFile(this->unifiedRoot + "/cgroup.controllers", controllers);
+        for (const auto& controller : String::Split(String::Trim(controllers), ' '))
+        {
+            if (controller == "cpuset" || controller == "cpu" || controller == "memory" || controller == "pids" || controller == "io")
+            {
+                int ret = WriteFile(this->unifiedRoot + "/cgroup.subtree_control", "+" + controller);
+                if (ret != 0)
+                {
+                    Logger::Warn("CGroup: failed to enable controller {0}, error code {1}", controller, ret);
+                }
+            }
+        }
+    }
+
+    Logger::Info("CGroup: version {0}, unified root {1}, v1 hierarchies {2}",
+        (int)this->version, this->unifiedRoot, this->hierarchies.size());
+}
+
+int CGroupController::Create(const std::string& groupName, const std::string& cpus)
+{
+    auto retry = [](const std::string& action, const std::function<int()>& func)
+    {
+        int ret = 0;
+        for (int i = 0; i < MaxRetry; i++)
+        {
+            ret = func();
+            if (ret == 0) break;
+
+            Logger::Warn("CGroup: failed to {0}, error code {1}, retry after {2} ms", action, ret, RetryIntervalMs);
+            usleep(RetryIntervalMs * 1000);
+        }
+
+        return ret;
+    };
+
+    for (const auto& path : this->GetGroupPaths(groupName))
+    {
+        int ret = retry("create " + path, [&path]()
+        {
+            return (mkdir(path.c_str(), 0755) == 0 || errno == EEXIST) ? 0 : errno;
+        });
+
+        if (ret != 0) return ret;
+    }
+
+    std::string cpusetPath = this->GetGroupPath("cpuset", groupName);
+    if (cpusetPath.empty() || !FileExists(cpusetPath + "/cpuset.cpus"))
+    {
+        return 0;
+    }
+
+    int ret = retry("set cpus for " + cpusetPath, [&cpusetPath, &cpus]()
+    {
+        return WriteFile(cpusetPath + "/cpuset.cpus", cpus);
+    });
+
+    if (ret != 0 || this->version != CGroupVersion::V1)
+    {
+        // v2 inherits the memory nodes from the parent when cpuset.mems is empty.
+        return ret;
+    }
+
+    std::string mems;
+    ret = ReadFile(this->hierarchies["cpuset"] + "/cpuset.mems", mems);
+    if (ret != 0) return ret;
+
+    mems = String::Trim(mems);
+    return retry("set mems for " + cpusetPath, [&cpusetPath, &mems]()
+    {
+        return WriteFile(cpusetPath + "/cpuset.mems", mems);
+    });
+}
+
+int CGroupController::Freeze(const std::string& groupName, bool frozen)
+{
+    if (this->version == CGroupVersion::V2)
+    {
+        std::string path = this->GetGroupPath(std::string(), groupName);
+        int ret = WriteFile(path + "/cgroup.freeze", frozen ? "1" : "0");
+        if (ret == 0 && !this->WaitForState(path + "/cgroup.events", "frozen", frozen ? "1" : "0"))
+        {
+            Logger::Warn("CGroup: {0} is not {1} in time", groupName, frozen ? "frozen" : "thawed");
+        }
+
+        return ret;
+    }
+
+    std::string path = this->GetGroupPath("freezer", groupName);
+    if (path.empty()) return ENOENT;
+
+    std::string state = frozen ? "FROZEN" : "THAWED";
+    int ret = WriteFile(path + "/freezer.state", state);
+    if (ret == 0 && !this->WaitForState(path + "/freezer.state", std::string(), state))
+    {
+        Logger::Warn("CGroup: {0} is not {1} in time", groupName, state);
+    }
+
+    return ret;
+}
+
+int CGroupController::Kill(const std::string& groupName, bool forced)
+{
+    if (!this->IsAvailable()) return ENOENT;
+
+    if (forced && this->version == CGroupVersion::V2)
+    {
+        std::string killFile = this->GetGroupPath(std::string(), groupName) + "/cgroup.kill";
+        if (FileExists(killFile))
+        {
+            return WriteFile(killFile, "1");
+        }
+    }
+
+    bool frozen = this->Freeze(groupName, true) == 0;
+
+    std::vector<int> pids;
+    int ret = this->ReadProcessIds(groupName, pids);
+
+    int signal = forced ? SIGKILL : SIGINT;
+    for (int pid : pids)
+    {
+        if (kill(pid, signal) != 0 && errno != ESRCH)
+        {
+            Logger::Warn("CGroup: failed to send signal {0} to {1} in {2}, errno {3}", signal, pid, groupName, errno);
+        }
+    }
+
+    if (frozen)
+    {
+        this->Freeze(groupName, false);
+    }
+
+    return ret;
+}
+
+int CGroupController::WaitForEmpty(const std::string& groupName, int timeoutMs)
+{
+    if (!this->IsAvailable()) return 0;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    auto remainingMs = [&deadline]()
+    {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        return ms > 0 ? (int)ms : 0;
+    };
+
+    if (this->version == CGroupVersion::V2)
+    {
+        std::string eventsFile = this->GetGroupPath(std::string(), groupName) + "/cgroup.events";
+
+        // the watch is added before the first read, so no transition is missed.
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd >= 0 && inotify_add_watch(fd, eventsFile.c_str(), IN_MODIFY) < 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+
+        int ret = ETIMEDOUT;
+        while (true)
+        {
+            std::string content;
+            uint64_t populated = 1;
+            if (ReadFile(eventsFile, content) != 0 || (ParseKeyValue(content, "populated", populated) && populated == 0))
+            {
+                ret = 0;
+                break;
+            }
+
+            int timeout = remainingMs();
+            if (timeout == 0) break;
+
+            if (fd < 0)
+            {
+                int interval = StateCheckIntervalMs;
+                usleep(std::min(timeout, interval) * 1000);
+                continue;
+            }
+
+            // the removal of the group also wakes the poll up.
+            pollfd pfd = { fd, POLLIN, 0 };
+            if (poll(&pfd, 1, timeout) > 0)
+            {
+                alignas(inotify_event) char buffer[4096];
+                while (read(fd, buffer, sizeof(buffer)) > 0) { }
+            }
+        }
+
+        if (fd >= 0) close(fd);
+        return ret;
+    }
+
+    // v1 has no populated notification, the processes forked meanwhile are
+    // found by reading the group again once the known ones exited.
+    while (true)
+    {
+        std::vector<int> pids;
+        if (this->ReadProcessIds(groupName, pids) != 0 || pids.empty())
+        {
+            return 0;
+        }
+
+        int timeout = remainingMs();
+        int ret = timeout == 0 ? ETIMEDOUT : System::WaitForExit(pids, timeout);
+        if (ret != 0)
+        {
+            return ret;
+        }
+    }
+}
+
+int CGroupController::GetStatistics(const std::string& groupName, ProcessStatistics& stat)
+{
+    if (!this->IsAvailable()) return ENOENT;
+
+    uint64_t userTimeMs = 0, kernelTimeMs = 0, workingSetBytes = 0;
+    std::string content;
+    int ret;
+
+    if (this->version == CGroupVersion::V2)
+    {
+        std::string path = this->GetGroupPath(std::string(), groupName);
+        ret = ReadFile(path + "/cpu.stat", content);
+        if (ret != 0) return ret;
+
+        uint64_t userUs = 0, systemUs = 0;
+        ParseKeyValue(content, "user_usec", userUs);
+        ParseKeyValue(content, "system_usec", systemUs);
+        userTimeMs = userUs / 1000;
+        kernelTimeMs = systemUs / 1000;
+
+        // memory.peak is only available since kernel 5.19.
+        if (ReadFile(path + "/memory.peak", content) == 0 || ReadFile(path + "/memory.current", content) == 0)
+        {
+            workingSetBytes = String::ConvertTo<uint64_t>(content);
+        }
+    }
+    else
+    {
+        std::string cpuacctPath = this->GetGroupPath("cpuacct", groupName);
+        ret = ReadFile(cpuacctPath + "/cpuacct.stat", content);
+        if (ret != 0) return ret;
+
+        uint64_t userTicks = 0, systemTicks = 0;
+        ParseKeyValue(content, "user", userTicks);
+        ParseKeyValue(content, "system", systemTicks);
+
+        static const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+        userTimeMs = userTicks * 1000 / ticksPerSecond;
+        kernelTimeMs = systemTicks * 1000 / ticksPerSecond;
+
+        std::string memoryPath = this->GetGroupPath("memory", groupName);
+        if (!memoryPath.empty() && ReadFile(memoryPath + "/memory.max_usage_in_bytes", content) == 0)
+        {
+            workingSetBytes = String::ConvertTo<uint64_t>(content);
+        }
+    }
+
+    std::vector<int> pids;
+    ret = this->ReadProcessIds(groupName, pids);
+    if (ret != 0) return ret;
+
+    stat.UserTimeMs = userTimeMs;
+    stat.KernelTimeMs = kernelTimeMs;
+    stat.WorkingSetKb = workingSetBytes / 1024;
+    stat.ProcessIds = std::move(pids);
+
+    return 0;
+}
+
+int CGroupController::GetUsage(const std::string& groupName, Usage& usage)
+{
+    if (!this->IsAvailable()) return ENOENT;
+
+    std::string content;
+    int ret;
+
+    if (this->version == CGroupVersion::V2)
+    {
+        std::string path = this->GetGroupPath(std::string(), groupName);
+        ret = ReadFile(path + "/cpu.stat", content);
+        if (ret != 0) return ret;
+
+        ParseKeyValue(content, "usage_usec", usage.CpuUsec);
+
+        if (ReadFile(path + "/memory.current", content) == 0)
+        {
+            usage.MemoryBytes = String::ConvertTo<uint64_t>(content);
+        }
+
+        // memory.peak is only available since kernel 5.19.
+        if (ReadFile(path + "/memory.peak", content) == 0)
+        {
+            usage.MemoryPeakBytes = String::ConvertTo<uint64_t>(content);
+        }
+
+        if (ReadFile(path + "/io.stat", content) == 0)
+        {
+            ParseIoStat(content, usage.IoReadBytes, usage.IoWriteBytes);
+        }
+
+        if (ReadFile(path + "/pids.current", content) == 0)
+        {
+            usage.ProcessCount = String::ConvertTo<uint32_t>(content);
+            return 0;
+        }
+    }
+    else
+    {
+        ret = ReadFile(this->GetGroupPath("cpuacct", groupName) + "/cpuacct.usage", content);
+        if (ret != 0) return ret;
+
+        usage.CpuUsec = String::ConvertTo<uint64_t>(content) / 1000;
+
+        std::string memoryPath = this->GetGroupPath("memory", groupName);
+        if (!memoryPath.empty())
+        {
+            if (ReadFile(memoryPath + "/memory.usage_in_bytes", content) == 0)
+            {
+                usage.MemoryBytes = String::ConvertTo<uint64_t>(content);
+            }
+
+            if (ReadFile(memoryPath + "/memory.max_usage_in_bytes", content) == 0)
+            {
+                usage.MemoryPeakBytes = String::ConvertTo<uint64_t>(content);
+            }
+        }
+
+        std::string blkioPath = this->GetGroupPath("blkio", groupName);
+        if (!blkioPath.empty() && ReadFile(blkioPath + "/blkio.throttle.io_service_bytes", content) == 0)
+        {
+            ParseBlkioStat(content, usage.IoReadBytes, usage.IoWriteBytes);
+        }
+    }
+
+    std::vector<int> pids;
+    if (this->ReadProcessIds(groupName, pids) == 0)
+    {
+        usage.ProcessCount = pids.size();
+    }
+
+    return 0;
+}
+
+int CGroupController::Remove(const std::string& groupName)
+{
+    int ret = 0;
+    auto paths = this->GetGroupPaths(groupName);
+
+    for (const auto& path : paths)
+    {
+        // The killed processes may take a while to leave the group.
+        for (int i = 0; i < StateCheckCount; i++)
+        {
+            ret = (rmdir(path.c_str()) == 0 || errno == ENOENT) ? 0 : errno;
+            if (ret != EBUSY) break;
+
+            usleep(StateCheckIntervalMs * 1000);
+        }
+
+        if (ret != 0)
+        {
+            Logger::Warn("CGroup: failed to remove {0}, error code {1}", path, ret);
+        }
+    }
+
+    return ret;
+}
+
+std::vector<std::string> CGroupController::GetProcsFiles(const std::string& groupName) const
+{
+    std::vector<std::string> files;
+    for (const auto& path : this->GetGroupPaths(groupName))
+    {
+        files.push_back(path + "/cgroup.procs");
+    }
+
+    return std::move(files);
+}
+
+std::vector<std::string> CGroupController::ListGroups() const
+{
+    std::vector<std::string> groups;
+
+    std::string root;
+    if (this->version == CGroupVersion::V2)
+    {
+        root = this->unifiedRoot;
+    }
+    else if (this->version == CGroupVersion::V1)
+    {
+        root = this->hierarchies.begin()->second;
+    }
+    else
+    {
+        return std::move(groups);
+    }
+
+    DIR* dir = opendir(root.c_str());
+    if (dir == nullptr)
+    {
+        Logger::Error("CGroup: failed to open {0}, errno {1}", root, errno);
+        return std::move(groups);
+    }
+
+    while (dirent* entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (entry->d_type == DT_DIR && name.compare(0, GroupPrefix.size(), GroupPrefix) == 0)
+        {
+            groups.push_back(name);
+        }
+    }
+
+    closedir(dir);
+
+    return std::move(groups);
+}
+
+int CGroupController::Attach(const std::vector<std::string>& procsFiles, pid_t pid)
+{
+    char buffer[16];
+    char* p = buffer + sizeof(buffer);
+    do
+    {
+        *--p = '0' + pid % 10;
+        pid /= 10;
+    } while (pid > 0);
+
+    size_t length = buffer + sizeof(buffer) - p;
+
+    for (const auto& file : procsFiles)
+    {
+        int fd = open(file.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd < 0) return errno;
+
+        int ret = write(fd, p, length) < 0 ? errno : 0;
+        close(fd);
+
+        if (ret != 0) return ret;
+    }
+
+    return 0;
+}
+
+std::string CGroupController::GetGroupPath(const std::string& subsystem, const std::string& groupName) const
+{
+    if (this->version == CGroupVersion::V2)
+    {
+        return this->unifiedRoot + "/" + groupName;
+    }
+
+    auto hierarchy = this->hierarchies.find(subsystem);
+    if (hierarchy == this->hierarchies.end())
+    {
+        return std::string();
+    }
+
+    return hierarchy->second + "/" + groupName;
+}
+
+std::vector<std::string> CGroupController::GetGroupPaths(const std::string& groupName) const
+{
+    std::vector<std::string> paths;
+
+    if (this->version == CGroupVersion::V2)
+    {
+        paths.push_back(this->GetGroupPath(std::string(), groupName));
+    }
+    else
+    {
+        // Subsystems may be co-mounted, e.g. cpu,cpuacct.
+        for (const auto& hierarchy : this->hierarchies)
+        {
+            std::string path = hierarchy.second + "/" + groupName;
+            if (std::find(paths.cbegin(), paths.cend(), path) == paths.cend())
+            {
+                paths.push_back(path);
+            }
+        }
+    }
+
+    return std::move(paths);
+}
+
+int CGroupController::ReadProcessIds(const std::string& groupName, std::vector<int>& pids) const
+{
+    std::string path = this->GetGroupPath("freezer", groupName);
+    if (path.empty())
+    {
+        auto paths = this->GetGroupPaths(groupName);
+        if (paths.empty()) return ENOENT;
+        path = paths.front();
+    }
+
+    std::string content;
+    int ret = ReadFile(path + "/cgroup.procs", content);
+    if (ret != 0) return ret;
+
+    std::istringstream iss(content);
+    int pid;
+    while (iss >> pid)
+    {
+        pids.push_back(pid);
+    }
+
+    return 0;
+}
+
+bool CGroupController::WaitForState(const std::string& file, const std::string& key, const std::string& expected) const
+{
+    for (int i = 0; i < StateCheckCount; i++)
+    {
+        std::string content;
+        if (ReadFile(file, content) != 0)
+        {
+            return false;
+        }
+
+        if (key.empty())
+        {
+            if (String::Trim(content) == expected) return true;
+        }
+        else
+        {
+            uint64_t value;
+            if (ParseKeyValue(content, key, value) && std::to_string(value) == expected) return true;
+        }
+
+        usleep(StateCheckIntervalMs * 1000);
+    }
+
+    return false;
+}
+
+int CGroupController::ReadFile(const std::string& path, std::string& content)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return errno;
+
+    content.clear();
+
+    char buffer[4096];
+    ssize_t bytesRead;
+    while ((bytesRead = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        content.append(buffer, bytesRead);
+    }
+
+    int ret = bytesRead < 0 ? errno : 0;
+    close(fd);
+
+    return ret;
+}
+
+int CGroupController::WriteFile(const std::string& path, const std::string& content)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return errno;
+
+    int ret = write(fd, content.c_str(), content.size()) < 0 ? errno : 0;
+    close(fd);
+
+    return ret;
+}
+
+bool CGroupController::FileExists(const std::string& path)
+{
+    return access(path.c_str(), F_OK) == 0;
+}
+
+bool CGroupController::ParseKeyValue(const std::string& content, const std::string& key, uint64_t& value)
+{
+    std::istringstream iss(content);
+    std::string name;
+    uint64_t v;
+    while (iss >> name >> v)
+    {
+        if (name == key)
+        {
+            value = v;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CGroupController::ParseIoStat(const std::string& content, uint64_t& readBytes, uint64_t& writeBytes)
+{
+    // a line per device, e.g. 8:0 rbytes=1 wbytes=2 rios=3 wios=4 dbytes=0 dios=0
+    std::istringstream iss(content);
+    std::string token;
+    while (iss >> token)
+    {
+        if (token.compare(0, 7, "rbytes=") == 0)
+        {
+            readBytes += String::ConvertTo<uint64_t>(token.substr(7));
+        }
+        else if (token.compare(0, 7, "wbytes=") == 0)
+        {
+            writeBytes += String::ConvertTo<uint64_t>(token.substr(7));
+        }
+    }
+}
+
+void CGroupController::ParseBlkioStat(const std::string& content, uint64_t& readBytes, uint64_t& writeBytes)
+{
+    // a line per device and operation, e.g. 8:0 Read 4096, and a Total line.
+    std::istringstream iss(content);
+    std::string line;
+    while (getline(iss, line))
+    {
+        std::istringstream lineStream(line);
+        std::string device, operation;
+        uint64_t value;
+        if (!(lineStream >> device >> operation >> value))
+        {
+            continue;
+        }
+
+        if (operation == "Read") readBytes += value;
+        else if (operation == "Write") writeBytes += value;
+    }
+}
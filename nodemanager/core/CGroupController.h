@@ -0,0 +1,110 @@
+#ifndef CGROUPCONTROLLER_H
+#define CGROUPCONTROLLER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unistd.h>
+
+#include "../data/ProcessStatistics.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        enum class CGroupVersion
+        {
+            None = 0,
+            V1 = 1,
+            V2 = 2
+        };
+
+        // Manages the per task cgroups directly through the cgroup file system,
+        // both the v1 hierarchies (cpuset, cpuacct, memory, freezer) and the v2
+        // unified hierarchy are supported.
+        class CGroupController
+        {
+            public:
+                // The usage read by the task telemetry, the counters are cumulative.
+                typedef struct _Usage
+                {
+                    uint64_t CpuUsec = 0;
+                    uint64_t MemoryBytes = 0;
+                    uint64_t MemoryPeakBytes = 0;
+                    uint64_t IoReadBytes = 0;
+                    uint64_t IoWriteBytes = 0;
+                    uint32_t ProcessCount = 0;
+                } Usage;
+
+                static CGroupController& GetInstance()
+                {
+                    static CGroupController instance;
+                    return instance;
+                }
+
+                static std::string GetGroupName(const std::string& taskExecutionId)
+                {
+                    return GroupPrefix + taskExecutionId;
+                }
+
+                CGroupVersion GetVersion() const { return this->version; }
+                bool IsAvailable() const { return this->version != CGroupVersion::None; }
+
+                int Create(const std::string& groupName, const std::string& cpus);
+                int Freeze(const std::string& groupName, bool frozen);
+                int Kill(const std::string& groupName, bool forced);
+                // Waits until no process is left in the group or the group is removed,
+                // driven by the populated notifications of cgroup.events on v2 and by
+                // the pidfds of the member processes on v1. Returns 0 or ETIMEDOUT.
+                int WaitForEmpty(const std::string& groupName, int timeoutMs);
+                int GetStatistics(const std::string& groupName, hpc::data::ProcessStatistics& stat);
+
+                // Reads cpu, memory, io and pids of the group, the counters missing on
+                // this kernel are left 0. Returns 0 or the errno.
+                int GetUsage(const std::string& groupName, Usage& usage);
+                int Remove(const std::string& groupName);
+
+                std::vector<std::string> GetProcsFiles(const std::string& groupName) const;
+                std::vector<std::string> ListGroups() const;
+
+                // Only async-signal-safe calls, so it can be used between fork and exec.
+                static int Attach(const std::vector<std::string>& procsFiles, pid_t pid);
+
+                // Parse the flat keyed files, e.g. cpu.stat, and the io statistics of
+                // v2 and v1, the bytes of all the devices are added to the counters.
+                static bool ParseKeyValue(const std::string& content, const std::string& key, uint64_t& value);
+                static void ParseIoStat(const std::string& content, uint64_t& readBytes, uint64_t& writeBytes);
+                static void ParseBlkioStat(const std::string& content, uint64_t& readBytes, uint64_t& writeBytes);
+
+                static const std::string GroupPrefix;
+
+            protected:
+            private:
+                CGroupController();
+
+                std::string GetGroupPath(const std::string& subsystem, const std::string& groupName) const;
+                std::vector<std::string> GetGroupPaths(const std::string& groupName) const;
+                int ReadProcessIds(const std::string& groupName, std::vector<int>& pids) const;
+                bool WaitForState(const std::string& file, const std::string& key, const std::string& expected) const;
+
+                static int ReadFile(const std::string& path, std::string& content);
+                static int WriteFile(const std::string& path, const std::string& content);
+                static bool FileExists(const std::string& path);
+
+                static constexpr int MaxRetry = 3;
+                static constexpr int RetryIntervalMs = 500;
+                static constexpr int StateCheckCount = 20;
+                static constexpr int StateCheckIntervalMs = 100;
+
+                CGroupVersion version = CGroupVersion::None;
+
+                // v2 mount point of the unified hierarchy.
+                std::string unifiedRoot;
+
+                // v1 mount point of each subsystem.
+                std::map<std::string, std::string> hierarchies;
+        };
+    }
+}
+
+#endif // CGROUPCONTROLLER_H
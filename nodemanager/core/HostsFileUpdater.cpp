@@ -0,0 +1,282 @@
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+
+#include "HostsFileUpdater.h"
+#include "../utils/Logger.h"
+
+using namespace hpc::core;
+using namespace hpc::data;
+using namespace hpc::utils;
+
+int HostsFileUpdater::Update(const std::vector<HostEntry>& hostEntries, bool& changed)
+{
+    changed = false;
+
+    struct stat st = { };
+    if (stat(this->path.c_str(), &st) != 0 && errno != ENOENT)
+    {
+        return errno;
+    }
+
+    if (!this->IsLoaded(st))
+    {
+        int ret = this->Load();
+        if (ret != 0)
+        {
+            return ret;
+        }
+    }
+
+    std::unordered_set<std::string> keys;
+    keys.reserve(hostEntries.size());
+
+    size_t added = 0;
+    for (const auto& entry : hostEntries)
+    {
+        auto key = GetKey(entry.IPAddress, entry.HostName);
+        if (keys.insert(key).second && this->entries.find(key) == this->entries.end())
+        {
+            added++;
+        }
+    }
+
+    // the entries kept are the ones not added.
+    size_t removed = this->entries.size() - (keys.size() - added);
+
+    if (added == 0 && removed == 0)
+    {
+        Logger::Info("Hosts file manager: {0} HPC entries unchanged in {1}", keys.size(), this->path);
+        return 0;
+    }
+
+    std::string contents;
+    contents.reserve(this->unmanagedSize + hostEntries.size() * 64);
+
+    for (const auto& line : this->unmanagedLines)
+    {
+        contents.append(line).push_back('\n');
+    }
+
+    // the <NetworkType>.<NodeName> entries at the end.
+    for (const auto& entry : hostEntries)
+    {
+        if (entry.HostName.find('.') == std::string::npos)
+        {
+            AppendEntry(contents, entry);
+        }
+    }
+
+    for (const auto& entry : hostEntries)
+    {
+        if (entry.HostName.find('.') != std::string::npos)
+        {
+            AppendEntry(contents, entry);
+        }
+    }
+
+    int ret = this->Write(contents);
+    if (ret != 0)
+    {
+        // parse the file again next time.
+        this->loaded = false;
+        return ret;
+    }
+
+    this->entries.swap(keys);
+    changed = true;
+
+    Logger::Info("Hosts file manager: {0} HPC entries added, {1} removed, {2} in total in {3}",
+        added, removed, this->entries.size(), this->path);
+
+    return 0;
+}
+
+bool HostsFileUpdater::ParseEntry(const std::string& line, std::string& ipAddress, std::string& hostName)
+{
+    // ^([0-9\.]+)\s+([^\s#]+)\s+#HPC\s*$
+    const size_t size = line.size();
+    size_t i = 0;
+
+    auto isSpace = [&line](size_t i) { return isspace((unsigned char)line[i]) != 0; };
+
+    while (i < size && (isdigit((unsigned char)line[i]) || line[i] == '.')) i++;
+    size_t ipEnd = i;
+    if (ipEnd == 0 || i >= size || !isSpace(i)) return false;
+
+    while (i < size && isSpace(i)) i++;
+    size_t hostStart = i;
+    while (i < size && !isSpace(i) && line[i] != '#') i++;
+    size_t hostEnd = i;
+    if (hostEnd == hostStart || i >= size || !isSpace(i)) return false;
+
+    while (i < size && isSpace(i)) i++;
+    if (line.compare(i, 4, "#HPC") != 0) return false;
+
+    for (i += 4; i < size; i++)
+    {
+        if (!isSpace(i)) return false;
+    }
+
+    ipAddress.assign(line, 0, ipEnd);
+    hostName.assign(line, hostStart, hostEnd - hostStart);
+    return true;
+}
+
+int HostsFileUpdater::Load()
+{
+    this->loaded = false;
+    this->unmanagedLines.clear();
+    this->unmanagedSize = 0;
+    this->entries.clear();
+
+    errno = 0;
+    std::ifstream ifs(this->path, std::ios::in);
+    if (!ifs.is_open() && errno != ENOENT)
+    {
+        return errno != 0 ? errno : EIO;
+    }
+
+    std::string line, ipAddress, hostName;
+    size_t managed = 0;
+    while (getline(ifs, line))
+    {
+        if (ParseEntry(line, ipAddress, hostName))
+        {
+            this->entries.insert(GetKey(ipAddress, hostName));
+            managed++;
+        }
+        else
+        {
+            this->unmanagedSize += line.size() + 1;
+            this->unmanagedLines.push_back(std::move(line));
+        }
+    }
+
+    // duplicated entries make the file differ from what is written.
+    if (managed != this->entries.size())
+    {
+        this->entries.clear();
+    }
+
+    if (stat(this->path.c_str(), &this->loadedStat) != 0)
+    {
+        memset(&this->loadedStat, 0, sizeof(this->loadedStat));
+    }
+
+    Logger::Debug("Hosts file manager: loaded {0} lines and {1} HPC entries from {2}",
+        this->unmanagedLines.size(), managed, this->path);
+
+    this->loaded = true;
+    return 0;
+}
+
+int HostsFileUpdater::Write(const std::string& contents)
+{
+    struct stat st;
+    bool exists = stat(this->path.c_str(), &st) == 0;
+
+    // The readers see either the old or the new file.
+    std::string tempPath = this->path + ".XXXXXX";
+    int fd = mkostemp(&tempPath[0], O_CLOEXEC);
+    if (fd < 0)
+    {
+        return errno;
+    }
+
+    int ret = 0;
+    size_t written = 0;
+    while (ret == 0 && written < contents.size())
+    {
+        ssize_t n = write(fd, contents.data() + written, contents.size() - written);
+        if (n < 0 && errno != EINTR) { ret = errno; }
+        else if (n > 0) { written += n; }
+    }
+
+    if (ret == 0 && exists && (fchown(fd, st.st_uid, st.st_gid) != 0 || fchmod(fd, st.st_mode & 07777) != 0))
+    {
+        ret = errno;
+    }
+    else if (ret == 0 && !exists && fchmod(fd, 0644) != 0)
+    {
+        ret = errno;
+    }
+
+    if (ret == 0 && fsync(fd) != 0)
+    {
+        ret = errno;
+    }
+
+    close(fd);
+
+    if (ret == 0 && rename(tempPath.c_str(), this->path.c_str()) != 0)
+    {
+        ret = errno;
+    }
+
+    if (ret != 0)
+    {
+        unlink(tempPath.c_str());
+    }
+
+    // a bind mounted file, e.g. in a container, can only be written in place.
+    if (ret == EBUSY)
+    {
+        Logger::Warn("Hosts file manager: {0} can't be replaced, writing it in place", this->path);
+
+        ret = 0;
+        fd = open(this->path.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return errno;
+        }
+
+        written = 0;
+        while (ret == 0 && written < contents.size())
+        {
+            ssize_t n = write(fd, contents.data() + written, contents.size() - written);
+            if (n < 0 && errno != EINTR) { ret = errno; }
+            else if (n > 0) { written += n; }
+        }
+
+        close(fd);
+    }
+
+    if (ret == 0 && stat(this->path.c_str(), &this->loadedStat) != 0)
+    {
+        ret = errno;
+    }
+
+    return ret;
+}
+
+bool HostsFileUpdater::IsLoaded(const struct stat& st) const
+{
+    return this->loaded &&
+        st.st_ino == this->loadedStat.st_ino &&
+        st.st_size == this->loadedStat.st_size &&
+        st.st_mtim.tv_sec == this->loadedStat.st_mtim.tv_sec &&
+        st.st_mtim.tv_nsec == this->loadedStat.st_mtim.tv_nsec;
+}
+
+std::string HostsFileUpdater::GetKey(const std::string& ipAddress, const std::string& hostName)
+{
+    std::string key;
+    key.reserve(ipAddress.size() + hostName.size() + 1);
+    key.append(ipAddress).push_back(' ');
+    key.append(hostName);
+    return key;
+}
+
+void HostsFileUpdater::AppendEntry(std::string& contents, const HostEntry& entry)
+{
+    // left aligned in columns of 24 and 30, with a space at least before #HPC.
+    contents.append(entry.IPAddress);
+    contents.append(entry.IPAddress.size() < 24 ? 24 - entry.IPAddress.size() : 1, ' ');
+    contents.append(entry.HostName);
+    contents.append(entry.HostName.size() < 30 ? 30 - entry.HostName.size() : 1, ' ');
+    contents.append("#HPC\n");
+}
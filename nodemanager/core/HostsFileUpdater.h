@@ -0,0 +1,51 @@
+#ifndef HOSTSFILEUPDATER_H
+#define HOSTSFILEUPDATER_H
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <sys/stat.h>
+
+#include "../data/HostEntry.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        // Keeps the HPC entries of a hosts file, the lines ending with #HPC,
+        // in sync with the entries fetched. The entries written last are indexed,
+        // the file is only parsed again when it was changed by someone else, and
+        // it is replaced atomically only when the entries are added or removed.
+        class HostsFileUpdater
+        {
+            public:
+                HostsFileUpdater(const std::string& path) : path(path) { }
+
+                // Replaces the HPC entries by the entries, the other lines are kept.
+                // Returns 0 or the errno, changed is set when the file is written.
+                int Update(const std::vector<hpc::data::HostEntry>& hostEntries, bool& changed);
+
+                // Parses a line of "<ip> <host name> #HPC".
+                static bool ParseEntry(const std::string& line, std::string& ipAddress, std::string& hostName);
+
+            protected:
+            private:
+                int Load();
+                int Write(const std::string& contents);
+                bool IsLoaded(const struct stat& st) const;
+
+                static std::string GetKey(const std::string& ipAddress, const std::string& hostName);
+                static void AppendEntry(std::string& contents, const hpc::data::HostEntry& entry);
+
+                const std::string path;
+
+                bool loaded = false;
+                struct stat loadedStat;
+                std::vector<std::string> unmanagedLines;
+                size_t unmanagedSize = 0;
+                std::unordered_set<std::string> entries;
+        };
+    }
+}
+
+#endif // HOSTSFILEUPDATER_H
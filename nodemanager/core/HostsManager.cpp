@@ -1,9 +1,3 @@
-#include <iostream>
-#include <iterator>
-#include <regex>
-#include <list>
-#include <fstream>
-#include <iomanip>
 #include "HostsManager.h"
 #include "HttpHelper.h"
 
@@ -12,7 +6,7 @@ using namespace hpc::data;
 using namespace web::http;
 using namespace hpc::core;
 
-HostsManager::HostsManager(std::function<std::string(pplx::cancellation_token)> getHostsUri, int fetchInterval)
+HostsManager::HostsManager(std::function<std::string(pplx::cancellation_token)> getHostsUri, int fetchInterval) : hostsFileUpdater(HostsFilePath)
 {
     this->hostsFetcher =
         std::unique_ptr<HttpFetcher>(
@@ -36,7 +30,7 @@ HostsManager::HostsManager(std::function<std::string(pplx::cancellation_token)>
                 },
                 []()
                 {
-                    NamingClient::InvalidateCache();
+                    NamingClient::InvalidateCache(NodeManagerConfig::GetDefaultServiceName());
                 }));
 }
 
@@ -56,64 +50,31 @@ bool HostsManager::HostsResponseHandler(const http_response& response)
     std::string respUpdateId;
     if (HttpHelper::FindHeader(response, UpdateIdHeaderName, respUpdateId))
     {
-        this->updateId = respUpdateId;
         Logger::Info("Hosts file manager: hosts file update received with update Id {0}", respUpdateId);
         std::vector<HostEntry> hostEntries = JsonHelper<std::vector<HostEntry>>::FromJson(response.extract_json().get());
-        this->UpdateHostsFile(hostEntries);
+
+        // fetched again with the previous update Id when failed.
+        if (this->UpdateHostsFile(hostEntries))
+        {
+            this->updateId = respUpdateId;
+        }
+
         return true;
     }
 
     return false;
 }
 
-void HostsManager::UpdateHostsFile(const std::vector<HostEntry>& hostEntries)
+bool HostsManager::UpdateHostsFile(const std::vector<HostEntry>& hostEntries)
 {
     Logger::Info("Hosts file manager: update local hosts file {0}", HostsFilePath);
-    std::list<std::string> unmanagedLines;
-    std::ifstream ifs(HostsFilePath, std::ios::in);
-    std::string line;
-    while (getline(ifs, line))
-    {
-        std::regex entryRegex(HPCHostEntryPattern);
-        std::smatch entryMatch;
-        // Strip the original HPC entries
-        if(!std::regex_match(line, entryMatch, entryRegex))
-        {
-            unmanagedLines.push_back(line);
-        }
-        else
-        {
-            Logger::Debug("Strip the existing HPC host entry: ({0}, {1})", entryMatch[2], entryMatch[1]);
-        }
-    }
 
-    ifs.close();
-
-    std::ofstream ofs(HostsFilePath);
-    auto it = unmanagedLines.cbegin();
-    while(it != unmanagedLines.cend())
+    bool changed;
+    int ret = this->hostsFileUpdater.Update(hostEntries, changed);
+    if (ret != 0)
     {
-        ofs << *it++ << std::endl;
+        Logger::Error("Hosts file manager: failed to update {0}, errno {1}", HostsFilePath, ret);
     }
 
-    // Append the HPC entries at the end
-    // Make the <NetworkType>.<NodeName> entries at the end
-    for(std::size_t i=0; i<hostEntries.size(); i++)
-    {
-        if (hostEntries[i].HostName.find('.') == std::string::npos)
-        {
-            Logger::Debug("Add HPC host entry: ({0}, {1})", hostEntries[i].HostName, hostEntries[i].IPAddress);
-            ofs << std::left << std::setw(24) << hostEntries[i].IPAddress << std::setw(30) << hostEntries[i].HostName << "#HPC" << std::endl;
-        }
-    }
-    for(std::size_t i=0; i<hostEntries.size(); i++)
-    {
-        if (hostEntries[i].HostName.find('.') != std::string::npos)
-        {
-            Logger::Debug("Add HPC host entry: ({0}, {1})", hostEntries[i].HostName, hostEntries[i].IPAddress);
-            ofs << std::left << std::setw(24) << hostEntries[i].IPAddress << std::setw(30) << hostEntries[i].HostName << "#HPC" << std::endl;
-        }
-    }
-    ofs.close();
+    return ret == 0;
 }
-
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include "HttpFetcher.h"
+#include "HostsFileUpdater.h"
 #include "../data/HostEntry.h"
 
 namespace hpc
@@ -15,7 +16,6 @@ namespace hpc
         {
             public:
                 const std::string HostsFilePath = "/etc/hosts";
-                const std::string HPCHostEntryPattern = R"delimiter(^([0-9\.]+)\s+([^\s#]+)\s+#HPC\s*$)delimiter";
                 const std::string UpdateIdHeaderName = "UpdateId";
 
                 HostsManager(std::function<std::string(pplx::cancellation_token)> getHostsUri, int fetchInterval);
@@ -23,13 +23,15 @@ namespace hpc
 
                 void Start() { this->hostsFetcher->Start(); }
                 void Stop() { this->hostsFetcher->Stop(); }
+                void SetFetchInterval(int seconds) { this->hostsFetcher->SetInterval(seconds); }
 
             protected:
             private:
                 bool HostsResponseHandler(const http_response& response);
-                void UpdateHostsFile(const std::vector<hpc::data::HostEntry>& hostEntries);
+                bool UpdateHostsFile(const std::vector<hpc::data::HostEntry>& hostEntries);
                 std::string updateId;
                 std::unique_ptr<HttpFetcher> hostsFetcher;
+                HostsFileUpdater hostsFileUpdater;
         };
     }
 }
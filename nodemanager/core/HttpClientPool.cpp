@@ -0,0 +1,107 @@
+#include "HttpClientPool.h"
+#include "../utils/WriterLock.h"
+#include "../utils/ReaderLock.h"
+#include "../utils/Logger.h"
+
+using namespace hpc::core;
+using namespace hpc::utils;
+
+HttpClientPool::~HttpClientPool()
+{
+    pthread_rwlock_destroy(&this->lock);
+}
+
+std::shared_ptr<http::client::http_client> HttpClientPool::GetClient(
+    const std::string& origin,
+    std::function<std::shared_ptr<http::client::http_client>(const std::string&)> factory)
+{
+    time_t now = time(nullptr);
+
+    {
+        WriterLock writerLock(&this->lock);
+
+        auto it = this->clients.find(origin);
+        if (it != this->clients.end())
+        {
+            it->second.LastUsed = now;
+            this->statistics.Hits++;
+            return it->second.Client;
+        }
+    }
+
+    // Creating the client doesn't connect, it is done outside the lock anyway.
+    auto client = factory(origin);
+
+    WriterLock writerLock(&this->lock);
+
+    // Another thread may have added the same origin meanwhile, the first one wins.
+    auto it = this->clients.find(origin);
+    if (it != this->clients.end())
+    {
+        it->second.LastUsed = now;
+        this->statistics.Hits++;
+        return it->second.Client;
+    }
+
+    this->statistics.Misses++;
+    this->Evict(now);
+    this->clients[origin] = { client, now };
+
+    return client;
+}
+
+void HttpClientPool::Evict(time_t now)
+{
+    // The requests in flight hold their own reference of the client, releasing
+    // it here only closes the idle connections after they complete.
+    for (auto it = this->clients.begin(); it != this->clients.end();)
+    {
+        if (now - it->second.LastUsed > IdleSeconds)
+        {
+            Logger::Debug("HttpClientPool: release the idle client to {0}", it->first);
+            it = this->clients.erase(it);
+            this->statistics.Evictions++;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    while (this->clients.size() >= MaxClients)
+    {
+        auto oldest = this->clients.begin();
+        for (auto it = this->clients.begin(); it != this->clients.end(); ++it)
+        {
+            if (it->second.LastUsed < oldest->second.LastUsed)
+            {
+                oldest = it;
+            }
+        }
+
+        Logger::Debug("HttpClientPool: release the least recently used client to {0}", oldest->first);
+        this->clients.erase(oldest);
+        this->statistics.Evictions++;
+    }
+}
+
+HttpClientPool::Statistics HttpClientPool::GetStatistics()
+{
+    ReaderLock readerLock(&this->lock);
+
+    Statistics s = this->statistics;
+    s.Size = this->clients.size();
+    return s;
+}
+
+json::value HttpClientPool::GetStatisticsJson()
+{
+    auto s = this->GetStatistics();
+
+    json::value j;
+    j["Hits"] = json::value::number(s.Hits);
+    j["Misses"] = json::value::number(s.Misses);
+    j["Evictions"] = json::value::number(s.Evictions);
+    j["Size"] = json::value::number((uint64_t)s.Size);
+    return j;
+}
@@ -0,0 +1,68 @@
+#ifndef HTTPCLIENTPOOL_H
+#define HTTPCLIENTPOOL_H
+
+#include <map>
+#include <functional>
+#include <pthread.h>
+#include <cpprest/http_client.h>
+#include <cpprest/json.h>
+
+namespace hpc
+{
+    namespace core
+    {
+        using namespace web;
+
+        // Keeps one http_client per origin (scheme://host:port) so the keep-alive
+        // connections and their TLS sessions are reused among the requests, the
+        // clients idle for too long or exceeding the bound are released.
+        class HttpClientPool
+        {
+            public:
+                typedef struct _Statistics
+                {
+                    uint64_t Hits = 0;
+                    uint64_t Misses = 0;
+                    uint64_t Evictions = 0;
+                    size_t Size = 0;
+                } Statistics;
+
+                static HttpClientPool& GetInstance()
+                {
+                    static HttpClientPool instance;
+                    return instance;
+                }
+
+                ~HttpClientPool();
+
+                std::shared_ptr<http::client::http_client> GetClient(
+                    const std::string& origin,
+                    std::function<std::shared_ptr<http::client::http_client>(const std::string&)> factory);
+
+                Statistics GetStatistics();
+                json::value GetStatisticsJson();
+
+                static const size_t MaxClients = 32;
+                static const int IdleSeconds = 120;
+
+            protected:
+            private:
+                HttpClientPool() { }
+
+                void Evict(time_t now);
+
+                typedef struct _Entry
+                {
+                    std::shared_ptr<http::client::http_client> Client;
+                    time_t LastUsed;
+                } Entry;
+
+                std::map<std::string, Entry> clients;
+                Statistics statistics;
+
+                pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
+        };
+    }
+}
+
+#endif // HTTPCLIENTPOOL_H
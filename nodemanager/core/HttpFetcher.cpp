@@ -13,8 +13,6 @@ int HttpFetcher::Report()
     try
     {
         uri = this->getReportUri(this->cts.get_token());
-        auto client = HttpHelper::GetHttpClient(uri);
-
         auto request = HttpHelper::GetHttpRequest(methods::GET);
 
         if (this->requestHandler)
@@ -26,7 +24,7 @@ int HttpFetcher::Report()
             }
         }
 
-        http_response response = client->request(*request, this->cts.get_token()).get();
+        http_response response = HttpHelper::SendRequest(uri, *request, this->cts.get_token()).get();
         Logger::Debug("---------> Fetched from {0} response code {1}", uri, response.status_code());
 
         if (this->responseHandler)
@@ -5,6 +5,7 @@
 #include <boost/asio/ssl.hpp>
 
 #include "NodeManagerConfig.h"
+#include "HttpClientPool.h"
 
 namespace hpc
 {
@@ -67,7 +68,43 @@ namespace hpc
                     }
                 }
 
-                static std::shared_ptr<http::client::http_client> GetHttpClient(const std::string& uri)
+                // Sends the request through the pooled client of the uri's origin, the
+                // request uri is set to the path and query of the uri.
+                static pplx::task<http::http_response> SendRequest(
+                    const std::string& uri,
+                    http::http_request& request,
+                    pplx::cancellation_token token = pplx::cancellation_token::none())
+                {
+                    web::uri u(uri);
+                    auto client = HttpClientPool::GetInstance().GetClient(u.authority().to_string(), CreateHttpClient);
+                    request.set_request_uri(u.resource());
+                    return client->request(request, token);
+                }
+
+                static bool FindCallbackUri(http::http_request& request, std::string& uri)
+                {
+                    return FindHeader(request, CallbackUriKey, uri);
+                }
+
+                template <typename T>
+                static bool FindHeader(const T& message, const std::string& headerKey, std::string& header)
+                {
+                    auto h = message.headers().find(headerKey);
+                    if (h != message.headers().end())
+                    {
+                        header = h->second;
+                        return true;
+                    }
+
+                    return false;
+                }
+
+                static const std::string CallbackUriKey;
+
+                static const std::string AuthenticationHeaderKey;
+            protected:
+            private:
+                static std::shared_ptr<http::client::http_client> CreateHttpClient(const std::string& uri)
                 {
                     http::client::http_client_config config;
 
@@ -100,30 +137,6 @@ namespace hpc
 
                     return std::make_shared<http::client::http_client>(uri, config);
                 }
-
-                static bool FindCallbackUri(http::http_request& request, std::string& uri)
-                {
-                    return FindHeader(request, CallbackUriKey, uri);
-                }
-
-                template <typename T>
-                static bool FindHeader(const T& message, const std::string& headerKey, std::string& header)
-                {
-                    auto h = message.headers().find(headerKey);
-                    if (h != message.headers().end())
-                    {
-                        header = h->second;
-                        return true;
-                    }
-
-                    return false;
-                }
-
-                static const std::string CallbackUriKey;
-
-                static const std::string AuthenticationHeaderKey;
-            protected:
-            private:
         };
     }
 }
@@ -25,11 +25,9 @@ int HttpReporter::Report()
 
         Logger::Debug("---------> Report to {0} with {1}", uri, jsonBody);
 
-        auto client = HttpHelper::GetHttpClient(uri);
-
         auto request = HttpHelper::GetHttpRequest(methods::POST, jsonBody);
 
-        http_response response = client->request(*request, this->cts.get_token()).get();
+        http_response response = HttpHelper::SendRequest(uri, *request, this->cts.get_token()).get();
 
         auto str = response.extract_string().get();
         std::istringstream iss(str);
@@ -41,10 +39,15 @@ int HttpReporter::Report()
             this->intervalSeconds = milliseconds / 1000;
         }
 
-        Logger::Debug("---------> Reported to {0} response code {1}, value {2}, interval {3}", uri, response.status_code(), milliseconds, this->intervalSeconds);
+        Logger::Debug("---------> Reported to {0} response code {1}, value {2}, interval {3}", uri, response.status_code(), milliseconds, this->intervalSeconds.load());
 
         if (response.status_code() == http::status_codes::OK)
         {
+            if (this->onSuccess)
+            {
+                this->onSuccess();
+            }
+
             return 0;
         }
         else
@@ -22,8 +22,10 @@ namespace hpc
                     int hold,
                     int interval,
                     std::function<json::value()> fetcher,
-                    std::function<void()> onErrorFunc)
-                : Reporter<json::value>(reporterName, getUri, hold, interval, fetcher, onErrorFunc)
+                    std::function<void()> onErrorFunc,
+                    std::function<void()> onSuccessFunc = nullptr)
+                : Reporter<json::value>(reporterName, getUri, hold, interval, fetcher, onErrorFunc),
+                  onSuccess(onSuccessFunc)
                 {
                 }
 
@@ -37,6 +39,8 @@ namespace hpc
 
             protected:
             private:
+                // called when the report is accepted, e.g. to acknowledge a delta.
+                std::function<void()> onSuccess;
         };
     }
 }
@@ -3,10 +3,13 @@
 
 #include "../arguments/StartJobAndTaskArgs.h"
 #include "../arguments/StartTaskArgs.h"
+#include "../arguments/StartTasksArgs.h"
 #include "../arguments/EndJobArgs.h"
 #include "../arguments/EndTaskArgs.h"
 #include "../arguments/MetricCountersConfig.h"
 #include "../arguments/PeekTaskOutputArgs.h"
+#include "../arguments/TaskMetricsArgs.h"
+#include "../arguments/MetricHistoryArgs.h"
 
 namespace hpc
 {
@@ -17,12 +20,15 @@ namespace hpc
             public:
                 virtual pplx::task<web::json::value> StartJobAndTask(hpc::arguments::StartJobAndTaskArgs&& args, std::string&& callbackUri) = 0;
                 virtual pplx::task<web::json::value> StartTask(hpc::arguments::StartTaskArgs&& args, std::string&& callbackUri) = 0;
+                virtual pplx::task<web::json::value> StartTasks(hpc::arguments::StartTasksArgs&& args, std::string&& callbackUri) = 0;
                 virtual pplx::task<web::json::value> EndJob(hpc::arguments::EndJobArgs&& args) = 0;
                 virtual pplx::task<web::json::value> EndTask(hpc::arguments::EndTaskArgs&& args, std::string&& callbackUri) = 0;
                 virtual pplx::task<web::json::value> Ping(std::string&& callbackUri) = 0;
                 virtual pplx::task<web::json::value> Metric(std::string&& callbackUri) = 0;
                 virtual pplx::task<web::json::value> MetricConfig(hpc::arguments::MetricCountersConfig&& config, std::string&& callbackUri) = 0;
                 virtual pplx::task<web::json::value> PeekTaskOutput(hpc::arguments::PeekTaskOutputArgs&& args) = 0;
+                virtual pplx::task<web::json::value> TaskMetrics(hpc::arguments::TaskMetricsArgs&& args) = 0;
+                virtual pplx::task<web::json::value> MetricHistory(hpc::arguments::MetricHistoryArgs&& args) = 0;
         };
     }
 }
@@ -12,11 +12,186 @@ JobTaskTable* JobTaskTable::instance = nullptr;
 
 json::value JobTaskTable::ToJson()
 {
-    ReaderLock readerLock(&this->lock);
-    auto j = this->nodeInfo.ToJson();
+    NodeInfo snapshot;
+
+    {
+        WriterLock writerLock(&this->lock);
+        this->Snapshot(snapshot, true);
+    }
+
+    auto j = snapshot.ToJson();
     return std::move(j);
 }
 
+json::value JobTaskTable::ToDeltaJson()
+{
+    NodeInfo snapshot;
+    std::vector<int> removedJobs;
+    std::vector<std::pair<int, int>> removedTasks;
+    uint64_t baseVersion, currentVersion;
+    bool full;
+
+    {
+        WriterLock writerLock(&this->lock);
+
+        full = this->nodeInfo.JustStarted ||
+            this->overflowVersion > this->ackedVersion ||
+            this->reportsSinceSnapshot >= FullSnapshotInterval;
+
+        this->Snapshot(snapshot, full);
+
+        if (full)
+        {
+            this->reportsSinceSnapshot = 0;
+        }
+        else
+        {
+            this->reportsSinceSnapshot++;
+
+            for (auto c = this->changes.upper_bound(this->ackedVersion); c != this->changes.end(); c++)
+            {
+                const Change& change = c->second;
+                if (change.TaskId < 0)
+                {
+                    removedJobs.push_back(change.JobId);
+                }
+                else if (!change.Task)
+                {
+                    removedTasks.push_back(std::make_pair(change.JobId, change.TaskId));
+                }
+                else
+                {
+                    auto& job = snapshot.Jobs[change.JobId];
+                    if (!job)
+                    {
+                        job = std::shared_ptr<JobInfo>(new JobInfo(change.JobId));
+                    }
+
+                    job->Tasks[change.TaskId] = std::make_shared<TaskInfo>(*change.Task);
+                }
+            }
+        }
+
+        baseVersion = this->ackedVersion;
+        currentVersion = this->version;
+        this->reportedVersion = this->version;
+    }
+
+    auto j = snapshot.ToJson();
+    j["Delta"] = !full;
+    j["Version"] = json::value::number(currentVersion);
+
+    if (!full)
+    {
+        j["BaseVersion"] = json::value::number(baseVersion);
+
+        std::vector<json::value> jobs;
+        for (int jobId : removedJobs)
+        {
+            jobs.push_back(json::value::number(jobId));
+        }
+
+        std::vector<json::value> tasks;
+        for (const auto& t : removedTasks)
+        {
+            json::value task;
+            task["JobId"] = t.first;
+            task["TaskId"] = t.second;
+            tasks.push_back(task);
+        }
+
+        j["RemovedJobs"] = json::value::array(jobs);
+        j["RemovedTasks"] = json::value::array(tasks);
+    }
+
+    return std::move(j);
+}
+
+void JobTaskTable::AcknowledgeReport()
+{
+    WriterLock writerLock(&this->lock);
+
+    this->ackedVersion = this->reportedVersion;
+
+    auto end = this->changes.upper_bound(this->ackedVersion);
+    for (auto c = this->changes.begin(); c != end; c++)
+    {
+        this->changeVersions.erase(std::make_pair(c->second.JobId, c->second.TaskId));
+    }
+
+    this->changes.erase(this->changes.begin(), end);
+}
+
+void JobTaskTable::UpdateTask(const std::shared_ptr<TaskInfo>& task, const std::function<void(TaskInfo&)>& update)
+{
+    WriterLock writerLock(&this->lock);
+
+    update(*task);
+
+    // a task removed or replaced by a later attempt is not reported.
+    auto j = this->nodeInfo.Jobs.find(task->JobId);
+    if (j != this->nodeInfo.Jobs.end())
+    {
+        auto t = j->second->Tasks.find(task->TaskId);
+        if (t != j->second->Tasks.end() && t->second == task)
+        {
+            this->RecordChange(task->JobId, task->TaskId, task);
+        }
+    }
+}
+
+void JobTaskTable::Snapshot(NodeInfo& snapshot, bool withJobs)
+{
+    snapshot.Availability = this->nodeInfo.Availability;
+    snapshot.JustStarted = this->nodeInfo.JustStarted;
+    snapshot.MacAddress = this->nodeInfo.MacAddress;
+    snapshot.Name = this->nodeInfo.Name;
+
+    if (withJobs)
+    {
+        // the task maps and the tasks are modified in place, so both are copied.
+        for (const auto& job : this->nodeInfo.Jobs)
+        {
+            auto copy = std::shared_ptr<JobInfo>(new JobInfo(job.first));
+            for (const auto& task : job.second->Tasks)
+            {
+                copy->Tasks[task.first] = std::make_shared<TaskInfo>(*task.second);
+            }
+
+            snapshot.Jobs[job.first] = copy;
+        }
+    }
+
+    this->nodeInfo.JustStarted = false;
+}
+
+void JobTaskTable::RecordChange(int jobId, int taskId, std::shared_ptr<TaskInfo> task)
+{
+    this->EraseChange(jobId, taskId);
+
+    this->version++;
+    this->changes[this->version] = { jobId, taskId, task };
+    this->changeVersions[std::make_pair(jobId, taskId)] = this->version;
+
+    if (this->changes.size() > MaxChangeLogSize)
+    {
+        // the scheduler is not acknowledging, resync with a full snapshot instead.
+        this->changes.clear();
+        this->changeVersions.clear();
+        this->overflowVersion = this->version;
+    }
+}
+
+void JobTaskTable::EraseChange(int jobId, int taskId)
+{
+    auto v = this->changeVersions.find(std::make_pair(jobId, taskId));
+    if (v != this->changeVersions.end())
+    {
+        this->changes.erase(v->second);
+        this->changeVersions.erase(v);
+    }
+}
+
 int JobTaskTable::GetTaskCount()
 {
     ReaderLock readerLock(&this->lock);
@@ -30,36 +205,46 @@ int JobTaskTable::GetTaskCount()
 
 int JobTaskTable::GetCoresInUse()
 {
-    ReaderLock readerLock(&this->lock);
-
-    const uint64_t AllCores = 0xFFFFFFFFFFFFFFFF;
     int cores, sockets;
     System::CPU(cores, sockets);
 
-    uint64_t coresMask = 0;
-    for_each(this->nodeInfo.Jobs.begin(), this->nodeInfo.Jobs.end(), [&coresMask, cores, AllCores] (auto& i)
+    // bit i of Affinity[i / 64] stands for the core i.
+    const size_t words = (cores + 63) / 64;
+    std::vector<uint64_t> coresMask(words, 0);
+
     {
-        for_each(i.second->Tasks.begin(), i.second->Tasks.end(), [&coresMask, cores, AllCores] (auto& t)
+        ReaderLock readerLock(&this->lock);
+
+        for (const auto& job : this->nodeInfo.Jobs)
         {
-            if (t.second->Affinity.empty())
-            {
-                coresMask |= AllCores;
-            }
-            else
+            for (const auto& task : job.second->Tasks)
             {
-                coresMask |= t.second->Affinity[0];
+                const auto& affinity = task.second->Affinity;
+                if (affinity.empty())
+                {
+                    // no affinity means the task can use all the cores.
+                    return cores;
+                }
+
+                for (size_t i = 0; i < std::min(words, affinity.size()); i++)
+                {
+                    coresMask[i] |= affinity[i];
+                }
             }
-        });
-    });
+        }
+    }
 
     int used = 0;
-    int bit = 1;
-    for (int i = 0; i < cores; i++)
+    for (size_t i = 0; i < words; i++)
     {
-        if (coresMask & (bit << i))
+        uint64_t mask = coresMask[i];
+        int bits = cores - i * 64;
+        if (bits < 64)
         {
-            used++;
+            mask &= (UINT64_C(1) << bits) - 1;
         }
+
+        used += __builtin_popcountll(mask);
     }
 
     return used;
@@ -69,30 +254,49 @@ std::shared_ptr<TaskInfo> JobTaskTable::AddJobAndTask(int jobId, int taskId, boo
 {
     WriterLock writerLock(&this->lock);
 
-    std::shared_ptr<JobInfo> job;
-    auto j = this->nodeInfo.Jobs.find(jobId);
-    if (j == this->nodeInfo.Jobs.end())
-    {
-        job = std::shared_ptr<JobInfo>(new JobInfo(jobId));
-        this->nodeInfo.Jobs[jobId] = job;
-    }
-    else
+    auto job = this->GetOrAddJob(jobId);
+    return this->GetOrAddTask(*job, taskId, isNewEntry);
+}
+
+std::vector<std::shared_ptr<TaskInfo>> JobTaskTable::AddJobAndTasks(int jobId, const std::vector<int>& taskIds, std::vector<bool>& isNewEntries)
+{
+    std::vector<std::shared_ptr<TaskInfo>> tasks;
+    tasks.reserve(taskIds.size());
+    isNewEntries.assign(taskIds.size(), false);
+
+    WriterLock writerLock(&this->lock);
+
+    auto job = this->GetOrAddJob(jobId);
+    for (size_t i = 0; i < taskIds.size(); i++)
     {
-        job = j->second;
+        bool isNewEntry;
+        tasks.push_back(this->GetOrAddTask(*job, taskIds[i], isNewEntry));
+        isNewEntries[i] = isNewEntry;
     }
 
-    std::shared_ptr<TaskInfo> task;
-    auto t = job->Tasks.find(taskId);
-    if (t == job->Tasks.end())
+    return tasks;
+}
+
+std::shared_ptr<JobInfo> JobTaskTable::GetOrAddJob(int jobId)
+{
+    auto& job = this->nodeInfo.Jobs[jobId];
+    if (!job)
     {
-        task = std::shared_ptr<TaskInfo>(new TaskInfo(jobId, taskId, nodeInfo.Name));
-        job->Tasks[taskId] = task;
-        isNewEntry = true;
+        job = std::shared_ptr<JobInfo>(new JobInfo(jobId));
     }
-    else
+
+    return job;
+}
+
+std::shared_ptr<TaskInfo> JobTaskTable::GetOrAddTask(JobInfo& job, int taskId, bool& isNewEntry)
+{
+    auto& task = job.Tasks[taskId];
+    isNewEntry = !task;
+
+    if (isNewEntry)
     {
-        task = t->second;
-        isNewEntry = false;
+        task = std::shared_ptr<TaskInfo>(new TaskInfo(job.JobId, taskId, nodeInfo.Name));
+        this->RecordChange(job.JobId, taskId, task);
     }
 
     return task;
@@ -117,6 +321,24 @@ std::shared_ptr<TaskInfo> JobTaskTable::GetTask(int jobId, int taskId)
     return task;
 }
 
+std::vector<std::shared_ptr<TaskInfo>> JobTaskTable::GetTasks(int jobId)
+{
+    ReaderLock readerLock(&this->lock);
+
+    std::vector<std::shared_ptr<TaskInfo>> tasks;
+
+    auto j = this->nodeInfo.Jobs.find(jobId);
+    if (j != this->nodeInfo.Jobs.end())
+    {
+        for (const auto& t : j->second->Tasks)
+        {
+            tasks.push_back(t.second);
+        }
+    }
+
+    return tasks;
+}
+
 std::shared_ptr<JobInfo> JobTaskTable::RemoveJob(int jobId)
 {
     WriterLock writerLock(&this->lock);
@@ -127,6 +349,14 @@ std::shared_ptr<JobInfo> JobTaskTable::RemoveJob(int jobId)
     {
         job = j->second;
         this->nodeInfo.Jobs.erase(j);
+
+        // the removal of the job covers its tasks.
+        for (const auto& t : job->Tasks)
+        {
+            this->EraseChange(jobId, t.first);
+        }
+
+        this->RecordChange(jobId, -1, nullptr);
     }
 
     return job;
@@ -146,6 +376,7 @@ void JobTaskTable::RemoveTask(int jobId, int taskId, uint64_t attemptId)
             t->second->GetAttemptId() == attemptId)
         {
             j->second->Tasks.erase(t);
+            this->RecordChange(jobId, taskId, nullptr);
         }
     }
 }
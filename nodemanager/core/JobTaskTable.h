@@ -2,6 +2,9 @@
 #define JOBTASKTABLE_H
 
 #include <map>
+#include <utility>
+#include <vector>
+#include <functional>
 #include <cpprest/json.h>
 
 #include "../data/TaskInfo.h"
@@ -30,10 +33,29 @@ namespace hpc
                 web::json::value ToJson();
              //   web::json::value GetTaskJson(int jobId, int taskId) const;
 
+                // The tasks changed and removed since the last acknowledged report,
+                // the removals apply before the changed tasks. A full snapshot is sent
+                // every FullSnapshotInterval reports, on resync or when the change log
+                // overflowed.
+                web::json::value ToDeltaJson();
+
+                // The last report from ToDeltaJson was received.
+                void AcknowledgeReport();
+
+                // Changes the task under the lock the reports copy the tasks with,
+                // and records the change while the task is in the table.
+                void UpdateTask(const std::shared_ptr<hpc::data::TaskInfo>& task, const std::function<void(hpc::data::TaskInfo&)>& update);
+
                 std::shared_ptr<hpc::data::TaskInfo> AddJobAndTask(int jobId, int taskId, bool& isNewEntry);
+
+                // Adds the tasks of a job under one lock, so a report has all or none
+                // of them.
+                std::vector<std::shared_ptr<hpc::data::TaskInfo>> AddJobAndTasks(int jobId, const std::vector<int>& taskIds, std::vector<bool>& isNewEntries);
+
                 std::shared_ptr<hpc::data::JobInfo> RemoveJob(int jobId);
                 void RemoveTask(int jobId, int taskId, uint64_t attemptId);
                 std::shared_ptr<hpc::data::TaskInfo> GetTask(int jobId, int taskId);
+                std::vector<std::shared_ptr<hpc::data::TaskInfo>> GetTasks(int jobId);
                 int GetJobCount()
                 {
                     ReaderLock readerLock(&this->lock);
@@ -50,13 +72,45 @@ namespace hpc
                     this->nodeInfo.JustStarted = true;
                 }
 
+                static const int FullSnapshotInterval = 10;
+                static const size_t MaxChangeLogSize = 100000;
+
                 static JobTaskTable* GetInstance() { return JobTaskTable::instance; }
 
             protected:
             private:
+                // A null task means the task is removed, a task id -1 means the job is removed.
+                typedef struct _Change
+                {
+                    int JobId;
+                    int TaskId;
+                    std::shared_ptr<hpc::data::TaskInfo> Task;
+                } Change;
+
+                // The header of the node, the jobs and the tasks are copied under
+                // the lock, the json is built outside the lock.
+                void Snapshot(hpc::data::NodeInfo& snapshot, bool withJobs);
+
+                // Called under the writer lock.
+                std::shared_ptr<hpc::data::JobInfo> GetOrAddJob(int jobId);
+                std::shared_ptr<hpc::data::TaskInfo> GetOrAddTask(hpc::data::JobInfo& job, int taskId, bool& isNewEntry);
+                void RecordChange(int jobId, int taskId, std::shared_ptr<hpc::data::TaskInfo> task);
+                void EraseChange(int jobId, int taskId);
+
                 pthread_rwlock_t lock;
                 hpc::data::NodeInfo nodeInfo;
 
+                // The latest change of each task ordered by the version.
+                uint64_t version = 0;
+                std::map<uint64_t, Change> changes;
+                std::map<std::pair<int, int>, uint64_t> changeVersions;
+                // the version when the change log was dropped for the size.
+                uint64_t overflowVersion = 0;
+
+                uint64_t ackedVersion = 0;
+                uint64_t reportedVersion = 0;
+                int reportsSinceSnapshot = FullSnapshotInterval;
+
                 static JobTaskTable* instance;
         };
     }
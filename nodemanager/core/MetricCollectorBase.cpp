@@ -2,6 +2,8 @@
 
 using namespace hpc::core;
 
+std::atomic<uint64_t> MetricCollectorBase::ConfigGeneration(0);
+
 void MetricCollectorBase::ApplyConfig(const MetricCounter& config, pplx::cancellation_token token)
 {
     this->metricId = config.MetricId;
@@ -15,12 +17,12 @@ void MetricCollectorBase::ApplyConfig(const MetricCounter& config, pplx::cancell
 
             if (!instanceNames.empty())
             {
-                auto client = HttpHelper::GetHttpClient(NodeManagerConfig::ResolveMetricInstanceIdsUri(token));
+                auto uri = NodeManagerConfig::ResolveMetricInstanceIdsUri(token);
 
                 json::value jsonBody = JsonHelper<std::vector<std::string>>::ToJson(instanceNames);
                 auto request = HttpHelper::GetHttpRequest(web::http::methods::POST, jsonBody);
 
-                client->request(*request).then([instanceNames, this](pplx::task<web::http::http_response> t)
+                HttpHelper::SendRequest(uri, *request).then([instanceNames, this](pplx::task<web::http::http_response> t)
                 {
                     auto response = t.get().extract_json().then([instanceNames, this](pplx::task<json::value> t)
                     {
@@ -45,6 +47,8 @@ void MetricCollectorBase::ApplyConfig(const MetricCounter& config, pplx::cancell
 
                             this->enabled = true;
                         }
+
+                        ConfigGeneration++;
                     }).then([instanceNames](pplx::task<void> t)
                     {
                         try
@@ -65,7 +69,7 @@ void MetricCollectorBase::ApplyConfig(const MetricCounter& config, pplx::cancell
                     catch (const std::exception& ex)
                     {
                         Logger::Error("Error when query instance ids for {0}, ex {1}, resetting naming cache", String::Join<','>(instanceNames), ex.what());
-                        NamingClient::InvalidateCache();
+                        NamingClient::InvalidateCache(NodeManagerConfig::GetDefaultServiceName());
                     }
                 });
             }
@@ -77,6 +81,7 @@ void MetricCollectorBase::ApplyConfig(const MetricCounter& config, pplx::cancell
 
                 this->cachedInstanceIds[config.InstanceId] = config.InstanceName;
                 this->enabled = true;
+                ConfigGeneration++;
             }
         }
         catch (const std::exception& ex)
@@ -89,5 +94,33 @@ void MetricCollectorBase::ApplyConfig(const MetricCounter& config, pplx::cancell
         Logger::Debug("Config instance name {0}, instance id {1}", config.InstanceName, config.InstanceId);
         this->cachedInstanceIds[config.InstanceId] = config.InstanceName;
         this->enabled = true;
+        ConfigGeneration++;
+    }
+}
+
+void MetricCollectorBase::Compile(std::vector<PlanEntry>& plan)
+{
+    if (!this->enabled)
+    {
+        return;
+    }
+
+    this->compiledInstanceNames.clear();
+
+    for (const auto& i : this->cachedInstanceIds)
+    {
+        PlanEntry entry = { Umid(this->metricId, i.first), this->source, this, 0 };
+
+        if (this->indexedCollectFunc)
+        {
+            entry.Instance = (i.second.empty() || i.second == "_Total") ? -1 : String::ConvertTo<int>(i.second);
+        }
+        else if (!this->source)
+        {
+            entry.Instance = this->compiledInstanceNames.size();
+            this->compiledInstanceNames.push_back(i.second);
+        }
+
+        plan.push_back(entry);
     }
 }
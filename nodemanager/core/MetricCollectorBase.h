@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <map>
+#include <atomic>
 #include <cpprest/json.h>
 #include <cpprest/http_client.h>
 
@@ -20,11 +21,34 @@ namespace hpc
         class MetricCollectorBase
         {
             public:
+                // A counter compiled from the metric config, the value is read from the
+                // source when it is set, otherwise collected by the collector for the
+                // resolved instance.
+                typedef struct _PlanEntry
+                {
+                    Umid Id;
+                    const float* Source;
+                    MetricCollectorBase* Collector;
+                    int Instance;
+                } PlanEntry;
+
                 MetricCollectorBase(std::function<float(const std::string&)> collecter, std::function<std::vector<std::string>()> instanceNameQuerier = std::function<std::vector<std::string>()>())
                     : collectFunc(collecter), instanceNamesFunc(instanceNameQuerier)
                 {
                 }
 
+                // The instance names are resolved to the indexes when compiled, "_Total"
+                // or empty to -1.
+                MetricCollectorBase(std::function<float(int)> indexedCollecter, std::function<std::vector<std::string>()> instanceNameQuerier)
+                    : indexedCollectFunc(indexedCollecter), instanceNamesFunc(instanceNameQuerier)
+                {
+                }
+
+                // The value is kept up to date in the source by the sampling.
+                MetricCollectorBase(const float* source) : source(source)
+                {
+                }
+
                 MetricCollectorBase() = default;
 
                 void ApplyConfig(const MetricCounter& config, pplx::cancellation_token token);
@@ -33,33 +57,40 @@ namespace hpc
                 {
                     this->enabled = false;
                     this->cachedInstanceIds.clear();
+                    ConfigGeneration++;
                 }
 
                 bool IsInstanceLevelMetric() { return this->isInstanceLevelMetric; }
 
                 bool IsEnabled() const { return this->enabled; }
 
-                virtual std::vector<std::pair<float, Umid>> CollectValues()
-                {
-                    std::vector<std::pair<float, Umid>> results;
+                // Appends the enabled instances to the plan.
+                void Compile(std::vector<PlanEntry>& plan);
 
-                    std::transform(cachedInstanceIds.cbegin(), cachedInstanceIds.cend(), std::back_inserter(results), [this] (auto& i)
+                float Collect(int instance)
+                {
+                    if (this->indexedCollectFunc)
                     {
-                        return std::make_pair<float, Umid>(
-                            this->collectFunc(i.second),
-                            Umid(this->metricId, i.first));
-                    });
+                        return this->indexedCollectFunc(instance);
+                    }
 
-                    return std::move(results);
+                    return this->collectFunc(this->compiledInstanceNames[instance]);
                 }
 
+                // Changed when any collector is enabled, disabled or its instances changed,
+                // so the plan should be compiled again.
+                static std::atomic<uint64_t> ConfigGeneration;
+
             private:
                 uint16_t metricId;
                 bool enabled = false;
                 bool isInstanceLevelMetric = false;
+                const float* source = nullptr;
                 std::function<float(const std::string&)> collectFunc;
+                std::function<float(int)> indexedCollectFunc;
                 std::function<std::vector<std::string>()> instanceNamesFunc;
                 std::map<uint16_t, std::string> cachedInstanceIds;
+                std::vector<std::string> compiledInstanceNames;
         };
     }
 }
@@ -0,0 +1,427 @@
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MetricHistory.h"
+#include "../utils/Logger.h"
+#include "../utils/ReaderLock.h"
+#include "../utils/WriterLock.h"
+
+using namespace web;
+using namespace hpc::core;
+using namespace hpc::data;
+using namespace hpc::utils;
+
+const std::string MetricHistory::DefaultFilePath = "metrichistory.dat";
+
+// the raw values have one column, the rollups have three.
+const size_t MetricHistory::SeriesBytes =
+    sizeof(SeriesHeader) +
+    RawCapacity * (sizeof(uint32_t) + sizeof(float)) +
+    MinuteCapacity * (sizeof(uint32_t) + 3 * sizeof(float)) +
+    HourCapacity * (sizeof(uint32_t) + 3 * sizeof(float));
+
+namespace
+{
+    const size_t HeaderBytes = 4096;
+}
+
+MetricHistory::MetricHistory(const std::string& filePath) : filePath(filePath)
+{
+    int ret = this->Open();
+    if (ret != 0)
+    {
+        Logger::Warn("MetricHistory: failed to map {0} of {1} bytes, error {2}, the metric history is not kept", this->filePath, this->fileSize, ret);
+    }
+}
+
+MetricHistory::~MetricHistory()
+{
+    if (this->mapped != nullptr)
+    {
+        munmap(this->mapped, this->fileSize);
+    }
+
+    if (this->fd >= 0)
+    {
+        close(this->fd);
+    }
+
+    pthread_rwlock_destroy(&this->lock);
+}
+
+int MetricHistory::Open()
+{
+    this->fileSize = HeaderBytes + SeriesCapacity * SeriesBytes;
+
+    this->fd = open(this->filePath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (this->fd < 0)
+    {
+        return errno;
+    }
+
+    struct stat st;
+    if (fstat(this->fd, &st) != 0)
+    {
+        return errno;
+    }
+
+    bool created = (size_t)st.st_size != this->fileSize;
+    if (created && ftruncate(this->fd, 0) != 0)
+    {
+        return errno;
+    }
+
+    if (created && ftruncate(this->fd, this->fileSize) != 0)
+    {
+        return errno;
+    }
+
+    // the blocks are reserved up front, a page of the shared mapping without a
+    // block raises SIGBUS when the disk is full.
+    int ret = posix_fallocate(this->fd, 0, this->fileSize);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    void* p = mmap(nullptr, this->fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if (p == MAP_FAILED)
+    {
+        return errno;
+    }
+
+    this->mapped = static_cast<char*>(p);
+
+    FileHeader* header = reinterpret_cast<FileHeader*>(this->mapped);
+    if (header->Magic != Magic || header->Version != FileVersion ||
+        header->SeriesCapacity != SeriesCapacity || header->RawCapacity != RawCapacity ||
+        header->MinuteCapacity != MinuteCapacity || header->HourCapacity != HourCapacity ||
+        header->SeriesCount > SeriesCapacity)
+    {
+        this->Initialize();
+    }
+
+    for (uint32_t i = 0; i < header->SeriesCount; i++)
+    {
+        this->seriesIndexes[this->GetSeries(i)->Key] = i;
+    }
+
+    Logger::Info("MetricHistory: mapped {0}, {1} series kept", this->filePath, header->SeriesCount);
+
+    return 0;
+}
+
+void MetricHistory::Initialize()
+{
+    Logger::Info("MetricHistory: initializing {0}", this->filePath);
+
+    // the rings are found through the counts, only the headers are cleared.
+    FileHeader* header = reinterpret_cast<FileHeader*>(this->mapped);
+    header->Magic = 0;
+
+    for (uint32_t i = 0; i < SeriesCapacity; i++)
+    {
+        memset(this->GetSeries(i), 0, sizeof(SeriesHeader));
+    }
+
+    header->Version = FileVersion;
+    header->SeriesCapacity = SeriesCapacity;
+    header->RawCapacity = RawCapacity;
+    header->MinuteCapacity = MinuteCapacity;
+    header->HourCapacity = HourCapacity;
+    header->SeriesCount = 0;
+    header->Magic = Magic;
+}
+
+MetricHistory::SeriesHeader* MetricHistory::GetSeries(uint32_t index) const
+{
+    return reinterpret_cast<SeriesHeader*>(this->mapped + HeaderBytes + index * SeriesBytes);
+}
+
+MetricHistory::Ring MetricHistory::GetRing(uint32_t index, int resolution) const
+{
+    SeriesHeader* series = this->GetSeries(index);
+    char* p = reinterpret_cast<char*>(series) + sizeof(SeriesHeader);
+
+    Ring ring = { };
+
+    if (resolution == 1)
+    {
+        ring.Capacity = RawCapacity;
+        ring.Count = &series->RawCount;
+        ring.Times = reinterpret_cast<uint32_t*>(p);
+        ring.Min = reinterpret_cast<float*>(p + RawCapacity * sizeof(uint32_t));
+        return ring;
+    }
+
+    p += RawCapacity * (sizeof(uint32_t) + sizeof(float));
+    ring.Capacity = MinuteCapacity;
+    ring.Count = &series->MinuteCount;
+
+    if (resolution == 3600)
+    {
+        p += MinuteCapacity * (sizeof(uint32_t) + 3 * sizeof(float));
+        ring.Capacity = HourCapacity;
+        ring.Count = &series->HourCount;
+    }
+
+    ring.Times = reinterpret_cast<uint32_t*>(p);
+    ring.Min = reinterpret_cast<float*>(p + ring.Capacity * sizeof(uint32_t));
+    ring.Max = ring.Min + ring.Capacity;
+    ring.Avg = ring.Max + ring.Capacity;
+
+    return ring;
+}
+
+int MetricHistory::FindOrAddSeries(uint32_t key)
+{
+    auto it = this->seriesIndexes.find(key);
+    if (it != this->seriesIndexes.end())
+    {
+        return it->second;
+    }
+
+    FileHeader* header = reinterpret_cast<FileHeader*>(this->mapped);
+    if (header->SeriesCount >= SeriesCapacity)
+    {
+        if (!this->fullWarned)
+        {
+            Logger::Warn("MetricHistory: {0} series are kept already, the history of the other counters is not kept", (int)SeriesCapacity);
+            this->fullWarned = true;
+        }
+
+        return -1;
+    }
+
+    uint32_t index = header->SeriesCount;
+    SeriesHeader* series = this->GetSeries(index);
+    memset(series, 0, sizeof(SeriesHeader));
+    series->Key = key;
+
+    // the series is visible after its header is written.
+    header->SeriesCount = index + 1;
+    this->seriesIndexes[key] = index;
+
+    return index;
+}
+
+void MetricHistory::Append(time_t time, const std::vector<std::pair<float, Umid>>& values)
+{
+    if (!this->IsOpen())
+    {
+        return;
+    }
+
+    WriterLock writerLock(&this->lock);
+
+    uint32_t t = (uint32_t)time;
+
+    for (const auto& value : values)
+    {
+        int index = this->FindOrAddSeries(GetKey(value.second));
+        if (index < 0)
+        {
+            continue;
+        }
+
+        SeriesHeader* series = this->GetSeries(index);
+        Push(this->GetRing(index, 1), t, value.first, value.first, value.first);
+
+        Accumulate(series->Minute, t - t % 60, value.first, this->GetRing(index, 60));
+        Accumulate(series->Hour, t - t % 3600, value.first, this->GetRing(index, 3600));
+    }
+}
+
+void MetricHistory::Accumulate(Accumulator& accumulator, uint32_t start, float value, const Ring& ring)
+{
+    // a period is written to the ring when the next one starts.
+    if (accumulator.Count > 0 && accumulator.Start != start)
+    {
+        Push(ring, accumulator.Start, accumulator.Min, accumulator.Max, (float)(accumulator.Sum / accumulator.Count));
+        accumulator.Count = 0;
+    }
+
+    if (accumulator.Count == 0)
+    {
+        accumulator.Start = start;
+        accumulator.Min = value;
+        accumulator.Max = value;
+        accumulator.Sum = 0.0;
+    }
+
+    accumulator.Min = std::min(accumulator.Min, value);
+    accumulator.Max = std::max(accumulator.Max, value);
+    accumulator.Sum += value;
+    accumulator.Count++;
+}
+
+void MetricHistory::Push(const Ring& ring, uint32_t time, float min, float max, float avg)
+{
+    uint64_t count = *ring.Count;
+    uint32_t position = count % ring.Capacity;
+
+    ring.Times[position] = time;
+    ring.Min[position] = min;
+    if (ring.Max) { ring.Max[position] = max; }
+    if (ring.Avg) { ring.Avg[position] = avg; }
+
+    *ring.Count = count + 1;
+}
+
+json::value MetricHistory::Query(int metricId, int instanceId, time_t from, time_t to, int resolution, size_t maxPoints)
+{
+    if (resolution == 0)
+    {
+        time_t age = time(nullptr) - from;
+        resolution = age <= (time_t)RawCapacity ? 1 : age <= (time_t)MinuteCapacity * 60 ? 60 : 3600;
+    }
+
+    if (resolution != 1 && resolution != 60 && resolution != 3600)
+    {
+        throw std::runtime_error("The resolution must be 1, 60 or 3600 seconds.");
+    }
+
+    std::vector<json::value> seriesJson;
+
+    if (this->IsOpen())
+    {
+        ReaderLock readerLock(&this->lock);
+
+        FileHeader* header = reinterpret_cast<FileHeader*>(this->mapped);
+        for (uint32_t i = 0; i < header->SeriesCount; i++)
+        {
+            SeriesHeader* series = this->GetSeries(i);
+            if ((series->Key >> 16) != (uint32_t)metricId || (instanceId >= 0 && (series->Key & 0xFFFF) != (uint32_t)instanceId))
+            {
+                continue;
+            }
+
+            // the latest points in the range when more than maxPoints.
+            Ring ring = this->GetRing(i, resolution);
+            uint64_t count = *ring.Count;
+            uint64_t begin = count > ring.Capacity ? count - ring.Capacity : 0;
+
+            std::vector<Point> points;
+            for (uint64_t p = count; p > begin && points.size() < maxPoints; p--)
+            {
+                uint32_t position = (p - 1) % ring.Capacity;
+                time_t t = ring.Times[position];
+                if (t < from) break;
+                if (t > to) continue;
+
+                points.push_back({
+                    ring.Times[position],
+                    ring.Min[position],
+                    ring.Max ? ring.Max[position] : ring.Min[position],
+                    ring.Avg ? ring.Avg[position] : ring.Min[position] });
+            }
+
+            std::reverse(points.begin(), points.end());
+
+            json::value j;
+            j["MetricId"] = (int)(series->Key >> 16);
+            j["InstanceId"] = (int)(series->Key & 0xFFFF);
+            j["Ranges"] = EncodeRanges(points);
+
+            if (resolution == 1)
+            {
+                j["Values"] = json::value::string(Encode(points, &Point::Avg));
+            }
+            else
+            {
+                j["Min"] = json::value::string(Encode(points, &Point::Min));
+                j["Max"] = json::value::string(Encode(points, &Point::Max));
+                j["Avg"] = json::value::string(Encode(points, &Point::Avg));
+            }
+
+            seriesJson.push_back(std::move(j));
+        }
+    }
+
+    json::value result;
+    result["Resolution"] = resolution;
+    result["Encoding"] = json::value::string("xor-varint-base64");
+    result["Series"] = json::value::array(seriesJson);
+
+    return result;
+}
+
+json::value MetricHistory::EncodeRanges(const std::vector<Point>& points)
+{
+    // the times as runs of an even step, a gap starts a new run.
+    std::vector<json::value> ranges;
+
+    size_t i = 0;
+    while (i < points.size())
+    {
+        uint32_t start = points[i].Time;
+        uint32_t step = i + 1 < points.size() ? points[i + 1].Time - start : 0;
+        size_t count = 1;
+
+        while (i + count < points.size() && points[i + count].Time - points[i + count - 1].Time == step)
+        {
+            count++;
+        }
+
+        json::value range;
+        range["Start"] = start;
+        range["Step"] = count > 1 ? step : 0;
+        range["Count"] = (uint32_t)count;
+        ranges.push_back(std::move(range));
+
+        i += count;
+    }
+
+    return json::value::array(ranges);
+}
+
+std::string MetricHistory::Encode(const std::vector<Point>& points, float Point::*column)
+{
+    // each value xor the previous one as a varint. The close values share the
+    // high bits, the round values share the zero low bits, which the varint
+    // drops when the bits are reversed, so both orders are tried and the first
+    // byte tells the order taken. A repeated value takes one byte.
+    auto reverse = [](uint32_t x)
+    {
+        x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+        x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+        x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+        return __builtin_bswap32(x);
+    };
+
+    std::vector<unsigned char> encoded[2];
+
+    for (int reversed = 0; reversed < 2; reversed++)
+    {
+        auto& bytes = encoded[reversed];
+        bytes.reserve(points.size() * 2 + 1);
+        bytes.push_back((unsigned char)reversed);
+
+        uint32_t previous = 0;
+        for (const auto& point : points)
+        {
+            uint32_t bits;
+            memcpy(&bits, &(point.*column), sizeof(bits));
+
+            uint32_t x = bits ^ previous;
+            previous = bits;
+
+            if (reversed) { x = reverse(x); }
+
+            while (x >= 0x80)
+            {
+                bytes.push_back((unsigned char)(x | 0x80));
+                x >>= 7;
+            }
+
+            bytes.push_back((unsigned char)x);
+        }
+    }
+
+    return utility::conversions::to_base64(encoded[encoded[1].size() < encoded[0].size() ? 1 : 0]);
+}
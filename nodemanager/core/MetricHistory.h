@@ -0,0 +1,130 @@
+#ifndef METRICHISTORY_H
+#define METRICHISTORY_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <pthread.h>
+#include <cpprest/json.h>
+
+#include "../data/Umid.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        // The history of the sampled metric values kept in a fixed size file
+        // mapped in memory, so it survives a restart of the node manager. Each
+        // UMID has a ring of the raw values and rings of the 1 minute and 1 hour
+        // rollups (min, max and avg), the columns of a ring are stored apart.
+        // The head node backfills the values lost in the UDP reports from it.
+        class MetricHistory
+        {
+            public:
+                MetricHistory(const std::string& filePath);
+                ~MetricHistory();
+
+                bool IsOpen() const { return this->mapped != nullptr; }
+
+                // Appends the values sampled at the time, in seconds since epoch.
+                void Append(time_t time, const std::vector<std::pair<float, hpc::data::Umid>>& values);
+
+                // The values of the metric in [from, to] at the resolution in seconds,
+                // 1, 60 or 3600, all the instances when instanceId is negative. The
+                // finest resolution covering from is used when resolution is 0.
+                web::json::value Query(int metricId, int instanceId, time_t from, time_t to, int resolution, size_t maxPoints);
+
+                static const std::string DefaultFilePath;
+
+                static const uint32_t SeriesCapacity = 256;
+                static const uint32_t RawCapacity = 3600;
+                static const uint32_t MinuteCapacity = 1440;
+                static const uint32_t HourCapacity = 720;
+
+            protected:
+            private:
+                typedef struct _FileHeader
+                {
+                    uint32_t Magic;
+                    uint32_t Version;
+                    uint32_t SeriesCapacity;
+                    uint32_t RawCapacity;
+                    uint32_t MinuteCapacity;
+                    uint32_t HourCapacity;
+                    uint32_t SeriesCount;
+                    uint32_t Reserved;
+                } FileHeader;
+
+                // The rollup of the period in progress.
+                typedef struct _Accumulator
+                {
+                    uint32_t Start;
+                    uint32_t Count;
+                    float Min;
+                    float Max;
+                    double Sum;
+                } Accumulator;
+
+                typedef struct _SeriesHeader
+                {
+                    uint32_t Key;
+                    uint32_t Reserved;
+                    uint64_t RawCount;
+                    uint64_t MinuteCount;
+                    uint64_t HourCount;
+                    Accumulator Minute;
+                    Accumulator Hour;
+                } SeriesHeader;
+
+                // The columns of a ring in the file, Max and Avg are null for the raw
+                // values, which are in Min.
+                typedef struct _Ring
+                {
+                    uint32_t Capacity;
+                    uint64_t* Count;
+                    uint32_t* Times;
+                    float* Min;
+                    float* Max;
+                    float* Avg;
+                } Ring;
+
+                typedef struct _Point
+                {
+                    uint32_t Time;
+                    float Min;
+                    float Max;
+                    float Avg;
+                } Point;
+
+                int Open();
+                void Initialize();
+
+                SeriesHeader* GetSeries(uint32_t index) const;
+                Ring GetRing(uint32_t index, int resolution) const;
+                int FindOrAddSeries(uint32_t key);
+
+                static void Accumulate(Accumulator& accumulator, uint32_t start, float value, const Ring& ring);
+                static void Push(const Ring& ring, uint32_t time, float min, float max, float avg);
+                static std::string Encode(const std::vector<Point>& points, float Point::*column);
+                static web::json::value EncodeRanges(const std::vector<Point>& points);
+
+                static uint32_t GetKey(const hpc::data::Umid& umid) { return ((uint32_t)umid.MetricId << 16) | umid.InstanceId; }
+
+                static const size_t SeriesBytes;
+                static const uint32_t Magic = 0x4D484E48;
+                static const uint32_t FileVersion = 1;
+
+                const std::string filePath;
+                int fd = -1;
+                size_t fileSize = 0;
+                char* mapped = nullptr;
+
+                std::unordered_map<uint32_t, uint32_t> seriesIndexes;
+                bool fullWarned = false;
+
+                pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
+        };
+    }
+}
+
+#endif // METRICHISTORY_H
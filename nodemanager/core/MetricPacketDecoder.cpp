@@ -0,0 +1,150 @@
+#include <errno.h>
+#include <string.h>
+
+#include "MetricPacketDecoder.h"
+#include "MetricPacketEncoder.h"
+
+using namespace hpc::core;
+using namespace hpc::data;
+
+int MetricPacketDecoder::Decode(const unsigned char* data, size_t size, MetricPacket& packet)
+{
+    if (size < MetricPacketEncoder::HeaderBytes ||
+        (int32_t)ReadUInt32(data) != MetricPacketEncoder::Version)
+    {
+        return EINVAL;
+    }
+
+    uint32_t sequence = ReadUInt32(data + 20);
+    uint32_t baseSequence = ReadUInt32(data + 24);
+    uint16_t fragmentIndex = ReadUInt16(data + 28);
+    uint16_t fragmentCount = ReadUInt16(data + 30);
+    uint16_t count = ReadUInt16(data + 34);
+
+    if (sequence == 0 || fragmentIndex >= fragmentCount)
+    {
+        return EINVAL;
+    }
+
+    if (baseSequence != 0 && baseSequence != this->lastSequence)
+    {
+        return ENODATA;
+    }
+
+    if (this->pending.size() >= MaxPendingPackets && this->pending.find(sequence) == this->pending.end())
+    {
+        this->pending.erase(this->pending.begin());
+    }
+
+    auto& pendingPacket = this->pending[sequence];
+    if (pendingPacket.Fragments.empty())
+    {
+        static const int uuidOrder[16] = { 3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15 };
+        for (int i = 0; i < 16; i++)
+        {
+            pendingPacket.Packet.Uuid.data[uuidOrder[i]] = data[4 + i];
+        }
+
+        pendingPacket.Packet.Sequence = sequence;
+        pendingPacket.Packet.TickCount = ReadUInt16(data + 32);
+        pendingPacket.FragmentCount = fragmentCount;
+    }
+
+    if (pendingPacket.Fragments.find(fragmentIndex) != pendingPacket.Fragments.end())
+    {
+        // a duplicated datagram.
+        return EAGAIN;
+    }
+
+    std::vector<std::pair<float, Umid>> values;
+
+    const unsigned char* p = data + MetricPacketEncoder::HeaderBytes;
+    const unsigned char* end = data + size;
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint32_t metricId, instanceId, bits;
+        if (!ReadVarint(p, end, metricId) || !ReadVarint(p, end, instanceId) || !ReadVarint(p, end, bits) ||
+            metricId > UINT16_MAX || instanceId > UINT16_MAX)
+        {
+            if (pendingPacket.Fragments.empty())
+            {
+                this->pending.erase(sequence);
+            }
+
+            return EINVAL;
+        }
+
+        if (baseSequence != 0)
+        {
+            auto previous = this->previousValues.find((metricId << 16) | instanceId);
+            if (previous != this->previousValues.end())
+            {
+                bits ^= previous->second;
+            }
+        }
+
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        values.push_back(std::make_pair(value, Umid(metricId, instanceId)));
+    }
+
+    pendingPacket.Fragments[fragmentIndex] = std::move(values);
+    if (pendingPacket.Fragments.size() < pendingPacket.FragmentCount)
+    {
+        return EAGAIN;
+    }
+
+    packet = std::move(pendingPacket.Packet);
+    for (auto& f : pendingPacket.Fragments)
+    {
+        packet.Values.insert(packet.Values.end(), f.second.begin(), f.second.end());
+    }
+
+    this->previousValues.clear();
+    for (const auto& v : packet.Values)
+    {
+        uint32_t bits;
+        memcpy(&bits, &v.first, sizeof(bits));
+        this->previousValues[((uint32_t)v.second.MetricId << 16) | v.second.InstanceId] = bits;
+    }
+
+    this->lastSequence = sequence;
+
+    // the incomplete packets before this one are lost.
+    this->pending.erase(this->pending.begin(), this->pending.upper_bound(sequence));
+
+    return 0;
+}
+
+bool MetricPacketDecoder::ReadVarint(const unsigned char*& p, const unsigned char* end, uint32_t& value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 35 && p < end; shift += 7)
+    {
+        unsigned char b = *p++;
+        value |= (uint32_t)(b & 0x7F) << shift;
+
+        if (!(b & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t MetricPacketDecoder::ReadUInt32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint16_t MetricPacketDecoder::ReadUInt16(const unsigned char* p)
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
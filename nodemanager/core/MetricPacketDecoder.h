@@ -0,0 +1,49 @@
+#ifndef METRICPACKETDECODER_H
+#define METRICPACKETDECODER_H
+
+#include <map>
+#include <vector>
+
+#include "../data/MetricPacket.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        // Reassembles and decodes the v2 packets of MetricPacketEncoder.
+        class MetricPacketDecoder
+        {
+            public:
+                MetricPacketDecoder() { }
+
+                // Returns 0 with the packet when its last fragment arrived, EAGAIN when
+                // more fragments are expected, ENODATA when the base packet was not
+                // decoded so the packet is dropped until the next key packet, or
+                // EINVAL for a malformed datagram.
+                int Decode(const unsigned char* data, size_t size, hpc::data::MetricPacket& packet);
+
+                static const size_t MaxPendingPackets = 16;
+
+            protected:
+            private:
+                typedef struct _PendingPacket
+                {
+                    uint16_t FragmentCount;
+                    // the values by the fragment index.
+                    std::map<uint16_t, std::vector<std::pair<float, hpc::data::Umid>>> Fragments;
+                    hpc::data::MetricPacket Packet;
+                } PendingPacket;
+
+                static bool ReadVarint(const unsigned char*& p, const unsigned char* end, uint32_t& value);
+
+                static uint32_t ReadUInt32(const unsigned char* p);
+                static uint16_t ReadUInt16(const unsigned char* p);
+
+                uint32_t lastSequence = 0;
+                std::map<uint32_t, uint32_t> previousValues;
+                std::map<uint32_t, PendingPacket> pending;
+        };
+    }
+}
+
+#endif // METRICPACKETDECODER_H
@@ -0,0 +1,140 @@
+#include <string.h>
+
+#include "MetricPacketEncoder.h"
+
+using namespace hpc::core;
+using namespace hpc::data;
+
+MetricPacketEncoder::MetricPacketEncoder(size_t maxDatagramBytes, int keyPacketInterval) :
+    maxDatagramBytes(maxDatagramBytes), keyPacketInterval(keyPacketInterval)
+{
+}
+
+void MetricPacketEncoder::Encode(MetricPacket& packet, std::vector<std::vector<unsigned char>>& datagrams)
+{
+    size_t count = packet.Values.size();
+
+    // the umids moved when the plan changed, the values are sent whole then.
+    bool isKey = this->packetsSinceKey == 0 || count != this->previousValues.size();
+    for (size_t i = 0; !isKey && i < count; i++)
+    {
+        isKey = this->previousValues[i].first != GetKey(packet.Values[i].second);
+    }
+
+    this->packetsSinceKey = ((isKey ? 0 : this->packetsSinceKey) + 1) % this->keyPacketInterval;
+
+    uint32_t baseSequence = isKey ? 0 : this->sequence;
+    if (++this->sequence == 0) { this->sequence++; }
+    packet.Sequence = this->sequence;
+
+    this->previousValues.resize(count);
+
+    size_t fragments = 0;
+    uint16_t fragmentValues = 0;
+    this->StartFragment(datagrams, fragments, fragmentValues, packet, baseSequence);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const auto& v = packet.Values[i];
+        uint32_t bits;
+        memcpy(&bits, &v.first, sizeof(bits));
+
+        uint32_t delta = isKey ? bits : bits ^ this->previousValues[i].second;
+        size_t bytes = VarintBytes(v.second.MetricId) + VarintBytes(v.second.InstanceId) + VarintBytes(delta);
+
+        if (datagrams[fragments - 1].size() + bytes > this->maxDatagramBytes || fragmentValues == UINT16_MAX)
+        {
+            this->StartFragment(datagrams, fragments, fragmentValues, packet, baseSequence);
+        }
+
+        auto& datagram = datagrams[fragments - 1];
+        WriteVarint(datagram, v.second.MetricId);
+        WriteVarint(datagram, v.second.InstanceId);
+        WriteVarint(datagram, delta);
+        fragmentValues++;
+
+        this->previousValues[i] = std::make_pair(GetKey(v.second), bits);
+    }
+
+    memcpy(&datagrams[fragments - 1][34], &fragmentValues, sizeof(fragmentValues));
+
+    datagrams.resize(fragments);
+
+    uint16_t fragmentCount = fragments;
+    for (auto& datagram : datagrams)
+    {
+        memcpy(&datagram[30], &fragmentCount, sizeof(fragmentCount));
+    }
+}
+
+void MetricPacketEncoder::StartFragment(
+    std::vector<std::vector<unsigned char>>& datagrams,
+    size_t& fragments,
+    uint16_t& fragmentValues,
+    const MetricPacket& packet,
+    uint32_t baseSequence)
+{
+    if (fragments > 0)
+    {
+        memcpy(&datagrams[fragments - 1][34], &fragmentValues, sizeof(fragmentValues));
+    }
+
+    if (fragments == datagrams.size())
+    {
+        datagrams.emplace_back();
+        datagrams.back().reserve(this->maxDatagramBytes);
+    }
+
+    WriteHeader(datagrams[fragments], packet, baseSequence, fragments);
+    fragments++;
+    fragmentValues = 0;
+}
+
+void MetricPacketEncoder::WriteHeader(
+    std::vector<unsigned char>& datagram,
+    const MetricPacket& packet,
+    uint32_t baseSequence,
+    uint16_t fragmentIndex)
+{
+    datagram.resize(HeaderBytes);
+    unsigned char* p = &datagram[0];
+
+    int32_t version = Version;
+    memcpy(p, &version, 4);
+
+    // the same layout as the Guid of the v1 packet.
+    static const int uuidOrder[16] = { 3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15 };
+    for (int i = 0; i < 16; i++)
+    {
+        p[4 + i] = packet.Uuid.data[uuidOrder[i]];
+    }
+
+    uint16_t tickCount = packet.TickCount;
+    memcpy(p + 20, &packet.Sequence, 4);
+    memcpy(p + 24, &baseSequence, 4);
+    memcpy(p + 28, &fragmentIndex, 2);
+    memcpy(p + 32, &tickCount, 2);
+}
+
+void MetricPacketEncoder::WriteVarint(std::vector<unsigned char>& buffer, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+
+    buffer.push_back(value);
+}
+
+size_t MetricPacketEncoder::VarintBytes(uint32_t value)
+{
+    size_t bytes = 1;
+    while (value >= 0x80)
+    {
+        bytes++;
+        value >>= 7;
+    }
+
+    return bytes;
+}
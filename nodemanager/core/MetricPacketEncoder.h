@@ -0,0 +1,71 @@
+#ifndef METRICPACKETENCODER_H
+#define METRICPACKETENCODER_H
+
+#include <vector>
+
+#include "../data/MetricPacket.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        // Encodes the metric packets in the v2 format, one or more datagrams of:
+        //   int32  Version, 2
+        //   16     Uuid, in the byte order of the v1 packet
+        //   uint32 Sequence, starting from 1
+        //   uint32 BaseSequence, the packet the values are relative to, 0 for a key packet
+        //   uint16 FragmentIndex
+        //   uint16 FragmentCount
+        //   uint16 TickCount
+        //   uint16 Count, of the values in this fragment
+        // followed by the values as varints of MetricId, InstanceId and the bits of
+        // the float xor the bits of the same umid in the base packet, 0 when absent.
+        // The integers of the header are little endian. Every KeyPacketInterval
+        // packets is a key packet, so a receiver recovers from the lost datagrams.
+        class MetricPacketEncoder
+        {
+            public:
+                MetricPacketEncoder(size_t maxDatagramBytes = DefaultMaxDatagramBytes, int keyPacketInterval = DefaultKeyPacketInterval);
+
+                // Assigns the sequence of the packet. The datagrams are written over the
+                // ones of the last call, so their buffers are reused between ticks.
+                void Encode(hpc::data::MetricPacket& packet, std::vector<std::vector<unsigned char>>& datagrams);
+
+                static const int Version = 2;
+                static const size_t HeaderBytes = 36;
+                static const size_t DefaultMaxDatagramBytes = 1024;
+                static const int DefaultKeyPacketInterval = 10;
+
+            protected:
+            private:
+                void StartFragment(
+                    std::vector<std::vector<unsigned char>>& datagrams,
+                    size_t& fragments,
+                    uint16_t& fragmentValues,
+                    const hpc::data::MetricPacket& packet,
+                    uint32_t baseSequence);
+
+                static void WriteHeader(
+                    std::vector<unsigned char>& datagram,
+                    const hpc::data::MetricPacket& packet,
+                    uint32_t baseSequence,
+                    uint16_t fragmentIndex);
+
+                static void WriteVarint(std::vector<unsigned char>& buffer, uint32_t value);
+                static size_t VarintBytes(uint32_t value);
+
+                static uint32_t GetKey(const hpc::data::Umid& umid) { return ((uint32_t)umid.MetricId << 16) | umid.InstanceId; }
+
+                const size_t maxDatagramBytes;
+                const int keyPacketInterval;
+
+                uint32_t sequence = 0;
+                int packetsSinceKey = 0;
+                // the umid and the float bits of the last packet by position, a packet
+                // with other umids in the positions is encoded as a key packet.
+                std::vector<std::pair<uint32_t, uint32_t>> previousValues;
+        };
+    }
+}
+
+#endif // METRICPACKETENCODER_H
@@ -1,4 +1,7 @@
 #include <pthread.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 #include <boost/range/algorithm.hpp>
 #include <boost/range/adaptors.hpp>
 #include <boost/phoenix.hpp>
@@ -8,6 +11,7 @@
 #include "../utils/WriterLock.h"
 #include "../utils/Logger.h"
 #include "../utils/System.h"
+#include "../utils/MetricSampler.h"
 #include "JobTaskTable.h"
 #include "NodeManagerConfig.h"
 
@@ -21,12 +25,30 @@ Monitor::Monitor(const std::string& nodeName, const std::string& netName, int in
     : name(nodeName), networkName(netName), lock(PTHREAD_RWLOCK_INITIALIZER), intervalSeconds(interval),
     isCollected(false)
 {
+    try
+    {
+        this->packetVersion = NodeManagerConfig::GetMetricPacketVersion();
+    }
+    catch (...)
+    {
+        Logger::Info("MetricPacketVersion not specified or invalid, use the default version {0}.", this->packetVersion);
+    }
+
+    if (this->packetVersion != 1 && this->packetVersion != MetricPacketEncoder::Version)
+    {
+        Logger::Warn("MetricPacketVersion {0} is not supported, use the version 1.", this->packetVersion);
+        this->packetVersion = 1;
+    }
+
     if (NodeManagerConfig::GetMetricDisabled())
     {
         Logger::Debug("MetricDisabled = true, skip initializing the monitor.");
         return;
     }
 
+    std::string historyFile = NodeManagerConfig::GetMetricHistoryFile();
+    this->history = std::unique_ptr<MetricHistory>(new MetricHistory(historyFile.empty() ? MetricHistory::DefaultFilePath : historyFile));
+
     std::get<0>(this->metricData[1]) = 1;
     std::get<0>(this->metricData[3]) = 0;
     std::get<0>(this->metricData[12]) = 1;
@@ -52,20 +74,9 @@ Monitor::Monitor(const std::string& nodeName, const std::string& netName, int in
         }
     });
 
-    this->collectors["\\Memory\\Pages/sec"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
-    {
-        return this->pagesPerSec;
-    });
-
-    this->collectors["\\Memory\\Available MBytes"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
-    {
-        return std::get<1>(this->metricData[3]);
-    });
-
-    this->collectors["\\System\\Context switches/sec"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
-    {
-        return this->contextSwitchesPerSec;
-    });
+    this->collectors["\\Memory\\Pages/sec"] = std::make_shared<MetricCollectorBase>(&this->pagesPerSec);
+    this->collectors["\\Memory\\Available MBytes"] = std::make_shared<MetricCollectorBase>(&std::get<1>(this->metricData[3]));
+    this->collectors["\\System\\Context switches/sec"] = std::make_shared<MetricCollectorBase>(&this->contextSwitchesPerSec);
 
     this->collectors["\\System\\System Calls/sec"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
     {
@@ -161,16 +172,15 @@ Monitor::Monitor(const std::string& nodeName, const std::string& netName, int in
 
     if (this->gpuInitRet == 0)
     {
-        this->collectors["\\GPU\\GPU Time (%)"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
+        this->collectors["\\GPU\\GPU Time (%)"] = std::make_shared<MetricCollectorBase>([this] (int index)
         {
-            if (instanceName == "_Total" || instanceName.empty())
+            if (index < 0)
             {
                 return this->gpuInfo.GetGpuUtilization();
             }
             else
             {
-                auto index = String::ConvertTo<size_t>(instanceName);
-                if (index >= 0 && index < this->gpuInfo.GpuInfos.size())
+                if ((size_t)index < this->gpuInfo.GpuInfos.size())
                 {
                     float v = this->gpuInfo.GpuInfos[index].GpuUtilization;
                     //Logger::Debug("\\GPU\\GPU Time (%), for index {0} is {1}", index, v);
@@ -178,7 +188,7 @@ Monitor::Monitor(const std::string& nodeName, const std::string& netName, int in
                 }
                 else
                 {
-                    Logger::Warn("Collect \\GPU\\GPU Time (%) for instance {0}, index {1}, invalid index", instanceName, index);
+                    Logger::Warn("Collect \\GPU\\GPU Time (%) for index {0}, invalid index", index);
                     return 0.0f;
                 }
             }
@@ -188,22 +198,21 @@ Monitor::Monitor(const std::string& nodeName, const std::string& netName, int in
             return this->gpuInfo.GetGpuInstanceNames();
         });
 
-        this->collectors["\\GPU\\GPU Fan Speed (%)"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
+        this->collectors["\\GPU\\GPU Fan Speed (%)"] = std::make_shared<MetricCollectorBase>([this] (int index)
         {
-            if (instanceName == "_Total" || instanceName.empty())
+            if (index < 0)
             {
                 return this->gpuInfo.GetFanPercentage();
             }
             else
             {
-                auto index = String::ConvertTo<size_t>(instanceName);
-                if (index >= 0 && index < this->gpuInfo.GpuInfos.size())
+                if ((size_t)index < this->gpuInfo.GpuInfos.size())
                 {
                     return this->gpuInfo.GpuInfos[index].FanPercentage;
                 }
                 else
                 {
-                    Logger::Warn("Collect \\GPU\\GPU Fan Speed (%) for instance {0}, index {1}, invalid index", instanceName, index);
+                    Logger::Warn("Collect \\GPU\\GPU Fan Speed (%) for index {0}, invalid index", index);
                     return 0.0f;
                 }
             }
@@ -213,22 +222,21 @@ Monitor::Monitor(const std::string& nodeName, const std::string& netName, int in
             return this->gpuInfo.GetGpuInstanceNames();
         });
 
-        this->collectors["\\GPU\\GPU Memory Usage (%)"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
+        this->collectors["\\GPU\\GPU Memory Usage (%)"] = std::make_shared<MetricCollectorBase>([this] (int index)
         {
-            if (instanceName == "_Total" || instanceName.empty())
+            if (index < 0)
             {
                 return this->gpuInfo.GetUsedMemoryPercentage();
             }
             else
             {
-                auto index = String::ConvertTo<size_t>(instanceName);
-                if (index >= 0 && index < this->gpuInfo.GpuInfos.size())
+                if ((size_t)index < this->gpuInfo.GpuInfos.size())
                 {
                     return this->gpuInfo.GpuInfos[index].GetUsedMemoryPercentage();
                 }
                 else
                 {
-                    Logger::Warn("Collect \\GPU\\GPU Memory Usage (%) for instance {0}, index {1}, invalid index", instanceName, index);
+                    Logger::Warn("Collect \\GPU\\GPU Memory Usage (%) for index {0}, invalid index", index);
                     return 0.0f;
                 }
             }
@@ -238,23 +246,22 @@ Monitor::Monitor(const std::string& nodeName, const std::string& netName, int in
             return this->gpuInfo.GetGpuInstanceNames();
         });
 
-        this->collectors["\\GPU\\GPU Memory Used (MB)"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
+        this->collectors["\\GPU\\GPU Memory Used (MB)"] = std::make_shared<MetricCollectorBase>([this] (int index)
         {
-            if (instanceName == "_Total" || instanceName.empty())
+            if (index < 0)
             {
                 // Get GPU Time;
                 return this->gpuInfo.GetUsedMemoryMB();
             }
             else
             {
-                auto index = String::ConvertTo<size_t>(instanceName);
-                if (index >= 0 && index < this->gpuInfo.GpuInfos.size())
+                if ((size_t)index < this->gpuInfo.GpuInfos.size())
                 {
                     return this->gpuInfo.GpuInfos[index].UsedMemoryMB;
                 }
                 else
                 {
-                    Logger::Warn("Collect \\GPU\\GPU Memory Used (MB) for instance {0}, index {1}, invalid index", instanceName, index);
+                    Logger::Warn("Collect \\GPU\\GPU Memory Used (MB) for index {0}, invalid index", index);
                     return 0.0f;
                 }
             }
@@ -264,22 +271,21 @@ Monitor::Monitor(const std::string& nodeName, const std::string& netName, int in
             return this->gpuInfo.GetGpuInstanceNames();
         });
 
-        this->collectors["\\GPU\\GPU Power Usage (Watts)"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
+        this->collectors["\\GPU\\GPU Power Usage (Watts)"] = std::make_shared<MetricCollectorBase>([this] (int index)
         {
-            if (instanceName == "_Total" || instanceName.empty())
+            if (index < 0)
             {
                 return this->gpuInfo.GetPowerWatt();
             }
             else
             {
-                auto index = String::ConvertTo<size_t>(instanceName);
-                if (index >= 0 && index < this->gpuInfo.GpuInfos.size())
+                if ((size_t)index < this->gpuInfo.GpuInfos.size())
                 {
                     return this->gpuInfo.GpuInfos[index].PowerWatt;
                 }
                 else
                 {
-                    Logger::Warn("Collect \\GPU\\GPU Power Usage (Watts) for instance {0}, index {1}, invalid index", instanceName, index);
+                    Logger::Warn("Collect \\GPU\\GPU Power Usage (Watts) for index {0}, invalid index", index);
                     return 0.0f;
                 }
             }
@@ -289,23 +295,22 @@ Monitor::Monitor(const std::string& nodeName, const std::string& netName, int in
             return this->gpuInfo.GetGpuInstanceNames();
         });
 
-        this->collectors["\\GPU\\GPU SM Clock (MHz)"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
+        this->collectors["\\GPU\\GPU SM Clock (MHz)"] = std::make_shared<MetricCollectorBase>([this] (int index)
         {
-            if (instanceName == "_Total" || instanceName.empty())
+            if (index < 0)
             {
                 // Get GPU Time;
                 return this->gpuInfo.GetCurrentSMClock();
             }
             else
             {
-                auto index = String::ConvertTo<size_t>(instanceName);
-                if (index >= 0 && index < this->gpuInfo.GpuInfos.size())
+                if ((size_t)index < this->gpuInfo.GpuInfos.size())
                 {
                     return this->gpuInfo.GpuInfos[index].CurrentSMClock;
                 }
                 else
                 {
-                    Logger::Warn("Collect \\GPU\\GPU SM Clock (MHz) for instance {0}, index {1}, invalid index", instanceName, index);
+                    Logger::Warn("Collect \\GPU\\GPU SM Clock (MHz) for index {0}, invalid index", index);
                     return 0.0f;
                 }
             }
@@ -315,23 +320,22 @@ Monitor::Monitor(const std::string& nodeName, const std::string& netName, int in
             return this->gpuInfo.GetGpuInstanceNames();
         });
 
-        this->collectors["\\GPU\\GPU Temperature (degrees C)"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
+        this->collectors["\\GPU\\GPU Temperature (degrees C)"] = std::make_shared<MetricCollectorBase>([this] (int index)
         {
-            if (instanceName == "_Total" || instanceName.empty())
+            if (index < 0)
             {
                 // Get GPU Time;
                 return this->gpuInfo.GetTemperature();
             }
             else
             {
-                auto index = String::ConvertTo<size_t>(instanceName);
-                if (index >= 0 && index < this->gpuInfo.GpuInfos.size())
+                if ((size_t)index < this->gpuInfo.GpuInfos.size())
                 {
                     return this->gpuInfo.GpuInfos[index].Temperature;
                 }
                 else
                 {
-                    Logger::Warn("Collect \\GPU\\GPU Temperature for instance {0}, index {1}, invalid index", instanceName, index);
+                    Logger::Warn("Collect \\GPU\\GPU Temperature for index {0}, invalid index", index);
                     return 0.0f;
                 }
             }
@@ -355,12 +359,18 @@ Monitor::~Monitor()
         pthread_join(this->threadId, nullptr);
     }
 
+    if (this->netlinkSocket >= 0)
+    {
+        close(this->netlinkSocket);
+    }
+
     pthread_rwlock_destroy(&this->lock);
 }
 
 void Monitor::SetNodeUuid(const uuid& id)
 {
     this->packet.Uuid.AssignFrom(id);
+    this->metricPacket.Uuid = id;
 }
 
 void Monitor::ApplyMetricConfig(MetricCountersConfig&& config, pplx::cancellation_token token)
@@ -394,56 +404,136 @@ bool Monitor::EnableMetricCounter(const MetricCounter& counterConfig, pplx::canc
     return false;
 }
 
-std::vector<unsigned char> Monitor::GetMonitorPacketData()
+void Monitor::GetMonitorPacketData(std::vector<std::vector<unsigned char>>& datagrams)
 {
     const size_t MaxPacketSize = 1024;
-    std::vector<unsigned char> packetData(MaxPacketSize);
 
-    ReaderLock readerLock(&this->lock);
+    // The plan, the packets and the encoder state are changed here too.
+    WriterLock writerLock(&this->lock);
 
-    if (this->isCollected)
+    if (!this->isCollected)
     {
-       // this->packet.Count = std::count_if(this->collectors.begin(), this->collectors.end(), [] (auto& kvp) { return kvp.second->IsEnabled(); });
-        this->packet.TickCount = this->intervalSeconds;
-        for (int i = 0; i < MaxCountersInPacket; i++)
+        datagrams.resize(this->packetVersion == 1 ? 1 : 0);
+        if (this->packetVersion == 1)
         {
-            this->packet.Umids[i] = Umid(0, 0);
-            this->packet.Values[i] = 0.0f;
+            datagrams[0].assign(MaxPacketSize, 0);
         }
 
-        int p = 0;
+        return;
+    }
 
-        if (NodeManagerConfig::GetDebug())
+    uint64_t generation = MetricCollectorBase::ConfigGeneration;
+    if (generation != this->planGeneration)
+    {
+        this->CompilePlan();
+        this->planGeneration = generation;
+    }
+
+    size_t count = this->plan.size();
+
+    if (this->packetVersion == MetricPacketEncoder::Version)
+    {
+        // the values are written in place, the vector keeps its capacity.
+        auto& values = this->metricPacket.Values;
+        values.resize(count);
+
+        for (size_t p = 0; p < count; p++)
         {
-            Logger::Debug("Start get package data");
+            const auto& entry = this->plan[p];
+            values[p].first = entry.Source ? *entry.Source : entry.Collector->Collect(entry.Instance);
+            values[p].second = entry.Id;
         }
 
-        for (auto& c : this->collectors)
-        {
-            if (c.second->IsEnabled())
-            {
-                auto values = c.second->CollectValues();
+        this->metricPacket.TickCount = this->intervalSeconds;
+        this->packetEncoder.Encode(this->metricPacket, datagrams);
 
-                for (auto& v : values)
-                {
-                    if (NodeManagerConfig::GetDebug())
-                    {
-                        Logger::Debug("Report p={0}, value={1}, metricId={2}, instanceId={3}", p, v.first, v.second.MetricId, v.second.InstanceId);
-                    }
-
-                    this->packet.Umids[p] = v.second;
-                    this->packet.Values[p] = v.first;
-                    p ++;
-                }
-            }
-        }
+        return;
+    }
+
+    // The v1 packet has a fixed number of slots.
+    if (count > (size_t)MaxCountersInPacket && !this->packetTruncated)
+    {
+        Logger::Warn("{0} counters are enabled, only the first {1} are reported in the version 1 packet, set MetricPacketVersion to 2 to report all.",
+            count, (int)MaxCountersInPacket);
+    }
+
+    this->packetTruncated = count > (size_t)MaxCountersInPacket;
 
-        this->packet.Count = p;
+    int p = std::min(count, (size_t)MaxCountersInPacket);
+    for (int i = 0; i < p; i++)
+    {
+        const auto& entry = this->plan[i];
+        this->packet.Umids[i] = entry.Id;
+        this->packet.Values[i] = entry.Source ? *entry.Source : entry.Collector->Collect(entry.Instance);
+    }
 
-        memcpy(&packetData[0], &this->packet, std::min(sizeof(this->packet), MaxPacketSize));
+    // only the slots used by the last packet need to be cleared.
+    for (int i = p; i < this->packetCount; i++)
+    {
+        this->packet.Umids[i] = Umid(0, 0);
+        this->packet.Values[i] = 0.0f;
     }
 
-    return std::move(packetData);
+    this->packetCount = p;
+    this->packet.TickCount = this->intervalSeconds;
+    this->packet.Count = p;
+
+    datagrams.resize(1);
+    datagrams[0].assign(MaxPacketSize, 0);
+    memcpy(&datagrams[0][0], &this->packet, std::min(sizeof(this->packet), MaxPacketSize));
+}
+
+json::value Monitor::QueryMetricHistory(const MetricHistoryArgs& args)
+{
+    if (!this->history)
+    {
+        throw std::runtime_error("The metric history is not kept, the metric is disabled.");
+    }
+
+    return this->history->Query(args.MetricId, args.InstanceId, args.From, args.To, args.Resolution, args.MaxPoints > 0 ? args.MaxPoints : (int)MetricHistoryArgs::DefaultMaxPoints);
+}
+
+void Monitor::AppendHistory(time_t time)
+{
+    uint64_t generation = MetricCollectorBase::ConfigGeneration;
+    if (generation != this->planGeneration)
+    {
+        this->CompilePlan();
+        this->planGeneration = generation;
+    }
+
+    // every enabled counter is kept, whether or how the values are reported.
+    size_t count = this->plan.size();
+    this->historyValues.resize(count);
+
+    for (size_t p = 0; p < count; p++)
+    {
+        const auto& entry = this->plan[p];
+        this->historyValues[p].first = entry.Source ? *entry.Source : entry.Collector->Collect(entry.Instance);
+        this->historyValues[p].second = entry.Id;
+    }
+
+    this->history->Append(time, this->historyValues);
+}
+
+void Monitor::CompilePlan()
+{
+    this->plan.clear();
+
+    for (auto& c : this->collectors)
+    {
+        c.second->Compile(this->plan);
+    }
+
+    Logger::Info("Compiled {0} metric counters of {1} collectors", this->plan.size(), this->collectors.size());
+
+    if (NodeManagerConfig::GetDebug())
+    {
+        for (size_t p = 0; p < this->plan.size(); p++)
+        {
+            Logger::Debug("Report p={0}, metricId={1}, instanceId={2}", p, this->plan[p].Id.MetricId, this->plan[p].Id.InstanceId);
+        }
+    }
 }
 
 json::value Monitor::GetRegisterInfo()
@@ -455,9 +545,16 @@ json::value Monitor::GetRegisterInfo()
         return json::value::null();
     }
 
+    json::value j = this->registerInfo;
+    j["Time"] = json::value::string(this->metricTime);
+
+    return std::move(j);
+}
+
+void Monitor::BuildRegisterInfo()
+{
     json::value j;
     j["NodeName"] = json::value::string(this->name);
-    j["Time"] = json::value::string(this->metricTime);
 
     j["IpAddress"] = json::value::string(this->ipAddress);
     j["CoreCount"] = this->coreCount;
@@ -498,61 +595,158 @@ json::value Monitor::GetRegisterInfo()
 
     j["GpuInfo"] = json::value::array(gpuValues);
 
-    return std::move(j);
+    this->registerInfo = std::move(j);
 }
 
-void Monitor::Run()
+bool Monitor::CollectNetworkInventory()
 {
-    uint64_t cpuLast = 0, idleLast = 0, networkLast = 0;
+    std::string ipAddress = System::GetIpAddress(IpAddressVersion::V4, this->networkName);
+    auto netInfo = System::GetNetworkInfo();
 
-    while (true)
+    WriterLock writerLock(&this->lock);
+
+    if (ipAddress == this->ipAddress && netInfo == this->networkInfo)
     {
-        time_t t;
-        time(&t);
+        return false;
+    }
+
+    Logger::Info("Network inventory changed, ip address {0}, {1} network interfaces", ipAddress, netInfo.size());
+    this->ipAddress = ipAddress;
+    this->networkInfo = std::move(netInfo);
+
+    return true;
+}
+
+bool Monitor::CollectCpuInventory()
+{
+    int cores, sockets;
+    System::CPU(cores, sockets);
+
+    WriterLock writerLock(&this->lock);
+
+    if (cores == this->coreCount && sockets == this->socketCount)
+    {
+        return false;
+    }
+
+    Logger::Info("CPU inventory changed, cores {0}, sockets {1}", cores, sockets);
+    this->coreCount = cores;
+    this->socketCount = sockets;
+
+    return true;
+}
+
+bool Monitor::CollectDistroInventory()
+{
+    const std::string& distro = System::GetDistroInfo();
+
+    WriterLock writerLock(&this->lock);
+
+    if (distro == this->distroInfo)
+    {
+        return false;
+    }
+
+    this->distroInfo = distro;
+
+    return true;
+}
+
+void Monitor::OpenNetlinkSocket()
+{
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0)
+    {
+        Logger::Warn("Failed to open the netlink socket, errno {0}, network changes are detected every {1} seconds", errno, (int)NetworkInventoryPeriodSeconds);
+        return;
+    }
+
+    sockaddr_nl address = {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0)
+    {
+        Logger::Warn("Failed to bind the netlink socket, errno {0}, network changes are detected every {1} seconds", errno, (int)NetworkInventoryPeriodSeconds);
+        close(fd);
+        return;
+    }
 
-        uint64_t cpuCurrent = cpuLast + 1, idleCurrent = idleLast;
+    this->netlinkSocket = fd;
+}
 
-        System::CPUUsage(cpuCurrent, idleCurrent);
-        uint64_t totalDiff = cpuCurrent - cpuLast;
-        uint64_t idleDiff = idleCurrent - idleLast;
-        float cpuUsage = (float)(100.0f * (totalDiff - idleDiff) / totalDiff);
-        cpuLast = cpuCurrent;
-        idleLast = idleCurrent;
+bool Monitor::HasNetworkChanged()
+{
+    if (this->netlinkSocket < 0)
+    {
+        return false;
+    }
 
-        uint64_t available, total;
-        System::Memory(available, total);
-        float availableMemoryMb = (float)available / 1024.0f;
-        float totalMemoryMb = (float)total / 1024.0f;
+    // Any link or address notification triggers a full re-collection, so only drain them.
+    bool changed = false;
+    char buffer[4096];
+    while (recv(this->netlinkSocket, buffer, sizeof(buffer), 0) > 0)
+    {
+        changed = true;
+    }
+
+    // the notifications overflowed the socket buffer.
+    return changed || errno == ENOBUFS;
+}
+
+void Monitor::Run()
+{
+    MetricSampler sampler(this->networkName);
 
-        float freeSpacePercent = 0.0f, queueLength = 0.0f, pagesPerSec = 0.0f, contextSwitchesPerSec = 0.0f, bytesPerSecond = 0.0f;
-        System::FreeSpace(freeSpacePercent);
-        System::IostatX(queueLength);
-        System::Vmstat(pagesPerSec, contextSwitchesPerSec);
-        System::Iostat(bytesPerSecond);
+    this->OpenNetlinkSocket();
+
+    std::vector<SamplingSource> sources =
+    {
+        { "Network", NetworkInventoryPeriodSeconds, [this]() { return this->CollectNetworkInventory(); }, 0 },
+        { "CPU", CpuInventoryPeriodSeconds, [this]() { return this->CollectCpuInventory(); }, 0 },
+        { "Distro", DistroInventoryPeriodSeconds, [this]() { return this->CollectDistroInventory(); }, 0 },
+    };
+
+    SamplingSource& networkSource = sources[0];
+
+    auto isSameGpu = [](const System::GpuInfo& a, const System::GpuInfo& b)
+    {
+        return a.Name == b.Name && a.Uuid == b.Uuid && a.PciBusId == b.PciBusId &&
+            a.TotalMemoryMB == b.TotalMemoryMB && a.MaxSMClock == b.MaxSMClock;
+    };
+
+    while (true)
+    {
+        time_t t;
+        time(&t);
 
-        uint64_t networkCurrent = 0;
-        int ret = System::NetworkUsage(networkCurrent, this->networkName);
+        MetricSampler::Sample sample;
+        int ret = sampler.Collect(sample);
 
         if (ret != 0)
         {
-            Logger::Error("Error occurred while collecting network usage {0}", ret);
+            Logger::Error("Error occurred while collecting metrics {0}", ret);
         }
 
-        float networkUsage = (float)(networkCurrent - networkLast) / this->intervalSeconds;
-        networkLast = networkCurrent;
-
-        // ip address;
-        std::string ipAddress = System::GetIpAddress(IpAddressVersion::V4, this->networkName);
-
-        // cpu type;
-        int cores, sockets;
-        System::CPU(cores, sockets);
+        if (this->HasNetworkChanged())
+        {
+            networkSource.NextDue = t;
+        }
 
-        // distro;
-        const std::string& distro = System::GetDistroInfo();
+        bool inventoryChanged = false;
+        for (auto& source : sources)
+        {
+            if (t >= source.NextDue)
+            {
+                if (source.Collect())
+                {
+                    Logger::Debug("Inventory source {0} changed", source.Name);
+                    inventoryChanged = true;
+                }
 
-        // networks;
-        auto netInfo = System::GetNetworkInfo();
+                source.NextDue = t + source.PeriodSeconds;
+            }
+        }
 
         // GPU
         System::GpuInfoList gpuInfo;
@@ -566,28 +760,42 @@ void Monitor::Run()
 
             this->metricTime = ctime(&t);
 
-            std::get<1>(this->metricData[1]) = cpuUsage;
-            std::get<1>(this->metricData[3]) = availableMemoryMb;
-            std::get<1>(this->metricData[12]) = networkUsage;
+            std::get<1>(this->metricData[1]) = sample.CpuUsage;
+            std::get<1>(this->metricData[3]) = sample.AvailableMemoryMb;
+            std::get<1>(this->metricData[12]) = sample.NetworkBytesPerSec;
 
-            this->totalMemoryMb = totalMemoryMb;
-            this->ipAddress = ipAddress;
-            this->coreCount = cores;
-            this->socketCount = sockets;
-            this->distroInfo = distro;
-            this->networkInfo = std::move(netInfo);
+            if ((int)sample.TotalMemoryMb != this->totalMemoryMb)
+            {
+                this->totalMemoryMb = sample.TotalMemoryMb;
+                inventoryChanged = true;
+            }
 
-            this->freeSpacePercent = freeSpacePercent;
-            this->queueLength = queueLength;
-            this->pagesPerSec = pagesPerSec;
-            this->contextSwitchesPerSec = contextSwitchesPerSec;
-            this->bytesPerSecond = bytesPerSecond;
+            this->freeSpacePercent = sample.FreeSpacePercent;
+            this->queueLength = sample.DiskQueueLength;
+            this->pagesPerSec = sample.PagesPerSec;
+            this->contextSwitchesPerSec = sample.ContextSwitchesPerSec;
+            this->bytesPerSecond = sample.DiskBytesPerSec;
 
             if (this->gpuInitRet == 0)
             {
                 Logger::Debug("Saving Gpu Info ret {0}, info count {1}", this->gpuInitRet, gpuInfo.GpuInfos.size());
+
+                inventoryChanged = inventoryChanged ||
+                    !std::equal(gpuInfo.GpuInfos.cbegin(), gpuInfo.GpuInfos.cend(),
+                        this->gpuInfo.GpuInfos.cbegin(), this->gpuInfo.GpuInfos.cend(), isSameGpu);
+
                 this->gpuInfo = std::move(gpuInfo);
             }
+
+            if (inventoryChanged)
+            {
+                this->BuildRegisterInfo();
+            }
+
+            if (this->history)
+            {
+                this->AppendHistory(t);
+            }
         }
 
         this->isCollected = true;
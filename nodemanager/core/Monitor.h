@@ -3,13 +3,18 @@
 
 #include <cpprest/json.h>
 #include <map>
+#include <functional>
 #include <boost/uuid/uuid.hpp>
 
 #include "../utils/System.h"
 #include "../data/MonitoringPacket.h"
+#include "../data/MetricPacket.h"
 #include "../arguments/MetricCounter.h"
 #include "../arguments/MetricCountersConfig.h"
+#include "../arguments/MetricHistoryArgs.h"
 #include "MetricCollectorBase.h"
+#include "MetricPacketEncoder.h"
+#include "MetricHistory.h"
 
 using namespace web;
 using namespace boost::uuids;
@@ -28,33 +33,78 @@ namespace hpc
 
                 ~Monitor();
 
-                std::vector<unsigned char> GetMonitorPacketData();
+                // Writes the datagrams of the metric packet in the MetricPacketVersion
+                // format, a v2 packet is fragmented when it doesn't fit in one datagram.
+                // The buffers of the caller are reused.
+                void GetMonitorPacketData(std::vector<std::vector<unsigned char>>& datagrams);
                 json::value GetRegisterInfo();
 
                 void SetNodeUuid(const uuid& id);
                 void ApplyMetricConfig(hpc::arguments::MetricCountersConfig&& config, pplx::cancellation_token token);
 
+                // The values of the enabled counters sampled so far, empty when the
+                // history file is not mapped.
+                json::value QueryMetricHistory(const hpc::arguments::MetricHistoryArgs& args);
+
             protected:
             private:
+                // A source of the node inventory, collected at its own period or when
+                // a change is detected. Collect returns whether the inventory changed.
+                typedef struct _SamplingSource
+                {
+                    std::string Name;
+                    int PeriodSeconds;
+                    std::function<bool()> Collect;
+                    time_t NextDue;
+                } SamplingSource;
+
                 bool EnableMetricCounter(const hpc::arguments::MetricCounter& counterConfig, pplx::cancellation_token token);
+                void CompilePlan();
+                // Under the writer lock, at every sample.
+                void AppendHistory(time_t time);
                 void Run();
+                bool CollectNetworkInventory();
+                bool CollectCpuInventory();
+                bool CollectDistroInventory();
+                void BuildRegisterInfo();
+                void OpenNetlinkSocket();
+                bool HasNetworkChanged();
 
                 static void* MonitoringThread(void* arg);
 
                 static const int MaxCountersInPacket = 80;
+                static const int NetworkInventoryPeriodSeconds = 600;
+                // CpuTopology is only parsed again on hotplug, so checking it every tick is cheap.
+                static const int CpuInventoryPeriodSeconds = 1;
+                static const int DistroInventoryPeriodSeconds = 86400;
 
                 std::string name;
                 std::string networkName;
                 std::string metricTime;
                 std::map<int, std::tuple<int, float>> metricData;
-                int coreCount;
-                int socketCount;
-                int totalMemoryMb;
+                int coreCount = 0;
+                int socketCount = 0;
+                int totalMemoryMb = 0;
                 std::string ipAddress;
                 std::string distroInfo;
                 std::vector<hpc::utils::System::NetInfo> networkInfo;
+                json::value registerInfo;
+                int netlinkSocket = -1;
                 std::map<std::string, std::shared_ptr<MetricCollectorBase>> collectors;
+                // the enabled counters in the order of the packet.
+                std::vector<MetricCollectorBase::PlanEntry> plan;
+                uint64_t planGeneration = 0;
                 hpc::data::MonitoringPacket<MaxCountersInPacket> packet = 1;
+                // the slots of the v1 packet to be cleared, all at the first time.
+                int packetCount = MaxCountersInPacket;
+                bool packetTruncated = false;
+                int packetVersion = 1;
+                hpc::data::MetricPacket metricPacket;
+                MetricPacketEncoder packetEncoder;
+
+                // null when the metric is disabled.
+                std::unique_ptr<MetricHistory> history;
+                std::vector<std::pair<float, hpc::data::Umid>> historyValues;
 
                 int gpuInitRet;
                 System::GpuInfoList gpuInfo;
@@ -1,66 +1,135 @@
 #include "NamingClient.h"
 #include "NodeManagerConfig.h"
 #include "../utils/Logger.h"
-#include "../utils/ReaderLock.h"
 #include "HttpHelper.h"
 #include <stdlib.h>
+#include <time.h>
 
 using namespace web::http;
 using namespace web::http::client;
 using namespace hpc::core;
 using namespace hpc::utils;
 
-void NamingClient::InvalidateCache()
+NamingClient::NamingClient(
+    const std::vector<std::string>& namingServices,
+    int interval) : intervalSeconds(interval), namingServicesUri(namingServices)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&this->resolved, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+NamingClient::~NamingClient()
+{
+    this->cts.cancel();
+    pthread_cond_destroy(&this->resolved);
+    pthread_mutex_destroy(&this->mutex);
+}
+
+void NamingClient::InvalidateCache(const std::string& serviceName)
 {
     auto instance = GetInstance(NodeManagerConfig::GetNamingServiceUri());
 
     if (instance)
     {
-        WriterLock writerLock(&instance->lock);
+        pthread_mutex_lock(&instance->mutex);
+
+        auto it = instance->entries.find(serviceName);
+        if (it != instance->entries.end() && it->second.Resolved)
+        {
+            Logger::Debug("ResolveServiceLocation> Invalidated {0}, location {1}", serviceName, it->second.Location);
+
+            // the callers keep the stale location until the refresh succeeds.
+            it->second.ExpiresAt = std::chrono::steady_clock::now();
+            if (!it->second.Resolving)
+            {
+                instance->StartResolve(serviceName, it->second);
+            }
+        }
 
-        Logger::Debug("ResolveServiceLocation> Cleared.");
-        instance->serviceLocations.clear();
+        pthread_mutex_unlock(&instance->mutex);
     }
 }
 
 std::string NamingClient::GetServiceLocation(const std::string& serviceName, pplx::cancellation_token token)
 {
-    std::map<std::string, std::string>::iterator location;
+    std::string location;
+
+    pthread_mutex_lock(&this->mutex);
 
+    // the entries are never erased, the reference stays valid while waiting.
+    Entry& entry = this->entries[serviceName];
+
+    if (entry.Resolved)
     {
-        ReaderLock readerLock(&this->lock);
-        location = this->serviceLocations.find(serviceName);
+        if (!entry.Resolving && std::chrono::steady_clock::now() >= entry.ExpiresAt)
+        {
+            Logger::Debug("ResolveServiceLocation> {0} expired, refreshing in background", serviceName);
+            this->StartResolve(serviceName, entry);
+        }
     }
-
-    if (location == this->serviceLocations.end())
+    else
     {
+        if (!entry.Resolving)
         {
-            ReaderLock readerLock(&this->lock);
             Logger::Debug("ResolveServiceLocation> there is no entry for {0}", serviceName);
-            for (auto kvp : this->serviceLocations)
-            {
-                Logger::Debug("ResolveServiceLocation> entry {0} = {1}", kvp.first, kvp.second);
-            }
-
-            location = this->serviceLocations.find(serviceName);
+            this->StartResolve(serviceName, entry);
         }
 
-        if (location == this->serviceLocations.end())
+        while (!entry.Resolved && !token.is_canceled())
         {
-            std::string temp;
-            this->RequestForServiceLocation(serviceName, temp, token);
+            // wakes up periodically to observe the cancellation of the caller.
+            timespec timeout;
+            clock_gettime(CLOCK_MONOTONIC, &timeout);
+            timeout.tv_sec += 1;
+            pthread_cond_timedwait(&this->resolved, &this->mutex, &timeout);
+        }
+    }
 
-            {
-                WriterLock writerLock(&this->lock);
+    if (entry.Resolved)
+    {
+        location = entry.Location;
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+
+    return location;
+}
+
+void NamingClient::StartResolve(const std::string& serviceName, Entry& entry)
+{
+    entry.Resolving = true;
 
-                this->serviceLocations[serviceName] = temp;
-                location = this->serviceLocations.find(serviceName);
+    auto self = this->shared_from_this();
+    auto token = this->cts.get_token();
+
+    pplx::create_task([self, serviceName, token]()
+    {
+        std::string location;
+        self->RequestForServiceLocation(serviceName, location, token);
+
+        pthread_mutex_lock(&self->mutex);
+
+        Entry& entry = self->entries[serviceName];
+        entry.Resolving = false;
+
+        if (!token.is_canceled())
+        {
+            if (!entry.Resolved || entry.Location != location)
+            {
+                Logger::Info("ResolveServiceLocation> Resolved serviceLocation {1} for {0}", location, serviceName);
             }
+
+            entry.Location = location;
+            entry.Resolved = true;
+            entry.ExpiresAt = std::chrono::steady_clock::now() + std::chrono::seconds(CacheTtlSeconds);
         }
-    }
 
-    Logger::Info("ResolveServiceLocation> Resolved serviceLocation {1} for {0}", location->second, serviceName);
-    return location->second;
+        pthread_cond_broadcast(&self->resolved);
+        pthread_mutex_unlock(&self->mutex);
+    });
 }
 
 void NamingClient::RequestForServiceLocation(const std::string& serviceName, std::string& serviceLocation, pplx::cancellation_token token)
@@ -76,10 +145,8 @@ void NamingClient::RequestForServiceLocation(const std::string& serviceName, std
             selected %= this->namingServicesUri.size();
             uri = this->namingServicesUri[selected++] + serviceName;
             Logger::Debug("ResolveServiceLocation> Fetching from {0}", uri);
-            auto client = HttpHelper::GetHttpClient(uri);
-
             auto request = HttpHelper::GetHttpRequest(methods::GET);
-            http_response response = client->request(*request, token).get();
+            http_response response = HttpHelper::SendRequest(uri, *request, token).get();
             if (response.status_code() == http::status_codes::OK)
             {
                 serviceLocation = JsonHelper<std::string>::FromJson(response.extract_json().get());
@@ -3,30 +3,31 @@
 
 #include <cpprest/json.h>
 #include <cpprest/http_client.h>
+#include <chrono>
 #include <functional>
-#include "../utils/WriterLock.h"
+#include <map>
+#include <memory>
+#include <pthread.h>
 
 namespace hpc
 {
     namespace core
     {
         using namespace web;
-        using namespace hpc::utils;
 
-        class NamingClient
+        // Resolves the service locations from the naming services. A resolved
+        // location is cached for CacheTtlSeconds, after that or after it is
+        // invalidated the stale location is still returned while one background
+        // request refreshes it. Only the callers of a service never resolved wait,
+        // and they wait for the one request in flight instead of sending their own.
+        class NamingClient : public std::enable_shared_from_this<NamingClient>
         {
             public:
                 NamingClient(
                     const std::vector<std::string>& namingServices,
-                    int interval) : intervalSeconds(interval), namingServicesUri(namingServices), lock(PTHREAD_RWLOCK_INITIALIZER)
-                {
-                }
+                    int interval);
 
-                virtual ~NamingClient()
-                {
-                    this->cts.cancel();
-                    pthread_rwlock_destroy(&this->lock);
-                }
+                virtual ~NamingClient();
 
                 static std::shared_ptr<NamingClient> GetInstance(const std::vector<std::string>& namingServices)
                 {
@@ -35,18 +36,36 @@ namespace hpc
                     return instance;
                 }
 
+                // Returns an empty string when the token is canceled before the
+                // service is resolved for the first time.
                 std::string GetServiceLocation(const std::string& serviceName, pplx::cancellation_token token);
 
-                static void InvalidateCache();
+                // Expires the cached location of the service which failed, the
+                // other services keep theirs.
+                static void InvalidateCache(const std::string& serviceName);
+
+                static const int CacheTtlSeconds = 300;
 
             private:
+                typedef struct _Entry
+                {
+                    std::string Location;
+                    bool Resolved = false;
+                    bool Resolving = false;
+                    std::chrono::steady_clock::time_point ExpiresAt;
+                } Entry;
+
+                // Called under the mutex.
+                void StartResolve(const std::string& serviceName, Entry& entry);
+
                 void RequestForServiceLocation(const std::string& serviceName, std::string& serviceLocation, pplx::cancellation_token token);
 
                 int intervalSeconds;
-                std::map<std::string, std::string> serviceLocations;
+                std::map<std::string, Entry> entries;
                 std::vector<std::string> namingServicesUri;
                 pplx::cancellation_token_source cts;
-                pthread_rwlock_t lock;
+                pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+                pthread_cond_t resolved;
         };
     }
 }
@@ -3,3 +3,61 @@
 using namespace hpc::core;
 
 NodeManagerConfig NodeManagerConfig::instance;
+
+NodeManagerConfig::NodeManagerConfig() : Configuration("nodemanager.json")
+{
+    this->Watch([this](const web::json::value& data) { this->OnLoaded(data); });
+}
+
+int NodeManagerConfig::AddReloadListener(std::function<void()> listener)
+{
+    pthread_mutex_lock(&instance.listenersMutex);
+    int id = instance.nextListenerId++;
+    instance.reloadListeners[id] = listener;
+    pthread_mutex_unlock(&instance.listenersMutex);
+
+    return id;
+}
+
+void NodeManagerConfig::RemoveReloadListener(int id)
+{
+    pthread_mutex_lock(&instance.listenersMutex);
+    instance.reloadListeners.erase(id);
+    pthread_mutex_unlock(&instance.listenersMutex);
+}
+
+void NodeManagerConfig::OnLoaded(const web::json::value& data)
+{
+    auto snapshot = std::make_shared<Snapshot>();
+
+#define ParseConfigurationValue(T, name) \
+    snapshot->name.Parse(#name, data);
+
+    PublicConfigurationItems(ParseConfigurationValue)
+    PrivateConfigurationItems(ParseConfigurationValue)
+
+#undef ParseConfigurationValue
+
+    auto previous = std::atomic_exchange(&this->snapshot, std::shared_ptr<const Snapshot>(snapshot));
+    if (!previous)
+    {
+        // the first load, main applies the log level.
+        return;
+    }
+
+    if (snapshot->LogLevel.IsValid() &&
+        (!previous->LogLevel.IsValid() || previous->LogLevel.Get() != snapshot->LogLevel.Get()))
+    {
+        Logger::Info("LogLevel changed to {0}", snapshot->LogLevel.Get());
+        Logger::SetLevel((spdlog::level::level_enum)snapshot->LogLevel.Get());
+    }
+
+    pthread_mutex_lock(&this->listenersMutex);
+
+    for (auto& listener : this->reloadListeners)
+    {
+        listener.second();
+    }
+
+    pthread_mutex_unlock(&this->listenersMutex);
+}
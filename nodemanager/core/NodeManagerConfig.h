@@ -10,10 +10,51 @@ namespace hpc
 {
     namespace core
     {
+// The configuration items, the getters and setters are generated in
+// NodeManagerConfig and the typed values in NodeManagerConfig::Snapshot.
+#define PublicConfigurationItems(Item) \
+                Item(std::string, ClusterAuthenticationKey) \
+                Item(std::string, TrustedCAPath) \
+                Item(std::string, TrustedCAFile) \
+                Item(std::string, CertificateChainFile) \
+                Item(std::string, PrivateKeyFile) \
+                Item(std::string, ListeningUri) \
+                Item(std::string, DefaultServiceName) \
+                Item(std::string, UdpMetricServiceName) \
+                Item(bool, UseDefaultCA) \
+                Item(bool, Debug) \
+                Item(int, HostsFetchInterval) \
+                Item(int, LogLevel) \
+                Item(std::vector<std::string>, NamingServiceUri) \
+                Item(std::string, MetricUri) \
+                Item(std::string, HeartbeatUri) \
+                Item(std::string, TaskCompletionUri) \
+                Item(std::string, HostsFileUri) \
+                Item(bool, MetricDisabled) \
+                Item(std::string, TaskCompletionBatchUri) \
+                Item(int, TaskCompletionBatchWindowMs) \
+                Item(int, TaskCompletionBatchSize) \
+                Item(std::string, TaskLaunchMode) \
+                Item(std::string, StreamOutputPolicy) \
+                Item(int, UserKeyLingerSeconds) \
+                Item(std::string, HeartbeatMode) \
+                Item(int, MetricPacketVersion) \
+                Item(std::string, FilterMode) \
+                Item(int, FilterWorkers) \
+                Item(int, FilterTimeoutSeconds) \
+                Item(bool, TaskStartFilterBatch) \
+                Item(int, ProxyMaxConcurrency) \
+                Item(int, TaskTelemetryIntervalMs) \
+                Item(std::string, MetricHistoryFile)
+
+#define PrivateConfigurationItems(Item) \
+                Item(std::string, RegisterUri) \
+                Item(std::string, MetricInstanceIdsUri)
+
 #define AddConfigurationItem(T, name) \
                 static T Get##name() \
                 { \
-                    return instance.ReadValue<T>(#name); \
+                    return GetSnapshot()->name.Get(); \
                 } \
                 \
                 static void Save##name(const T& v) \
@@ -22,29 +63,32 @@ namespace hpc
                     instance.Save(); \
                 }
 
+#define DeclareConfigurationValue(T, name) \
+                    ConfigurationValue<T> name;
+
         class NodeManagerConfig : Configuration
         {
             public:
-                NodeManagerConfig() : Configuration("nodemanager.json") { }
-
-                AddConfigurationItem(std::string, ClusterAuthenticationKey);
-                AddConfigurationItem(std::string, TrustedCAPath);
-                AddConfigurationItem(std::string, TrustedCAFile);
-                AddConfigurationItem(std::string, CertificateChainFile);
-                AddConfigurationItem(std::string, PrivateKeyFile);
-                AddConfigurationItem(std::string, ListeningUri);
-                AddConfigurationItem(std::string, DefaultServiceName);
-                AddConfigurationItem(std::string, UdpMetricServiceName);
-                AddConfigurationItem(bool, UseDefaultCA);
-                AddConfigurationItem(bool, Debug);
-                AddConfigurationItem(int, HostsFetchInterval);
-                AddConfigurationItem(int, LogLevel);
-                AddConfigurationItem(std::vector<std::string>, NamingServiceUri);
-                AddConfigurationItem(std::string, MetricUri);
-                AddConfigurationItem(std::string, HeartbeatUri);
-                AddConfigurationItem(std::string, TaskCompletionUri);
-                AddConfigurationItem(std::string, HostsFileUri);
-                AddConfigurationItem(bool, MetricDisabled);
+                NodeManagerConfig();
+
+                // The items parsed once per change of the file, a hot path may keep
+                // the snapshot and read its fields.
+                typedef struct _Snapshot
+                {
+                    PublicConfigurationItems(DeclareConfigurationValue)
+                    PrivateConfigurationItems(DeclareConfigurationValue)
+                } Snapshot;
+
+                static std::shared_ptr<const Snapshot> GetSnapshot()
+                {
+                    return std::atomic_load(&instance.snapshot);
+                }
+
+                // Called after the configuration file is changed, returns the id to remove it.
+                static int AddReloadListener(std::function<void()> listener);
+                static void RemoveReloadListener(int id);
+
+                PublicConfigurationItems(AddConfigurationItem)
 
                 static std::string ResolveRegisterUri(pplx::cancellation_token token)
                 {
@@ -87,10 +131,23 @@ namespace hpc
                     return ResolveUri(configUri, [token](std::shared_ptr<NamingClient> namingClient) { return namingClient->GetServiceLocation(NodeManagerConfig::GetDefaultServiceName(), token); });
                 }
 
+                static std::string ResolveTaskCompletionBatchUri(pplx::cancellation_token token)
+                {
+                    std::string uri = NodeManagerConfig::GetTaskCompletionBatchUri();
+                    return ResolveUri(uri, [token](std::shared_ptr<NamingClient> namingClient) { return namingClient->GetServiceLocation(NodeManagerConfig::GetDefaultServiceName(), token); });
+                }
+
             protected:
             private:
-                AddConfigurationItem(std::string, RegisterUri);
-                AddConfigurationItem(std::string, MetricInstanceIdsUri);
+                PrivateConfigurationItems(AddConfigurationItem)
+
+                void OnLoaded(const web::json::value& data);
+
+                std::shared_ptr<const Snapshot> snapshot;
+
+                std::map<int, std::function<void()>> reloadListeners;
+                int nextListenerId = 0;
+                pthread_mutex_t listenersMutex = PTHREAD_MUTEX_INITIALIZER;
 
                 static std::string ResolveUri(const std::string& uri, std::function<std::string(std::shared_ptr<NamingClient>)> resolver)
                 {
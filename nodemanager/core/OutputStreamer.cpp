@@ -0,0 +1,246 @@
+#include <boost/algorithm/string.hpp>
+
+#include "OutputStreamer.h"
+#include "HttpHelper.h"
+#include "NodeManagerConfig.h"
+#include "../utils/Logger.h"
+#include "../utils/System.h"
+#include "../utils/Reactor.h"
+#include "../data/OutputData.h"
+
+using namespace web::http;
+using namespace hpc::core;
+using namespace hpc::utils;
+
+OutputStreamer::OutputStreamer(
+    int jobId,
+    int taskId,
+    int requeueCount,
+    const std::string& uri,
+    int firstOrder,
+    OutputPolicy policy,
+    std::function<void()> onResume,
+    std::function<void()> onFinished) :
+    jobId(jobId), taskId(taskId), requeueCount(requeueCount), uri(uri), policy(policy),
+    onResume(onResume), onFinished(onFinished), ring(RingCapacity), nextOrder(firstOrder)
+{
+}
+
+OutputStreamer::~OutputStreamer()
+{
+    pthread_mutex_destroy(&this->mutex);
+}
+
+OutputPolicy OutputStreamer::GetConfiguredPolicy()
+{
+    static OutputPolicy policy = []()
+    {
+        std::string name = NodeManagerConfig::GetStreamOutputPolicy();
+        OutputPolicy p = boost::algorithm::iequals(name, "dropoldest") ? OutputPolicy::DropOldest : OutputPolicy::Block;
+        Logger::Info("OutputStreamer: {0} when the output buffer is full", p == OutputPolicy::DropOldest ? "drop the oldest output" : "block the task");
+        return p;
+    }();
+
+    return policy;
+}
+
+char* OutputStreamer::GetWriteBuffer(size_t& length)
+{
+    pthread_mutex_lock(&this->mutex);
+
+    size_t pending = this->writePosition - this->readPosition;
+    if (pending == RingCapacity)
+    {
+        if (this->policy == OutputPolicy::DropOldest)
+        {
+            this->readPosition += FlushBytes;
+            this->droppedBytes += FlushBytes;
+            pending -= FlushBytes;
+        }
+        else
+        {
+            this->readerPaused = true;
+        }
+    }
+
+    size_t index = this->writePosition % RingCapacity;
+    length = std::min(RingCapacity - pending, RingCapacity - index);
+    char* buffer = &this->ring[index];
+
+    pthread_mutex_unlock(&this->mutex);
+
+    return buffer;
+}
+
+void OutputStreamer::Commit(size_t length)
+{
+    pthread_mutex_lock(&this->mutex);
+    this->writePosition += length;
+    pthread_mutex_unlock(&this->mutex);
+
+    this->TrySend(false);
+}
+
+void OutputStreamer::End()
+{
+    pthread_mutex_lock(&this->mutex);
+    this->ended = true;
+    uint64_t dropped = this->droppedBytes;
+    pthread_mutex_unlock(&this->mutex);
+
+    if (dropped > 0)
+    {
+        Logger::Warn(this->jobId, this->taskId, this->requeueCount,
+            "Dropped {0} bytes of output to {1}, the receiver is slower than the task", dropped, this->uri);
+    }
+
+    this->TrySend(true);
+}
+
+int OutputStreamer::GetNextOrder()
+{
+    pthread_mutex_lock(&this->mutex);
+    int order = this->nextOrder;
+    pthread_mutex_unlock(&this->mutex);
+
+    return order;
+}
+
+std::string OutputStreamer::GetTail(size_t length)
+{
+    pthread_mutex_lock(&this->mutex);
+
+    length = std::min(length, (size_t)std::min(this->writePosition, (uint64_t)RingCapacity));
+    size_t index = (this->writePosition - length) % RingCapacity;
+    size_t first = std::min(length, RingCapacity - index);
+
+    std::string tail;
+    tail.reserve(length);
+    tail.append(&this->ring[index], first);
+    tail.append(&this->ring[0], length - first);
+
+    pthread_mutex_unlock(&this->mutex);
+
+    return tail;
+}
+
+void OutputStreamer::TrySend(bool force)
+{
+    pthread_mutex_lock(&this->mutex);
+
+    if (this->sending || this->eofSent)
+    {
+        pthread_mutex_unlock(&this->mutex);
+        return;
+    }
+
+    size_t pending = this->writePosition - this->readPosition;
+    if (pending == 0 && !this->ended)
+    {
+        pthread_mutex_unlock(&this->mutex);
+        return;
+    }
+
+    if (pending < FlushBytes && !force && !this->ended)
+    {
+        // coalesce the small writes until the interval elapses.
+        if (!this->timerScheduled)
+        {
+            this->timerScheduled = true;
+            auto self = this->shared_from_this();
+            Reactor::GetInstance().AddTimer(FlushIntervalMilliseconds, [self]()
+            {
+                pthread_mutex_lock(&self->mutex);
+                self->timerScheduled = false;
+                pthread_mutex_unlock(&self->mutex);
+
+                self->TrySend(true);
+            });
+        }
+
+        pthread_mutex_unlock(&this->mutex);
+        return;
+    }
+
+    // The chunk is copied out for the json body anyway, so its space is released
+    // right away.
+    size_t length = std::min(pending, (size_t)MaxChunkBytes);
+    size_t index = this->readPosition % RingCapacity;
+    size_t first = std::min(length, RingCapacity - index);
+
+    std::string content;
+    content.reserve(length);
+    content.append(&this->ring[index], first);
+    content.append(&this->ring[0], length - first);
+    this->readPosition += length;
+
+    bool eof = length == 0;
+    if (eof) { this->eofSent = true; }
+
+    this->sending = true;
+    int order = this->nextOrder++;
+
+    bool resume = this->readerPaused && length > 0;
+    if (resume) { this->readerPaused = false; }
+
+    pthread_mutex_unlock(&this->mutex);
+
+    if (resume) { this->onResume(); }
+
+    this->Send(std::move(content), order, eof);
+}
+
+void OutputStreamer::Send(std::string content, int order, bool eof)
+{
+    auto self = this->shared_from_this();
+
+    try
+    {
+        OutputData od(System::GetNodeName(), order, content);
+        od.Eof = eof;
+
+        auto request = HttpHelper::GetHttpRequest(methods::POST, od.ToJson());
+        Logger::Debug(this->jobId, this->taskId, this->requeueCount,
+            "Callback to {0} with {1} bytes, order {2}, eof {3}", this->uri, content.size(), order, eof);
+
+        HttpHelper::SendRequest(this->uri, *request).then([self, eof](pplx::task<http_response> t)
+        {
+            try
+            {
+                http_response response = t.get();
+                Logger::Info(self->jobId, self->taskId, self->requeueCount,
+                    "Callback to {0} response code {1}", self->uri, response.status_code());
+            }
+            catch (const std::exception& ex)
+            {
+                Logger::Error(self->jobId, self->taskId, self->requeueCount,
+                    "Exception when sending back output. {0}", ex.what());
+            }
+
+            self->OnSent(eof);
+        });
+    }
+    catch (const std::exception& ex)
+    {
+        Logger::Error(this->jobId, this->taskId, this->requeueCount,
+            "Exception when sending back output. {0}", ex.what());
+
+        this->OnSent(eof);
+    }
+}
+
+void OutputStreamer::OnSent(bool eof)
+{
+    pthread_mutex_lock(&this->mutex);
+    this->sending = false;
+    pthread_mutex_unlock(&this->mutex);
+
+    if (eof)
+    {
+        this->onFinished();
+    }
+    else
+    {
+        this->TrySend(false);
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef OUTPUTSTREAMER_H
+#define OUTPUTSTREAMER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <pthread.h>
+
+namespace hpc
+{
+    namespace core
+    {
+        enum class OutputPolicy
+        {
+            // Stops reading the pipe when the buffer is full, the task blocks on write.
+            Block,
+            // Discards the oldest unsent output to keep the task running.
+            DropOldest
+        };
+
+        // Buffers the streamed stdout of a task in a bounded ring and sends it in
+        // coalesced chunks, a chunk goes out when enough output is pending or when
+        // the oldest pending output waited for the flush interval. One chunk is in
+        // flight at a time over the pooled keep-alive connection, so the orders are
+        // sequential and the Eof chunk is the last one.
+        class OutputStreamer : public std::enable_shared_from_this<OutputStreamer>
+        {
+            public:
+                OutputStreamer(
+                    int jobId,
+                    int taskId,
+                    int requeueCount,
+                    const std::string& uri,
+                    int firstOrder,
+                    OutputPolicy policy,
+                    std::function<void()> onResume,
+                    std::function<void()> onFinished);
+
+                ~OutputStreamer();
+
+                // The policy from the StreamOutputPolicy configuration, "block" or "dropoldest".
+                static OutputPolicy GetConfiguredPolicy();
+
+                // The contiguous free space of the ring for the pipe to be read into.
+                // Under the Block policy a zero length means the reader should pause
+                // until onResume is called.
+                char* GetWriteBuffer(size_t& length);
+                void Commit(size_t length);
+
+                // No more output, onFinished is called after the Eof chunk is sent.
+                void End();
+
+                int GetNextOrder();
+
+                // The last output read from the pipe, sent or not, the ring keeps the
+                // bytes until they are overwritten.
+                std::string GetTail(size_t length);
+
+                static const size_t RingCapacity = 1024 * 1024;
+                static const size_t FlushBytes = 64 * 1024;
+                static const size_t MaxChunkBytes = 256 * 1024;
+                static const int FlushIntervalMilliseconds = 100;
+
+            protected:
+            private:
+                void TrySend(bool force);
+                void Send(std::string content, int order, bool eof);
+                void OnSent(bool eof);
+
+                const int jobId;
+                const int taskId;
+                const int requeueCount;
+                const std::string uri;
+                const OutputPolicy policy;
+                std::function<void()> onResume;
+                std::function<void()> onFinished;
+
+                std::vector<char> ring;
+                // absolute positions, the index in the ring is the position modulo the capacity.
+                uint64_t readPosition = 0;
+                uint64_t writePosition = 0;
+                uint64_t droppedBytes = 0;
+
+                int nextOrder;
+                bool sending = false;
+                bool timerScheduled = false;
+                bool readerPaused = false;
+                bool ended = false;
+                bool eofSent = false;
+
+                pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        };
+    }
+}
+
+#endif // OUTPUTSTREAMER_H
@@ -1,4 +1,6 @@
 #include <memory.h>
+#include <string.h>
+#include <fcntl.h>
 #include <sys/wait.h>
 #include <sys/resource.h>
 #include <fstream>
@@ -10,8 +12,11 @@
 #include "../utils/String.h"
 #include "../common/ErrorCodes.h"
 #include "../utils/WriterLock.h"
-#include "../data/OutputData.h"
+#include "../utils/ReaderLock.h"
+#include "../utils/Reactor.h"
 #include "HttpHelper.h"
+#include "CGroupController.h"
+#include "TaskLauncher.h"
 
 using namespace hpc::core;
 using namespace hpc::utils;
@@ -37,9 +42,12 @@ Process::Process(
     jobId(jobId), taskId(taskId), requeueCount(requeueCount), taskExecutionId(String::Join("_", taskExecutionName, jobId, taskId, requeueCount)),
     commandLine(cmdLine), stdOutFile(standardOut), stdErrFile(standardErr), stdInFile(standardIn),
     workDirectory(workDir), userName(user.empty() ? "root" : user), dockerImage(envi["CCP_DOCKER_IMAGE"]), dumpStdout(dumpStdoutToExecutionMessage),
-    affinity(cpuAffinity), environments(envi), callback(completed), processId(0)
+    affinity(cpuAffinity), environments(envi), cgroupName(CGroupController::GetGroupName(taskExecutionId)),
+    callback(completed), strand(std::make_shared<WorkerPool::Strand>()), processId(0)
 {
     this->streamOutput = StartWithHttpOrHttps(stdOutFile);
+    this->nativeCGroup = this->dockerImage.empty() && CGroupController::GetInstance().IsAvailable();
+    this->launchMode = TaskLauncher::GetConfiguredMode();
 
     Logger::Debug(this->jobId, this->taskId, this->requeueCount, "{0}, stream ? {1}", stdOutFile, this->streamOutput);
 }
@@ -54,19 +62,27 @@ Process::~Process()
 
 void Process::Cleanup()
 {
+    auto& cgroup = CGroupController::GetInstance();
+    for (const auto& groupName : cgroup.ListGroups())
+    {
+        Logger::Info("Cleanup zombie cgroup {0}", groupName);
+        cgroup.Kill(groupName, true);
+        cgroup.Remove(groupName);
+    }
+
     std::string output;
     System::ExecuteCommandOut(output, "/bin/bash", "CleanupAllTasks.sh");
     Logger::Info("Cleanup zombie result: {0}", output);
 }
 
-pplx::task<std::pair<pid_t, pthread_t>> Process::Start(std::shared_ptr<Process> self)
+pplx::task<pid_t> Process::Start(std::shared_ptr<Process> self)
 {
     this->SetSelfPtr(self);
-    pthread_create(&this->threadId, nullptr, ForkThread, this);
+    Reactor::GetInstance().PostBlocking([this]() { this->Launch(); });
 
-    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Created thread {0}", this->threadId);
+    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Queued the launch");
 
-    return pplx::task<std::pair<pid_t, pthread_t>>(this->started);
+    return pplx::task<pid_t>(this->started);
 }
 
 void Process::Kill(int forcedExitCode, bool forced)
@@ -79,12 +95,56 @@ void Process::Kill(int forcedExitCode, bool forced)
 
     if (!this->ended)
     {
-        this->ExecuteCommand("/bin/bash", "EndTask.sh", this->taskExecutionId, this->processId, forced ? "1" : "0", this->taskFolder);
+        if (this->nativeCGroup)
+        {
+            int ret = CGroupController::GetInstance().Kill(this->cgroupName, forced);
+            Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Kill cgroup {0}, forced {1}, ret {2}", this->cgroupName, forced, ret);
+        }
+        else
+        {
+            this->ExecuteCommand("/bin/bash", "EndTask.sh", this->taskExecutionId, this->processId, forced ? "1" : "0", this->taskFolder);
+        }
+    }
+}
+
+int Process::WaitForExit(int timeoutMs)
+{
+    if (this->nativeCGroup)
+    {
+        return CGroupController::GetInstance().WaitForEmpty(this->cgroupName, timeoutMs);
     }
+
+    // the pid is reaped right before processExited is set.
+    if (this->processId <= 0 || this->processExited)
+    {
+        return 0;
+    }
+
+    return System::WaitForExit(std::vector<int> { this->processId }, timeoutMs);
 }
 
 const ProcessStatistics& Process::GetStatisticsFromCGroup()
 {
+    if (this->nativeCGroup)
+    {
+        ProcessStatistics stat;
+        int ret = CGroupController::GetInstance().GetStatistics(this->cgroupName, stat);
+
+        WriterLock writerLock(&this->lock);
+        if (ret == 0)
+        {
+            this->statistics = std::move(stat);
+        }
+        else
+        {
+            // The group is gone, keep the last known usage.
+            Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Statistics of cgroup {0} unavailable, ret {1}", this->cgroupName, ret);
+            this->statistics.ProcessIds.clear();
+        }
+
+        return this->statistics;
+    }
+
     std::string stat;
     System::ExecuteCommandOut(stat, "/bin/bash", "Statistics.sh", this->taskExecutionId, this->taskFolder);
 
@@ -123,8 +183,6 @@ void Process::OnCompletedInternal()
 {
     try
     {
-        this->completed.set();
-
         this->callback(
             this->exitCode,
             this->message.str(),
@@ -138,214 +196,321 @@ void Process::OnCompletedInternal()
     {
         Logger::Error(this->jobId, this->taskId, this->requeueCount, "Unknown exception happened when callback");
     }
+
+    this->completed.set();
 }
 
-void* Process::ForkThread(void* arg)
+void Process::Launch()
 {
-    Process* const p = static_cast<Process* const>(arg);
     std::string path;
 
-Start:
-    int ret = p->CreateTaskFolder();
+    int ret = this->CreateTaskFolder();
     if (ret != 0)
     {
-        p->message << "Task " << p->taskId << ": error when create task folder, ret " << ret << std::endl;
-        Logger::Error(p->jobId, p->taskId, p->requeueCount, "error when create task folder, ret {0}", ret);
+        this->message << "Task " << this->taskId << ": error when create task folder, ret " << ret << std::endl;
+        Logger::Error(this->jobId, this->taskId, this->requeueCount, "error when create task folder, ret {0}", ret);
 
-        p->SetExitCode(ret);
+        this->SetExitCode(ret);
         goto Final;
     }
 
-    path = p->BuildScript();
+    path = this->BuildScript();
 
     if (path.empty())
     {
-        p->message << "Error when build script." << std::endl;
-        Logger::Error(p->jobId, p->taskId, p->requeueCount, "Error when build script.");
+        this->message << "Error when build script." << std::endl;
+        Logger::Error(this->jobId, this->taskId, this->requeueCount, "Error when build script.");
 
-        p->SetExitCode((int)ErrorCodes::BuildScriptError);
+        this->SetExitCode((int)ErrorCodes::BuildScriptError);
         goto Final;
     }
 
-    if (!p->dockerImage.empty())
+    if (!this->dockerImage.empty())
     {
-        p -> environmentsBuffer.clear();
+        this->environmentsBuffer.clear();
         std::transform(
-            p->environments.cbegin(),
-            p->environments.cend(),
-            std::back_inserter(p->environmentsBuffer),
+            this->environments.cbegin(),
+            this->environments.cend(),
+            std::back_inserter(this->environmentsBuffer),
             [](const auto& v) { return String::Join("=", v.first, v.second); });
-    
-        std::string envFile = p->taskFolder + "/environments"; 
-        int ret = System::WriteStringToFile(envFile, String::Join<'\n'>(p->environmentsBuffer));
+
+        std::string envFile = this->taskFolder + "/environments";
+        int ret = System::WriteStringToFile(envFile, String::Join<'\n'>(this->environmentsBuffer));
         if (ret != 0)
         {
-            Logger::Error(p->jobId, p->taskId, p->requeueCount, "Failed to create environment file for docker task. Exitcode: {0}", ret);
+            Logger::Error(this->jobId, this->taskId, this->requeueCount, "Failed to create environment file for docker task. Exitcode: {0}", ret);
             goto Final;
         }
     }
 
-    if (0 != p->ExecuteCommand("/bin/bash", "PrepareTask.sh", p->taskExecutionId, p->GetAffinity(), p->taskFolder, p->userName))
+    if (this->nativeCGroup)
+    {
+        if (0 != this->PrepareCGroup())
+        {
+            goto Final;
+        }
+    }
+    else if (0 != this->ExecuteCommand("/bin/bash", "PrepareTask.sh", this->taskExecutionId, this->GetAffinity(), this->taskFolder, this->userName))
     {
         goto Final;
     }
 
-    if (-1 == pipe(p->stdoutPipe))
+    // The pipe of one task must not leak into the other tasks forked meanwhile,
+    // or its end of file is delayed until they exit.
+    if (-1 == pipe2(this->stdoutPipe, O_CLOEXEC))
     {
-        p->message << "Error when create stdout pipe." << std::endl;
-        Logger::Error(p->jobId, p->taskId, p->requeueCount, "Error when create stdout pipe.");
+        this->message << "Error when create stdout pipe." << std::endl;
+        Logger::Error(this->jobId, this->taskId, this->requeueCount, "Error when create stdout pipe.");
 
-        p->SetExitCode(errno);
+        this->SetExitCode(errno);
         goto Final;
     }
 
-    p->processId = fork();
+    this->processId = this->Run(path, ret);
 
-    if (p->processId < 0)
+    if (this->processId < 0)
     {
         std::string errorMessage =
-            errno == EAGAIN ? "number of process reached upper limit" : "not enough memory";
+            ret == EAGAIN ? "number of process reached upper limit" : "not enough memory";
 
-        p->message << "Failed to fork(), pid = " << p->processId << ", errno = " << errno
+        this->message << "Failed to fork(), pid = " << this->processId << ", errno = " << ret
             << ", msg = " << errorMessage << std::endl;
-        Logger::Error(p->jobId, p->taskId, p->requeueCount, "Failed to fork(), pid = {0}, errno = {1}, msg = {2}", p->processId, errno, errorMessage);
+        Logger::Error(this->jobId, this->taskId, this->requeueCount, "Failed to fork(), pid = {0}, errno = {1}, msg = {2}", this->processId, ret, errorMessage);
+
+        this->SetExitCode(ret);
+        this->started.set(this->processId);
 
-        p->SetExitCode(errno);
-        p->started.set(std::pair<pid_t, pthread_t>(p->processId, p->threadId));
+        close(this->stdoutPipe[0]);
+        close(this->stdoutPipe[1]);
         goto Final;
     }
 
-    if (p->processId == 0)
+    assert(this->processId > 0);
+    this->started.set(this->processId);
+
+    // the handlers of the watches wait for the strand, so none runs before
+    // both watches are set up.
+    Reactor::GetInstance().Post(this->strand, [this]() { this->Monitor(); });
+
+    return;
+
+Final:
+    this->ReleaseResources();
+
+    Reactor::GetInstance().Post(this->strand, [this]()
     {
-        p->Run(path);
+        this->processExited = true;
+        this->outputEnded = true;
+        this->TryComplete();
+    });
+}
+
+void Process::ReleaseResources()
+{
+    int ret;
+    if (this->nativeCGroup)
+    {
+        auto& cgroup = CGroupController::GetInstance();
+        cgroup.Kill(this->cgroupName, true);
+        this->GetStatisticsFromCGroup();
+        ret = cgroup.Remove(this->cgroupName);
     }
     else
     {
-        assert(p->processId > 0);
-        p->started.set(std::pair<pid_t, pthread_t>(p->processId, p->threadId));
-        p->Monitor();
-    }
+        this->ExecuteCommandNoCapture("/bin/bash", "EndTask.sh", this->taskExecutionId, this->processId, "1", this->taskFolder);
+        this->GetStatisticsFromCGroup();
 
-Final:
-    p->ExecuteCommandNoCapture("/bin/bash", "EndTask.sh", p->taskExecutionId, p->processId, "1", p->taskFolder);
-    p->GetStatisticsFromCGroup();
+        ret = this->ExecuteCommandNoCapture("/bin/bash", "CleanupTask.sh", this->taskExecutionId, this->processId, this->taskFolder);
+    }
 
-    ret = p->ExecuteCommandNoCapture("/bin/bash", "CleanupTask.sh", p->taskExecutionId, p->processId, p->taskFolder);
+    this->cleanupResult = ret;
 
     // Only clean up the folder when success.
-    if (p->exitCode == 0)
-    {
-        p->ExecuteCommandNoCapture("rm -rf", p->taskFolder);
-    }
-
-    if (p->outputThreadId != 0)
+    if (this->exitCode == 0)
     {
-        int joinret = pthread_join(p->outputThreadId, nullptr);
-        if (joinret != 0)
+        ret = System::RemoveFolder(this->taskFolder);
+        if (ret != 0)
         {
-            Logger::Error(p->jobId, p->taskId, p->requeueCount, "Join the output thread id {0}, ret = {1}", p->outputThreadId, joinret);
+            Logger::Warn(this->jobId, this->taskId, this->requeueCount, "Failed to remove task folder {0}, ret {1}", this->taskFolder, ret);
         }
+    }
+}
 
-        p->outputThreadId = 0;
+void Process::TryComplete()
+{
+    // Both the process and the output have to end, the cgroup kill in
+    // ReleaseResources closes the pipe held by any remaining descendant.
+    if (!this->processExited || !this->outputEnded)
+    {
+        return;
     }
 
     // TODO: Add logic to precisely define 253 error.
-    if ((p->exitCode == 82 && ret == 96) || p->exitCode == 253)
+    if ((this->exitCode == 82 && this->cleanupResult == 96) || this->exitCode == 253)
     {
-        p->exitCodeSet = false;
-        p->exitCode = (int)hpc::common::ErrorCodes::DefaultExitCode;
-        Logger::Error(p->jobId, p->taskId, p->requeueCount, "Exit Code {0} Reset exit code and retry to fork()", p->exitCode);
-        goto Start;
-    }
+        this->exitCodeSet = false;
+        this->exitCode = (int)hpc::common::ErrorCodes::DefaultExitCode;
+        Logger::Error(this->jobId, this->taskId, this->requeueCount, "Exit Code {0} Reset exit code and retry to fork()", this->exitCode);
 
-    p->ended = true;
+        this->processExited = false;
+        this->outputEnded = false;
+        Reactor::GetInstance().PostBlocking([this]() { this->Launch(); });
+        return;
+    }
 
-    auto tmp = p->stdErr.str();
-    if (!tmp.empty()) { p->message << tmp; }
+    this->ended = true;
 
-    p->OnCompletedInternal();
+    auto tmp = this->stdErr.str();
+    if (!tmp.empty()) { this->message << tmp; }
 
-    p->ResetSelfPtr();
+    // The callback takes the job lock, which EndJob holds while terminating the
+    // tasks.
+    Reactor::GetInstance().PostBlocking([this]()
+    {
+        this->OnCompletedInternal();
 
-    pthread_detach(pthread_self());
-    pthread_exit(nullptr);
+        // The process may be deleted here.
+        this->ResetSelfPtr();
+    });
 }
 
-void* Process::ReadPipeThread(void* p)
+WatchAction Process::ReadPipe()
 {
-    Logger::Info("Started reading pipe thread");
-    auto* process = static_cast<Process*>(p);
-
-    const std::string& uri = process->stdOutFile;
-    close(process->stdoutPipe[1]);
+    if (this->outputStreamer)
+    {
+        return this->StreamPipe();
+    }
 
-    int bytesRead = 0;
+    ssize_t bytesRead = 0;
     char buffer[1024];
-    int order = 0;
-    while ((bytesRead = read(process->stdoutPipe[0], buffer, sizeof(buffer) - 1)) > 0)
+    while ((bytesRead = read(this->stdoutPipe[0], buffer, sizeof(buffer) - 1)) > 0)
     {
         buffer[bytesRead] = '\0';
-        auto readStr = String::Join("", buffer);
+        this->stdErr << buffer;
+    }
+
+    if (bytesRead < 0 && (errno == EAGAIN || errno == EINTR))
+    {
+        return WatchAction::Continue;
+    }
+
+    Logger::Debug("read end. streamOutput {0}", this->streamOutput);
 
-        Logger::Debug("read {0} bytes, streamOutput {1}", bytesRead, process->streamOutput);
-        if (process->streamOutput)
+    // the reactor closes the read end.
+    this->outputEnded = true;
+    this->TryComplete();
+
+    return WatchAction::Stop;
+}
+
+WatchAction Process::StreamPipe()
+{
+    while (true)
+    {
+        // The pipe is read straight into the free space of the ring.
+        size_t length = 0;
+        char* buffer = this->outputStreamer->GetWriteBuffer(length);
+        if (length == 0)
         {
-            // send out readStr
-            process->SendbackOutput(uri, readStr, order++);
+            Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Output buffer is full, pause reading");
+            return WatchAction::Pause;
         }
-        else
+
+        ssize_t bytesRead = read(this->stdoutPipe[0], buffer, length);
+        if (bytesRead > 0)
         {
-            process->stdErr << buffer;
+            this->outputStreamer->Commit(bytesRead);
+            continue;
         }
-    }
 
-    Logger::Debug("read end. treamOutput {0}", process->streamOutput);
-    if (process->streamOutput)
-    {
-        process->SendbackOutput(uri, std::string(), order++);
+        if (bytesRead < 0 && (errno == EAGAIN || errno == EINTR))
+        {
+            return WatchAction::Continue;
+        }
+
+        break;
     }
 
-    close(process->stdoutPipe[0]);
+    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "read end. streamOutput {0}", this->streamOutput);
+
+    // outputEnded is set after the Eof chunk is sent.
+    this->outputStreamer->End();
 
-    pthread_exit(nullptr);
+    return WatchAction::Stop;
 }
 
-void Process::SendbackOutput(const std::string& uri, const std::string& output, int order) const
+void Process::StartOutputStreamer()
 {
-    try
-    {
-        OutputData od(System::GetNodeName(), order, output);
+    // PeekOutput reads the streamer from other threads.
+    WriterLock writerLock(&this->lock);
+    this->outputStreamer = std::make_shared<OutputStreamer>(
+        this->jobId,
+        this->taskId,
+        this->requeueCount,
+        this->stdOutFile,
+        this->outputOrder,
+        OutputStreamer::GetConfiguredPolicy(),
+        [this]() { Reactor::GetInstance().Resume(this->outputWatchId); },
+        [this]()
+        {
+            Reactor::GetInstance().Post(this->strand, [this]()
+            {
+                // a relaunch continues the orders.
+                this->outputOrder = this->outputStreamer->GetNextOrder();
+                {
+                    WriterLock writerLock(&this->lock);
+                    this->outputStreamer.reset();
+                }
 
-        if (output.empty()) { od.Eof = true; }
+                this->outputEnded = true;
+                this->TryComplete();
+            });
+        });
+}
 
-        auto jsonBody = od.ToJson();
-        if (!jsonBody.is_null())
-        {
-            Logger::Debug(this->jobId, this->taskId, this->requeueCount,
-                "Callback to {0} with {1}", uri, jsonBody);
+void Process::Monitor()
+{
+    assert(this->processId > 0);
+    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Monitor the forked process {0}", this->processId);
 
-            auto client = HttpHelper::GetHttpClient(uri);
-            auto request = HttpHelper::GetHttpRequest(methods::POST, jsonBody);
-            http_response response = client->request(*request).get();
+    close(this->stdoutPipe[1]);
+    fcntl(this->stdoutPipe[0], F_SETFL, fcntl(this->stdoutPipe[0], F_GETFL) | O_NONBLOCK);
 
-            Logger::Info(this->jobId, this->taskId, this->requeueCount,
-                "Callback to {0} response code {1}", uri, response.status_code());
-        }
+    if (this->streamOutput)
+    {
+        this->StartOutputStreamer();
     }
-    catch (const std::exception& ex)
+
+    auto& reactor = Reactor::GetInstance();
+    this->outputWatchId = reactor.Watch(this->stdoutPipe[0], this->strand, [this]() { return this->ReadPipe(); });
+    if (0 == this->outputWatchId)
     {
-        Logger::Error(this->jobId, this->taskId, this->requeueCount,
-            "Exception when sending back output. {0}", ex.what());
+        if (this->outputStreamer) { this->outputStreamer->End(); }
+        else { this->outputEnded = true; }
     }
+
+    reactor.WatchProcess(this->processId, this->strand, [this]() { this->OnExited(); });
 }
 
-void Process::Monitor()
+void Process::OnExited()
 {
-    assert(this->processId > 0);
-    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Monitor the forked process {0}", this->processId);
+    this->Reap();
 
-    pthread_create(&this->outputThreadId, nullptr, Process::ReadPipeThread, this);
+    // The kill and the removal of the cgroup wait for the remaining processes.
+    Reactor::GetInstance().PostBlocking([this]()
+    {
+        this->ReleaseResources();
+
+        Reactor::GetInstance().Post(this->strand, [this]()
+        {
+            this->processExited = true;
+            this->TryComplete();
+        });
+    });
+}
 
+void Process::Reap()
+{
     int status;
     rusage usage;
     assert(this->processId > 0);
@@ -383,7 +548,7 @@ void Process::Monitor()
             int ret = 0;
             if (this->dumpStdout)
             {
-                ret = System::ExecuteCommandOut(output, "head -c 1500", this->stdOutFile);
+                ret = System::ReadFileHead(this->stdOutFile, ExitSnippetBytes, output);
                 if (ret == 0)
                 {
                     this->message << "STDOUT: " << output << std::endl;
@@ -392,7 +557,7 @@ void Process::Monitor()
 
             if (this->stdOutFile != this->stdErrFile)
             {
-                ret = System::ExecuteCommandOut(output, "head -c 1500", this->stdErrFile);
+                ret = System::ReadFileHead(this->stdErrFile, ExitSnippetBytes, output);
                 if (ret == 0)
                 {
                     this->message << "STDERR: " << output << std::endl;
@@ -420,27 +585,11 @@ void Process::Monitor()
         this->message << "Process " << this->processId << ": wait4 status " << status << std::endl;
     }
 
-    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Process {0}: Monitor ended", this->processId);
+    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Process {0}: Reaped", this->processId);
 }
 
-void Process::Run(const std::string& path)
+pid_t Process::Run(const std::string& path, int& error)
 {
-    if (this->streamOutput)
-    {
-        // in clusrun case, only monitor stdout, because stderr will be redirected
-        // to stdout
-        dup2(this->stdoutPipe[1], 1);
-    }
-    else
-    {
-        // in normal case, only monitor error messages from our own script
-        // customer script output will be redirected to the stdout/stderr file directly.
-        dup2(this->stdoutPipe[1], 2);
-    }
-
-    close(this->stdoutPipe[0]);
-    close(this->stdoutPipe[1]);
-
     std::vector<char> pathBuffer(path.cbegin(), path.cend());
     pathBuffer.push_back('\0');
 
@@ -452,18 +601,46 @@ void Process::Run(const std::string& path)
         &pathBuffer[0],
         const_cast<char* const>(this->userName.c_str()),
         const_cast<char* const>(this->taskFolder.c_str()),
+        const_cast<char* const>(this->nativeCGroup ? "1" : "0"),
         nullptr
     };
 
     auto envi = this->PrepareEnvironment();
 
-    int ret = execvpe(args[0], args, const_cast<char* const*>(envi.get()));
+    // in clusrun case, only monitor stdout, because stderr will be redirected
+    // to stdout.
+    // in normal case, only monitor error messages from our own script
+    // customer script output will be redirected to the stdout/stderr file directly.
+    return TaskLauncher::Launch(
+        this->launchMode,
+        args,
+        const_cast<char* const*>(envi.get()),
+        this->stdoutPipe[1],
+        this->streamOutput ? 1 : 2,
+        this->nativeCGroup ? &this->cgroupProcsFiles : nullptr,
+        error);
+}
+
+int Process::PrepareCGroup()
+{
+    std::string cpus = this->GetAffinity();
+    int ret = CGroupController::GetInstance().Create(this->cgroupName, cpus);
 
-    assert(ret == -1);
+    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Create cgroup {0}, cpus {1}, ret {2}", this->cgroupName, cpus, ret);
 
-    std::cout << "Error occurred when execvpe, errno = " << errno << std::endl;
+    if (ret != 0)
+    {
+        this->SetExitCode(ret);
+        this->message
+            << "Task " << this->taskId << ": failed to create cgroup " << this->cgroupName
+            << " with cpus " << cpus << ", exitCode " << ret << std::endl;
+
+        return ret;
+    }
 
-    exit(errno);
+    this->cgroupProcsFiles = CGroupController::GetInstance().GetProcsFiles(this->cgroupName);
+
+    return 0;
 }
 
 std::string Process::GetAffinity()
@@ -616,7 +793,7 @@ std::unique_ptr<const char* []> Process::PrepareEnvironment()
         std::back_inserter(this->environmentsBuffer),
         [](const auto& v) { return String::Join("=", v.first, v.second); });
 
-    auto envi = std::unique_ptr<const char* []>(new const char*[this->environments.size() + 1]);
+    auto envi = std::unique_ptr<const char* []>(new const char*[this->environmentsBuffer.size() + 1]);
     int p = 0;
     for_each(
         this->environmentsBuffer.cbegin(),
@@ -630,14 +807,25 @@ std::unique_ptr<const char* []> Process::PrepareEnvironment()
 
 std::string Process::PeekOutput()
 {
+    if (this->streamOutput)
+    {
+        std::shared_ptr<OutputStreamer> streamer;
+        {
+            ReaderLock readerLock(&this->lock);
+            streamer = this->outputStreamer;
+        }
+
+        return streamer ? streamer->GetTail(PeekBytes) : std::string();
+    }
+
     std::string output;
 
     int ret = 0;
     std::string stdout;
-    ret = System::ExecuteCommandOut(stdout, "tail -c 5000 2>&1", this->stdOutFile);
+    ret = System::ReadFileTail(this->stdOutFile, PeekBytes, stdout);
     if (ret != 0)
     {
-        stdout = String::Join(" ", "Reading", this->stdOutFile, "failed with exitcode", ret, ":", stdout);
+        stdout = String::Join(" ", "Reading", this->stdOutFile, "failed with errno", ret, ":", strerror(ret));
     }
 
     output = stdout;
@@ -645,10 +833,10 @@ std::string Process::PeekOutput()
     if (this->stdOutFile != this->stdErrFile)
     {
         std::string stderr;
-        ret = System::ExecuteCommandOut(stderr, "tail -c 5000 2>&1", this->stdErrFile);
+        ret = System::ReadFileTail(this->stdErrFile, PeekBytes, stderr);
         if (ret != 0)
         {
-            stderr = String::Join(" ", "Reading", this->stdErrFile, "failed with exitcode", ret, ":", stderr);
+            stderr = String::Join(" ", "Reading", this->stdErrFile, "failed with errno", ret, ":", strerror(ret));
         }
 
         output = String::Join("\n", "STDOUT:", stdout, "STDERR:", stderr);
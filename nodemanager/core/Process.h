@@ -6,6 +6,7 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <atomic>
 #include <unistd.h>
 #include <sys/signal.h>
 #include <pplx/pplxtasks.h>
@@ -15,8 +16,12 @@
 #include "../utils/String.h"
 #include "../utils/Logger.h"
 #include "../utils/System.h"
+#include "../utils/WorkerPool.h"
+#include "../utils/Reactor.h"
 #include "../common/ErrorCodes.h"
 #include "../data/ProcessStatistics.h"
+#include "TaskLauncher.h"
+#include "OutputStreamer.h"
 
 using namespace hpc::utils;
 
@@ -52,22 +57,34 @@ namespace hpc
 
                 virtual ~Process();
 
-                pplx::task<std::pair<pid_t, pthread_t>> Start(std::shared_ptr<Process> self);
+                pplx::task<pid_t> Start(std::shared_ptr<Process> self);
                 void Kill(int forcedExitCode = 0x0FFFFFFF, bool forced = true);
                 const hpc::data::ProcessStatistics& GetStatisticsFromCGroup();
 
+                // Waits for the processes of the task to exit after Kill, the whole
+                // cgroup for the native cgroups, otherwise the forked process only.
+                // Returns 0 or ETIMEDOUT.
+                int WaitForExit(int timeoutMs);
+
                 static void Cleanup();
 
                 pplx::task<void> OnCompleted();
 
                 int GetExitCode() const { return this->exitCode; }
+                bool IsNativeCGroup() const { return this->nativeCGroup; }
+                const std::string& GetCGroupName() const { return this->cgroupName; }
                 std::string GetExecutionMessage() const { return this->message.str(); }
 
                 void SetSelfPtr(std::shared_ptr<Process> self) { this->selfPtr.swap(self); }
                 void ResetSelfPtr() { this->selfPtr.reset(); }
 
+                // The last PeekBytes of the output, read by pread from the files or
+                // from the ring of the streamed output.
                 std::string PeekOutput();
 
+                static const size_t PeekBytes = 5000;
+                static const size_t ExitSnippetBytes = 1500;
+
             protected:
             private:
                 static bool StartWithHttpOrHttps(const std::string& path)
@@ -115,7 +132,9 @@ namespace hpc
                     return ret;
                 }
 
-                static void* ForkThread(void*);
+                void Launch();
+
+                int PrepareCGroup();
 
                 std::string GetAffinity();
                 static inline void OutputAffinity(std::ostringstream& oss, int start, int end)
@@ -124,10 +143,15 @@ namespace hpc
                     else if (start < end) { oss << "," << start << "-" << end; }
                 }
 
-                void Run(const std::string& path);
-                static void* ReadPipeThread(void* p);
-                void SendbackOutput(const std::string& uri, const std::string& output, int order) const;
+                pid_t Run(const std::string& path, int& error);
+                hpc::utils::WatchAction ReadPipe();
+                hpc::utils::WatchAction StreamPipe();
+                void StartOutputStreamer();
                 void Monitor();
+                void OnExited();
+                void Reap();
+                void ReleaseResources();
+                void TryComplete();
                 std::string BuildScript();
                 std::unique_ptr<const char* []> PrepareEnvironment();
                 void OnCompletedInternal();
@@ -159,19 +183,36 @@ namespace hpc
                 std::vector<std::string> environmentsBuffer;
                 bool streamOutput = false;
                 int stdoutPipe[2];
+                int outputOrder = 0;
+                std::shared_ptr<OutputStreamer> outputStreamer;
+                uint64_t outputWatchId = 0;
+
+                LaunchMode launchMode = LaunchMode::Fork;
+
+                // docker tasks are still managed by the scripts.
+                bool nativeCGroup = false;
+                const std::string cgroupName;
+                std::vector<std::string> cgroupProcsFiles;
 
                 const std::function<Callback> callback;
 
                 std::shared_ptr<Process> selfPtr;
 
-                pthread_t threadId = 0;
-                pthread_t outputThreadId = 0;
+                // The pipe reads and the exit of the process are handled one at a
+                // time on the reactor workers. The launch, the cleanup and the
+                // completion callback block, so they run on the blocking workers.
+                const std::shared_ptr<hpc::utils::WorkerPool::Strand> strand;
+                // written on the strand, read by Kill and WaitForExit meanwhile.
+                std::atomic<bool> processExited { false };
+                std::atomic<bool> outputEnded { false };
+                int cleanupResult = 0;
+
                 pid_t processId;
-                bool ended = false;
+                std::atomic<bool> ended { false };
 
                 pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
 
-                pplx::task_completion_event<std::pair<pid_t, pthread_t>> started;
+                pplx::task_completion_event<pid_t> started;
                 pplx::task_completion_event<void> completed;
         };
     }
@@ -22,7 +22,7 @@ using namespace hpc::filters;
 
 RemoteCommunicator::RemoteCommunicator(IRemoteExecutor& exec, const http_listener_config& config, const std::string& uri) :
     listeningUri(uri), isListening(false), localNodeName(System::GetNodeName()), executor(exec),
-    listener(listeningUri, config)
+    listener(listeningUri, config), forwarder(GetProxyMaxActive())
 {
     this->listener.support(
         methods::POST,
@@ -37,12 +37,15 @@ RemoteCommunicator::RemoteCommunicator(IRemoteExecutor& exec, const http_listene
 
     this->processors["startjobandtask"] = [this] (auto&& j, auto&& c) mutable -> pplx::task<json::value> { return this->StartJobAndTask(std::move(j), std::move(c)); };
     this->processors["starttask"] = [this] (auto&& j, auto&& c) mutable -> pplx::task<json::value> { return this->StartTask(std::move(j), std::move(c)); };
+    this->processors["starttasks"] = [this] (auto&& j, auto&& c) mutable -> pplx::task<json::value> { return this->StartTasks(std::move(j), std::move(c)); };
     this->processors["endjob"] = [this] (auto&& j, auto&& c) mutable -> pplx::task<json::value> { return this->EndJob(std::move(j), std::move(c)); };
     this->processors["endtask"] = [this] (auto&& j, auto&& c) { return this->EndTask(std::move(j), std::move(c)); };
     this->processors["ping"] = [this] (auto&& j, auto&& c) { return this->Ping(std::move(j), std::move(c)); };
     this->processors["metric"] = [this] (auto&& j, auto&& c) { return this->Metric(std::move(j), std::move(c)); };
     this->processors["metricconfig"] = [this] (auto&& j, auto&& c) { return this->MetricConfig(std::move(j), std::move(c)); };
     this->processors["peektaskoutput"] = [this] (auto&& j, auto&& c) { return this->PeekTaskOutput(std::move(j), std::move(c)); };
+    this->processors["taskmetrics"] = [this] (auto&& j, auto&& c) { return this->TaskMetrics(std::move(j), std::move(c)); };
+    this->processors["metrichistory"] = [this] (auto&& j, auto&& c) { return this->MetricHistory(std::move(j), std::move(c)); };
 }
 
 RemoteCommunicator::~RemoteCommunicator()
@@ -89,6 +92,22 @@ void RemoteCommunicator::Close()
     }
 }
 
+int RemoteCommunicator::GetProxyMaxActive()
+{
+    int maxActive = RequestForwarder::DefaultMaxActive;
+
+    try
+    {
+        maxActive = NodeManagerConfig::GetProxyMaxConcurrency();
+    }
+    catch (...)
+    {
+        Logger::Info("ProxyMaxConcurrency not specified or invalid, use the default {0}.", maxActive);
+    }
+
+    return maxActive;
+}
+
 void RemoteCommunicator::HandleGet(http_request request)
 {
     auto uri = request.relative_uri().to_string();
@@ -96,6 +115,8 @@ void RemoteCommunicator::HandleGet(http_request request)
 
     json::value body;
     body["status"] = json::value::string("node manager working");
+    body["httpClientPool"] = HttpClientPool::GetInstance().GetStatisticsJson();
+    body["proxy"] = this->forwarder.GetStatisticsJson();
     request.reply(status_codes::OK, body).then([this](auto t) { this->IsError(t); });
 }
 
@@ -134,7 +155,7 @@ void RemoteCommunicator::HandlePost(http_request request)
         Logger::Debug("AuthenticationKey found");
     }
 
-    if (NodeManagerConfig::GetClusterAuthenticationKey() != authenticationKey)
+    if (NodeManagerConfig::GetSnapshot()->ClusterAuthenticationKey.Get() != authenticationKey)
     {
         Logger::Warn("Authentication key validation failed.");
         request.reply(status_codes::Unauthorized, "").then([this](auto t) { this->IsError(t); });
@@ -151,47 +172,25 @@ void RemoteCommunicator::HandlePost(http_request request)
 
     if (nodeName != this->localNodeName)
     {
-        // proxy to other node.
-        request.extract_json().then(
-        [callbackUri, nodeName, this, request, apiSpace, methodName] (pplx::task<json::value> t)
-        {
-            auto j = t.get();
-
-            auto req = HttpHelper::GetHttpRequest(methods::POST, j, callbackUri);
+        // proxy to other node, the body is streamed through without parsing.
+        uri_builder uriBuilder(this->listeningUri);
 
-            uri_builder uriBuilder(this->listeningUri);
-
-            if (nodeName == "LOCALHOST")
-            {
-                // only for test purpose, redirect the localhost to the local node name.
-                uriBuilder.set_path(String::Join("", "/", apiSpace, "/", this->localNodeName, "/", methodName));
-            }
-            else
-            {
-                uriBuilder.set_path(request.relative_uri().to_string());
-            }
+        if (nodeName == "LOCALHOST")
+        {
+            // only for test purpose, redirect the localhost to the local node name.
+            uriBuilder.set_path(String::Join("", "/", apiSpace, "/", this->localNodeName, "/", methodName));
+        }
+        else
+        {
+            uriBuilder.set_path(request.relative_uri().to_string());
+        }
 
-            uriBuilder.set_host(nodeName);
+        uriBuilder.set_host(nodeName);
 
-            auto newUri = uriBuilder.to_string();
-            auto cli = HttpHelper::GetHttpClient(newUri);
-            Logger::Info("Proxy to {0}", newUri);
+        auto newUri = uriBuilder.to_string();
+        Logger::Info("Proxy to {0}", newUri);
 
-            cli->request(*req).then([request, newUri](pplx::task<http_response> responseTask)
-            {
-                try
-                {
-                    auto response = responseTask.get();
-                    Logger::Info("Proxy result from {0} response code {1}", newUri, response.status_code());
-                    request.reply(response).then([](auto t) { IsError(t); });
-                }
-                catch (const std::exception& ex)
-                {
-                    Logger::Error("Error when get response {0}", ex.what());
-                    request.reply(http::status_codes::InternalError, json::value(ex.what())).then([](auto t) { IsError(t); });
-                }
-            });
-        });
+        this->forwarder.Forward(request, newUri);
 
         return;
     }
@@ -269,6 +268,17 @@ pplx::task<json::value> RemoteCommunicator::StartTask(json::value&& val, std::st
     });
 }
 
+pplx::task<json::value> RemoteCommunicator::StartTasks(json::value&& val, std::string&& callbackUri)
+{
+    return this->filter.OnTasksStart(val).then(
+    [this, callback = std::move(callbackUri)](pplx::task<json::value> t)
+    {
+        auto filteredJson = t.get();
+        auto uri = callback;
+        return this->executor.StartTasks(StartTasksArgs::FromJson(filteredJson), std::move(uri));
+    });
+}
+
 pplx::task<json::value> RemoteCommunicator::EndJob(json::value&& val, std::string&& callbackUri)
 {
     auto args = EndJobArgs::FromJson(val);
@@ -304,5 +314,17 @@ pplx::task<json::value> RemoteCommunicator::PeekTaskOutput(json::value&& val, st
     return this->executor.PeekTaskOutput(std::move(args));
 }
 
+pplx::task<json::value> RemoteCommunicator::TaskMetrics(json::value&& val, std::string&& callbackUri)
+{
+    auto args = TaskMetricsArgs::FromJson(val);
+    return this->executor.TaskMetrics(std::move(args));
+}
+
+pplx::task<json::value> RemoteCommunicator::MetricHistory(json::value&& val, std::string&& callbackUri)
+{
+    auto args = MetricHistoryArgs::FromJson(val);
+    return this->executor.MetricHistory(std::move(args));
+}
+
 const std::string RemoteCommunicator::ApiSpace = "api";
 
@@ -7,6 +7,7 @@
 #include "../utils/Logger.h"
 #include "../filters/ExecutionFilter.h"
 #include "IRemoteExecutor.h"
+#include "RequestForwarder.h"
 
 namespace hpc
 {
@@ -30,6 +31,8 @@ namespace hpc
                 void HandlePost(web::http::http_request message);
                 void HandleGet(web::http::http_request message);
 
+                static int GetProxyMaxActive();
+
                 template <typename T>
                 static bool IsError(pplx::task<T>& t, std::string& errorMessage)
                 {
@@ -57,12 +60,15 @@ namespace hpc
 
                 pplx::task<json::value> StartJobAndTask(json::value&& val, std::string&&);
                 pplx::task<json::value> StartTask(json::value&& val, std::string&&);
+                pplx::task<json::value> StartTasks(json::value&& val, std::string&&);
                 pplx::task<json::value> EndJob(json::value&& val, std::string&&);
                 pplx::task<json::value> EndTask(json::value&& val, std::string&&);
                 pplx::task<json::value> Ping(json::value&& val, std::string&&);
                 pplx::task<json::value> Metric(json::value&& val, std::string&&);
                 pplx::task<json::value> MetricConfig(json::value&& val, std::string&&);
                 pplx::task<json::value> PeekTaskOutput(json::value&& val, std::string&&);
+                pplx::task<json::value> TaskMetrics(json::value&& val, std::string&&);
+                pplx::task<json::value> MetricHistory(json::value&& val, std::string&&);
 
                 static const std::string ApiSpace;
                 const std::string listeningUri;
@@ -76,6 +82,7 @@ namespace hpc
 
                 web::http::experimental::listener::http_listener listener;
                 ExecutionFilter filter;
+                RequestForwarder forwarder;
         };
     }
 }
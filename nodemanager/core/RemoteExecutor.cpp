@@ -10,11 +10,13 @@
 #include "../utils/WriterLock.h"
 #include "../utils/ReaderLock.h"
 #include "../utils/Logger.h"
+#include "../utils/Reactor.h"
 #include "../utils/System.h"
 #include "../common/ErrorCodes.h"
 #include "../data/ProcessStatistics.h"
 #include "NodeManagerConfig.h"
 #include "HttpHelper.h"
+#include "CGroupController.h"
 
 using namespace web::http;
 using namespace web;
@@ -24,9 +26,27 @@ using namespace hpc::arguments;
 using namespace hpc::data;
 using namespace hpc::common;
 
-RemoteExecutor::RemoteExecutor(const std::string& networkName)
+RemoteExecutor::RemoteExecutor(const std::string& networkName, UserProvisioner* provisioner)
     : monitor(System::GetNodeName(), networkName, MetricReportInterval), lock(PTHREAD_RWLOCK_INITIALIZER)
 {
+    if (provisioner == nullptr)
+    {
+        int lingerSeconds = UserProvisioner::DefaultKeyLingerSeconds;
+
+        try
+        {
+            lingerSeconds = NodeManagerConfig::GetUserKeyLingerSeconds();
+        }
+        catch (...)
+        {
+            Logger::Info("UserKeyLingerSeconds not specified or invalid, use the default {0} seconds.", lingerSeconds);
+        }
+
+        provisioner = new UserProvisioner(lingerSeconds);
+    }
+
+    this->userProvisioner = std::unique_ptr<UserProvisioner>(provisioner);
+
     this->registerReporter =
         std::unique_ptr<Reporter<json::value>>(
             new HttpReporter(
@@ -42,13 +62,15 @@ RemoteExecutor::RemoteExecutor(const std::string& networkName)
     this->StartHeartbeat();
     this->StartMetric();
     this->StartHostsManager();
+    this->StartTaskCompletionQueue();
+    this->StartTaskTelemetry();
+
+    this->configListenerId = NodeManagerConfig::AddReloadListener([this]() { this->OnConfigReloaded(); });
 }
 
 pplx::task<json::value> RemoteExecutor::StartJobAndTask(StartJobAndTaskArgs&& args, std::string&& callbackUri)
 {
     {
-        WriterLock writerLock(&this->lock);
-
         const auto& envi = args.StartInfo.EnvironmentVariables;
         auto isAdminIt = envi.find("CCP_ISADMIN");
         bool isAdmin = isAdminIt != envi.end() && isAdminIt->second == "1";
@@ -61,7 +83,7 @@ pplx::task<json::value> RemoteExecutor::StartJobAndTask(StartJobAndTaskArgs&& ar
         bool isWindowsSystemAccount = boost::iequals(args.UserName, WindowsSystemUser);
 
         std::string userName;
-        bool existed;
+        bool createUser;
 
         // Use root user in 3 scenarios:
         // 1. This is old image, username is empty, we use root.
@@ -70,7 +92,7 @@ pplx::task<json::value> RemoteExecutor::StartJobAndTask(StartJobAndTaskArgs&& ar
         if (args.UserName.empty() || mapAdminToRoot || isWindowsSystemAccount)
         {
             userName = "root";
-            existed = true;
+            createUser = false;
         }
         else
         {
@@ -78,68 +100,31 @@ pplx::task<json::value> RemoteExecutor::StartJobAndTask(StartJobAndTaskArgs&& ar
             bool preserveDomain = preserveDomainIt != envi.end() && preserveDomainIt->second == "1";
             userName = preserveDomain ? args.UserName : String::GetUserName(args.UserName);
             if (userName == "root") { userName = "hpc_faked_root"; }
-            int ret = System::CreateUser(userName, args.Password, isAdmin);
-            existed = ret == 9;
-            if (ret != 0 && ret != 9)
-            {
-                throw std::runtime_error(
-                    String::Join(" ", "Create user", userName, "failed with error code", ret));
-            }
-
-            Logger::Debug(args.JobId, args.TaskId, this->UnknowId, "Create user {0} return code: {1}.", userName, ret);
+            createUser = true;
         }
 
-        bool privateKeyAdded = false;
-        bool publicKeyAdded = false;
-        bool authKeyAdded = false;
-
         // Set SSH keys in 3 scenarios:
         // 1. User is not a Windows or HPC Administrator.
         // 2. User is Windows or HPC Administrator and it is mapped to non-root user in Linux.
         // 3. User is Windows local system account, which is mapped to Linux root user.
-        if (!isAdmin || mapAdminToUser || isWindowsSystemAccount)
-        {
-            std::string privateKeyFile;
-            privateKeyAdded = 0 == System::AddSshKey(userName, args.PrivateKey, "id_rsa", "600", privateKeyFile);
+        bool addKeys = !isAdmin || mapAdminToUser || isWindowsSystemAccount;
 
-            if (privateKeyAdded && args.PublicKey.empty())
-            {
-                int ret = System::ExecuteCommandOut(args.PublicKey, "ssh-keygen -y -f ", privateKeyFile);
-                if (ret != 0)
-                {
-                    Logger::Error(args.JobId, args.TaskId, this->UnknowId, "Retrieve public key failed with exitcode {0}.", ret);
-                }
-            }
-
-            std::string publicKeyFile;
-            publicKeyAdded = privateKeyAdded && (0 == System::AddSshKey(userName, args.PublicKey, "id_rsa.pub", "644", publicKeyFile));
-
-            std::string userAuthKeyFile;
-            authKeyAdded = privateKeyAdded && publicKeyAdded && (0 == System::AddAuthorizedKey(userName, args.PublicKey, "600", userAuthKeyFile));
-
-            Logger::Debug(args.JobId, args.TaskId, this->UnknowId,
-                "Add ssh key for user {0} result: private {1}, public {2}, auth {3}",
-                userName, privateKeyAdded, publicKeyAdded, authKeyAdded);
+        // The jobs of other users are not blocked by the provisioning.
+        int ret = this->userProvisioner->Acquire(args.JobId, userName, args.Password, isAdmin, createUser, addKeys, args.PrivateKey, args.PublicKey);
+        if (ret != 0)
+        {
+            throw std::runtime_error(
+                String::Join(" ", "Create user", userName, "failed with error code", ret));
         }
 
+        WriterLock writerLock(&this->lock);
+
         if (this->jobUsers.find(args.JobId) == this->jobUsers.end())
         {
             Logger::Debug(args.JobId, args.TaskId, this->UnknowId,
                 "Create user: jobUsers entry added.");
 
-            this->jobUsers[args.JobId] =
-                std::tuple<std::string, bool, bool, bool, bool, std::string>(userName, existed, privateKeyAdded, publicKeyAdded, authKeyAdded, args.PublicKey);
-        }
-
-        auto it = this->userJobs.find(userName);
-
-        if (it != this->userJobs.end())
-        {
-            it->second.insert(args.JobId);
-        }
-        else
-        {
-            this->userJobs[userName] = { args.JobId };
+            this->jobUsers[args.JobId] = userName;
         }
     }
 
@@ -148,34 +133,137 @@ pplx::task<json::value> RemoteExecutor::StartJobAndTask(StartJobAndTaskArgs&& ar
 
 pplx::task<json::value> RemoteExecutor::StartTask(StartTaskArgs&& args, std::string&& callbackUri)
 {
-    WriterLock writerLock(&this->lock);
+    LockTable<int>::Guard jobGuard(this->jobLocks, args.JobId);
 
     bool isNewEntry;
     std::shared_ptr<TaskInfo> taskInfo = this->jobTaskTable.AddJobAndTask(args.JobId, args.TaskId, isNewEntry);
 
-    taskInfo->Affinity = args.StartInfo.Affinity;
-    taskInfo->SetTaskRequeueCount(args.StartInfo.TaskRequeueCount);
-
-    std::string userName = "root";
-    auto jobUser = this->jobUsers.find(args.JobId);
-    if (jobUser == this->jobUsers.end())
+    std::string userName = this->GetJobUser(args.JobId);
+    if (userName.empty())
     {
         this->jobTaskTable.RemoveJob(args.JobId);
         throw std::runtime_error(String::Join(" ", "Job", args.JobId, "was not started on this node."));
     }
-    else
+
+    std::string message;
+    this->StartTaskProcess(std::move(args), taskInfo, isNewEntry, userName, std::move(callbackUri), message);
+
+    return pplx::task_from_result(json::value());
+}
+
+pplx::task<json::value> RemoteExecutor::StartTasks(StartTasksArgs&& args, std::string&& callbackUri)
+{
+    auto getResult = [](int jobId, int taskId, bool succeeded, const std::string& message)
     {
-        userName = std::get<0>(jobUser->second);
+        json::value result;
+        result["JobId"] = jobId;
+        result["TaskId"] = taskId;
+        result["Succeeded"] = succeeded;
+        result["Message"] = json::value::string(message);
+        return result;
+    };
+
+    std::vector<json::value> results(args.Tasks.size());
+
+    // the tasks of each job are added in one transaction under the job lock, the
+    // processes launch on their own strands in parallel.
+    std::map<int, std::vector<size_t>> jobTasks;
+    for (size_t i = 0; i < args.Tasks.size(); i++)
+    {
+        if (!args.Errors[i].empty())
+        {
+            results[i] = getResult(args.Tasks[i].JobId, args.Tasks[i].TaskId, false, args.Errors[i]);
+            continue;
+        }
+
+        jobTasks[args.Tasks[i].JobId].push_back(i);
+    }
+
+    for (const auto& job : jobTasks)
+    {
+        int jobId = job.first;
+        const auto& indexes = job.second;
+
+        LockTable<int>::Guard jobGuard(this->jobLocks, jobId);
+
+        std::string userName = this->GetJobUser(jobId);
+        if (userName.empty())
+        {
+            std::string message = String::Join(" ", "Job", jobId, "was not started on this node.");
+            for (size_t i : indexes)
+            {
+                results[i] = getResult(jobId, args.Tasks[i].TaskId, false, message);
+            }
+
+            continue;
+        }
+
+        std::vector<int> taskIds;
+        for (size_t i : indexes)
+        {
+            taskIds.push_back(args.Tasks[i].TaskId);
+        }
+
+        std::vector<bool> isNewEntries;
+        auto taskInfos = this->jobTaskTable.AddJobAndTasks(jobId, taskIds, isNewEntries);
+
+        for (size_t k = 0; k < indexes.size(); k++)
+        {
+            bool succeeded = false;
+            std::string message;
+
+            try
+            {
+                std::string uri = callbackUri;
+                succeeded = this->StartTaskProcess(std::move(args.Tasks[indexes[k]]), taskInfos[k], isNewEntries[k], userName, std::move(uri), message);
+            }
+            catch (const std::exception& ex)
+            {
+                message = ex.what();
+                Logger::Error(jobId, taskIds[k], this->UnknowId, "StartTasks: {0}", message);
+            }
+
+            results[indexes[k]] = getResult(jobId, taskIds[k], succeeded, message);
+        }
     }
 
+    Logger::Info("StartTasks: {0} tasks of {1} jobs, process count {2}", args.Tasks.size(), jobTasks.size(), this->GetProcessCount());
+
+    return pplx::task_from_result(json::value::array(results));
+}
+
+std::string RemoteExecutor::GetJobUser(int jobId)
+{
+    ReaderLock readerLock(&this->lock);
+
+    auto jobUser = this->jobUsers.find(jobId);
+    return jobUser != this->jobUsers.end() ? jobUser->second : std::string();
+}
+
+bool RemoteExecutor::StartTaskProcess(
+    StartTaskArgs&& args, std::shared_ptr<TaskInfo> taskInfo, bool isNewEntry,
+    const std::string& userName, std::string&& callbackUri, std::string& message)
+{
+    bool succeeded = false;
+
+    std::string dockerImage = args.StartInfo.EnvironmentVariables["CCP_DOCKER_IMAGE"];
+    bool isMpiContainer = args.StartInfo.CommandLine.empty() && !dockerImage.empty();
+
+    this->jobTaskTable.UpdateTask(taskInfo, [&args, isMpiContainer](TaskInfo& t)
+    {
+        t.Affinity = args.StartInfo.Affinity;
+        t.SetTaskRequeueCount(args.StartInfo.TaskRequeueCount);
+        if (isMpiContainer) { t.IsPrimaryTask = false; }
+    });
+
     if (args.StartInfo.CommandLine.empty())
     {
-        Logger::Info(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, "MPI non-master task found, skip creating the process.");
-        std::string dockerImage = args.StartInfo.EnvironmentVariables["CCP_DOCKER_IMAGE"];
+        succeeded = true;
+        message = "MPI non-master task found, skip creating the process.";
+        Logger::Info(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, "{0}", message);
         std::string isNvidiaDocker = args.StartInfo.EnvironmentVariables["CCP_DOCKER_NVIDIA"];
-        if (!dockerImage.empty())
+        if (isMpiContainer)
         {
-            taskInfo->IsPrimaryTask = false;
             std::string output;
             int ret = System::ExecuteCommandOut(output, "/bin/bash 2>&1", "StartMpiContainer.sh", taskInfo->TaskId, userName, dockerImage, isNvidiaDocker);
             if (ret == 0)
@@ -190,7 +278,7 @@ pplx::task<json::value> RemoteExecutor::StartTask(StartTaskArgs&& args, std::str
     }
     else
     {
-        if (this->processes.find(taskInfo->ProcessKey) == this->processes.end() &&
+        if (!this->FindProcess(taskInfo->ProcessKey) &&
             isNewEntry)
         {
             auto process = std::shared_ptr<Process>(new Process(
@@ -216,10 +304,17 @@ pplx::task<json::value> RemoteExecutor::StartTask(StartTaskArgs&& args, std::str
                     {
                         json::value jsonBody;
 
-                        taskInfo->CancelGracefulThread();
+                        taskInfo->CancelGracePeriodTimer();
 
+                        // the task ended by EndTask is not sampled any more either.
+                        json::value telemetry;
+                        if (this->taskTelemetry)
                         {
-                            WriterLock writerLock(&this->lock);
+                            telemetry = this->taskTelemetry->Remove(taskInfo->ProcessKey);
+                        }
+
+                        {
+                            LockTable<int>::Guard jobGuard(this->jobLocks, taskInfo->JobId);
 
                             if (taskInfo->Exited)
                             {
@@ -228,10 +323,14 @@ pplx::task<json::value> RemoteExecutor::StartTask(StartTaskArgs&& args, std::str
                             }
                             else
                             {
-                                taskInfo->Exited = true;
-                                taskInfo->ExitCode = exitCode;
-                                taskInfo->Message = std::move(message);
-                                taskInfo->AssignFromStat(stat);
+                                this->jobTaskTable.UpdateTask(taskInfo, [&](TaskInfo& t)
+                                {
+                                    t.Exited = true;
+                                    t.ExitCode = exitCode;
+                                    t.Message = std::move(message);
+                                    t.AssignFromStat(stat);
+                                    t.Telemetry = std::move(telemetry);
+                                });
 
                                 jsonBody = taskInfo->ToCompletionEventArgJson();
                             }
@@ -253,74 +352,98 @@ pplx::task<json::value> RemoteExecutor::StartTask(StartTaskArgs&& args, std::str
                         "attemptId {0}, processKey {1}, erasing process", taskInfo->GetAttemptId(), taskInfo->ProcessKey);
 
                     {
-                        WriterLock writerLock(&this->lock);
+                        // TerminateTask uses the statistics of the process under the job lock.
+                        LockTable<int>::Guard jobGuard(this->jobLocks, taskInfo->JobId);
 
                         // Process will be deleted here.
-                        this->processes.erase(taskInfo->ProcessKey);
+                        this->RemoveProcess(taskInfo->ProcessKey);
                     }
                 }));
 
-            this->processes[taskInfo->ProcessKey] = process;
+            this->AddProcess(taskInfo->ProcessKey, process);
+
+            if (this->taskTelemetry && process->IsNativeCGroup())
+            {
+                int cores = 0;
+                for (uint64_t mask : taskInfo->Affinity)
+                {
+                    cores += __builtin_popcountll(mask);
+                }
+
+                this->taskTelemetry->Add(taskInfo->ProcessKey, process->GetCGroupName(), cores);
+            }
             Logger::Debug(
                 args.JobId, args.TaskId, taskInfo->GetTaskRequeueCount(),
-                "StartTask for ProcessKey {0}, process count {1}", taskInfo->ProcessKey, this->processes.size());
+                "StartTask for ProcessKey {0}, process count {1}", taskInfo->ProcessKey, this->GetProcessCount());
 
-            process->Start(process).then([this, taskInfo] (std::pair<pid_t, pthread_t> ids)
+            succeeded = true;
+            process->Start(process).then([this, taskInfo] (pid_t pid)
             {
-                if (ids.first > 0)
+                if (pid > 0)
                 {
                     Logger::Debug(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
-                        "Process started pid {0}, tid {1}", ids.first, ids.second);
+                        "Process started pid {0}", pid);
                 }
             });
         }
         else
         {
-            Logger::Warn(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
-                "The task has started already.");
+            // a repeated start succeeds as the single starttask does.
+            succeeded = true;
+            message = "The task has started already.";
+            Logger::Warn(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(), "{0}", message);
         }
     }
 
-    return pplx::task_from_result(json::value());
+    return succeeded;
 }
 
 pplx::task<json::value> RemoteExecutor::EndJob(hpc::arguments::EndJobArgs&& args)
 {
-    WriterLock writerLock(&this->lock);
+    LockTable<int>::Guard jobGuard(this->jobLocks, args.JobId);
 
     Logger::Info(args.JobId, this->UnknowId, this->UnknowId, "EndJob: starting");
 
-    auto jobInfo = this->jobTaskTable.RemoveJob(args.JobId);
-
-    json::value jsonBody;
+    // The tasks are terminated while the job is still in the table, so the
+    // reports see their final state before the removal of the job.
+    auto tasks = this->jobTaskTable.GetTasks(args.JobId);
 
-    if (jobInfo)
+    for (auto& taskInfo : tasks)
     {
-        for (auto& taskPair : jobInfo->Tasks)
+        const auto* stat = this->TerminateTask(
+            args.JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
+            taskInfo->ProcessKey, (int)ErrorCodes::EndJobExitCode, true, !taskInfo->IsPrimaryTask);
+        Logger::Debug(args.JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(), "EndJob: Terminating task");
+        if (stat != nullptr)
         {
-            auto taskInfo = taskPair.second;
-
-            if (taskInfo)
+            json::value telemetry;
+            if (this->taskTelemetry)
             {
-                const auto* stat = this->TerminateTask(
-                    args.JobId, taskPair.first, taskInfo->GetTaskRequeueCount(),
-                    taskInfo->ProcessKey, (int)ErrorCodes::EndJobExitCode, true, !taskInfo->IsPrimaryTask);
-                Logger::Debug(args.JobId, taskPair.first, taskInfo->GetTaskRequeueCount(), "EndJob: Terminating task");
-                if (stat != nullptr)
-                {
-                    taskInfo->Exited = stat->IsTerminated();
-                    taskInfo->ExitCode = (int)ErrorCodes::EndJobExitCode;
-                    taskInfo->AssignFromStat(*stat);
-                    taskInfo->CancelGracefulThread();
-                }
+                telemetry = this->taskTelemetry->GetSummary(taskInfo->ProcessKey);
             }
-            else
+
+            this->jobTaskTable.UpdateTask(taskInfo, [stat, &telemetry](TaskInfo& t)
             {
-                Logger::Warn(args.JobId, taskPair.first, this->UnknowId,
-                    "EndJob: Task is already finished");
+                t.Exited = stat->IsTerminated();
+                t.ExitCode = (int)ErrorCodes::EndJobExitCode;
+                t.AssignFromStat(*stat);
+                t.Telemetry = std::move(telemetry);
+            });
 
-                assert(false);
-            }
+            taskInfo->CancelGracePeriodTimer();
+        }
+    }
+
+    auto jobInfo = this->jobTaskTable.RemoveJob(args.JobId);
+
+    json::value jsonBody;
+
+    if (jobInfo)
+    {
+        // the tasks completed meanwhile are reported as well.
+        for (auto& taskInfo : tasks)
+        {
+            jobInfo->Tasks[taskInfo->TaskId] = taskInfo;
         }
 
         jsonBody = jobInfo->ToJson();
@@ -331,87 +454,24 @@ pplx::task<json::value> RemoteExecutor::EndJob(hpc::arguments::EndJobArgs&& args
         Logger::Warn(args.JobId, this->UnknowId, this->UnknowId, "EndJob: Job is already finished");
     }
 
-    auto jobUser = this->jobUsers.find(args.JobId);
-
-    if (jobUser != this->jobUsers.end())
+    std::string jobUserName;
     {
-        Logger::Info(args.JobId, this->UnknowId, this->UnknowId, "EndJob: Cleanup user {0}", std::get<0>(jobUser->second));
-        auto userJob = this->userJobs.find(std::get<0>(jobUser->second));
-
-        bool cleanupUser = false;
-        if (userJob == this->userJobs.end())
-        {
-            cleanupUser = true;
-        }
-        else
-        {
-            userJob->second.erase(args.JobId);
-
-            // cleanup when no one is using the user;
-            cleanupUser = userJob->second.empty();
-            Logger::Info(args.JobId, this->UnknowId, this->UnknowId,
-                "EndJob: {0} jobs associated with the user {1}", userJob->second.size(), std::get<0>(jobUser->second));
-
-            if (cleanupUser)
-            {
-                this->userJobs.erase(userJob);
-            }
-        }
+        WriterLock writerLock(&this->lock);
 
-        if (cleanupUser)
+        auto jobUser = this->jobUsers.find(args.JobId);
+        if (jobUser != this->jobUsers.end())
         {
-            std::string userName, publicKey;
-            bool existed, privateKeyAdded, publicKeyAdded, authKeyAdded;
-
-            std::tie(userName, existed, privateKeyAdded, publicKeyAdded, authKeyAdded, publicKey) = jobUser->second;
-
-            // the existed could be true for the later job, so the user will be left
-            // on the node, which is by design.
-            // we just have this delete user logic for a simple way of cleanup.
-            // if delete user failed, cleanup keys as necessary.
-
-            bool cleanupKeys = true;
-
-//            if (!existed)
-//            {
-//                if (!userName.empty())
-//                {
-//                    Logger::Info(args.JobId, this->UnknowId, this->UnknowId,
-//                        "EndJob: Delete user {0}", userName);
-//
-//                    cleanupKeys = 0 != System::DeleteUser(userName);
-//                }
-//            }
-
-            if (cleanupKeys)
-            {
-                if (privateKeyAdded)
-                {
-                    Logger::Info(args.JobId, this->UnknowId, this->UnknowId,
-                        "EndJob: RemoveSshKey id_rsa: {0}", userName);
-
-                    System::RemoveSshKey(userName, "id_rsa");
-                }
-
-                if (publicKeyAdded)
-                {
-                    Logger::Info(args.JobId, this->UnknowId, this->UnknowId,
-                        "EndJob: RemoveSshKey id_rsa.pub: {0}", userName);
-
-                    System::RemoveSshKey(userName, "id_rsa.pub");
-                }
-
-                if (authKeyAdded)
-                {
-                    Logger::Info(args.JobId, this->UnknowId, this->UnknowId,
-                        "EndJob: RemoveAuthorizedKey {0}", userName);
-
-                    System::RemoveAuthorizedKey(userName, publicKey);
-                }
-            }
+            jobUserName = jobUser->second;
+            this->jobUsers.erase(jobUser);
         }
+    }
 
-        this->jobUsers.erase(jobUser);
+    if (!jobUserName.empty())
+    {
+        // the keys are removed after the last job of the user, the user will be
+        // left on the node, which is by design.
+        Logger::Info(args.JobId, this->UnknowId, this->UnknowId, "EndJob: Cleanup user {0}", jobUserName);
+        this->userProvisioner->Release(args.JobId, jobUserName);
     }
 
     return pplx::task_from_result(jsonBody);
@@ -419,7 +479,7 @@ pplx::task<json::value> RemoteExecutor::EndJob(hpc::arguments::EndJobArgs&& args
 
 pplx::task<json::value> RemoteExecutor::EndTask(hpc::arguments::EndTaskArgs&& args, std::string&& callbackUri)
 {
-    ReaderLock readerLock(&this->lock);
+    LockTable<int>::Guard jobGuard(this->jobLocks, args.JobId);
     Logger::Info(args.JobId, args.TaskId, this->UnknowId, "EndTask: starting");
 
     auto taskInfo = this->jobTaskTable.GetTask(args.JobId, args.TaskId);
@@ -431,7 +491,7 @@ pplx::task<json::value> RemoteExecutor::EndTask(hpc::arguments::EndTaskArgs&& ar
         Logger::Debug(
             args.JobId, args.TaskId, taskInfo->GetTaskRequeueCount(),
             "EndTask for ProcessKey {0}, processes count {1}",
-            taskInfo->ProcessKey, this->processes.size());
+            taskInfo->ProcessKey, this->GetProcessCount());
 
         const auto* stat = this->TerminateTask(
             args.JobId, args.TaskId, taskInfo->GetTaskRequeueCount(),
@@ -440,31 +500,46 @@ pplx::task<json::value> RemoteExecutor::EndTask(hpc::arguments::EndTaskArgs&& ar
             args.TaskCancelGracePeriodSeconds == 0,
             !taskInfo->IsPrimaryTask);
 
-        taskInfo->ExitCode = (int)ErrorCodes::EndTaskExitCode;
+        json::value telemetry;
+        if (stat != nullptr && this->taskTelemetry)
+        {
+            telemetry = this->taskTelemetry->GetSummary(taskInfo->ProcessKey);
+        }
 
-        if (stat == nullptr || stat->IsTerminated())
+        bool terminated = stat == nullptr || stat->IsTerminated();
+        if (terminated)
         {
             this->jobTaskTable.RemoveTask(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetAttemptId());
+            taskInfo->CancelGracePeriodTimer();
+        }
 
-            taskInfo->Exited = true;
-            taskInfo->CancelGracefulThread();
-
+        this->jobTaskTable.UpdateTask(taskInfo, [stat, terminated, &telemetry](TaskInfo& t)
+        {
+            t.ExitCode = (int)ErrorCodes::EndTaskExitCode;
+            t.Exited = terminated;
             if (stat != nullptr)
             {
-                taskInfo->AssignFromStat(*stat);
+                t.AssignFromStat(*stat);
+                t.Telemetry = std::move(telemetry);
             }
-        }
-        else
-        {
-            taskInfo->Exited = false;
-            taskInfo->AssignFromStat(*stat);
+        });
 
-            // start a thread to kill the task after a period of time;
-            auto* taskIds = new std::tuple<int, int, int, uint64_t, std::string, int, RemoteExecutor*>(
-                taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(), taskInfo->ProcessKey,
-                callbackUri, args.TaskCancelGracePeriodSeconds, this);
+        if (!terminated)
+        {
+            // kill the task after a period of time;
+            int jobId = taskInfo->JobId, taskId = taskInfo->TaskId, requeueCount = taskInfo->GetTaskRequeueCount();
+            uint64_t processKey = taskInfo->ProcessKey;
 
-            pthread_create(&taskInfo->GracefulThreadId, nullptr, RemoteExecutor::GracePeriodElapsed, taskIds);
+            taskInfo->GracePeriodTimerId = Reactor::GetInstance().AddTimer(
+                args.TaskCancelGracePeriodSeconds * 1000,
+                [this, jobId, taskId, requeueCount, processKey, uri = std::move(callbackUri)]()
+                {
+                    // the termination waits for the processes to exit.
+                    Reactor::GetInstance().PostBlocking([this, jobId, taskId, requeueCount, processKey, uri]()
+                    {
+                        this->GracePeriodElapsed(jobId, taskId, requeueCount, processKey, uri);
+                    });
+                });
         }
 
         jsonBody = taskInfo->ToJson();
@@ -478,32 +553,17 @@ pplx::task<json::value> RemoteExecutor::EndTask(hpc::arguments::EndTaskArgs&& ar
     return pplx::task_from_result(jsonBody);
 }
 
-void* RemoteExecutor::GracePeriodElapsed(void* data)
+void RemoteExecutor::GracePeriodElapsed(int jobId, int taskId, int requeueCount, uint64_t processKey, const std::string& callbackUri)
 {
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, nullptr);
-    pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, nullptr);
-
-    auto* ids = static_cast<std::tuple<int, int, int, uint64_t, std::string, int, RemoteExecutor*>*>(data);
+    LockTable<int>::Guard jobGuard(this->jobLocks, jobId);
 
-    int jobId, taskId, requeueCount, period;
-    uint64_t processKey;
-    std::string callbackUri;
-    RemoteExecutor* e;
-    std::tie(jobId, taskId, requeueCount, processKey, callbackUri, period, e) = *ids;
+    Logger::Info(jobId, taskId, this->UnknowId, "GracePeriodElapsed: starting");
 
-    delete ids;
-
-    sleep(period);
-
-    WriterLock writerLock(&e->lock);
-
-    Logger::Info(jobId, taskId, e->UnknowId, "GracePeriodElapsed: starting");
-
-    auto taskInfo = e->jobTaskTable.GetTask(jobId, taskId);
+    auto taskInfo = this->jobTaskTable.GetTask(jobId, taskId);
 
     if (taskInfo)
     {
-        const auto* stat = e->TerminateTask(
+        const auto* stat = this->TerminateTask(
             jobId, taskId, requeueCount,
             processKey,
             (int)ErrorCodes::EndTaskExitCode,
@@ -530,24 +590,25 @@ void* RemoteExecutor::GracePeriodElapsed(void* data)
 
             // stat == nullptr means the processKey is already removed from the map
             // which means the main task has exited already.
-            taskInfo->Exited = true;
-            taskInfo->ExitCode = (int)ErrorCodes::EndTaskExitCode;
-            taskInfo->AssignFromStat(*stat);
-            taskInfo->ProcessIds.clear();
+            this->jobTaskTable.UpdateTask(taskInfo, [stat](TaskInfo& t)
+            {
+                t.Exited = true;
+                t.ExitCode = (int)ErrorCodes::EndTaskExitCode;
+                t.AssignFromStat(*stat);
+                t.ProcessIds.clear();
+            });
 
-            e->jobTaskTable.RemoveTask(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetAttemptId());
+            this->jobTaskTable.RemoveTask(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetAttemptId());
 
             json::value jsonBody = taskInfo->ToCompletionEventArgJson();
-            Logger::Info(jobId, taskId, e->UnknowId, "EndTask: ended {0}", jsonBody);
-            e->ReportTaskCompletion(jobId, taskId, requeueCount, jsonBody, callbackUri);
+            Logger::Info(jobId, taskId, this->UnknowId, "EndTask: ended {0}", jsonBody);
+            this->ReportTaskCompletion(jobId, taskId, requeueCount, jsonBody, callbackUri);
         }
     }
     else
     {
-        Logger::Warn(jobId, taskId, e->UnknowId, "EndTask: Task is already finished");
+        Logger::Warn(jobId, taskId, this->UnknowId, "EndTask: Task is already finished");
     }
-
-    pthread_exit(nullptr);
 }
 
 void RemoteExecutor::ReportTaskCompletion(
@@ -556,16 +617,25 @@ void RemoteExecutor::ReportTaskCompletion(
 {
     try
     {
-        if (!jsonBody.is_null())
+        if (!jsonBody.is_null() && this->taskCompletionQueue)
+        {
+            Logger::Debug(jobId, taskId, taskRequeueCount,
+                "Queued the task completion {0}", jsonBody);
+
+            // the configured completion uri overrides the callbacks, as for the
+            // single reports.
+            std::string batchCallbackUri = NodeManagerConfig::GetTaskCompletionUri().empty() ? callbackUri : std::string();
+            this->taskCompletionQueue->Enqueue(jobId, taskId, taskRequeueCount, std::move(jsonBody), batchCallbackUri);
+        }
+        else if (!jsonBody.is_null())
         {
             std::string uri = NodeManagerConfig::ResolveTaskCompletedUri(callbackUri, this->cts.get_token());
             Logger::Debug(jobId, taskId, taskRequeueCount,
                 "Callback to {0} with {1}", uri, jsonBody);
 
-            auto client = HttpHelper::GetHttpClient(uri);
             auto request = HttpHelper::GetHttpRequest(methods::POST, jsonBody);
 
-            client->request(*request).then([jobId, taskId, taskRequeueCount, uri, this](pplx::task<http_response> t)
+            HttpHelper::SendRequest(uri, *request).then([jobId, taskId, taskRequeueCount, uri, this](pplx::task<http_response> t)
             {
                 try
                 {
@@ -597,6 +667,10 @@ void RemoteExecutor::ReportTaskCompletion(
 
 void RemoteExecutor::StartHeartbeat()
 {
+    // The delta heartbeat needs the scheduler to merge the changes, so it is opt-in.
+    bool delta = boost::algorithm::iequals(NodeManagerConfig::GetHeartbeatMode(), "delta");
+    Logger::Info("Heartbeat: report {0}", delta ? "the changes since the last acknowledged report" : "the full job table");
+
     WriterLock writerLock(&this->lock);
 
     this->nodeInfoReporter =
@@ -606,34 +680,52 @@ void RemoteExecutor::StartHeartbeat()
                 [](pplx::cancellation_token token) { return NodeManagerConfig::ResolveHeartbeatUri(token); },
                 0,
                 this->NodeInfoReportInterval,
-                [this]() { return this->jobTaskTable.ToJson(); },
-                [this]() { this->ResyncAndInvalidateCache(); }));
+                [this, delta]() { return delta ? this->jobTaskTable.ToDeltaJson() : this->jobTaskTable.ToJson(); },
+                [this]() { this->ResyncAndInvalidateCache(); },
+                [this, delta]() { if (delta) { this->jobTaskTable.AcknowledgeReport(); } }));
 
     this->nodeInfoReporter->Start();
 }
 
+int RemoteExecutor::GetHostsFetchInterval()
+{
+    int interval = this->DefaultHostsFetchInterval;
+
+    try
+    {
+        interval = NodeManagerConfig::GetHostsFetchInterval();
+    }
+    catch (...)
+    {
+        // The Hosts Fetch interval may be not specified, just use the default interval in this case.
+        Logger::Info("HostsFetchInterval not specified or invalid, use the default interval {0} seconds.", interval);
+    }
+
+    if (interval < MinHostsFetchInterval)
+    {
+        Logger::Info("HostsFetchInterval {0} is less than minimum interval {1}, use the minimum interval.", interval, MinHostsFetchInterval);
+        interval = MinHostsFetchInterval;
+    }
+
+    return interval;
+}
+
+void RemoteExecutor::OnConfigReloaded()
+{
+    ReaderLock readerLock(&this->lock);
+
+    if (this->hostsManager)
+    {
+        this->hostsManager->SetFetchInterval(this->GetHostsFetchInterval());
+    }
+}
+
 void RemoteExecutor::StartHostsManager()
 {
     std::string hostsUri = NodeManagerConfig::GetHostsFileUri();
     if (!hostsUri.empty())
     {
-        int interval = this->DefaultHostsFetchInterval;
-
-        try
-        {
-            interval = NodeManagerConfig::GetHostsFetchInterval();
-        }
-        catch (...)
-        {
-            // The Hosts Fetch interval may be not specified, just use the default interval in this case.
-            Logger::Info("HostsFetchInterval not specified or invalid, use the default interval {0} seconds.", interval);
-        }
-
-        if (interval < MinHostsFetchInterval)
-        {
-            Logger::Info("HostsFetchInterval {0} is less than minimum interval {1}, use the minimum interval.", interval, MinHostsFetchInterval);
-            interval = MinHostsFetchInterval;
-        }
+        int interval = this->GetHostsFetchInterval();
 
         WriterLock writerLock(&this->lock);
 
@@ -646,6 +738,83 @@ void RemoteExecutor::StartHostsManager()
     }
 }
 
+void RemoteExecutor::StartTaskCompletionQueue()
+{
+    std::string batchUri = NodeManagerConfig::GetTaskCompletionBatchUri();
+    if (batchUri.empty())
+    {
+        Logger::Info("TaskCompletionBatchUri not specified, the task completions are reported one by one.");
+        return;
+    }
+
+    int windowMs = this->DefaultTaskCompletionBatchWindowMs;
+    int batchSize = this->DefaultTaskCompletionBatchSize;
+
+    try
+    {
+        windowMs = NodeManagerConfig::GetTaskCompletionBatchWindowMs();
+    }
+    catch (...)
+    {
+        Logger::Info("TaskCompletionBatchWindowMs not specified or invalid, use the default window {0} ms.", windowMs);
+    }
+
+    try
+    {
+        batchSize = NodeManagerConfig::GetTaskCompletionBatchSize();
+    }
+    catch (...)
+    {
+        Logger::Info("TaskCompletionBatchSize not specified or invalid, use the default size {0}.", batchSize);
+    }
+
+    if (batchSize < 1)
+    {
+        batchSize = 1;
+    }
+
+    Logger::Info("Batch the task completions to {0}, window {1} ms, size {2}.", batchUri, windowMs, batchSize);
+
+    WriterLock writerLock(&this->lock);
+
+    this->taskCompletionQueue = std::unique_ptr<TaskCompletionQueue>(
+        new TaskCompletionQueue(
+            [](pplx::cancellation_token token) { return NodeManagerConfig::ResolveTaskCompletionBatchUri(token); },
+            windowMs,
+            batchSize,
+            [this]() { this->ResyncAndInvalidateCache(); }));
+}
+
+void RemoteExecutor::StartTaskTelemetry()
+{
+    if (!CGroupController::GetInstance().IsAvailable())
+    {
+        Logger::Info("No native cgroup, the task telemetry is disabled.");
+        return;
+    }
+
+    int intervalMs = TaskTelemetry::DefaultIntervalMilliseconds;
+
+    try
+    {
+        intervalMs = NodeManagerConfig::GetTaskTelemetryIntervalMs();
+    }
+    catch (...)
+    {
+        Logger::Info("TaskTelemetryIntervalMs not specified or invalid, use the default interval {0} ms.", intervalMs);
+    }
+
+    if (intervalMs <= 0)
+    {
+        Logger::Info("The task telemetry is disabled.");
+        return;
+    }
+
+    Logger::Info("Sample the task telemetry every {0} ms, {1} samples kept per task.", intervalMs, (int)TaskTelemetry::DefaultCapacity);
+
+    this->taskTelemetry = std::unique_ptr<TaskTelemetry>(new TaskTelemetry(intervalMs, TaskTelemetry::DefaultCapacity));
+}
+
 pplx::task<json::value> RemoteExecutor::Ping(std::string&& callbackUri)
 {
     auto uri = NodeManagerConfig::GetHeartbeatUri();
@@ -671,15 +840,22 @@ void RemoteExecutor::StartMetric()
 
         this->monitor.SetNodeUuid(id);
 
+        // Only the reporting thread uses the buffers, they are reused at every report.
+        auto datagrams = std::make_shared<std::vector<std::vector<unsigned char>>>();
+
         this->metricReporter =
-            std::unique_ptr<Reporter<std::vector<unsigned char>>>(
+            std::unique_ptr<Reporter<const std::vector<std::vector<unsigned char>>&>>(
                 new UdpReporter(
                     "MetricReporter",
                     [](pplx::cancellation_token token) { return NodeManagerConfig::ResolveMetricUri(token); },
                     0,
                     this->MetricReportInterval,
-                    [this]() { return this->monitor.GetMonitorPacketData(); },
-                    [this]() { NamingClient::InvalidateCache(); }));
+                    [this, datagrams]() -> const std::vector<std::vector<unsigned char>>&
+                    {
+                        this->monitor.GetMonitorPacketData(*datagrams);
+                        return *datagrams;
+                    },
+                    []() { NamingClient::InvalidateCache(NodeManagerConfig::GetUdpMetricServiceName()); }));
 
         this->metricReporter->Start();
     }
@@ -730,7 +906,7 @@ const ProcessStatistics* RemoteExecutor::TerminateTask(
         return nullptr;
     }
 
-    auto p = this->processes.find(processKey);
+    auto process = this->FindProcess(processKey);
 //    Logger::Debug(
 //        jobId, taskId, requeueCount,
 //        "TerminateTask for ProcessKey {0}, processes count {1}",
@@ -744,25 +920,21 @@ const ProcessStatistics* RemoteExecutor::TerminateTask(
 //            pro.first);
 //    }
 
-    if (p != this->processes.end())
+    if (process)
     {
         Logger::Debug(jobId, taskId, requeueCount, "About to Kill the task, forced {0}.", forced);
-        p->second->Kill(exitCode, forced);
-
-        const auto* stat = &p->second->GetStatisticsFromCGroup();
+        process->Kill(exitCode, forced);
 
-        int times = 10;
-        while (!stat->IsTerminated() && times-- > 0)
-        {
-            sleep(0.1);
-            stat = &p->second->GetStatisticsFromCGroup();
-        }
+        // Only the job is locked while waiting, the wait ends as soon as the
+        // last process exits and the statistics are read once afterwards.
+        int ret = process->WaitForExit(TerminateTimeoutMs);
+        const auto* stat = &process->GetStatisticsFromCGroup();
 
-        if (!stat->IsTerminated())
+        if (ret != 0 || !stat->IsTerminated())
         {
             Logger::Warn(jobId, taskId, requeueCount,
-                "The task didn't exit within 1s, process Ids {0}",
-                String::Join<' '>(stat->ProcessIds));
+                "The task didn't exit within {0} ms, process Ids {1}",
+                TerminateTimeoutMs, String::Join<' '>(stat->ProcessIds));
         }
 
         return stat;
@@ -774,10 +946,58 @@ const ProcessStatistics* RemoteExecutor::TerminateTask(
     }
 }
 
+std::shared_ptr<Process> RemoteExecutor::FindProcess(uint64_t processKey)
+{
+    auto snapshot = std::atomic_load(&this->processes);
+    if (snapshot)
+    {
+        auto p = snapshot->find(processKey);
+        if (p != snapshot->end())
+        {
+            return p->second;
+        }
+    }
+
+    return nullptr;
+}
+
+size_t RemoteExecutor::GetProcessCount()
+{
+    auto snapshot = std::atomic_load(&this->processes);
+    return snapshot ? snapshot->size() : 0;
+}
+
+void RemoteExecutor::AddProcess(uint64_t processKey, std::shared_ptr<Process> process)
+{
+    pthread_mutex_lock(&this->processesMutex);
+
+    auto snapshot = std::atomic_load(&this->processes);
+    auto updated = snapshot ? std::make_shared<ProcessMap>(*snapshot) : std::make_shared<ProcessMap>();
+    (*updated)[processKey] = std::move(process);
+    std::atomic_store(&this->processes, std::shared_ptr<const ProcessMap>(updated));
+
+    pthread_mutex_unlock(&this->processesMutex);
+}
+
+void RemoteExecutor::RemoveProcess(uint64_t processKey)
+{
+    pthread_mutex_lock(&this->processesMutex);
+
+    auto snapshot = std::atomic_load(&this->processes);
+    if (snapshot && snapshot->find(processKey) != snapshot->end())
+    {
+        auto updated = std::make_shared<ProcessMap>(*snapshot);
+        updated->erase(processKey);
+        std::atomic_store(&this->processes, std::shared_ptr<const ProcessMap>(updated));
+    }
+
+    pthread_mutex_unlock(&this->processesMutex);
+}
+
 void RemoteExecutor::ResyncAndInvalidateCache()
 {
     this->jobTaskTable.RequestResync();
-    NamingClient::InvalidateCache();
+    NamingClient::InvalidateCache(NodeManagerConfig::GetDefaultServiceName());
 }
 
 pplx::task<json::value> RemoteExecutor::PeekTaskOutput(hpc::arguments::PeekTaskOutputArgs&& args)
@@ -792,12 +1012,12 @@ pplx::task<json::value> RemoteExecutor::PeekTaskOutput(hpc::arguments::PeekTaskO
         {
             Logger::Debug(args.JobId, args.TaskId, taskInfo->GetTaskRequeueCount(),
                 "PeekTaskOutput for ProcessKey {0}, processes count {1}",
-                taskInfo->ProcessKey, this->processes.size());
+                taskInfo->ProcessKey, this->GetProcessCount());
 
-            auto p = this->processes.find(taskInfo->ProcessKey);
-            if (p != this->processes.end())
+            auto process = this->FindProcess(taskInfo->ProcessKey);
+            if (process)
             {
-                output = p->second->PeekOutput();
+                output = process->PeekOutput();
             }
         }
     }
@@ -809,3 +1029,27 @@ pplx::task<json::value> RemoteExecutor::PeekTaskOutput(hpc::arguments::PeekTaskO
 
     return pplx::task_from_result(json::value::string(output));
 }
+
+pplx::task<json::value> RemoteExecutor::TaskMetrics(hpc::arguments::TaskMetricsArgs&& args)
+{
+    json::value metrics;
+
+    auto taskInfo = this->jobTaskTable.GetTask(args.JobId, args.TaskId);
+    if (taskInfo && this->taskTelemetry)
+    {
+        size_t maxSamples = args.MaxSamples > 0 ? args.MaxSamples : TaskTelemetry::DefaultCapacity;
+        metrics = this->taskTelemetry->ToJson(taskInfo->ProcessKey, maxSamples);
+    }
+
+    if (metrics.is_null())
+    {
+        Logger::Debug(args.JobId, args.TaskId, this->UnknowId, "TaskMetrics: the task is not sampled.");
+    }
+
+    return pplx::task_from_result(metrics);
+}
+
+pplx::task<json::value> RemoteExecutor::MetricHistory(hpc::arguments::MetricHistoryArgs&& args)
+{
+    return pplx::task_from_result(this->monitor.QueryMetricHistory(args));
+}
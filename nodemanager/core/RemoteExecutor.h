@@ -10,27 +10,43 @@
 #include "Process.h"
 #include "Reporter.h"
 #include "HostsManager.h"
+#include "TaskCompletionQueue.h"
+#include "TaskTelemetry.h"
+#include "UserProvisioner.h"
+#include "NodeManagerConfig.h"
 #include "../arguments/MetricCountersConfig.h"
 #include "../data/ProcessStatistics.h"
+#include "../utils/LockTable.h"
 
 namespace hpc
 {
     namespace core
     {
+        // The slow work of a job, the user provisioning and the termination, runs
+        // under the lock of the job or the user only. The global lock guards the
+        // job users for short and the processes are looked up in a snapshot.
         class RemoteExecutor : public IRemoteExecutor
         {
             public:
-                RemoteExecutor(const std::string& networkName);
-                ~RemoteExecutor()
+                // The executor owns the provisioner, a default one when null.
+                RemoteExecutor(const std::string& networkName, UserProvisioner* provisioner = nullptr);
+                virtual ~RemoteExecutor()
                 {
                     Logger::Info("Closing the Remote Executor.");
+                    NodeManagerConfig::RemoveReloadListener(this->configListenerId);
                     this->cts.cancel();
                     pthread_rwlock_destroy(&this->lock);
+                    pthread_mutex_destroy(&this->processesMutex);
                     Logger::Info("Closed the Remote Executor.");
                 }
 
                 virtual pplx::task<web::json::value> StartJobAndTask(hpc::arguments::StartJobAndTaskArgs&& args, std::string&& callbackUri);
                 virtual pplx::task<web::json::value> StartTask(hpc::arguments::StartTaskArgs&& args, std::string&& callbackUri);
+
+                // Returns the result of each task in the order of the args, a task
+                // failed doesn't fail the others.
+                virtual pplx::task<web::json::value> StartTasks(hpc::arguments::StartTasksArgs&& args, std::string&& callbackUri);
+
                 virtual pplx::task<web::json::value> EndJob(hpc::arguments::EndJobArgs&& args);
                 virtual pplx::task<web::json::value> EndTask(hpc::arguments::EndTaskArgs&& args, std::string&& callbackUri);
                 virtual pplx::task<web::json::value> Ping(std::string&& callbackUri);
@@ -38,16 +54,44 @@ namespace hpc
                 virtual pplx::task<web::json::value> MetricConfig(hpc::arguments::MetricCountersConfig&& config, std::string&& callbackUri);
                 virtual pplx::task<web::json::value> PeekTaskOutput(hpc::arguments::PeekTaskOutputArgs&& args);
 
+                // The telemetry samples of a running task, null when it is not sampled.
+                virtual pplx::task<web::json::value> TaskMetrics(hpc::arguments::TaskMetricsArgs&& args);
+
+                // The reported metric values kept on the node, to fill the gaps of the
+                // UDP reports.
+                virtual pplx::task<web::json::value> MetricHistory(hpc::arguments::MetricHistoryArgs&& args);
+
             protected:
             private:
-                static void* GracePeriodElapsed(void* data);
+                typedef std::map<uint64_t, std::shared_ptr<Process>> ProcessMap;
+
+                std::shared_ptr<Process> FindProcess(uint64_t processKey);
+                void AddProcess(uint64_t processKey, std::shared_ptr<Process> process);
+                void RemoveProcess(uint64_t processKey);
+                size_t GetProcessCount();
+
+                // Returns an empty name when the job was not started on this node.
+                std::string GetJobUser(int jobId);
+
+                // Called under the job lock, returns whether the task is started and
+                // the reason in message when not.
+                bool StartTaskProcess(
+                    hpc::arguments::StartTaskArgs&& args, std::shared_ptr<hpc::data::TaskInfo> taskInfo, bool isNewEntry,
+                    const std::string& userName, std::string&& callbackUri, std::string& message);
+
+                void GracePeriodElapsed(int jobId, int taskId, int requeueCount, uint64_t processKey, const std::string& callbackUri);
 
                 void StartHeartbeat();
                 void StartMetric();
                 void StartHostsManager();
+                void StartTaskCompletionQueue();
+                void StartTaskTelemetry();
 
                 void ResyncAndInvalidateCache();
 
+                int GetHostsFetchInterval();
+                void OnConfigReloaded();
+
                 const hpc::data::ProcessStatistics* TerminateTask(
                     int jobId, int taskId, int requeueCount,
                     uint64_t processKey, int exitCode, bool forced, bool mpiDockerTask);
@@ -60,20 +104,35 @@ namespace hpc
                 const int RegisterInterval = 300;
                 const int DefaultHostsFetchInterval = 300;
                 const int MinHostsFetchInterval = 30;
+                const int DefaultTaskCompletionBatchWindowMs = 20;
+                const int DefaultTaskCompletionBatchSize = 100;
+                const int TerminateTimeoutMs = 1000;
 
                 JobTaskTable jobTaskTable;
                 Monitor monitor;
 
                 std::unique_ptr<Reporter<json::value>> nodeInfoReporter;
                 std::unique_ptr<Reporter<json::value>> registerReporter;
-                std::unique_ptr<Reporter<std::vector<unsigned char>>> metricReporter;
+                std::unique_ptr<Reporter<const std::vector<std::vector<unsigned char>>&>> metricReporter;
                 std::unique_ptr<HostsManager> hostsManager;
+                std::unique_ptr<TaskCompletionQueue> taskCompletionQueue;
+
+                // null when disabled or no native cgroup, set in the constructor only.
+                std::unique_ptr<TaskTelemetry> taskTelemetry;
 
-                std::map<uint64_t, std::shared_ptr<Process>> processes;
-                std::map<int, std::tuple<std::string, bool, bool, bool, bool, std::string>> jobUsers;
-                std::map<std::string, std::set<int>> userJobs;
+                // copied on write, read with atomic_load.
+                std::shared_ptr<const ProcessMap> processes;
+                pthread_mutex_t processesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+                std::unique_ptr<UserProvisioner> userProvisioner;
+                std::map<int, std::string> jobUsers;
                 pthread_rwlock_t lock;
 
+                // lock order: job, user in the provisioner, then the global lock.
+                hpc::utils::LockTable<int> jobLocks;
+
+                int configListenerId;
+
                 pplx::cancellation_token_source cts;
         };
     }
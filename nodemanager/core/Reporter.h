@@ -3,6 +3,7 @@
 
 #include <cpprest/json.h>
 #include <functional>
+#include <atomic>
 
 #include "../utils/Logger.h"
 #include "NamingClient.h"
@@ -50,12 +51,18 @@ namespace hpc
 
                 virtual int Report() = 0;
 
+                // Takes effect after the current interval.
+                void SetInterval(int seconds)
+                {
+                    this->intervalSeconds = seconds;
+                }
+
             protected:
                 std::string name;
                 std::function<std::string(pplx::cancellation_token)> getReportUri;
                 std::function<ReportType()> valueFetcher;
                 std::function<void()> onError;
-                int intervalSeconds;
+                std::atomic<int> intervalSeconds;
                 pplx::cancellation_token_source cts;
 
             private:
@@ -81,7 +88,7 @@ namespace hpc
                             r->inRequest = false;
                         }
 
-                        if (r->isRunning) sleep(needRetry ? r->ErrorRetrySeconds : r->intervalSeconds);
+                        if (r->isRunning) sleep(needRetry ? r->ErrorRetrySeconds : r->intervalSeconds.load());
                     }
 
                     return nullptr;
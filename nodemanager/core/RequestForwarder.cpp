@@ -0,0 +1,188 @@
+#include "RequestForwarder.h"
+#include "HttpHelper.h"
+#include "../utils/Logger.h"
+
+using namespace web;
+using namespace web::http;
+using namespace hpc::core;
+using namespace hpc::utils;
+
+RequestForwarder::RequestForwarder(int maxActive) : maxActive(maxActive > 0 ? maxActive : DefaultMaxActive)
+{
+}
+
+RequestForwarder::~RequestForwarder()
+{
+    pthread_mutex_destroy(&this->mutex);
+}
+
+void RequestForwarder::Forward(http_request request, const std::string& uri)
+{
+    std::string target = web::uri(uri).authority().to_string();
+
+    pthread_mutex_lock(&this->mutex);
+
+    auto& t = this->targets[target];
+    if (t.Active < this->maxActive)
+    {
+        t.Active++;
+        pthread_mutex_unlock(&this->mutex);
+
+        this->Send(request, uri, target);
+        return;
+    }
+
+    bool rejected = t.Waiting.size() >= MaxQueued;
+    if (rejected)
+    {
+        t.Rejected++;
+    }
+    else
+    {
+        t.Waiting.push_back([this, request, uri, target]() { this->Send(request, uri, target); });
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+
+    if (rejected)
+    {
+        Logger::Warn("Proxy to {0}: {1} requests in flight and {2} waiting, rejected", uri, this->maxActive, (size_t)MaxQueued);
+        request.reply(status_codes::ServiceUnavailable, "Too many requests to " + target).then([](pplx::task<void> t)
+        {
+            try { t.wait(); } catch (const std::exception& ex) { Logger::Error("Proxy: failed to reply, {0}", ex.what()); }
+        });
+    }
+}
+
+void RequestForwarder::Send(http_request request, const std::string& uri, const std::string& target)
+{
+    auto start = Clock::now();
+
+    // anything thrown before the request is sent fails it as the target would,
+    // so the reply is sent and the slot is released in the same way.
+    pplx::task<http_response> response;
+    try
+    {
+        http_request forwarded(request.method());
+
+        // the body is framed by the client again, the other headers are kept, e.g.
+        // the authentication key and the callback uri.
+        for (const auto& h : request.headers())
+        {
+            if (h.first != header_names::host &&
+                h.first != header_names::content_length &&
+                h.first != header_names::transfer_encoding &&
+                h.first != header_names::connection)
+            {
+                forwarded.headers().add(h.first, h.second);
+            }
+        }
+
+        auto& headers = request.headers();
+        if (headers.has(header_names::content_length))
+        {
+            forwarded.set_body(request.body(), headers.content_length(), headers.content_type());
+        }
+        else
+        {
+            forwarded.set_body(request.body(), headers.content_type());
+        }
+
+        response = HttpHelper::SendRequest(uri, forwarded);
+    }
+    catch (const std::exception& ex)
+    {
+        response = pplx::task_from_exception<http_response>(std::current_exception());
+    }
+
+    auto sent = Clock::now();
+
+    response.then([this, request, uri, target, start, sent](pplx::task<http_response> t)
+    {
+        auto received = Clock::now();
+        bool succeeded = false;
+        pplx::task<void> replied;
+
+        try
+        {
+            auto response = t.get();
+            Logger::Info("Proxy result from {0} response code {1}", uri, response.status_code());
+            replied = request.reply(response);
+            succeeded = true;
+        }
+        catch (const std::exception& ex)
+        {
+            Logger::Error("Proxy to {0}: error when get response {1}", uri, ex.what());
+            replied = request.reply(status_codes::BadGateway, json::value(ex.what()));
+        }
+
+        auto end = Clock::now();
+
+        replied.then([](pplx::task<void> t)
+        {
+            try { t.wait(); } catch (const std::exception& ex) { Logger::Error("Proxy: failed to reply, {0}", ex.what()); }
+        });
+
+        this->Complete(
+            target,
+            succeeded,
+            std::chrono::duration_cast<std::chrono::microseconds>((sent - start) + (end - received)).count(),
+            std::chrono::duration_cast<std::chrono::microseconds>(received - sent).count());
+    });
+}
+
+void RequestForwarder::Complete(const std::string& target, bool succeeded, uint64_t overheadMicroseconds, uint64_t targetMicroseconds)
+{
+    std::function<void()> next;
+
+    pthread_mutex_lock(&this->mutex);
+
+    auto& t = this->targets[target];
+    if (succeeded) t.Forwarded++; else t.Failed++;
+    t.OverheadMicroseconds += overheadMicroseconds;
+    t.TargetMicroseconds += targetMicroseconds;
+
+    // the slot passes to the next request waiting.
+    if (!t.Waiting.empty())
+    {
+        next = std::move(t.Waiting.front());
+        t.Waiting.pop_front();
+    }
+    else
+    {
+        t.Active--;
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+
+    if (next)
+    {
+        next();
+    }
+}
+
+json::value RequestForwarder::GetStatisticsJson()
+{
+    json::value statistics = json::value::object();
+
+    pthread_mutex_lock(&this->mutex);
+
+    for (const auto& t : this->targets)
+    {
+        uint64_t completed = t.second.Forwarded + t.second.Failed;
+
+        json::value v;
+        v["Active"] = json::value::number(t.second.Active);
+        v["Waiting"] = json::value::number((uint64_t)t.second.Waiting.size());
+        v["Forwarded"] = json::value::number(t.second.Forwarded);
+        v["Failed"] = json::value::number(t.second.Failed);
+        v["Rejected"] = json::value::number(t.second.Rejected);
+        v["AverageOverheadMicroseconds"] = json::value::number(completed ? (double)t.second.OverheadMicroseconds / completed : 0.0);
+        v["AverageTargetMicroseconds"] = json::value::number(completed ? (double)t.second.TargetMicroseconds / completed : 0.0);
+        statistics[t.first] = v;
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+
+    return statistics;
+}
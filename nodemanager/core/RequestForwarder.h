@@ -0,0 +1,66 @@
+#ifndef REQUESTFORWARDER_H
+#define REQUESTFORWARDER_H
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <pthread.h>
+#include <cpprest/http_listener.h>
+#include <cpprest/json.h>
+
+namespace hpc
+{
+    namespace core
+    {
+        // Forwards the requests for other nodes. The body is streamed to the pooled
+        // client of the target as it is received and the response is streamed back,
+        // neither is parsed. At most maxActive requests per target are in flight,
+        // the others wait in order up to MaxQueued and are rejected beyond.
+        class RequestForwarder
+        {
+            public:
+                RequestForwarder(int maxActive);
+                ~RequestForwarder();
+
+                // Replies to the request with the response of the uri, or with
+                // ServiceUnavailable or BadGateway.
+                void Forward(web::http::http_request request, const std::string& uri);
+
+                web::json::value GetStatisticsJson();
+
+                static const int DefaultMaxActive = 16;
+                static const size_t MaxQueued = 256;
+
+            protected:
+            private:
+                typedef std::chrono::steady_clock Clock;
+
+                typedef struct _Target
+                {
+                    int Active = 0;
+                    std::deque<std::function<void()>> Waiting;
+
+                    uint64_t Forwarded = 0;
+                    uint64_t Failed = 0;
+                    uint64_t Rejected = 0;
+
+                    // the time in the forwarder, excluding the time waiting for the
+                    // target and in the queue.
+                    uint64_t OverheadMicroseconds = 0;
+                    uint64_t TargetMicroseconds = 0;
+                } Target;
+
+                void Send(web::http::http_request request, const std::string& uri, const std::string& target);
+                void Complete(const std::string& target, bool succeeded, uint64_t overheadMicroseconds, uint64_t targetMicroseconds);
+
+                const int maxActive;
+
+                std::map<std::string, Target> targets;
+                pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        };
+    }
+}
+
+#endif // REQUESTFORWARDER_H
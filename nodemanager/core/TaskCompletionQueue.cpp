@@ -0,0 +1,243 @@
+#include <set>
+#include <errno.h>
+#include <time.h>
+
+#include "TaskCompletionQueue.h"
+#include "HttpHelper.h"
+#include "../utils/Logger.h"
+
+using namespace web::http;
+using namespace hpc::core;
+using namespace hpc::utils;
+
+TaskCompletionQueue::TaskCompletionQueue(
+    std::function<std::string(pplx::cancellation_token)> getUri,
+    int windowMilliseconds,
+    size_t maxBatchSize,
+    std::function<void()> onErrorFunc) :
+    getReportUri(getUri), windowMilliseconds(windowMilliseconds), maxBatchSize(maxBatchSize), onError(onErrorFunc)
+{
+    pthread_create(&this->threadId, nullptr, SendingThread, this);
+}
+
+TaskCompletionQueue::~TaskCompletionQueue()
+{
+    Logger::Debug("Stopping the task completion queue");
+
+    pthread_mutex_lock(&this->mutex);
+    this->isRunning = false;
+    pthread_cond_broadcast(&this->cond);
+    pthread_mutex_unlock(&this->mutex);
+
+    // The remaining events are sent once more without retry.
+    pthread_join(this->threadId, nullptr);
+
+    pthread_cond_destroy(&this->cond);
+    pthread_mutex_destroy(&this->mutex);
+}
+
+void TaskCompletionQueue::Enqueue(int jobId, int taskId, int requeueCount, json::value jsonBody, const std::string& callbackUri)
+{
+    pthread_mutex_lock(&this->mutex);
+    this->queue.push_back({ jobId, taskId, requeueCount, std::move(jsonBody), callbackUri, 0 });
+    pthread_cond_signal(&this->cond);
+    pthread_mutex_unlock(&this->mutex);
+}
+
+static timespec GetDeadline(int milliseconds)
+{
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+
+    deadline.tv_sec += milliseconds / 1000;
+    deadline.tv_nsec += (milliseconds % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    return deadline;
+}
+
+void* TaskCompletionQueue::SendingThread(void* arg)
+{
+    TaskCompletionQueue* q = static_cast<TaskCompletionQueue*>(arg);
+
+    std::vector<Completion> batch;
+    while (q->TakeBatch(batch))
+    {
+        if (!q->SendBatch(batch))
+        {
+            // back off before retrying the failed events.
+            timespec deadline = GetDeadline(RetryIntervalMilliseconds);
+
+            pthread_mutex_lock(&q->mutex);
+            while (q->isRunning && pthread_cond_timedwait(&q->cond, &q->mutex, &deadline) != ETIMEDOUT);
+            pthread_mutex_unlock(&q->mutex);
+        }
+
+        batch.clear();
+    }
+
+    pthread_exit(nullptr);
+}
+
+bool TaskCompletionQueue::TakeBatch(std::vector<Completion>& batch)
+{
+    pthread_mutex_lock(&this->mutex);
+
+    while (this->isRunning && this->queue.empty())
+    {
+        pthread_cond_wait(&this->cond, &this->mutex);
+    }
+
+    if (this->queue.empty())
+    {
+        pthread_mutex_unlock(&this->mutex);
+        return false;
+    }
+
+    // The window starts from the first event, so a single event waits no longer
+    // than the window.
+    timespec deadline = GetDeadline(this->windowMilliseconds);
+    while (this->isRunning && this->queue.size() < this->maxBatchSize)
+    {
+        if (pthread_cond_timedwait(&this->cond, &this->mutex, &deadline) == ETIMEDOUT) break;
+    }
+
+    // The batch takes the callback uri of the oldest event. A later event of a
+    // task already seen stays in the queue for the next batch, also when the
+    // earlier one is left for another callback uri.
+    const std::string callbackUri = this->queue.front().CallbackUri;
+    std::set<std::pair<int, int>> tasks;
+    std::deque<Completion> remaining;
+    for (auto& completion : this->queue)
+    {
+        bool isFirst = tasks.insert(std::make_pair(completion.JobId, completion.TaskId)).second;
+        if (batch.size() < this->maxBatchSize && isFirst && completion.CallbackUri == callbackUri)
+        {
+            batch.push_back(std::move(completion));
+        }
+        else
+        {
+            remaining.push_back(std::move(completion));
+        }
+    }
+
+    this->queue.swap(remaining);
+
+    pthread_mutex_unlock(&this->mutex);
+    return true;
+}
+
+bool TaskCompletionQueue::SendBatch(std::vector<Completion>& batch)
+{
+    std::vector<Completion> failed;
+    std::string uri;
+
+    try
+    {
+        uri = this->getReportUri(this->cts.get_token());
+
+        json::value jsonBody = json::value::array(batch.size());
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            jsonBody[i] = batch[i].Body;
+        }
+
+        const std::string& callbackUri = batch.front().CallbackUri;
+        Logger::Debug("Callback to {0} with {1} task completions of {2}", uri, batch.size(), callbackUri);
+
+        auto request = callbackUri.empty() ?
+            HttpHelper::GetHttpRequest(methods::POST, jsonBody) :
+            HttpHelper::GetHttpRequest(methods::POST, jsonBody, callbackUri);
+        http_response response = HttpHelper::SendRequest(uri, *request, this->cts.get_token()).get();
+
+        Logger::Info("Callback to {0} with {1} task completions response code {2}", uri, batch.size(), response.status_code());
+
+        if (response.status_code() == status_codes::OK)
+        {
+            // The endpoint may reply an array of the per task results, the ones
+            // replied false are retried.
+            json::value results;
+            try
+            {
+                results = response.extract_json().get();
+            }
+            catch (...)
+            {
+            }
+
+            if (results.is_array() && results.size() == batch.size())
+            {
+                for (size_t i = 0; i < batch.size(); i++)
+                {
+                    if (results[i].is_boolean() && !results[i].as_bool())
+                    {
+                        failed.push_back(std::move(batch[i]));
+                    }
+                }
+            }
+        }
+        else
+        {
+            failed = std::move(batch);
+        }
+    }
+    catch (const http_exception& httpEx)
+    {
+        Logger::Warn("HttpException occurred when sending back {1} task results to {0}, ex {2}", uri, batch.size(), httpEx.what());
+        failed = std::move(batch);
+    }
+    catch (const std::exception& ex)
+    {
+        Logger::Error("Exception occurred when sending back {1} task results to {0}, ex {2}", uri, batch.size(), ex.what());
+        failed = std::move(batch);
+    }
+
+    if (failed.empty())
+    {
+        return true;
+    }
+
+    this->Requeue(failed);
+    return false;
+}
+
+void TaskCompletionQueue::Requeue(std::vector<Completion>& failed)
+{
+    bool isRunning;
+
+    pthread_mutex_lock(&this->mutex);
+
+    isRunning = this->isRunning;
+    if (isRunning)
+    {
+        // Put back to the front in the original order, so they are sent before
+        // any later event of the same task.
+        for (auto it = failed.rbegin(); it != failed.rend(); it++)
+        {
+            if (++it->Attempts < MaxAttempts)
+            {
+                this->queue.push_front(std::move(*it));
+            }
+            else
+            {
+                Logger::Error(it->JobId, it->TaskId, it->RequeueCount,
+                    "Failed to send back task result after {0} attempts", it->Attempts);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+
+    if (!isRunning)
+    {
+        Logger::Warn("Dropped {0} task results when stopping the task completion queue", failed.size());
+    }
+    else if (this->onError)
+    {
+        this->onError();
+    }
+}
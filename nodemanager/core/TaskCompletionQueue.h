@@ -0,0 +1,72 @@
+#ifndef TASKCOMPLETIONQUEUE_H
+#define TASKCOMPLETIONQUEUE_H
+
+#include <deque>
+#include <functional>
+#include <pthread.h>
+#include <cpprest/json.h>
+#include <cpprest/http_client.h>
+
+namespace hpc
+{
+    namespace core
+    {
+        using namespace web;
+
+        // Coalesces the task completion events reported within a window into one
+        // request to the batch endpoint. A batch holds at most one event per task
+        // and the events of one callback uri only, which is passed in the
+        // CallbackURI header. The failed ones are retried before the newer ones,
+        // so the events of a task arrive in order.
+        class TaskCompletionQueue
+        {
+            public:
+                TaskCompletionQueue(
+                    std::function<std::string(pplx::cancellation_token)> getUri,
+                    int windowMilliseconds,
+                    size_t maxBatchSize,
+                    std::function<void()> onErrorFunc);
+
+                ~TaskCompletionQueue();
+
+                void Enqueue(int jobId, int taskId, int requeueCount, json::value jsonBody, const std::string& callbackUri);
+
+                static const int MaxAttempts = 3;
+                static const int RetryIntervalMilliseconds = 1000;
+
+            protected:
+            private:
+                typedef struct _Completion
+                {
+                    int JobId;
+                    int TaskId;
+                    int RequeueCount;
+                    json::value Body;
+                    std::string CallbackUri;
+                    int Attempts;
+                } Completion;
+
+                static void* SendingThread(void* arg);
+
+                bool TakeBatch(std::vector<Completion>& batch);
+                bool SendBatch(std::vector<Completion>& batch);
+                void Requeue(std::vector<Completion>& failed);
+
+                std::function<std::string(pplx::cancellation_token)> getReportUri;
+                const int windowMilliseconds;
+                const size_t maxBatchSize;
+                std::function<void()> onError;
+
+                std::deque<Completion> queue;
+                bool isRunning = true;
+
+                pthread_t threadId = 0;
+                pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+                pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+                pplx::cancellation_token_source cts;
+        };
+    }
+}
+
+#endif // TASKCOMPLETIONQUEUE_H
@@ -0,0 +1,139 @@
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <boost/algorithm/string.hpp>
+
+#include "TaskLauncher.h"
+#include "CGroupController.h"
+#include "NodeManagerConfig.h"
+#include "../utils/Logger.h"
+
+using namespace hpc::core;
+using namespace hpc::utils;
+
+LaunchMode TaskLauncher::GetConfiguredMode()
+{
+    static LaunchMode mode = []()
+    {
+        std::string name = NodeManagerConfig::GetTaskLaunchMode();
+        LaunchMode m = boost::algorithm::iequals(name, "spawn") ? LaunchMode::Spawn : LaunchMode::Fork;
+        Logger::Info("TaskLauncher: launch the tasks by {0}", m == LaunchMode::Spawn ? "spawn" : "fork");
+        return m;
+    }();
+
+    return mode;
+}
+
+pid_t TaskLauncher::Launch(
+    LaunchMode mode,
+    char* const args[],
+    char* const envi[],
+    int outputFd,
+    int targetFd,
+    const std::vector<std::string>* procsFiles,
+    int& error)
+{
+    ChildContext context = { args, envi, outputFd, targetFd, procsFiles };
+
+    // Block all the signals so no handler of the node manager runs in the child
+    // before the child resets them.
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &context.SignalMask);
+
+    pid_t pid = mode == LaunchMode::Spawn ? Spawn(context, error) : Fork(context, error);
+
+    pthread_sigmask(SIG_SETMASK, &context.SignalMask, nullptr);
+
+    return pid;
+}
+
+pid_t TaskLauncher::Fork(ChildContext& context, int& error)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        _exit(ChildMain(&context));
+    }
+
+    error = pid < 0 ? errno : 0;
+    return pid;
+}
+
+pid_t TaskLauncher::Spawn(ChildContext& context, int& error)
+{
+    // CLONE_INTO_CGROUP needs clone3 which glibc doesn't wrap with a child
+    // function, the child joins the cgroup itself before exec instead, the parent
+    // is suspended until then anyway.
+    void* stack = mmap(nullptr, ChildStackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED)
+    {
+        error = errno;
+        return -1;
+    }
+
+    pid_t pid = clone(ChildMain, static_cast<char*>(stack) + ChildStackSize, CLONE_VM | CLONE_VFORK | SIGCHLD, &context);
+    error = pid < 0 ? errno : 0;
+
+    munmap(stack, ChildStackSize);
+
+    return pid;
+}
+
+int TaskLauncher::ChildMain(void* arg)
+{
+    ChildContext* context = static_cast<ChildContext*>(arg);
+
+    for (int sig = 1; sig < NSIG; sig++)
+    {
+        struct sigaction action;
+        if (sigaction(sig, nullptr, &action) == 0 && action.sa_handler != SIG_DFL && action.sa_handler != SIG_IGN)
+        {
+            action.sa_handler = SIG_DFL;
+            sigaction(sig, &action, nullptr);
+        }
+    }
+
+    sigprocmask(SIG_SETMASK, &context->SignalMask, nullptr);
+
+    // The pipe is created with O_CLOEXEC, only the duplicated end survives exec.
+    if (dup2(context->OutputFd, context->TargetFd) < 0)
+    {
+        return errno;
+    }
+
+    if (context->ProcsFiles != nullptr)
+    {
+        // 0 stands for the writing process.
+        int ret = CGroupController::Attach(*context->ProcsFiles, 0);
+        if (ret != 0)
+        {
+            WriteError(context->TargetFd, "Error occurred when joining cgroup, errno = ", ret);
+            return ret;
+        }
+    }
+
+    execve(context->Args[0], context->Args, context->Environment);
+
+    int ret = errno;
+    WriteError(context->TargetFd, "Error occurred when execvpe, errno = ", ret);
+    return ret;
+}
+
+void TaskLauncher::WriteError(int fd, const char* message, int error)
+{
+    char buffer[16];
+    char* p = buffer + sizeof(buffer);
+    *--p = '\n';
+    do
+    {
+        *--p = '0' + error % 10;
+        error /= 10;
+    } while (error > 0);
+
+    ssize_t ret = write(fd, message, strlen(message));
+    ret = write(fd, p, buffer + sizeof(buffer) - p);
+    (void)ret;
+}
@@ -0,0 +1,65 @@
+#ifndef TASKLAUNCHER_H
+#define TASKLAUNCHER_H
+
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <sys/types.h>
+
+namespace hpc
+{
+    namespace core
+    {
+        enum class LaunchMode
+        {
+            Fork,
+            Spawn
+        };
+
+        // Starts the task processes. Fork copies the page tables of the whole node
+        // manager, Spawn uses clone(CLONE_VM | CLONE_VFORK) so the cost doesn't
+        // grow with the node manager's memory.
+        class TaskLauncher
+        {
+            public:
+                // The mode from the TaskLaunchMode configuration, "spawn" or "fork".
+                static LaunchMode GetConfiguredMode();
+
+                // Starts args[0] with the environment, redirecting outputFd to targetFd,
+                // the child joins the cgroup before exec when procsFiles is not null.
+                // Returns the pid, or -1 with the errno in error.
+                static pid_t Launch(
+                    LaunchMode mode,
+                    char* const args[],
+                    char* const envi[],
+                    int outputFd,
+                    int targetFd,
+                    const std::vector<std::string>* procsFiles,
+                    int& error);
+
+            protected:
+            private:
+                typedef struct _ChildContext
+                {
+                    char* const* Args;
+                    char* const* Environment;
+                    int OutputFd;
+                    int TargetFd;
+                    const std::vector<std::string>* ProcsFiles;
+                    sigset_t SignalMask;
+                } ChildContext;
+
+                static pid_t Fork(ChildContext& context, int& error);
+                static pid_t Spawn(ChildContext& context, int& error);
+
+                // Only async-signal-safe calls, the spawned child shares the memory
+                // of the node manager until exec.
+                static int ChildMain(void* arg);
+                static void WriteError(int fd, const char* message, int error);
+
+                static const size_t ChildStackSize = 64 * 1024;
+        };
+    }
+}
+
+#endif // TASKLAUNCHER_H
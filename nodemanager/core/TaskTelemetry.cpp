@@ -0,0 +1,276 @@
+#include <errno.h>
+#include <time.h>
+
+#include "TaskTelemetry.h"
+#include "CGroupController.h"
+#include "../utils/Logger.h"
+
+using namespace web;
+using namespace hpc::core;
+using namespace hpc::utils;
+
+TaskTelemetry::TaskTelemetry(int intervalMilliseconds, size_t capacity) :
+    intervalMilliseconds(intervalMilliseconds), capacity(capacity)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&this->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_create(&this->threadId, nullptr, SamplingThread, this);
+}
+
+TaskTelemetry::~TaskTelemetry()
+{
+    pthread_mutex_lock(&this->mutex);
+    this->isRunning = false;
+    pthread_cond_broadcast(&this->cond);
+    pthread_mutex_unlock(&this->mutex);
+
+    pthread_join(this->threadId, nullptr);
+
+    pthread_cond_destroy(&this->cond);
+    pthread_mutex_destroy(&this->mutex);
+}
+
+void TaskTelemetry::Add(uint64_t processKey, const std::string& groupName, int allocatedCores)
+{
+    auto task = std::make_shared<Task>(groupName, allocatedCores, this->capacity);
+
+    pthread_mutex_lock(&this->mutex);
+    this->tasks[processKey] = task;
+    pthread_mutex_unlock(&this->mutex);
+}
+
+json::value TaskTelemetry::Remove(uint64_t processKey)
+{
+    std::shared_ptr<Task> task;
+
+    pthread_mutex_lock(&this->mutex);
+    auto it = this->tasks.find(processKey);
+    if (it != this->tasks.end())
+    {
+        task = it->second;
+        this->tasks.erase(it);
+    }
+    pthread_mutex_unlock(&this->mutex);
+
+    return task ? Summarize(*task) : json::value::null();
+}
+
+json::value TaskTelemetry::GetSummary(uint64_t processKey)
+{
+    auto task = this->Find(processKey);
+    return task ? Summarize(*task) : json::value::null();
+}
+
+json::value TaskTelemetry::ToJson(uint64_t processKey, size_t maxSamples)
+{
+    auto task = this->Find(processKey);
+    if (!task)
+    {
+        return json::value::null();
+    }
+
+    auto samples = task->Samples.Snapshot(maxSamples);
+
+    std::vector<json::value> samplesJson;
+    samplesJson.reserve(samples.size());
+    for (const auto& sample : samples)
+    {
+        samplesJson.push_back(ToJson(sample));
+    }
+
+    json::value j;
+    j["IntervalMs"] = this->intervalMilliseconds;
+    j["Summary"] = Summarize(*task);
+    j["Samples"] = json::value::array(samplesJson);
+
+    return j;
+}
+
+std::shared_ptr<TaskTelemetry::Task> TaskTelemetry::Find(uint64_t processKey)
+{
+    std::shared_ptr<Task> task;
+
+    pthread_mutex_lock(&this->mutex);
+    auto it = this->tasks.find(processKey);
+    if (it != this->tasks.end())
+    {
+        task = it->second;
+    }
+    pthread_mutex_unlock(&this->mutex);
+
+    return task;
+}
+
+void* TaskTelemetry::SamplingThread(void* arg)
+{
+    pthread_setname_np(pthread_self(), "telemetry");
+
+    TaskTelemetry* t = static_cast<TaskTelemetry*>(arg);
+
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    pthread_mutex_lock(&t->mutex);
+
+    while (t->isRunning)
+    {
+        // a fixed cadence, the time spent sampling doesn't shift the next sample.
+        next.tv_sec += t->intervalMilliseconds / 1000;
+        next.tv_nsec += (t->intervalMilliseconds % 1000) * 1000000L;
+        if (next.tv_nsec >= 1000000000L)
+        {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+
+        while (t->isRunning && pthread_cond_timedwait(&t->cond, &t->mutex, &next) != ETIMEDOUT);
+
+        if (!t->isRunning)
+        {
+            break;
+        }
+
+        pthread_mutex_unlock(&t->mutex);
+        t->SampleAll();
+        pthread_mutex_lock(&t->mutex);
+    }
+
+    pthread_mutex_unlock(&t->mutex);
+
+    pthread_exit(nullptr);
+}
+
+void TaskTelemetry::SampleAll()
+{
+    std::vector<std::shared_ptr<Task>> snapshot;
+
+    pthread_mutex_lock(&this->mutex);
+    snapshot.reserve(this->tasks.size());
+    for (auto& task : this->tasks)
+    {
+        snapshot.push_back(task.second);
+    }
+    pthread_mutex_unlock(&this->mutex);
+
+    // the cgroup files are read without the lock, Add and Remove don't wait.
+    for (auto& task : snapshot)
+    {
+        SampleTask(*task);
+    }
+}
+
+void TaskTelemetry::SampleTask(Task& task)
+{
+    CGroupController::Usage usage;
+    int ret = CGroupController::GetInstance().GetUsage(task.GroupName, usage);
+    if (ret != 0)
+    {
+        // the group is not created yet or removed already.
+        return;
+    }
+
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    Record(task, usage, (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+void TaskTelemetry::Record(Task& task, const CGroupController::Usage& usage, uint64_t time)
+{
+    Sample sample;
+    sample.Time = time;
+    sample.CpuUsec = usage.CpuUsec;
+    sample.CpuPercent = 0.0f;
+    sample.MemoryBytes = usage.MemoryBytes;
+    sample.MemoryPeakBytes = usage.MemoryPeakBytes;
+    sample.IoReadBytes = usage.IoReadBytes;
+    sample.IoWriteBytes = usage.IoWriteBytes;
+    sample.ProcessCount = usage.ProcessCount;
+
+    auto last = task.Samples.Snapshot(1);
+    if (last.empty())
+    {
+        task.StartCpuUsec.store(sample.CpuUsec, std::memory_order_relaxed);
+        task.StartTime.store(sample.Time, std::memory_order_release);
+    }
+    else
+    {
+        const Sample& previous = last.front();
+
+        if (sample.Time > previous.Time && sample.CpuUsec >= previous.CpuUsec)
+        {
+            sample.CpuPercent = (float)(sample.CpuUsec - previous.CpuUsec) / 10.0f / (sample.Time - previous.Time);
+        }
+
+        // the peak is tracked here when memory.peak is unavailable.
+        sample.MemoryPeakBytes = std::max(sample.MemoryPeakBytes, previous.MemoryPeakBytes);
+    }
+
+    sample.MemoryPeakBytes = std::max(sample.MemoryPeakBytes, sample.MemoryBytes);
+
+    if (sample.CpuPercent > task.MaxCpuPercent.load(std::memory_order_relaxed))
+    {
+        task.MaxCpuPercent.store(sample.CpuPercent, std::memory_order_relaxed);
+    }
+
+    if (sample.ProcessCount > task.MaxProcessCount.load(std::memory_order_relaxed))
+    {
+        task.MaxProcessCount.store(sample.ProcessCount, std::memory_order_relaxed);
+    }
+
+    task.Samples.Push(sample);
+}
+
+json::value TaskTelemetry::Summarize(const Task& task)
+{
+    json::value j;
+    j["SampleCount"] = task.Samples.GetCount();
+
+    auto last = task.Samples.Snapshot(1);
+    if (last.empty())
+    {
+        return j;
+    }
+
+    const Sample& sample = last.front();
+    uint64_t startTime = task.StartTime.load(std::memory_order_acquire);
+    uint64_t startCpuUsec = task.StartCpuUsec.load(std::memory_order_relaxed);
+
+    // the averages over the sampled period, the efficiency is the share of the
+    // allocated cores used.
+    float averageCpuPercent = 0.0f;
+    if (sample.Time > startTime && sample.CpuUsec >= startCpuUsec)
+    {
+        averageCpuPercent = (float)(sample.CpuUsec - startCpuUsec) / 10.0f / (sample.Time - startTime);
+    }
+
+    j["AverageCpuPercent"] = averageCpuPercent;
+    j["MaxCpuPercent"] = task.MaxCpuPercent.load(std::memory_order_relaxed);
+    j["CpuEfficiency"] = task.AllocatedCores > 0 ? averageCpuPercent / 100.0f / task.AllocatedCores : 0.0f;
+    j["MemoryBytes"] = sample.MemoryBytes;
+    j["MemoryPeakBytes"] = sample.MemoryPeakBytes;
+    j["IoReadBytes"] = sample.IoReadBytes;
+    j["IoWriteBytes"] = sample.IoWriteBytes;
+    j["MaxProcessCount"] = task.MaxProcessCount.load(std::memory_order_relaxed);
+
+    return j;
+}
+
+json::value TaskTelemetry::ToJson(const Sample& sample)
+{
+    json::value j;
+    j["Time"] = sample.Time;
+    j["CpuUsec"] = sample.CpuUsec;
+    j["CpuPercent"] = sample.CpuPercent;
+    j["MemoryBytes"] = sample.MemoryBytes;
+    j["MemoryPeakBytes"] = sample.MemoryPeakBytes;
+    j["IoReadBytes"] = sample.IoReadBytes;
+    j["IoWriteBytes"] = sample.IoWriteBytes;
+    j["ProcessCount"] = sample.ProcessCount;
+
+    return j;
+}
@@ -0,0 +1,105 @@
+#ifndef TASKTELEMETRY_H
+#define TASKTELEMETRY_H
+
+#include <map>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <cpprest/json.h>
+
+#include "CGroupController.h"
+#include "../utils/SampleRing.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        // Samples the cgroup usage of the running tasks at a fixed interval into a
+        // ring per task, read by the taskmetrics call while the task runs. The
+        // summary of the whole run is folded into the completion event. Only the
+        // tasks in a native cgroup are sampled.
+        class TaskTelemetry
+        {
+            public:
+                typedef struct _Sample
+                {
+                    // milliseconds since epoch.
+                    uint64_t Time;
+                    uint64_t CpuUsec;
+                    // of one core, 200 for 2 busy cores.
+                    float CpuPercent;
+                    uint64_t MemoryBytes;
+                    uint64_t MemoryPeakBytes;
+                    uint64_t IoReadBytes;
+                    uint64_t IoWriteBytes;
+                    uint32_t ProcessCount;
+                } Sample;
+
+                TaskTelemetry(int intervalMilliseconds, size_t capacity);
+                ~TaskTelemetry();
+
+                void Add(uint64_t processKey, const std::string& groupName, int allocatedCores);
+
+                // Stops sampling the task, returns the summary or null when the task
+                // was not sampled.
+                web::json::value Remove(uint64_t processKey);
+
+                // The summary of the samples so far, null when the task is not sampled.
+                web::json::value GetSummary(uint64_t processKey);
+
+                // The summary and the last maxSamples samples, null when the task is
+                // not sampled.
+                web::json::value ToJson(uint64_t processKey, size_t maxSamples);
+
+                int GetInterval() const { return this->intervalMilliseconds; }
+
+                static const int DefaultIntervalMilliseconds = 1000;
+                static const size_t DefaultCapacity = 256;
+
+                // written by the sampling thread only, read by the summary and the
+                // taskmetrics call meanwhile.
+                typedef struct _Task
+                {
+                    _Task(const std::string& groupName, int allocatedCores, size_t capacity) :
+                        GroupName(groupName), AllocatedCores(allocatedCores), Samples(capacity) { }
+
+                    const std::string GroupName;
+                    const int AllocatedCores;
+                    hpc::utils::SampleRing<Sample> Samples;
+
+                    std::atomic<uint64_t> StartTime { 0 };
+                    std::atomic<uint64_t> StartCpuUsec { 0 };
+                    std::atomic<float> MaxCpuPercent { 0.0f };
+                    std::atomic<uint32_t> MaxProcessCount { 0 };
+                } Task;
+
+                // Adds the usage read at time, in milliseconds since epoch, to the
+                // samples and the peaks of the task.
+                static void Record(Task& task, const CGroupController::Usage& usage, uint64_t time);
+                static web::json::value Summarize(const Task& task);
+
+            protected:
+            private:
+                static void* SamplingThread(void* arg);
+
+                std::shared_ptr<Task> Find(uint64_t processKey);
+                void SampleAll();
+                static void SampleTask(Task& task);
+                static web::json::value ToJson(const Sample& sample);
+
+                const int intervalMilliseconds;
+                const size_t capacity;
+
+                std::map<uint64_t, std::shared_ptr<Task>> tasks;
+                bool isRunning = true;
+
+                pthread_t threadId = 0;
+                pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+                pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+        };
+    }
+}
+
+#endif // TASKTELEMETRY_H
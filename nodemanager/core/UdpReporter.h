@@ -10,7 +10,8 @@ namespace hpc
 {
     namespace core
     {
-        class UdpReporter : public Reporter<std::vector<unsigned char>>
+        // Sends the datagrams of a report, e.g. the fragments of a v2 metric packet.
+        class UdpReporter : public Reporter<const std::vector<std::vector<unsigned char>>&>
         {
             public:
                 UdpReporter(
@@ -18,7 +19,7 @@ namespace hpc
                     std::function<std::string(pplx::cancellation_token)> getReportUri,
                     int hold,
                     int interval,
-                    std::function<std::vector<unsigned char>()> fetcher,
+                    std::function<const std::vector<std::vector<unsigned char>>&()> fetcher,
                     std::function<void()> onErrorFunc);
 
                 virtual ~UdpReporter();
@@ -0,0 +1,453 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <openssl/evp.h>
+
+#include "UserProvisioner.h"
+#include "../utils/Logger.h"
+#include "../utils/String.h"
+#include "../utils/System.h"
+#include "../utils/Reactor.h"
+#include "../common/ErrorCodes.h"
+
+using namespace hpc::core;
+using namespace hpc::utils;
+using namespace hpc::common;
+
+UserProvisioner::UserProvisioner(int keyLingerSeconds) : keyLingerSeconds(keyLingerSeconds)
+{
+}
+
+UserProvisioner::~UserProvisioner()
+{
+    pthread_mutex_lock(&this->mutex);
+
+    for (auto& u : this->users)
+    {
+        if (u.second.RemovalTimerId != 0)
+        {
+            Reactor::GetInstance().Cancel(u.second.RemovalTimerId);
+        }
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+    pthread_mutex_destroy(&this->mutex);
+}
+
+int UserProvisioner::Acquire(
+    int jobId,
+    const std::string& userName,
+    const std::string& password,
+    bool isAdmin,
+    bool createUser,
+    bool addKeys,
+    const std::string& privateKey,
+    std::string& publicKey)
+{
+    LockTable<std::string>::Guard userGuard(this->userLocks, userName);
+
+    // The entries are only changed under the lock of the user, the map lock
+    // protects the map itself.
+    pthread_mutex_lock(&this->mutex);
+    User& user = this->users[userName];
+    pthread_mutex_unlock(&this->mutex);
+
+    if (user.RemovalTimerId != 0)
+    {
+        Reactor::GetInstance().Cancel(user.RemovalTimerId);
+        user.RemovalTimerId = 0;
+    }
+
+    if (createUser && !user.Created)
+    {
+        bool existed = false;
+        int ret = this->CreateUser(userName, password, isAdmin, existed);
+        if (ret != 0)
+        {
+            return ret;
+        }
+
+        user.Created = true;
+        user.Existed = existed;
+        Logger::Debug("Job {0}: provisioned user {1}, existed {2}", jobId, userName, existed);
+    }
+
+    if (addKeys)
+    {
+        std::string fingerprint = Fingerprint(privateKey, publicKey);
+        if (user.KeysReady && user.Fingerprint == fingerprint)
+        {
+            publicKey = user.PublicKey;
+            Logger::Debug("Job {0}: the ssh keys of user {1} are provisioned already", jobId, userName);
+        }
+        else
+        {
+            // The state is kept so the files written for the earlier keys are
+            // still removed.
+            int ret = this->AddKeys(userName, privateKey, publicKey, user.Keys);
+
+            user.KeysReady = ret == 0 && user.Keys.PrivateKeyReady && user.Keys.PublicKeyReady && user.Keys.AuthKeyReady;
+            user.Fingerprint = fingerprint;
+            user.PublicKey = publicKey;
+
+            Logger::Debug("Job {0}: add ssh key for user {1} result: ret {2}, private {3}, public {4}, auth {5}",
+                jobId, userName, ret, user.Keys.PrivateKeyReady, user.Keys.PublicKeyReady, user.Keys.AuthKeyReady);
+
+            // The job still starts without the keys, the files written are
+            // removed with the user's last job.
+            if (ret != 0)
+            {
+                Logger::Error("Job {0}: failed to add the ssh keys of user {1}, error code {2}", jobId, userName, ret);
+            }
+        }
+    }
+
+    user.Jobs.insert(jobId);
+
+    return 0;
+}
+
+void UserProvisioner::Release(int jobId, const std::string& userName)
+{
+    LockTable<std::string>::Guard userGuard(this->userLocks, userName);
+
+    pthread_mutex_lock(&this->mutex);
+    auto it = this->users.find(userName);
+    pthread_mutex_unlock(&this->mutex);
+
+    if (it == this->users.end())
+    {
+        return;
+    }
+
+    User& user = it->second;
+    user.Jobs.erase(jobId);
+
+    // The user is left on the node, which is by design, only the keys are removed.
+    if (!user.Jobs.empty() || user.RemovalTimerId != 0)
+    {
+        return;
+    }
+
+    if (this->keyLingerSeconds <= 0)
+    {
+        this->RemoveKeysIfUnused(userName, 0);
+        return;
+    }
+
+    Logger::Info("Job {0}: no job of user {1}, remove the ssh keys in {2} seconds", jobId, userName, this->keyLingerSeconds);
+
+    // The timer handler waits for the user lock, so the id is set before it checks.
+    auto timerId = std::make_shared<uint64_t>(0);
+    *timerId = Reactor::GetInstance().AddTimer(this->keyLingerSeconds * 1000, [this, userName, timerId]()
+    {
+        Reactor::GetInstance().PostBlocking([this, userName, timerId]()
+        {
+            LockTable<std::string>::Guard userGuard(this->userLocks, userName);
+            this->RemoveKeysIfUnused(userName, *timerId);
+        });
+    });
+
+    user.RemovalTimerId = *timerId;
+}
+
+void UserProvisioner::RemoveKeysIfUnused(const std::string& userName, uint64_t timerId)
+{
+    pthread_mutex_lock(&this->mutex);
+    auto it = this->users.find(userName);
+    pthread_mutex_unlock(&this->mutex);
+
+    // A new job may have taken the user after the timer fired.
+    if (it == this->users.end() || !it->second.Jobs.empty() || it->second.RemovalTimerId != timerId)
+    {
+        return;
+    }
+
+    User& user = it->second;
+    user.RemovalTimerId = 0;
+
+    Logger::Info("Remove the ssh keys of user {0}", userName);
+    this->RemoveKeys(userName, user.PublicKey, user.Keys);
+
+    user.Keys = KeyState();
+    user.KeysReady = false;
+    user.Fingerprint.clear();
+    user.PublicKey.clear();
+}
+
+int UserProvisioner::CreateUser(const std::string& userName, const std::string& password, bool isAdmin, bool& existed)
+{
+    std::string homeDir;
+    uid_t uid;
+    gid_t gid;
+    if (GetUserIds(userName, homeDir, uid, gid) == 0)
+    {
+        existed = true;
+        return 0;
+    }
+
+    int ret = System::CreateUser(userName, password, isAdmin);
+    existed = ret == 9;
+
+    return existed ? 0 : ret;
+}
+
+int UserProvisioner::AddKeys(const std::string& userName, const std::string& privateKey, std::string& publicKey, KeyState& state)
+{
+    // nothing to provision, the job runs without the keys.
+    if (privateKey.empty())
+    {
+        return 0;
+    }
+
+    std::string homeDir;
+    uid_t uid;
+    gid_t gid;
+    int ret = GetUserIds(userName, homeDir, uid, gid);
+    if (ret != 0)
+    {
+        Logger::Error("Cannot find home folder for user {0}, errno {1}", userName, ret);
+        return ret;
+    }
+
+    std::string sshFolder = homeDir + "/.ssh";
+    if ((mkdir(sshFolder.c_str(), 0700) != 0 && errno != EEXIST) ||
+        chown(sshFolder.c_str(), uid, gid) != 0 ||
+        chmod(sshFolder.c_str(), 0700) != 0)
+    {
+        ret = errno;
+        Logger::Error("Cannot create folder {0}, errno {1}", sshFolder, ret);
+        return ret;
+    }
+
+    // won't overwrite existing user's private key
+    std::string privateKeyFile = sshFolder + "/id_rsa";
+    if (FileExists(privateKeyFile))
+    {
+        Logger::Info("File {0} exist, skip overwriting", privateKeyFile);
+        state.PrivateKeyReady = true;
+    }
+    else
+    {
+        ret = WriteFileAtomically(privateKeyFile, privateKey, uid, gid, 0600);
+        state.PrivateKeyReady = state.PrivateKeyWritten = ret == 0;
+    }
+
+    if (!state.PrivateKeyReady)
+    {
+        Logger::Error("Error when writing the file {0}, errno {1}", privateKeyFile, ret);
+        return ret;
+    }
+
+    if (publicKey.empty())
+    {
+        ret = System::ExecuteCommandOut(publicKey, "ssh-keygen -y -f ", privateKeyFile);
+        if (ret != 0)
+        {
+            Logger::Error("Retrieve public key failed with exitcode {0}.", ret);
+            publicKey.clear();
+            return ret;
+        }
+    }
+
+    std::string publicKeyFile = sshFolder + "/id_rsa.pub";
+    if (FileExists(publicKeyFile))
+    {
+        Logger::Info("File {0} exist, skip overwriting", publicKeyFile);
+        state.PublicKeyReady = true;
+    }
+    else
+    {
+        ret = WriteFileAtomically(publicKeyFile, publicKey, uid, gid, 0644);
+        state.PublicKeyReady = state.PublicKeyWritten = ret == 0;
+    }
+
+    if (!state.PublicKeyReady)
+    {
+        Logger::Error("Error when writing the file {0}, errno {1}", publicKeyFile, ret);
+        return ret;
+    }
+
+    std::string authFile = sshFolder + "/authorized_keys";
+    std::string trimKey = String::Trim(publicKey);
+    std::string contents;
+    bool found = false;
+
+    {
+        std::ifstream fs(authFile, std::ios::in);
+        std::string line;
+        while (getline(fs, line))
+        {
+            found = found || String::Trim(line) == trimKey;
+            contents += line + "\n";
+        }
+    }
+
+    if (found)
+    {
+        state.AuthKeyReady = true;
+        return 0;
+    }
+
+    ret = WriteFileAtomically(authFile, contents + trimKey + "\n", uid, gid, 0600);
+    state.AuthKeyReady = ret == 0;
+    state.AuthKeyWritten = state.AuthKeyWritten || ret == 0;
+
+    if (ret != 0)
+    {
+        Logger::Error("Error when writing the auth file {0}, errno {1}", authFile, ret);
+    }
+
+    return ret;
+}
+
+void UserProvisioner::RemoveKeys(const std::string& userName, const std::string& publicKey, const KeyState& state)
+{
+    std::string homeDir;
+    uid_t uid;
+    gid_t gid;
+    if (GetUserIds(userName, homeDir, uid, gid) != 0)
+    {
+        return;
+    }
+
+    std::string sshFolder = homeDir + "/.ssh";
+
+    if (state.PrivateKeyWritten)
+    {
+        unlink((sshFolder + "/id_rsa").c_str());
+    }
+
+    if (state.PublicKeyWritten)
+    {
+        unlink((sshFolder + "/id_rsa.pub").c_str());
+    }
+
+    if (state.AuthKeyWritten)
+    {
+        int ret = RemoveAuthorizedKey(sshFolder + "/authorized_keys", publicKey, uid, gid);
+        if (ret != 0)
+        {
+            Logger::Warn("Failed to remove the authorized key of user {0}, errno {1}", userName, ret);
+        }
+    }
+}
+
+std::string UserProvisioner::Fingerprint(const std::string& privateKey, const std::string& publicKey)
+{
+    std::string data = privateKey;
+    data.push_back('\0');
+    data += publicKey;
+
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    if (!EVP_Digest(data.data(), data.size(), digest, &length, EVP_sha256(), nullptr))
+    {
+        // never matches, the keys are provisioned every time.
+        return std::string();
+    }
+
+    std::ostringstream oss;
+    for (unsigned int i = 0; i < length; i++)
+    {
+        oss << std::hex << std::setw(2) << std::setfill('0') << (int)digest[i];
+    }
+
+    return oss.str();
+}
+
+int UserProvisioner::GetUserIds(const std::string& userName, std::string& homeDir, uid_t& uid, gid_t& gid)
+{
+    long size = sysconf(_SC_GETPW_R_SIZE_MAX);
+    std::vector<char> buffer(size > 0 ? size : 16384);
+
+    struct passwd pwd;
+    struct passwd* result = nullptr;
+    int ret = getpwnam_r(userName.c_str(), &pwd, buffer.data(), buffer.size(), &result);
+    if (result == nullptr)
+    {
+        return ret == 0 ? ENOENT : ret;
+    }
+
+    homeDir = pwd.pw_dir;
+    uid = pwd.pw_uid;
+    gid = pwd.pw_gid;
+
+    return 0;
+}
+
+int UserProvisioner::WriteFileAtomically(const std::string& path, const std::string& contents, uid_t uid, gid_t gid, mode_t mode)
+{
+    // The readers, e.g. sshd, see either the old or the new file.
+    std::string tempPath = path + ".XXXXXX";
+    int fd = mkostemp(&tempPath[0], O_CLOEXEC);
+    if (fd < 0)
+    {
+        return errno;
+    }
+
+    int ret = 0;
+    size_t written = 0;
+    while (ret == 0 && written < contents.size())
+    {
+        ssize_t n = write(fd, contents.data() + written, contents.size() - written);
+        if (n < 0 && errno != EINTR) { ret = errno; }
+        else if (n > 0) { written += n; }
+    }
+
+    if (ret == 0 && (fchown(fd, uid, gid) != 0 || fchmod(fd, mode) != 0))
+    {
+        ret = errno;
+    }
+
+    close(fd);
+
+    if (ret == 0 && rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        ret = errno;
+    }
+
+    if (ret != 0)
+    {
+        unlink(tempPath.c_str());
+    }
+
+    return ret;
+}
+
+int UserProvisioner::RemoveAuthorizedKey(const std::string& path, const std::string& key, uid_t uid, gid_t gid)
+{
+    std::ifstream fs(path, std::ios::in);
+    if (!fs.good())
+    {
+        return (int)ErrorCodes::WriteFileError;
+    }
+
+    std::string trimKey = String::Trim(key);
+    std::string contents;
+    std::string line;
+    while (getline(fs, line))
+    {
+        if (String::Trim(line) != trimKey)
+        {
+            contents += line + "\n";
+        }
+    }
+
+    fs.close();
+
+    return WriteFileAtomically(path, contents, uid, gid, 0600);
+}
+
+bool UserProvisioner::FileExists(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
@@ -0,0 +1,93 @@
+#ifndef USERPROVISIONER_H
+#define USERPROVISIONER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "../utils/LockTable.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        // Creates the job users and their ssh keys. The provisioned users are
+        // cached with the fingerprint of the keys and counted by the jobs using
+        // them, a job of a user already provisioned with the same keys skips the
+        // provisioning. The keys are removed when the last job of the user ended
+        // for the linger period, so back to back jobs keep them.
+        class UserProvisioner
+        {
+            public:
+                UserProvisioner(int keyLingerSeconds);
+                virtual ~UserProvisioner();
+
+                // Provisions the user for the job, the public key is derived from the
+                // private key when empty. Returns 0 or the error code of the user
+                // creation, a failure to add the keys is logged only.
+                int Acquire(
+                    int jobId,
+                    const std::string& userName,
+                    const std::string& password,
+                    bool isAdmin,
+                    bool createUser,
+                    bool addKeys,
+                    const std::string& privateKey,
+                    std::string& publicKey);
+
+                void Release(int jobId, const std::string& userName);
+
+                static const int DefaultKeyLingerSeconds = 60;
+
+            protected:
+                typedef struct _KeyState
+                {
+                    bool PrivateKeyReady;
+                    bool PublicKeyReady;
+                    bool AuthKeyReady;
+                    // only the files written by the provisioner are removed.
+                    bool PrivateKeyWritten;
+                    bool PublicKeyWritten;
+                    bool AuthKeyWritten;
+                } KeyState;
+
+                // The system operations, returns 0 or the error code.
+                virtual int CreateUser(const std::string& userName, const std::string& password, bool isAdmin, bool& existed);
+                virtual int AddKeys(const std::string& userName, const std::string& privateKey, std::string& publicKey, KeyState& state);
+                virtual void RemoveKeys(const std::string& userName, const std::string& publicKey, const KeyState& state);
+
+            private:
+                typedef struct _User
+                {
+                    std::set<int> Jobs;
+                    bool Created;
+                    bool Existed;
+                    bool KeysReady;
+                    std::string Fingerprint;
+                    std::string PublicKey;
+                    KeyState Keys;
+                    uint64_t RemovalTimerId;
+                } User;
+
+                void RemoveKeysIfUnused(const std::string& userName, uint64_t timerId);
+
+                static std::string Fingerprint(const std::string& privateKey, const std::string& publicKey);
+                static int GetUserIds(const std::string& userName, std::string& homeDir, uid_t& uid, gid_t& gid);
+                static int WriteFileAtomically(const std::string& path, const std::string& contents, uid_t uid, gid_t gid, mode_t mode);
+                static int RemoveAuthorizedKey(const std::string& path, const std::string& key, uid_t uid, gid_t gid);
+                static bool FileExists(const std::string& path);
+
+                const int keyLingerSeconds;
+
+                std::map<std::string, User> users;
+                pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+                // The provisioning and the removal of a user are serialized.
+                hpc::utils::LockTable<std::string> userLocks;
+        };
+    }
+}
+
+#endif // USERPROVISIONER_H
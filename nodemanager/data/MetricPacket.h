@@ -0,0 +1,30 @@
+#ifndef METRICPACKET_H
+#define METRICPACKET_H
+
+#include <vector>
+#include <boost/uuid/uuid.hpp>
+
+#include "Umid.h"
+
+namespace hpc
+{
+    namespace data
+    {
+        // The metric values of a tick as encoded in the v2 udp packets.
+        struct MetricPacket
+        {
+            public:
+                MetricPacket() { }
+
+                boost::uuids::uuid Uuid = boost::uuids::uuid();
+                uint32_t Sequence = 0;
+                int TickCount = 0;
+                std::vector<std::pair<float, Umid>> Values;
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // METRICPACKET_H
@@ -6,6 +6,15 @@ using namespace web;
 using namespace hpc::data;
 using namespace hpc::utils;
 
+TaskInfo::TaskInfo(const TaskInfo& t) :
+    NodeName(t.NodeName), JobId(t.JobId), TaskId(t.TaskId), ExitCode(t.ExitCode), Exited(t.Exited),
+    KernelProcessorTimeMs(t.KernelProcessorTimeMs), UserProcessorTimeMs(t.UserProcessorTimeMs),
+    WorkingSetKb(t.WorkingSetKb), IsPrimaryTask(t.IsPrimaryTask), ProcessKey(t.ProcessKey),
+    Message(t.Message), ProcessIds(t.ProcessIds), Affinity(t.Affinity), Telemetry(t.Telemetry),
+    taskRequeueCount(t.taskRequeueCount), processKeySet(t.processKeySet)
+{
+}
+
 json::value TaskInfo::ToJson() const
 {
     json::value j;
@@ -22,6 +31,11 @@ json::value TaskInfo::ToJson() const
     j["Message"] = JsonHelper<std::string>::ToJson(this->Message);
     j["ProcessIds"] = JsonHelper<std::string>::ToJson(String::Join<','>(this->ProcessIds));
 
+    if (!this->Telemetry.is_null())
+    {
+        j["Telemetry"] = this->Telemetry;
+    }
+
     return j;
 }
 
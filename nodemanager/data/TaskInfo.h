@@ -7,6 +7,7 @@
 #include <memory>
 
 #include "../utils/Logger.h"
+#include "../utils/Reactor.h"
 #include "../data/ProcessStatistics.h"
 
 using namespace hpc::utils;
@@ -25,22 +26,24 @@ namespace hpc
 
                 ~TaskInfo()
                 {
-                    this->CancelGracefulThread();
+                    this->CancelGracePeriodTimer();
                 }
 
-                void CancelGracefulThread()
+                void CancelGracePeriodTimer()
                 {
-                    if (this->GracefulThreadId)
+                    if (this->GracePeriodTimerId)
                     {
-                        pthread_cancel(this->GracefulThreadId);
-                        pthread_join(this->GracefulThreadId, nullptr);
-                        Logger::Debug("Destructed TaskInfo GracefulThread {0}", this->GracefulThreadId);
-                        this->GracefulThreadId = 0;
+                        hpc::utils::Reactor::GetInstance().Cancel(this->GracePeriodTimerId);
+                        Logger::Debug("Canceled TaskInfo GracePeriodTimer {0}", this->GracePeriodTimerId);
+                        this->GracePeriodTimerId = 0;
                     }
                 }
 
                 TaskInfo(TaskInfo&& t) = default;
 
+                // A copy of the reported fields, it doesn't own the grace period timer.
+                TaskInfo(const TaskInfo& t);
+
                 web::json::value ToJson() const;
                 web::json::value ToCompletionEventArgJson() const;
 
@@ -97,7 +100,10 @@ namespace hpc
                 std::vector<int> ProcessIds;
                 std::vector<uint64_t> Affinity;
 
-                pthread_t GracefulThreadId = 0;
+                // The summary of the task telemetry, null when not sampled.
+                web::json::value Telemetry;
+
+                uint64_t GracePeriodTimerId = 0;
             protected:
             private:
                 int taskRequeueCount = 0;
@@ -1,3 +1,8 @@
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <boost/algorithm/string.hpp>
+
 #include "ExecutionFilter.h"
 #include "FilterException.h"
 #include "../utils/Logger.h"
@@ -5,11 +10,63 @@
 #include "../utils/System.h"
 #include "../core/Process.h"
 #include "../data/ProcessStatistics.h"
+#include "../arguments/StartTaskArgs.h"
+#include "../arguments/StartTasksArgs.h"
 
 using namespace hpc::filters;
 using namespace hpc::utils;
 using namespace hpc::common;
 using namespace hpc::data;
+using namespace hpc::arguments;
+
+ExecutionFilter::ExecutionFilter()
+{
+    filterFiles[JobStartFilter] = "filters/OnJobTaskStart.sh";
+    filterFiles[JobEndFilter] = "filters/OnJobEnd.sh";
+    filterFiles[TaskStartFilter] = "filters/OnTaskStart.sh";
+
+    try
+    {
+        this->batchTaskStart = NodeManagerConfig::GetTaskStartFilterBatch();
+    }
+    catch (...)
+    {
+        this->batchTaskStart = false;
+    }
+
+    if (!boost::algorithm::iequals(NodeManagerConfig::GetFilterMode(), "persistent"))
+    {
+        return;
+    }
+
+    int workers = FilterWorkerPool::DefaultMaxWorkers;
+    int timeoutSeconds = FilterWorkerPool::DefaultTimeoutSeconds;
+
+    try
+    {
+        workers = NodeManagerConfig::GetFilterWorkers();
+    }
+    catch (...)
+    {
+        Logger::Info("FilterWorkers not specified or invalid, use the default {0}.", workers);
+    }
+
+    try
+    {
+        timeoutSeconds = NodeManagerConfig::GetFilterTimeoutSeconds();
+    }
+    catch (...)
+    {
+        Logger::Info("FilterTimeoutSeconds not specified or invalid, use the default {0} seconds.", timeoutSeconds);
+    }
+
+    for (auto& filter : this->filterFiles)
+    {
+        this->workerPools[filter.first] = std::make_shared<FilterWorkerPool>(GetAbsolutePath(filter.second), workers, timeoutSeconds);
+    }
+
+    Logger::Info("Execution filters run persistently, {0} workers per filter, timeout {1} seconds", workers, timeoutSeconds);
+}
 
 pplx::task<json::value> ExecutionFilter::OnJobStart(int jobId, int taskId, int requeueCount, const json::value& input) const
 {
@@ -26,6 +83,77 @@ pplx::task<json::value> ExecutionFilter::OnTaskStart(int jobId, int taskId, int
     return this->ExecuteFilter(TaskStartFilter, jobId, taskId, requeueCount, input);
 }
 
+pplx::task<json::value> ExecutionFilter::OnTasksStart(const json::value& input) const
+{
+    const auto& tasks = input.as_array();
+
+    // checked once for the batch instead of per task.
+    std::ifstream test(this->filterFiles.at(TaskStartFilter));
+    if (tasks.size() == 0 || !test.good())
+    {
+        return pplx::task_from_result(input);
+    }
+
+    if (this->batchTaskStart)
+    {
+        auto first = StartTaskArgs::FromJson(*tasks.begin());
+        size_t count = tasks.size();
+
+        return this->ExecuteFilter(TaskStartFilter, first.JobId, first.TaskId, first.StartInfo.TaskRequeueCount, input).then(
+        [count](json::value output)
+        {
+            if (!output.is_array() || output.as_array().size() != count)
+            {
+                throw std::runtime_error(String::Join(" ", "TaskStartFilter returned", output.is_array() ? output.as_array().size() : 0, "tasks of", count));
+            }
+
+            return output;
+        });
+    }
+
+    // a task failed in its filter carries the error to its own result, the
+    // others of the batch still start.
+    std::vector<pplx::task<json::value>> filtered;
+    for (const auto& task : tasks)
+    {
+        auto args = StartTaskArgs::FromJson(task);
+        int jobId = args.JobId, taskId = args.TaskId, requeueCount = args.StartInfo.TaskRequeueCount;
+
+        auto fail = [task, jobId, taskId, requeueCount](const std::string& message)
+        {
+            Logger::Error(jobId, taskId, requeueCount, "TaskStartFilter failed: {0}", message);
+
+            json::value failed = task;
+            failed[StartTasksArgs::ErrorField] = json::value::string(message);
+            return failed;
+        };
+
+        try
+        {
+            filtered.push_back(this->OnTaskStart(jobId, taskId, requeueCount, task).then([fail](pplx::task<json::value> t)
+            {
+                try
+                {
+                    return t.get();
+                }
+                catch (const std::exception& ex)
+                {
+                    return fail(ex.what());
+                }
+            }));
+        }
+        catch (const std::exception& ex)
+        {
+            filtered.push_back(pplx::task_from_result(fail(ex.what())));
+        }
+    }
+
+    return pplx::when_all(filtered.begin(), filtered.end()).then([](std::vector<json::value> outputs)
+    {
+        return json::value::array(outputs);
+    });
+}
+
 pplx::task<json::value> ExecutionFilter::ExecuteFilter(const std::string& filterType, int jobId, int taskId, int requeueCount, const json::value& input) const
 {
     auto filterIt = this->filterFiles.find(filterType);
@@ -44,11 +172,12 @@ pplx::task<json::value> ExecutionFilter::ExecuteFilter(const std::string& filter
         return pplx::task_from_result(input);
     }
 
-    if (filterFile[0] != '/')
+    filterFile = GetAbsolutePath(filterFile);
+
+    auto pool = this->workerPools.find(filterType);
+    if (pool != this->workerPools.end())
     {
-        std::string pwd;
-        System::ExecuteCommandOut(pwd, "pwd | tr -d '\n'");
-        filterFile = pwd + "/" + filterFile;
+        return this->ExecutePersistentFilter(filterType, filterFile, pool->second, jobId, taskId, requeueCount, input);
     }
 
 //    std::string tt;
@@ -90,9 +219,9 @@ pplx::task<json::value> ExecutionFilter::ExecuteFilter(const std::string& filter
         {
         });
 
-    p->Start(p).then([=] (std::pair<pid_t, pthread_t> ids)
+    p->Start(p).then([=] (pid_t pid)
     {
-        Logger::Info(jobId, taskId, requeueCount, "{0} {1}: pid {2} tid {3}", filterType, filterFile, ids.first, ids.second);
+        Logger::Info(jobId, taskId, requeueCount, "{0} {1}: pid {2}", filterType, filterFile, pid);
     });
 
     return p->OnCompleted().then([=] (pplx::task<void> t)
@@ -157,3 +286,46 @@ pplx::task<json::value> ExecutionFilter::ExecuteFilter(const std::string& filter
 #endif // DEBUG
 
 }
+
+pplx::task<json::value> ExecutionFilter::ExecutePersistentFilter(
+    const std::string& filterType, const std::string& filterFile, std::shared_ptr<FilterWorkerPool> pool,
+    int jobId, int taskId, int requeueCount, const json::value& input) const
+{
+    std::string request = input.serialize();
+
+    return pplx::create_task([=]()
+    {
+        std::string output;
+        int exitCode;
+        int ret = pool->Execute(request, output, exitCode);
+
+        if (ret == ETIMEDOUT || ret == EPIPE)
+        {
+            throw FilterException(exitCode, String::Join("", filterType, " ", filterFile, ": Filter worker ",
+                ret == ETIMEDOUT ? "timed out" : "exited", ", exit code ", exitCode));
+        }
+        else if (ret != 0)
+        {
+            throw std::runtime_error(String::Join("", filterType, " ", filterFile, ": Failed to start the filter worker, errno ", ret));
+        }
+
+        Logger::Info(jobId, taskId, requeueCount, "{0} {1}: plugin output read", filterType, filterFile);
+        return json::value::parse(output);
+    });
+}
+
+std::string ExecutionFilter::GetAbsolutePath(const std::string& path)
+{
+    if (path.empty() || path[0] == '/')
+    {
+        return path;
+    }
+
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr)
+    {
+        return path;
+    }
+
+    return std::string(cwd) + "/" + path;
+}
@@ -1,9 +1,12 @@
 #ifndef EXECUTIONFILTER_H
 #define EXECUTIONFILTER_H
 
+#include <map>
+#include <memory>
 #include <string>
 #include <cpprest/json.h>
 #include "../core/NodeManagerConfig.h"
+#include "FilterWorkerPool.h"
 
 namespace hpc
 {
@@ -11,23 +14,34 @@ namespace hpc
     {
         using namespace hpc::core;
 
+        // Runs the filter of a type as a process per call, or with FilterMode
+        // "persistent" as the co-processes of a FilterWorkerPool.
         class ExecutionFilter
         {
             public:
-                ExecutionFilter()
-                {
-                    filterFiles[JobStartFilter] = "filters/OnJobTaskStart.sh";
-                    filterFiles[JobEndFilter] = "filters/OnJobEnd.sh";
-                    filterFiles[TaskStartFilter] = "filters/OnTaskStart.sh";
-                }
+                ExecutionFilter();
 
                 pplx::task<json::value> OnJobStart(int jobId, int taskId, int requeueCount, const json::value& input) const;
                 pplx::task<json::value> OnJobEnd(int jobId, const json::value& input) const;
                 pplx::task<json::value> OnTaskStart(int jobId, int taskId, int requeueCount, const json::value& input) const;
+
+                // Filters an array of StartTaskArgs, by one call with the array when
+                // TaskStartFilterBatch is set, or by a call per task in parallel, where
+                // a failed task keeps its input with StartTasksArgs::ErrorField set.
+                pplx::task<json::value> OnTasksStart(const json::value& input) const;
+
                 pplx::task<json::value> ExecuteFilter(const std::string& filterType, int jobId, int taskId, int requeueCount, const json::value& input) const;
 
             private:
+                pplx::task<json::value> ExecutePersistentFilter(
+                    const std::string& filterType, const std::string& filterFile, std::shared_ptr<FilterWorkerPool> pool,
+                    int jobId, int taskId, int requeueCount, const json::value& input) const;
+
+                static std::string GetAbsolutePath(const std::string& path);
+
                 std::map<std::string, std::string> filterFiles;
+                std::map<std::string, std::shared_ptr<FilterWorkerPool>> workerPools;
+                bool batchTaskStart = false;
                 const std::string JobStartFilter = "JobStartFilter";
                 const std::string JobEndFilter = "JobEndFilter";
                 const std::string TaskStartFilter = "TaskStartFilter";
@@ -0,0 +1,270 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <chrono>
+
+#include "FilterWorkerPool.h"
+#include "../utils/Logger.h"
+
+extern char** environ;
+
+using namespace hpc::filters;
+using namespace hpc::utils;
+
+FilterWorkerPool::FilterWorkerPool(const std::string& filterFile, int maxWorkers, int timeoutSeconds) :
+    filterFile(filterFile), maxWorkers(maxWorkers), timeoutSeconds(timeoutSeconds)
+{
+}
+
+FilterWorkerPool::~FilterWorkerPool()
+{
+    pthread_mutex_lock(&this->mutex);
+
+    for (auto& worker : this->idleWorkers)
+    {
+        this->Stop(*worker, false);
+    }
+
+    this->idleWorkers.clear();
+
+    pthread_mutex_unlock(&this->mutex);
+
+    pthread_cond_destroy(&this->available);
+    pthread_mutex_destroy(&this->mutex);
+}
+
+int FilterWorkerPool::Execute(const std::string& input, std::string& output, int& exitCode)
+{
+    exitCode = 0;
+
+    auto worker = this->Acquire();
+
+    int ret = worker->Pid < 0 ? this->Start(*worker) : 0;
+    if (ret == 0)
+    {
+        ret = this->Request(*worker, input, output);
+        if (ret != 0)
+        {
+            exitCode = this->Stop(*worker, ret == ETIMEDOUT);
+            Logger::Warn("Filter {0}: worker stopped with exit code {1}, error {2}", this->filterFile, exitCode, ret);
+        }
+    }
+
+    this->Release(std::move(worker));
+
+    return ret;
+}
+
+std::unique_ptr<FilterWorkerPool::Worker> FilterWorkerPool::Acquire()
+{
+    std::unique_ptr<Worker> worker;
+
+    pthread_mutex_lock(&this->mutex);
+
+    while (this->idleWorkers.empty() && this->workerCount >= this->maxWorkers)
+    {
+        pthread_cond_wait(&this->available, &this->mutex);
+    }
+
+    if (!this->idleWorkers.empty())
+    {
+        worker = std::move(this->idleWorkers.back());
+        this->idleWorkers.pop_back();
+    }
+    else
+    {
+        // started by the caller outside the lock.
+        worker.reset(new Worker());
+        this->workerCount++;
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+
+    return worker;
+}
+
+void FilterWorkerPool::Release(std::unique_ptr<Worker> worker)
+{
+    pthread_mutex_lock(&this->mutex);
+
+    if (worker->Pid < 0)
+    {
+        this->workerCount--;
+    }
+    else
+    {
+        this->idleWorkers.push_back(std::move(worker));
+    }
+
+    pthread_cond_signal(&this->available);
+    pthread_mutex_unlock(&this->mutex);
+}
+
+int FilterWorkerPool::Start(Worker& worker)
+{
+    int inputPipe[2], outputPipe[2];
+    if (pipe2(inputPipe, O_CLOEXEC) != 0)
+    {
+        return errno;
+    }
+
+    if (pipe2(outputPipe, O_CLOEXEC) != 0)
+    {
+        int ret = errno;
+        close(inputPipe[0]);
+        close(inputPipe[1]);
+        return ret;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, inputPipe[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, outputPipe[1], STDOUT_FILENO);
+
+    // in its own process group, so a timeout kills the children of the script too.
+    sigset_t noSignals, allSignals;
+    sigemptyset(&noSignals);
+    sigfillset(&allSignals);
+    sigdelset(&allSignals, SIGKILL);
+    sigdelset(&allSignals, SIGSTOP);
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &noSignals);
+    posix_spawnattr_setsigdefault(&attr, &allSignals);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+
+    char* const args[] =
+    {
+        const_cast<char* const>("/bin/bash"),
+        const_cast<char* const>(this->filterFile.c_str()),
+        nullptr
+    };
+
+    pid_t pid;
+    int ret = posix_spawn(&pid, args[0], &actions, &attr, args, environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(inputPipe[0]);
+    close(outputPipe[1]);
+
+    if (ret != 0)
+    {
+        close(inputPipe[1]);
+        close(outputPipe[0]);
+        Logger::Error("Filter {0}: failed to start a worker, error {1}", this->filterFile, ret);
+        return ret;
+    }
+
+    worker.Pid = pid;
+    worker.InputFd = inputPipe[1];
+    worker.OutputFd = outputPipe[0];
+    worker.Buffer.clear();
+
+    Logger::Info("Filter {0}: worker {1} started", this->filterFile, pid);
+
+    return 0;
+}
+
+int FilterWorkerPool::Request(Worker& worker, const std::string& input, std::string& output)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(this->timeoutSeconds);
+    auto remainingMs = [&deadline]()
+    {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        return ms > 0 ? (int)ms : 0;
+    };
+
+    // the serialized json has no new line.
+    std::string line = input + "\n";
+
+    // a worker which exited raises SIGPIPE on the write, blocked in this thread
+    // and taken back below instead of terminating the node manager.
+    sigset_t pipeSignal, oldMask;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, &oldMask);
+
+    int ret = 0;
+    size_t written = 0;
+    while (ret == 0 && written < line.size())
+    {
+        pollfd fd = { worker.InputFd, POLLOUT, 0 };
+        int n = poll(&fd, 1, remainingMs());
+        if (n == 0) { ret = ETIMEDOUT; break; }
+        if (n < 0) { if (errno != EINTR) ret = errno; continue; }
+
+        ssize_t w = write(worker.InputFd, line.data() + written, line.size() - written);
+        if (w < 0 && errno != EINTR && errno != EAGAIN) { ret = errno; }
+        else if (w > 0) { written += w; }
+    }
+
+    if (ret == EPIPE)
+    {
+        timespec zero = { 0, 0 };
+        sigtimedwait(&pipeSignal, nullptr, &zero);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+
+    size_t end = 0;
+    while (ret == 0 && (end = worker.Buffer.find('\n')) == std::string::npos)
+    {
+        pollfd fd = { worker.OutputFd, POLLIN, 0 };
+        int n = poll(&fd, 1, remainingMs());
+        if (n == 0) { ret = ETIMEDOUT; break; }
+        if (n < 0) { if (errno != EINTR) ret = errno; continue; }
+
+        char buffer[65536];
+        ssize_t r = read(worker.OutputFd, buffer, sizeof(buffer));
+        if (r == 0) { ret = EPIPE; }
+        else if (r < 0 && errno != EINTR && errno != EAGAIN) { ret = errno; }
+        else if (r > 0) { worker.Buffer.append(buffer, r); }
+    }
+
+    if (ret == 0)
+    {
+        output.assign(worker.Buffer, 0, end);
+        worker.Buffer.erase(0, end + 1);
+    }
+
+    return ret;
+}
+
+int FilterWorkerPool::Stop(Worker& worker, bool kill)
+{
+    // the worker exits on the end of its stdin unless killed.
+    close(worker.InputFd);
+    close(worker.OutputFd);
+
+    int status = 0;
+    pid_t ret = 0;
+    for (int i = 0; !kill && i < 100 && (ret = waitpid(worker.Pid, &status, WNOHANG)) == 0; i++)
+    {
+        usleep(10000);
+    }
+
+    if (ret == 0)
+    {
+        ::kill(-worker.Pid, SIGKILL);
+        ret = waitpid(worker.Pid, &status, 0);
+    }
+
+    worker.Pid = -1;
+    worker.InputFd = worker.OutputFd = -1;
+    worker.Buffer.clear();
+
+    if (ret < 0)
+    {
+        return -1;
+    }
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
@@ -0,0 +1,62 @@
+#ifndef FILTERWORKERPOOL_H
+#define FILTERWORKERPOOL_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/types.h>
+
+namespace hpc
+{
+    namespace filters
+    {
+        // Runs a filter as long lived co-processes. A request is the input json
+        // in one line on the stdin of an idle worker, the reply is one line of json
+        // on its stdout, so the filter must flush each line, e.g. sed -u. Up to
+        // maxWorkers workers run in parallel, a worker which exited or timed out is
+        // started again by the next request.
+        class FilterWorkerPool
+        {
+            public:
+                FilterWorkerPool(const std::string& filterFile, int maxWorkers, int timeoutSeconds);
+                ~FilterWorkerPool();
+
+                // Returns 0 with the reply in output, ETIMEDOUT or EPIPE when the worker
+                // was killed or exited with its exit code in exitCode, or the errno of
+                // starting the worker.
+                int Execute(const std::string& input, std::string& output, int& exitCode);
+
+                static const int DefaultMaxWorkers = 2;
+                static const int DefaultTimeoutSeconds = 60;
+
+            protected:
+            private:
+                typedef struct _Worker
+                {
+                    pid_t Pid = -1;
+                    int InputFd = -1;
+                    int OutputFd = -1;
+                    std::string Buffer;
+                } Worker;
+
+                std::unique_ptr<Worker> Acquire();
+                void Release(std::unique_ptr<Worker> worker);
+
+                int Start(Worker& worker);
+                int Request(Worker& worker, const std::string& input, std::string& output);
+                int Stop(Worker& worker, bool kill);
+
+                const std::string filterFile;
+                const int maxWorkers;
+                const int timeoutSeconds;
+
+                std::vector<std::unique_ptr<Worker>> idleWorkers;
+                int workerCount = 0;
+                pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+                pthread_cond_t available = PTHREAD_COND_INITIALIZER;
+        };
+    }
+}
+
+#endif // FILTERWORKERPOOL_H
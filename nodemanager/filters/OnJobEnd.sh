@@ -1 +1 @@
-sed -s 's/123/456/g'
+sed -u -s 's/123/456/g'
@@ -11,6 +11,8 @@ taskId=$1
 runPath=$2
 userName=$3
 taskFolder=$4
+# the node manager has already put this process into the task cgroup
+cgroupAttached=$5
 
 cp {TestMutualTrust.sh,WaitForTrust.sh} $taskFolder
 
@@ -31,7 +33,7 @@ if [ "$isDockerTask" == "1" ]; then
     exit
 fi
 
-if $CGInstalled; then
+if $CGInstalled && [ "$cgroupAttached" != "1" ]; then
     groupName=$(GetCGroupName "$taskId")
     group=$CGroupSubSys:$groupName
     cgexec -g "$group" /bin/bash $taskFolder/TestMutualTrust.sh "$taskId" "$taskFolder" "$userName" &&\
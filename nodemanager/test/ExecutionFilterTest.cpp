@@ -2,6 +2,7 @@
 
 #ifdef DEBUG
 
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -17,11 +18,13 @@
 #include "../common/ErrorCodes.h"
 #include "../core/HttpHelper.h"
 #include "../utils/System.h"
+#include "../filters/FilterWorkerPool.h"
 
 using namespace hpc::tests;
 using namespace hpc::core;
 using namespace hpc::data;
 using namespace hpc::utils;
+using namespace hpc::filters;
 
 using namespace web::http;
 using namespace web;
@@ -104,4 +107,97 @@ bool ExecutionFilterTest::JobStart()
     return result;
 }
 
+bool ExecutionFilterTest::PersistentWorkers()
+{
+    const int Calls = 200;
+    const int Parallel = 8;
+    bool result = true;
+
+    char filterFile[] = "/tmp/nodemanager_filter_XXXXXX";
+    int fd = mkstemp(filterFile);
+    if (fd < 0)
+    {
+        Logger::Error("PersistentWorkers: failed to create the filter, errno {0}", errno);
+        return false;
+    }
+
+    close(fd);
+
+    {
+        std::ofstream ofs(filterFile);
+        ofs << "while IFS= read -r line; do" << std::endl;
+        ofs << "    case \"$line\" in" << std::endl;
+        ofs << "        *crash*) exit 3 ;;" << std::endl;
+        ofs << "        *hang*) sleep 60 ;;" << std::endl;
+        ofs << "        *) echo \"${line//123/456}\" ;;" << std::endl;
+        ofs << "    esac" << std::endl;
+        ofs << "done" << std::endl;
+    }
+
+    FilterWorkerPool pool(filterFile, 2, 2);
+    std::string input = json::value::string("echo 123").serialize();
+    std::string expected = json::value::string("echo 456").serialize();
+    std::string output;
+    int exitCode;
+
+    // the first call starts the worker.
+    int ret = pool.Execute(input, output, exitCode);
+    result &= ret == 0 && output == expected;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < Calls && result; i++)
+    {
+        ret = pool.Execute(input, output, exitCode);
+        result &= ret == 0 && output == expected;
+    }
+
+    double roundTripUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / Calls;
+
+    if (!result)
+    {
+        Logger::Error("PersistentWorkers: ret {0}, output {1}, expected {2}", ret, output, expected);
+    }
+
+    ret = pool.Execute(json::value::string("crash").serialize(), output, exitCode);
+    if (ret != EPIPE || exitCode != 3)
+    {
+        Logger::Error("PersistentWorkers: crash returned {0}, exit code {1}", ret, exitCode);
+        result = false;
+    }
+
+    ret = pool.Execute(json::value::string("hang").serialize(), output, exitCode);
+    if (ret != ETIMEDOUT)
+    {
+        Logger::Error("PersistentWorkers: hang returned {0}, exit code {1}", ret, exitCode);
+        result = false;
+    }
+
+    // the workers stopped are started again, more callers than workers wait.
+    std::vector<pplx::task<bool>> calls;
+    for (int i = 0; i < Parallel; i++)
+    {
+        calls.push_back(pplx::create_task([&pool, &input, &expected]()
+        {
+            std::string output;
+            int exitCode;
+            return pool.Execute(input, output, exitCode) == 0 && output == expected;
+        }));
+    }
+
+    for (auto& c : calls)
+    {
+        if (!c.get())
+        {
+            Logger::Error("PersistentWorkers: a parallel call failed");
+            result = false;
+        }
+    }
+
+    Logger::Info("PersistentWorkers: {0} us per filter call", roundTripUs);
+
+    unlink(filterFile);
+
+    return result;
+}
+
 #endif // DEBUG
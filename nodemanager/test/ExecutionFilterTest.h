@@ -13,6 +13,7 @@ namespace hpc
                 ExecutionFilterTest() { }
 
                 static bool JobStart();
+                static bool PersistentWorkers();
 
             protected:
             private:
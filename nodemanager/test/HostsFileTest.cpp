@@ -0,0 +1,134 @@
+#include "HostsFileTest.h"
+
+#ifdef DEBUG
+
+#include <chrono>
+#include <fstream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../core/HostsFileUpdater.h"
+#include "../utils/Logger.h"
+
+using namespace hpc::tests;
+using namespace hpc::core;
+using namespace hpc::data;
+using namespace hpc::utils;
+
+namespace
+{
+    template <typename F>
+    double Milliseconds(F f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::vector<HostEntry> GetEntries(int nodes, int changedIp)
+    {
+        std::vector<HostEntry> entries;
+        entries.reserve(nodes * 2);
+
+        for (int i = 0; i < nodes; i++)
+        {
+            std::string name = "node" + std::to_string(i);
+            std::string ip = "10." + std::to_string(i / 65536) + "." + std::to_string(i / 256 % 256) + "." + std::to_string(i % 256);
+            entries.emplace_back(name, i < changedIp ? "192.168.0." + std::to_string(i % 256) : ip);
+            entries.emplace_back("Enterprise." + name, ip);
+        }
+
+        return entries;
+    }
+}
+
+bool HostsFileTest::LargeUpdate()
+{
+    const int Nodes = 25000;
+    const int Changed = 100;
+    bool result = true;
+
+    char path[] = "/tmp/nodemanager_hosts_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        Logger::Error("LargeUpdate: failed to create the hosts file, errno {0}", errno);
+        return false;
+    }
+
+    close(fd);
+
+    {
+        std::ofstream ofs(path);
+        ofs << "127.0.0.1   localhost" << std::endl;
+        ofs << "# a comment kept" << std::endl;
+        ofs << "10.9.9.9                removed.node                  #HPC" << std::endl;
+        ofs << "::1         localhost ip6-localhost" << std::endl;
+    }
+
+    auto entries = GetEntries(Nodes, 0);
+    auto changedEntries = GetEntries(Nodes, Changed);
+
+    HostsFileUpdater updater(path);
+    bool changed = false;
+    int ret = 0;
+    struct stat before, after;
+
+    double full = Milliseconds([&]() { ret = updater.Update(entries, changed); });
+    if (ret != 0 || !changed)
+    {
+        Logger::Error("LargeUpdate: the first update returned {0}, changed {1}", ret, changed);
+        result = false;
+    }
+
+    stat(path, &before);
+    double same = Milliseconds([&]() { ret = updater.Update(entries, changed); });
+    stat(path, &after);
+    if (ret != 0 || changed || before.st_ino != after.st_ino || before.st_mtim.tv_nsec != after.st_mtim.tv_nsec)
+    {
+        Logger::Error("LargeUpdate: the file is written without changes, returned {0}", ret);
+        result = false;
+    }
+
+    double diff = Milliseconds([&]() { ret = updater.Update(changedEntries, changed); });
+    stat(path, &after);
+    if (ret != 0 || !changed || before.st_ino == after.st_ino)
+    {
+        Logger::Error("LargeUpdate: the changes are not written atomically, returned {0}", ret);
+        result = false;
+    }
+
+    // a new updater parses the file written.
+    HostsFileUpdater reloaded(path);
+    double parse = Milliseconds([&]() { ret = reloaded.Update(changedEntries, changed); });
+    if (ret != 0 || changed)
+    {
+        Logger::Error("LargeUpdate: the file written doesn't parse to the entries, returned {0}, changed {1}", ret, changed);
+        result = false;
+    }
+
+    std::ifstream ifs(path);
+    std::string line, ip, host;
+    int managed = 0, unmanaged = 0;
+    while (getline(ifs, line))
+    {
+        if (HostsFileUpdater::ParseEntry(line, ip, host)) managed++;
+        else unmanaged++;
+    }
+
+    if (managed != Nodes * 2 || unmanaged != 3)
+    {
+        Logger::Error("LargeUpdate: {0} HPC entries and {1} other lines in the file", managed, unmanaged);
+        result = false;
+    }
+
+    Logger::Info("LargeUpdate: {0} entries, {1} ms to write, {2} ms unchanged, {3} ms with {4} changed, {5} ms to parse",
+        entries.size(), full, same, diff, Changed, parse);
+
+    unlink(path);
+
+    return result;
+}
+
+#endif // DEBUG
@@ -0,0 +1,25 @@
+#ifndef HOSTSFILETEST_H
+#define HOSTSFILETEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class HostsFileTest
+        {
+            public:
+                HostsFileTest() { }
+
+                static bool LargeUpdate();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // HOSTSFILETEST_H
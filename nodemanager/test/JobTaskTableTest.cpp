@@ -0,0 +1,124 @@
+#include "JobTaskTableTest.h"
+
+#ifdef DEBUG
+
+#include <set>
+
+#include "../core/JobTaskTable.h"
+#include "../utils/Logger.h"
+
+using namespace web;
+using namespace hpc::tests;
+using namespace hpc::core;
+using namespace hpc::data;
+using namespace hpc::utils;
+
+namespace
+{
+    // The job id and task id pairs of the tasks in the report.
+    std::set<std::pair<int, int>> GetTasks(const json::value& report)
+    {
+        std::set<std::pair<int, int>> tasks;
+
+        const auto& jobs = report.at("Jobs");
+        for (size_t i = 0; i < jobs.size(); i++)
+        {
+            const auto& jobTasks = jobs.at(i).at("Tasks");
+            for (size_t t = 0; t < jobTasks.size(); t++)
+            {
+                tasks.insert(std::make_pair(jobs.at(i).at("JobId").as_integer(), jobTasks.at(t).at("TaskId").as_integer()));
+            }
+        }
+
+        return tasks;
+    }
+
+    bool Expect(bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            Logger::Error("DeltaReports: {0}", what);
+        }
+
+        return condition;
+    }
+}
+
+bool JobTaskTableTest::DeltaReports()
+{
+    bool result = true;
+    JobTaskTable table;
+    bool isNewEntry;
+
+    // The first report is a full snapshot.
+    auto report = table.ToDeltaJson();
+    result &= Expect(!report.at("Delta").as_bool(), "the first report is not full");
+    table.AcknowledgeReport();
+
+    std::vector<std::shared_ptr<TaskInfo>> tasks;
+    tasks.push_back(table.AddJobAndTask(1, 1, isNewEntry));
+    tasks.push_back(table.AddJobAndTask(1, 2, isNewEntry));
+    auto other = table.AddJobAndTask(2, 1, isNewEntry);
+
+    report = table.ToDeltaJson();
+    uint64_t version = report.at("Version").as_number().to_uint64();
+    result &= Expect(report.at("Delta").as_bool(), "the report is not a delta");
+    result &= Expect(GetTasks(report) == std::set<std::pair<int, int>>({ { 1, 1 }, { 1, 2 }, { 2, 1 } }), "the added tasks are not reported");
+
+    // Not acknowledged, the changes are reported again from the same base.
+    uint64_t baseVersion = report.at("BaseVersion").as_number().to_uint64();
+    report = table.ToDeltaJson();
+    result &= Expect(report.at("BaseVersion").as_number().to_uint64() == baseVersion, "the base moved without an acknowledgement");
+    result &= Expect(GetTasks(report).size() == 3, "the unacknowledged changes are not reported again");
+    table.AcknowledgeReport();
+
+    // Only the updated task is reported.
+    table.UpdateTask(tasks[0], [](TaskInfo& t) { t.Exited = true; t.ExitCode = 3; });
+    report = table.ToDeltaJson();
+    result &= Expect(report.at("BaseVersion").as_number().to_uint64() == version, "the base is not the acknowledged version");
+    result &= Expect(GetTasks(report) == std::set<std::pair<int, int>>({ { 1, 1 } }), "the update is not reported alone");
+
+    const auto& reported = report.at("Jobs").at(0).at("Tasks").at(0);
+    result &= Expect(reported.at("Exited").as_bool() && reported.at("ExitCode").as_integer() == 3, "the reported task is not the updated one");
+    table.AcknowledgeReport();
+
+    // A removed task is reported as removed and not updated any more.
+    table.RemoveTask(1, 2, tasks[1]->GetAttemptId());
+    table.UpdateTask(tasks[1], [](TaskInfo& t) { t.Exited = true; });
+    report = table.ToDeltaJson();
+    const auto& removedTasks = report.at("RemovedTasks");
+    result &= Expect(removedTasks.size() == 1 && removedTasks.at(0).at("TaskId").as_integer() == 2, "the removed task is not reported");
+    result &= Expect(GetTasks(report).empty(), "the removed task is reported as changed");
+    table.AcknowledgeReport();
+
+    // The removal of a job covers its tasks.
+    table.UpdateTask(other, [](TaskInfo& t) { t.ExitCode = 1; });
+    table.RemoveJob(2);
+    report = table.ToDeltaJson();
+    const auto& removedJobs = report.at("RemovedJobs");
+    result &= Expect(removedJobs.size() == 1 && removedJobs.at(0).as_integer() == 2, "the removed job is not reported");
+    result &= Expect(GetTasks(report).empty(), "the tasks of the removed job are reported");
+    table.AcknowledgeReport();
+
+    // A resync sends the full snapshot with all the tasks.
+    table.RequestResync();
+    report = table.ToDeltaJson();
+    result &= Expect(!report.at("Delta").as_bool() && report.at("JustStarted").as_bool(), "the resync is not a full snapshot");
+    result &= Expect(GetTasks(report) == std::set<std::pair<int, int>>({ { 1, 1 } }), "the full snapshot has wrong tasks");
+    table.AcknowledgeReport();
+
+    // A full snapshot is sent every FullSnapshotInterval reports.
+    int fullReports = 0;
+    for (int i = 0; i < JobTaskTable::FullSnapshotInterval; i++)
+    {
+        report = table.ToDeltaJson();
+        table.AcknowledgeReport();
+        if (!report.at("Delta").as_bool()) fullReports++;
+    }
+
+    result &= Expect(fullReports == 1, "no periodic full snapshot");
+
+    return result;
+}
+
+#endif // DEBUG
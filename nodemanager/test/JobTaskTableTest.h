@@ -0,0 +1,25 @@
+#ifndef JOBTASKTABLETEST_H
+#define JOBTASKTABLETEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class JobTaskTableTest
+        {
+            public:
+                JobTaskTableTest() { }
+
+                static bool DeltaReports();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // JOBTASKTABLETEST_H
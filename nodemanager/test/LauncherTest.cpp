@@ -0,0 +1,73 @@
+#include "LauncherTest.h"
+
+#ifdef DEBUG
+
+#include <chrono>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../utils/Logger.h"
+#include "../core/TaskLauncher.h"
+
+using namespace hpc::tests;
+using namespace hpc::core;
+using namespace hpc::utils;
+
+bool LauncherTest::LaunchLatency()
+{
+    bool result = true;
+    const int LaunchCount = 20;
+
+    // A large resident heap makes fork slower, the same as a busy node manager.
+    std::vector<char> heap(512L * 1024 * 1024, 1);
+
+    char* const args[] = { const_cast<char*>("/bin/bash"), const_cast<char*>("-c"), const_cast<char*>("echo 123 >&2"), nullptr };
+    char* const envi[] = { const_cast<char*>("PATH=/bin:/usr/bin"), nullptr };
+
+    for (auto mode : { LaunchMode::Fork, LaunchMode::Spawn })
+    {
+        const char* modeName = mode == LaunchMode::Fork ? "fork" : "spawn";
+        double totalMs = 0;
+
+        for (int i = 0; i < LaunchCount; i++)
+        {
+            int pipeFds[2];
+            if (pipe2(pipeFds, O_CLOEXEC) != 0)
+            {
+                Logger::Error("Failed to create pipe, errno {0}", errno);
+                return false;
+            }
+
+            int error = 0;
+            auto start = std::chrono::steady_clock::now();
+            pid_t pid = TaskLauncher::Launch(mode, args, envi, pipeFds[1], 2, nullptr, error);
+            totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            close(pipeFds[1]);
+
+            char buffer[16] = { 0 };
+            ssize_t bytesRead = read(pipeFds[0], buffer, sizeof(buffer) - 1);
+            close(pipeFds[0]);
+
+            int status = -1;
+            if (pid > 0)
+            {
+                waitpid(pid, &status, 0);
+            }
+
+            if (pid <= 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 || bytesRead != 4 || std::string(buffer) != "123\n")
+            {
+                Logger::Error("{0}: pid {1}, error {2}, status {3}, output {4}", modeName, pid, error, status, buffer);
+                result = false;
+            }
+        }
+
+        Logger::Info("{0}: {1} ms per launch with {2} MB heap", modeName, totalMs / LaunchCount, heap.size() / 1024 / 1024);
+    }
+
+    return result;
+}
+
+#endif // DEBUG
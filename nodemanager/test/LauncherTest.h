@@ -0,0 +1,25 @@
+#ifndef LAUNCHERTEST_H
+#define LAUNCHERTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class LauncherTest
+        {
+            public:
+                LauncherTest() { }
+
+                static bool LaunchLatency();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // LAUNCHERTEST_H
@@ -0,0 +1,77 @@
+#include "LoggerTest.h"
+
+#ifdef DEBUG
+
+#include <chrono>
+
+#include "../utils/Logger.h"
+
+using namespace hpc::tests;
+using namespace hpc::utils;
+
+namespace
+{
+    template <typename F>
+    double NanosecondsPerCall(int calls, F f)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < calls; i++)
+        {
+            f(i);
+        }
+
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+    }
+}
+
+bool LoggerTest::LogLatency()
+{
+    // Below the ring capacity, so the enabled calls are not dropped.
+    const int EnabledCalls = Logger::RingCapacity / 2;
+    const int DisabledCalls = 1000000;
+
+    Logger::Flush();
+    uint64_t dropped = Logger::GetDroppedCount();
+
+    auto level = Logger::GetLevel();
+    Logger::SetLevel(spdlog::level::info);
+
+    double disabled = NanosecondsPerCall(DisabledCalls, [](int i)
+    {
+        Logger::Debug(1, 2, 0, "LogLatency: disabled record {0} of {1}", i, "the benchmark");
+    });
+
+    double enabled = NanosecondsPerCall(EnabledCalls, [](int i)
+    {
+        Logger::Info(1, 2, 0, "LogLatency: enabled record {0} of {1}", i, "the benchmark");
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    bool written = Logger::Flush();
+    double writeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t droppedNow = Logger::GetDroppedCount() - dropped;
+
+    Logger::SetLevel(level);
+
+    // the latencies depend on the build and the machine, they are reported only.
+    Logger::Info("LogLatency: {0} ns per disabled call, {1} ns per enabled call, {2} records written in {3} ms, {4} dropped",
+        disabled, enabled, EnabledCalls, writeMs, droppedNow);
+
+    if (!written)
+    {
+        Logger::Error("LogLatency: the records are not written in {0} ms", writeMs);
+        return false;
+    }
+
+    if (droppedNow != 0)
+    {
+        Logger::Error("LogLatency: {0} records dropped below the ring capacity", droppedNow);
+        return false;
+    }
+
+    return true;
+}
+
+#endif // DEBUG
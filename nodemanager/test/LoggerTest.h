@@ -0,0 +1,25 @@
+#ifndef LOGGERTEST_H
+#define LOGGERTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class LoggerTest
+        {
+            public:
+                LoggerTest() { }
+
+                static bool LogLatency();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // LOGGERTEST_H
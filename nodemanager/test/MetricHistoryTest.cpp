@@ -0,0 +1,147 @@
+#include "MetricHistoryTest.h"
+
+#ifdef DEBUG
+
+#include <chrono>
+#include <string.h>
+#include <unistd.h>
+
+#include "../utils/Logger.h"
+#include "../utils/JsonHelper.h"
+#include "../core/MetricHistory.h"
+
+using namespace hpc::tests;
+using namespace hpc::core;
+using namespace hpc::data;
+using namespace hpc::utils;
+
+namespace
+{
+    std::vector<float> Decode(const json::value& encoded)
+    {
+        auto bytes = utility::conversions::from_base64(encoded.as_string());
+
+        auto reverse = [](uint32_t x)
+        {
+            uint32_t r = 0;
+            for (int b = 0; b < 32; b++) { r = (r << 1) | ((x >> b) & 1); }
+            return r;
+        };
+
+        std::vector<float> values;
+        if (bytes.empty()) return values;
+
+        bool reversed = bytes[0] == 1;
+        uint32_t previous = 0;
+        size_t i = 1;
+        while (i < bytes.size())
+        {
+            uint32_t x = 0;
+            int shift = 0;
+            while (bytes[i] & 0x80)
+            {
+                x |= (uint32_t)(bytes[i++] & 0x7F) << shift;
+                shift += 7;
+            }
+
+            x |= (uint32_t)bytes[i++] << shift;
+            previous ^= reversed ? reverse(x) : x;
+
+            float value;
+            memcpy(&value, &previous, sizeof(value));
+            values.push_back(value);
+        }
+
+        return values;
+    }
+
+    size_t CountPoints(const json::value& ranges)
+    {
+        size_t count = 0;
+        for (const auto& range : ranges.as_array())
+        {
+            count += JsonHelper<int>::Read("Count", range);
+        }
+
+        return count;
+    }
+}
+
+bool MetricHistoryTest::Rollups()
+{
+    char path[] = "/tmp/nm_metrichistory_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return false;
+    close(fd);
+
+    // two hours of one counter of 4 instances, the value of a second is its
+    // offset in the minute, with a gap of 10 minutes.
+    const time_t start = 1700000000 - 1700000000 % 3600;
+    const int Seconds = 7200;
+
+    double appendUs;
+    {
+        MetricHistory history(path);
+        if (!history.IsOpen()) return false;
+
+        std::vector<std::pair<float, Umid>> values(4);
+
+        auto begin = std::chrono::steady_clock::now();
+        for (int s = 0; s < Seconds; s++)
+        {
+            if (s >= 3000 && s < 3600) continue;
+
+            for (int i = 0; i < 4; i++)
+            {
+                values[i] = std::make_pair((float)((start + s) % 60 + i), Umid(5, i));
+            }
+
+            history.Append(start + s, values);
+        }
+
+        appendUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / (Seconds - 600);
+    }
+
+    // the history survives the reopen.
+    MetricHistory history(path);
+
+    bool result = true;
+
+    auto raw = history.Query(5, 2, start + Seconds - 100, start + Seconds, 1, 3600);
+    auto rawSeries = raw["Series"].as_array();
+    if (rawSeries.size() != 1 || CountPoints(rawSeries.at(0).at("Ranges")) != 100) result = false;
+
+    auto rawValues = rawSeries.size() == 1 ? Decode(rawSeries.at(0).at("Values")) : std::vector<float>();
+    if (rawValues.size() != 100 || rawValues.back() != (float)((start + Seconds - 1) % 60 + 2)) result = false;
+
+    // the gap splits the minutes into two runs, the minute in progress is not
+    // written yet.
+    auto minutes = history.Query(5, -1, start, start + Seconds, 60, 3600);
+    auto minuteSeries = minutes["Series"].as_array();
+    if (minuteSeries.size() != 4) result = false;
+
+    for (const auto& series : minuteSeries)
+    {
+        int instance = JsonHelper<int>::Read("InstanceId", series);
+        auto ranges = series.at("Ranges").as_array();
+        auto mins = Decode(series.at("Min"));
+        auto maxs = Decode(series.at("Max"));
+        auto avgs = Decode(series.at("Avg"));
+
+        if (ranges.size() != 2 || CountPoints(series.at("Ranges")) != 109 || mins.size() != 109) result = false;
+        if (mins.empty() || mins[0] != instance || maxs[0] != 59 + instance || avgs[0] != 29.5f + instance) result = false;
+    }
+
+    auto hours = history.Query(5, 0, start, start + Seconds, 3600, 3600);
+    auto hourSeries = hours["Series"].as_array();
+    if (hourSeries.size() != 1 || CountPoints(hourSeries.at(0).at("Ranges")) != 1) result = false;
+
+    Logger::Info("MetricHistory: {0} us per append of 4 values, raw {1} bytes, minutes {2}",
+        appendUs, rawSeries.size() == 1 ? rawSeries.at(0).at("Values").as_string().size() : 0, minutes.serialize().size());
+
+    unlink(path);
+
+    return result;
+}
+
+#endif // DEBUG
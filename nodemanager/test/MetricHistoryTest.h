@@ -0,0 +1,25 @@
+#ifndef METRICHISTORYTEST_H
+#define METRICHISTORYTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class MetricHistoryTest
+        {
+            public:
+                MetricHistoryTest() { }
+
+                static bool Rollups();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // METRICHISTORYTEST_H
@@ -0,0 +1,167 @@
+#include "MetricPacketTest.h"
+
+#ifdef DEBUG
+
+#include <errno.h>
+#include <boost/uuid/uuid_generators.hpp>
+
+#include "../utils/Logger.h"
+#include "../core/MetricPacketEncoder.h"
+#include "../core/MetricPacketDecoder.h"
+
+using namespace hpc::tests;
+using namespace hpc::core;
+using namespace hpc::data;
+using namespace hpc::utils;
+
+namespace
+{
+    // The per core and per gpu counters of a big node, far beyond the 80 of v1.
+    MetricPacket Tick(const boost::uuids::uuid& id, int tick, int counters)
+    {
+        MetricPacket packet;
+        packet.Uuid = id;
+        packet.TickCount = 1;
+
+        for (int i = 0; i < counters; i++)
+        {
+            // some counters are constant, some change every tick.
+            float value = (i % 3 == 0) ? 100.0f : i * 0.5f + tick * (i % 7);
+            packet.Values.push_back(std::make_pair(value, Umid(i / 64 + 1, i % 64)));
+        }
+
+        return packet;
+    }
+
+    bool SameValues(const MetricPacket& expected, const MetricPacket& actual)
+    {
+        if (expected.Uuid != actual.Uuid ||
+            expected.Sequence != actual.Sequence ||
+            expected.TickCount != actual.TickCount ||
+            expected.Values.size() != actual.Values.size())
+        {
+            Logger::Error("Packet {0} has {1} values, expected packet {2} with {3} values",
+                actual.Sequence, actual.Values.size(), expected.Sequence, expected.Values.size());
+            return false;
+        }
+
+        for (size_t i = 0; i < expected.Values.size(); i++)
+        {
+            const auto& e = expected.Values[i];
+            const auto& a = actual.Values[i];
+            if (e.first != a.first || e.second.MetricId != a.second.MetricId || e.second.InstanceId != a.second.InstanceId)
+            {
+                Logger::Error("Value {0} of packet {1} is {2} of {3}/{4}, expected {5} of {6}/{7}",
+                    i, actual.Sequence, a.first, a.second.MetricId, a.second.InstanceId,
+                    e.first, e.second.MetricId, e.second.InstanceId);
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+bool MetricPacketTest::RoundTrip()
+{
+    const int Counters = 1000;
+    const int Ticks = 25;
+
+    auto id = boost::uuids::random_generator()();
+    MetricPacketEncoder encoder;
+    MetricPacketDecoder decoder;
+    std::vector<std::vector<unsigned char>> datagrams;
+    size_t keyBytes = 0, deltaBytes = 0;
+
+    for (int t = 0; t < Ticks; t++)
+    {
+        auto packet = Tick(id, t, t == Ticks - 1 ? 5 : Counters);
+        encoder.Encode(packet, datagrams);
+
+        size_t bytes = 0;
+        MetricPacket decoded;
+        int ret = EAGAIN;
+
+        // the datagrams may arrive out of order.
+        for (auto d = datagrams.rbegin(); d != datagrams.rend(); d++)
+        {
+            if (d->size() > MetricPacketEncoder::DefaultMaxDatagramBytes)
+            {
+                Logger::Error("Datagram of {0} bytes exceeds the limit", d->size());
+                return false;
+            }
+
+            bytes += d->size();
+            ret = decoder.Decode(&(*d)[0], d->size(), decoded);
+            if (ret != (d + 1 == datagrams.rend() ? 0 : EAGAIN))
+            {
+                Logger::Error("Decode returned {0} for packet {1}", ret, packet.Sequence);
+                return false;
+            }
+        }
+
+        if (!SameValues(packet, decoded))
+        {
+            return false;
+        }
+
+        if (t == 0) { keyBytes = bytes; }
+        if (t == 1) { deltaBytes = bytes; }
+
+        if (t == Ticks - 1 && bytes > 128)
+        {
+            Logger::Error("{0} bytes sent for 5 counters", bytes);
+            return false;
+        }
+    }
+
+    Logger::Info("{0} counters took {1} bytes in the key packet, {2} bytes in the delta packet", Counters, keyBytes, deltaBytes);
+
+    // the constant counters take 3 bytes instead of 7.
+    return deltaBytes < keyBytes;
+}
+
+bool MetricPacketTest::LostDatagram()
+{
+    const int Counters = 500;
+
+    auto id = boost::uuids::random_generator()();
+    MetricPacketEncoder encoder(MetricPacketEncoder::DefaultMaxDatagramBytes, 3);
+    MetricPacketDecoder decoder;
+    std::vector<std::vector<unsigned char>> datagrams;
+
+    for (int t = 0; t < 6; t++)
+    {
+        auto packet = Tick(id, t, Counters);
+        encoder.Encode(packet, datagrams);
+
+        // lose a fragment of the second packet, the third is dropped as it is
+        // relative to the second, the fourth is a key packet.
+        MetricPacket decoded;
+        int ret = 0;
+        for (size_t d = (t == 1 ? 1 : 0); d < datagrams.size(); d++)
+        {
+            ret = decoder.Decode(&datagrams[d][0], datagrams[d].size(), decoded);
+        }
+
+        int expected = t == 1 ? EAGAIN : t == 2 ? ENODATA : 0;
+        if (ret != expected)
+        {
+            Logger::Error("Decode returned {0} for packet {1}, expected {2}", ret, packet.Sequence, expected);
+            return false;
+        }
+
+        if (ret == 0 && !SameValues(packet, decoded))
+        {
+            return false;
+        }
+    }
+
+    // a v1 packet is not decoded.
+    std::vector<unsigned char> v1(1024);
+    v1[0] = 1;
+    MetricPacket decoded;
+    return decoder.Decode(&v1[0], v1.size(), decoded) == EINVAL;
+}
+
+#endif // DEBUG
@@ -0,0 +1,26 @@
+#ifndef METRICPACKETTEST_H
+#define METRICPACKETTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class MetricPacketTest
+        {
+            public:
+                MetricPacketTest() { }
+
+                static bool RoundTrip();
+                static bool LostDatagram();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // METRICPACKETTEST_H
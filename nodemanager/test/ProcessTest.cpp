@@ -5,6 +5,8 @@
 #include <cpprest/http_listener.h>
 #include "../utils/JsonHelper.h"
 #include "../core/Process.h"
+#include <chrono>
+#include <signal.h>
 
 using namespace hpc::tests;
 using namespace hpc::core;
@@ -65,17 +67,14 @@ bool ProcessTest::ClusRun()
             callbacked = true;
         });
 
-    pthread_t threadId;
-
-    p->Start(p).then([&result, &started, &threadId] (std::pair<pid_t, pthread_t> ids)
+    p->Start(p).then([&result, &started] (pid_t pid)
     {
-        if (ids.first <= 0) result = false;
-        Logger::Info("pid {0}, result {1}", ids.first, result);
-        threadId = ids.second;
+        if (pid <= 0) result = false;
+        Logger::Info("pid {0}, result {1}", pid, result);
         started = true;
     }).wait();
 
-    pthread_join(threadId, nullptr);
+    p->OnCompleted().wait();
 
     if (!(callbacked && started)) result = false;
 
@@ -155,17 +154,14 @@ a8lxTKnZCsRXU1HexqZs+DSc+30tz50bNqLdido/l5B4EJnQP03ciO0=\
             callbacked = true;
         });
 
-    pthread_t threadId;
-
-    p->Start(p).then([&result, &started, &threadId] (std::pair<pid_t, pthread_t> ids)
+    p->Start(p).then([&result, &started] (pid_t pid)
     {
-        if (ids.first <= 0) result = false;
-        Logger::Info("pid {0}, result {1}", ids.first, result);
-        threadId = ids.second;
+        if (pid <= 0) result = false;
+        Logger::Info("pid {0}, result {1}", pid, result);
         started = true;
     }).wait();
 
-    pthread_join(threadId, nullptr);
+    p->OnCompleted().wait();
 
     if (!(callbacked && started)) result = false;
 
@@ -248,17 +244,14 @@ a8lxTKnZCsRXU1HexqZs+DSc+30tz50bNqLdido/l5B4EJnQP03ciO0=\
             callbacked = true;
         });
 
-    pthread_t threadId;
-
-    p->Start(p).then([&result, &started, &threadId] (std::pair<pid_t, pthread_t> ids)
+    p->Start(p).then([&result, &started] (pid_t pid)
     {
-        if (ids.first <= 0) result = false;
-        Logger::Info("pid {0}, result {1}", ids.first, result);
-        threadId = ids.second;
+        if (pid <= 0) result = false;
+        Logger::Info("pid {0}, result {1}", pid, result);
         started = true;
     }).wait();
 
-    pthread_join(threadId, nullptr);
+    p->OnCompleted().wait();
 
     if (!(callbacked && started)) result = false;
 
@@ -376,17 +369,14 @@ a8lxTKnZCsRXU1HexqZs+DSc+30tz50bNqLdido/l5B4EJnQP03ciO0=\
             callbacked = true;
         });
 
-    pthread_t threadId;
-
-    p->Start(p).then([&result, &started, &threadId] (std::pair<pid_t, pthread_t> ids)
+    p->Start(p).then([&result, &started] (pid_t pid)
     {
-        if (ids.first <= 0) result = false;
-        Logger::Info("pid {0}, result {1}", ids.first, result);
-        threadId = ids.second;
+        if (pid <= 0) result = false;
+        Logger::Info("pid {0}, result {1}", pid, result);
         started = true;
     }).wait();
 
-    pthread_join(threadId, nullptr);
+    p->OnCompleted().wait();
 
     if (!(callbacked && started)) result = false;
 
@@ -402,4 +392,47 @@ a8lxTKnZCsRXU1HexqZs+DSc+30tz50bNqLdido/l5B4EJnQP03ciO0=\
     return result;
 }
 
+bool ProcessTest::WaitForExit()
+{
+    auto spawn = []()
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            execl("/bin/sleep", "sleep", "30", (char*)nullptr);
+            _exit(127);
+        }
+
+        return pid;
+    };
+
+    pid_t pid = spawn();
+    if (pid <= 0) return false;
+
+    // a process alive until the deadline.
+    auto start = std::chrono::steady_clock::now();
+    int ret = System::WaitForExit(std::vector<int> { pid }, 200);
+    double timeoutMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // the wait ends as soon as the process is killed.
+    pthread_t killer;
+    pthread_create(&killer, nullptr, [](void* arg) -> void*
+    {
+        usleep(50 * 1000);
+        kill(*(pid_t*)arg, SIGKILL);
+        return nullptr;
+    }, &pid);
+
+    start = std::chrono::steady_clock::now();
+    int killedRet = System::WaitForExit(std::vector<int> { pid }, 5000);
+    double killedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    pthread_join(killer, nullptr);
+    waitpid(pid, nullptr, 0);
+
+    Logger::Info("WaitForExit: timed out ret {0} after {1} ms, killed ret {2} after {3} ms", ret, timeoutMs, killedRet, killedMs);
+
+    return ret == ETIMEDOUT && timeoutMs >= 190 && killedRet == 0 && killedMs < 1000;
+}
+
 #endif // DEBUG
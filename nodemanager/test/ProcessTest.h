@@ -16,6 +16,7 @@ namespace hpc
                 static bool SimpleEcho();
                 static bool Affinity();
                 static bool RemainingProcess();
+                static bool WaitForExit();
 
             protected:
             private:
@@ -2,6 +2,7 @@
 
 #ifdef DEBUG
 
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -27,6 +28,76 @@ using namespace web::http;
 using namespace web;
 using namespace web::http::experimental::listener;
 using namespace web::http::client;
+using namespace hpc::arguments;
+
+namespace
+{
+    // Replies to endtask with the ids received, so a body changed by the proxy is found.
+    class EchoExecutor : public IRemoteExecutor
+    {
+        public:
+            virtual pplx::task<json::value> StartJobAndTask(StartJobAndTaskArgs&& args, std::string&& callbackUri) { return pplx::task_from_result(json::value()); }
+            virtual pplx::task<json::value> StartTask(StartTaskArgs&& args, std::string&& callbackUri) { return pplx::task_from_result(json::value()); }
+            virtual pplx::task<json::value> StartTasks(StartTasksArgs&& args, std::string&& callbackUri) { return pplx::task_from_result(json::value()); }
+            virtual pplx::task<json::value> EndJob(EndJobArgs&& args) { return pplx::task_from_result(json::value()); }
+            virtual pplx::task<json::value> Ping(std::string&& callbackUri) { return pplx::task_from_result(json::value()); }
+            virtual pplx::task<json::value> Metric(std::string&& callbackUri) { return pplx::task_from_result(json::value()); }
+            virtual pplx::task<json::value> MetricConfig(MetricCountersConfig&& config, std::string&& callbackUri) { return pplx::task_from_result(json::value()); }
+            virtual pplx::task<json::value> PeekTaskOutput(PeekTaskOutputArgs&& args) { return pplx::task_from_result(json::value()); }
+            virtual pplx::task<json::value> TaskMetrics(TaskMetricsArgs&& args) { return pplx::task_from_result(json::value()); }
+            virtual pplx::task<json::value> MetricHistory(MetricHistoryArgs&& args) { return pplx::task_from_result(json::value()); }
+
+            virtual pplx::task<json::value> EndTask(EndTaskArgs&& args, std::string&& callbackUri)
+            {
+                json::value v;
+                v["JobId"] = args.JobId;
+                v["TaskId"] = args.TaskId;
+                return pplx::task_from_result(v);
+            }
+    };
+
+    // Sends the endtask requests, parallel at a time, returns the milliseconds.
+    double SendEndTasks(http_client& client, const std::string& path, int requests, int parallel, int& failed)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < requests; i += parallel)
+        {
+            std::vector<pplx::task<bool>> calls;
+            for (int id = i; id < std::min(requests, i + parallel); id++)
+            {
+                json::value body;
+                body["JobId"] = id;
+                body["TaskId"] = id;
+                body["TaskCancelGracePeriod"] = 0;
+
+                auto request = HttpHelper::GetHttpRequest(methods::POST, body);
+                request->set_request_uri(path);
+
+                calls.push_back(client.request(*request).then([id](http_response response)
+                {
+                    return response.status_code() == status_codes::OK &&
+                        response.extract_json().get().at("TaskId").as_integer() == id;
+                }));
+            }
+
+            for (auto& c : calls)
+            {
+                try
+                {
+                    failed += c.get() ? 0 : 1;
+                }
+                catch (const std::exception& ex)
+                {
+                    Logger::Error("ProxyThroughput: request failed, {0}", ex.what());
+                    failed++;
+                }
+            }
+        }
+
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
 
 bool ProxyTest::ProxyToLocal()
 {
@@ -109,4 +180,41 @@ bool ProxyTest::ProxyToLocal()
     return result;
 }
 
+bool ProxyTest::ProxyThroughput()
+{
+    const int Requests = 1000;
+    const int Parallel = 16;
+    bool result = true;
+
+    EchoExecutor executor;
+    http_listener_config config;
+    RemoteCommunicator rc(executor, config, "http://localhost:40000");
+    rc.Open();
+
+    http_client client(U("http://localhost:40000/"));
+    std::string directPath = "/api/" + System::GetNodeName() + "/endtask";
+
+    // localhost is forwarded to the local node name through the proxy.
+    std::string proxiedPath = "/api/localhost/endtask";
+
+    int failed = 0;
+    SendEndTasks(client, directPath, Parallel, Parallel, failed);
+    SendEndTasks(client, proxiedPath, Parallel, Parallel, failed);
+
+    double directMs = SendEndTasks(client, directPath, Requests, Parallel, failed);
+    double proxiedMs = SendEndTasks(client, proxiedPath, Requests, Parallel, failed);
+
+    double overheadUs = (proxiedMs - directMs) * 1000 / Requests;
+    Logger::Info("ProxyThroughput: {0} requests, {1} per second direct, {2} per second proxied, {3} us proxy overhead per request, {4} failed",
+        Requests, Requests * 1000 / directMs, Requests * 1000 / proxiedMs, overheadUs, failed);
+
+    if (failed != 0)
+    {
+        Logger::Error("ProxyThroughput: {0} requests failed", failed);
+        result = false;
+    }
+
+    return result;
+}
+
 #endif // DEBUG
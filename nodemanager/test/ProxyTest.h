@@ -13,6 +13,7 @@ namespace hpc
                 ProxyTest() { }
 
                 static bool ProxyToLocal();
+                static bool ProxyThroughput();
 
             protected:
             private:
@@ -0,0 +1,308 @@
+#include "RemoteExecutorTest.h"
+
+#ifdef DEBUG
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <unistd.h>
+
+#include "../utils/Logger.h"
+#include "../core/RemoteExecutor.h"
+
+using namespace hpc::tests;
+using namespace hpc::core;
+using namespace hpc::utils;
+using namespace hpc::arguments;
+
+namespace
+{
+    const int ProvisionMilliseconds = 200;
+
+    // Bounds the waits of the test, so a blocked call fails it instead of hanging.
+    const int HoldMilliseconds = 10000;
+
+    // Stands for a node where useradd and the key files are slow.
+    class StubProvisioner : public UserProvisioner
+    {
+        public:
+            StubProvisioner() : UserProvisioner(DefaultKeyLingerSeconds) { }
+
+            int GetProvisionCount(const std::string& userName)
+            {
+                pthread_mutex_lock(&this->mutex);
+                int count = this->provisionCounts[userName];
+                pthread_mutex_unlock(&this->mutex);
+                return count;
+            }
+
+            // The user creations wait until Open, or until HoldMilliseconds passed.
+            void Hold() { this->held = true; }
+            void Open() { this->held = false; }
+
+            int GetInFlight() { return this->inFlight; }
+            int GetMaxInFlight() { return this->maxInFlight; }
+
+            bool WaitInFlight(int count)
+            {
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(HoldMilliseconds);
+                while (this->inFlight < count && std::chrono::steady_clock::now() < deadline)
+                {
+                    usleep(1000);
+                }
+
+                return this->inFlight >= count;
+            }
+
+        protected:
+            virtual int CreateUser(const std::string& userName, const std::string& password, bool isAdmin, bool& existed)
+            {
+                int current = ++this->inFlight;
+                int max = this->maxInFlight;
+                while (current > max && !this->maxInFlight.compare_exchange_weak(max, current)) { }
+
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(HoldMilliseconds);
+                while (this->held && std::chrono::steady_clock::now() < deadline)
+                {
+                    usleep(1000);
+                }
+
+                usleep(ProvisionMilliseconds / 2 * 1000);
+                this->inFlight--;
+
+                existed = false;
+                return 0;
+            }
+
+            virtual int AddKeys(const std::string& userName, const std::string& privateKey, std::string& publicKey, KeyState& state)
+            {
+                pthread_mutex_lock(&this->mutex);
+                this->provisionCounts[userName]++;
+                pthread_mutex_unlock(&this->mutex);
+
+                usleep(ProvisionMilliseconds / 2 * 1000);
+                state.PrivateKeyReady = state.PublicKeyReady = state.AuthKeyReady = true;
+                return 0;
+            }
+
+            virtual void RemoveKeys(const std::string& userName, const std::string& publicKey, const KeyState& state) { }
+
+        private:
+            std::map<std::string, int> provisionCounts;
+            pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+            std::atomic<bool> held { false };
+            std::atomic<int> inFlight { 0 };
+            std::atomic<int> maxInFlight { 0 };
+    };
+
+    StartJobAndTaskArgs JobArgs(int jobId, int taskId, const std::string& userName)
+    {
+        // An empty command line starts no process, as the non-master MPI tasks.
+        ProcessStartInfo startInfo("", "", "", "", "", 0, std::vector<uint64_t>(), std::map<std::string, std::string>());
+        return StartJobAndTaskArgs(jobId, taskId, std::move(startInfo), std::string(userName), "");
+    }
+
+    double ElapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+bool RemoteExecutorTest::ConcurrentJobs()
+{
+    const int JobCount = 16;
+    const int SameUserJobCount = 4;
+    const int EndTaskCount = 64;
+    const int BaseJobId = 9000;
+    bool result = true;
+
+    auto provisioner = new StubProvisioner();
+    RemoteExecutor executor("", provisioner);
+
+    // The tasks to be ended while the other jobs are provisioning.
+    executor.StartJobAndTask(JobArgs(BaseJobId, 1, "hpc_test_user"), "").wait();
+    for (int t = 2; t <= EndTaskCount; t++)
+    {
+        ProcessStartInfo startInfo("", "", "", "", "", 0, std::vector<uint64_t>(), std::map<std::string, std::string>());
+        executor.StartTask(StartTaskArgs(BaseJobId, t, std::move(startInfo)), "").wait();
+    }
+
+    // The user creations are held, so the starts stay in flight while the
+    // tasks end.
+    provisioner->Hold();
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<pplx::task<web::json::value>> starts;
+    for (int j = 1; j <= JobCount; j++)
+    {
+        starts.push_back(pplx::create_task([&executor, j]()
+        {
+            return executor.StartJobAndTask(JobArgs(BaseJobId + j, 1, "hpc_test_user" + std::to_string(j)), "");
+        }));
+    }
+
+    // The provisioning of different users runs in parallel.
+    bool overlapped = provisioner->WaitInFlight(2);
+
+    double maxEndTaskMs = 0;
+    for (int t = 1; t <= EndTaskCount; t++)
+    {
+        auto endStart = std::chrono::steady_clock::now();
+        executor.EndTask(EndTaskArgs(BaseJobId, t, 0), "").wait();
+        maxEndTaskMs = std::max(maxEndTaskMs, ElapsedMs(endStart));
+    }
+
+    // EndTask doesn't wait for the provisioning of other jobs.
+    int inFlightAfterEnds = provisioner->GetInFlight();
+
+    provisioner->Open();
+    for (auto& s : starts) s.wait();
+    double startAllMs = ElapsedMs(start);
+
+    Logger::Info("{0} jobs of different users started in {1} ms, provisioning takes {2} ms each, {3} in parallel at most, {4} EndTask calls took {5} ms at most",
+        JobCount, startAllMs, ProvisionMilliseconds, provisioner->GetMaxInFlight(), EndTaskCount, maxEndTaskMs);
+
+    if (!overlapped)
+    {
+        Logger::Error("Starting the jobs of different users was serialized, {0} in parallel at most", provisioner->GetMaxInFlight());
+        result = false;
+    }
+
+    if (inFlightAfterEnds == 0)
+    {
+        Logger::Error("EndTask was blocked by the job starts, no provisioning was in flight when the tasks ended");
+        result = false;
+    }
+
+    // The concurrent and the back to back jobs of the same user are provisioned once.
+    start = std::chrono::steady_clock::now();
+    starts.clear();
+    for (int j = 1; j <= SameUserJobCount; j++)
+    {
+        starts.push_back(pplx::create_task([&executor, j]()
+        {
+            return executor.StartJobAndTask(JobArgs(BaseJobId + JobCount + j, 1, "hpc_test_same_user"), "");
+        }));
+    }
+
+    for (auto& s : starts) s.wait();
+
+    // all the jobs of the user end, the next one still finds the keys.
+    for (int j = 1; j <= SameUserJobCount; j++)
+    {
+        executor.EndJob(EndJobArgs(BaseJobId + JobCount + j)).wait();
+    }
+
+    executor.StartJobAndTask(JobArgs(BaseJobId + JobCount + 1, 1, "hpc_test_same_user"), "").wait();
+
+    double sameUserMs = ElapsedMs(start);
+    int provisionCount = provisioner->GetProvisionCount("hpc_test_same_user");
+    Logger::Info("{0} jobs of the same user started in {1} ms, provisioned {2} times", SameUserJobCount + 1, sameUserMs, provisionCount);
+
+    if (provisionCount != 1)
+    {
+        Logger::Error("The user was provisioned {0} times", provisionCount);
+        result = false;
+    }
+
+    for (int j = 0; j <= JobCount + SameUserJobCount; j++)
+    {
+        executor.EndJob(EndJobArgs(BaseJobId + j)).wait();
+    }
+
+    auto table = JobTaskTable::GetInstance();
+    if (table != nullptr && table->GetJobCount() != 0)
+    {
+        Logger::Error("{0} jobs left after EndJob", table->GetJobCount());
+        result = false;
+    }
+
+    return result;
+}
+
+bool RemoteExecutorTest::BatchedStart()
+{
+    const int TaskCount = 64;
+    const int JobId = 9100;
+    const int MissingJobId = 9101;
+    const int FilteredTaskId = TaskCount + 2;
+    bool result = true;
+
+    RemoteExecutor executor("", new StubProvisioner());
+    executor.StartJobAndTask(JobArgs(JobId, 1, "root"), "").wait();
+
+    auto table = JobTaskTable::GetInstance();
+    int taskCount = table->GetTaskCount();
+
+    // the processes outlive the call, EndJob terminates them.
+    std::vector<StartTaskArgs> tasks;
+    for (int t = 2; t <= TaskCount + 1; t++)
+    {
+        ProcessStartInfo startInfo("sleep 60", "", "", "", "", 0, std::vector<uint64_t>(), std::map<std::string, std::string>());
+        tasks.push_back(StartTaskArgs(JobId, t, std::move(startInfo)));
+    }
+
+    // the repeated start succeeds as the single starttask, the task failed in
+    // its filter and the task of a job not started fail alone.
+    ProcessStartInfo duplicated("sleep 60", "", "", "", "", 0, std::vector<uint64_t>(), std::map<std::string, std::string>());
+    tasks.push_back(StartTaskArgs(JobId, 2, std::move(duplicated)));
+    ProcessStartInfo filtered("sleep 60", "", "", "", "", 0, std::vector<uint64_t>(), std::map<std::string, std::string>());
+    tasks.push_back(StartTaskArgs(JobId, FilteredTaskId, std::move(filtered)));
+    ProcessStartInfo missing("sleep 60", "", "", "", "", 0, std::vector<uint64_t>(), std::map<std::string, std::string>());
+    tasks.push_back(StartTaskArgs(MissingJobId, 1, std::move(missing)));
+
+    size_t count = tasks.size();
+    StartTasksArgs args(std::move(tasks));
+    args.Errors[count - 2] = "TaskStartFilter returned exit code 1";
+
+    auto start = std::chrono::steady_clock::now();
+    auto results = executor.StartTasks(std::move(args), "").get();
+    double batchMs = ElapsedMs(start);
+
+    const auto& values = results.as_array();
+    if (values.size() != count)
+    {
+        Logger::Error("BatchedStart: {0} results for {1} tasks", values.size(), count);
+        executor.EndJob(EndJobArgs(JobId)).wait();
+        return false;
+    }
+
+    Logger::Info("BatchedStart: {0} tasks in {1} ms, {2}", count, batchMs, results.serialize());
+
+    // the results are in the order of the tasks.
+    for (size_t i = 0; i < count; i++)
+    {
+        const auto& v = values.at(i);
+        int jobId = i == count - 1 ? MissingJobId : JobId;
+        int taskId = i == count - 1 ? 1 : i == count - 2 ? FilteredTaskId : i == count - 3 ? 2 : (int)i + 2;
+        bool succeeded = i < count - 2;
+
+        if (v.at("JobId").as_integer() != jobId ||
+            v.at("TaskId").as_integer() != taskId ||
+            v.at("Succeeded").as_bool() != succeeded)
+        {
+            Logger::Error("BatchedStart: result {0} is {1}, expected task {2}.{3} succeeded {4}",
+                i, v.serialize(), jobId, taskId, succeeded);
+            result = false;
+        }
+    }
+
+    if (values.at(count - 3).at("Message").as_string() != "The task has started already.")
+    {
+        Logger::Error("BatchedStart: the repeated start returned {0}", values.at(count - 3).serialize());
+        result = false;
+    }
+
+    if (table->GetTaskCount() != taskCount + TaskCount)
+    {
+        Logger::Error("BatchedStart: {0} tasks in the table, expected {1}", table->GetTaskCount(), taskCount + TaskCount);
+        result = false;
+    }
+
+    executor.EndJob(EndJobArgs(JobId)).wait();
+
+    return result;
+}
+
+#endif // DEBUG
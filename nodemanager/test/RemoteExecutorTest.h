@@ -0,0 +1,26 @@
+#ifndef REMOTEEXECUTORTEST_H
+#define REMOTEEXECUTORTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class RemoteExecutorTest
+        {
+            public:
+                RemoteExecutorTest() { }
+
+                static bool ConcurrentJobs();
+                static bool BatchedStart();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // REMOTEEXECUTORTEST_H
@@ -0,0 +1,188 @@
+#include "TaskCompletionTest.h"
+
+#ifdef DEBUG
+
+#include <map>
+#include <set>
+#include <chrono>
+#include <cpprest/http_listener.h>
+#include <cpprest/json.h>
+
+#include "../utils/Logger.h"
+#include "../core/HttpHelper.h"
+#include "../core/TaskCompletionQueue.h"
+
+using namespace hpc::tests;
+using namespace hpc::core;
+using namespace hpc::utils;
+
+using namespace web::http;
+using namespace web;
+using namespace web::http::experimental::listener;
+
+bool TaskCompletionTest::BatchedCompletions()
+{
+    const std::string listeningUri = "http://localhost:50003/api";
+    const int TaskCount = 500;
+    bool result = true;
+
+    // The mock scheduler records the requeue counts received per task in the
+    // arrival order, and rejects the first event of every 10th task once in a
+    // batch to exercise the per task retry.
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    std::map<int, std::vector<int>> received;
+    std::set<int> rejected;
+    int receivedCount = 0;
+    int batchCount = 0;
+    int misroutedCount = 0;
+
+    // The even and odd tasks have different callbacks, a batch must not mix them.
+    auto getCallbackUri = [](int taskId) { return taskId % 2 == 0 ? std::string("http://even/taskcompleted") : std::string("http://odd/taskcompleted"); };
+
+    http_listener listener(listeningUri);
+    listener.support(
+        methods::POST,
+        [&](http_request request)
+        {
+            auto j = request.extract_json().get();
+            bool isBatch = j.is_array();
+
+            std::vector<json::value> events;
+            if (isBatch)
+            {
+                for (size_t i = 0; i < j.size(); i++) events.push_back(j[i]);
+            }
+            else
+            {
+                events.push_back(j);
+            }
+
+            json::value results = json::value::array(events.size());
+
+            std::string callbackUri;
+            HttpHelper::FindCallbackUri(request, callbackUri);
+
+            pthread_mutex_lock(&mutex);
+            if (isBatch) batchCount++;
+
+            for (size_t i = 0; i < events.size(); i++)
+            {
+                int taskId = events[i]["TaskInfo"]["TaskId"].as_integer();
+                int requeueCount = events[i]["TaskInfo"]["TaskRequeueCount"].as_integer();
+
+                if (isBatch && callbackUri != getCallbackUri(taskId))
+                {
+                    misroutedCount++;
+                }
+
+                bool accepted = !(isBatch && taskId % 10 == 0 && rejected.insert(taskId).second);
+                if (accepted)
+                {
+                    received[taskId].push_back(requeueCount);
+                    receivedCount++;
+                }
+
+                results[i] = json::value::boolean(accepted);
+            }
+
+            pthread_mutex_unlock(&mutex);
+
+            request.reply(status_codes::OK, results);
+        });
+
+    listener.open().wait();
+
+    auto createEvent = [](int taskId, int requeueCount)
+    {
+        json::value taskInfo;
+        taskInfo["TaskId"] = taskId;
+        taskInfo["TaskRequeueCount"] = requeueCount;
+
+        json::value event;
+        event["JobId"] = 1;
+        event["TaskInfo"] = taskInfo;
+        return event;
+    };
+
+    auto waitForCount = [&](int expected)
+    {
+        for (int i = 0; i < 3000; i++)
+        {
+            pthread_mutex_lock(&mutex);
+            int count = receivedCount;
+            pthread_mutex_unlock(&mutex);
+
+            if (count >= expected) return true;
+            usleep(10000);
+        }
+
+        Logger::Error("Timed out waiting for {0} completions", expected);
+        return false;
+    };
+
+    // One request per completion, the same as the default reporting.
+    auto start = std::chrono::steady_clock::now();
+    for (int taskId = 0; taskId < TaskCount; taskId++)
+    {
+        auto request = HttpHelper::GetHttpRequest(methods::POST, createEvent(taskId, 0));
+        HttpHelper::SendRequest(listeningUri + "/taskcompleted", *request).then([](pplx::task<http_response> t)
+        {
+            try { t.get(); } catch (const std::exception& ex) { Logger::Error("Single completion failed {0}", ex.what()); }
+        });
+    }
+
+    result &= waitForCount(TaskCount);
+    double singleSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    pthread_mutex_lock(&mutex);
+    received.clear();
+    receivedCount = 0;
+    pthread_mutex_unlock(&mutex);
+
+    // Two events per task, they must arrive in order even when the first is retried.
+    start = std::chrono::steady_clock::now();
+    {
+        TaskCompletionQueue queue(
+            [listeningUri](pplx::cancellation_token) { return listeningUri + "/taskscompleted"; },
+            20,
+            100,
+            []() { Logger::Debug("Some task completions are rejected"); });
+
+        for (int taskId = 0; taskId < TaskCount; taskId++)
+        {
+            queue.Enqueue(1, taskId, 0, createEvent(taskId, 0), getCallbackUri(taskId));
+            queue.Enqueue(1, taskId, 1, createEvent(taskId, 1), getCallbackUri(taskId));
+        }
+
+        result &= waitForCount(TaskCount * 2);
+    }
+
+    double batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    pthread_mutex_lock(&mutex);
+    for (int taskId = 0; taskId < TaskCount; taskId++)
+    {
+        if (received[taskId] != std::vector<int>({ 0, 1 }))
+        {
+            Logger::Error("Task {0} received {1} completions out of order", taskId, received[taskId].size());
+            result = false;
+        }
+    }
+
+    if (misroutedCount > 0)
+    {
+        Logger::Error("{0} completions were batched with the callback of another task", misroutedCount);
+        result = false;
+    }
+
+    Logger::Info("Single completions: {0} per second", TaskCount / singleSeconds);
+    Logger::Info("Batched completions: {0} per second in {1} batches", TaskCount * 2 / batchSeconds, batchCount);
+    pthread_mutex_unlock(&mutex);
+
+    listener.close().wait();
+    pthread_mutex_destroy(&mutex);
+
+    return result;
+}
+
+#endif // DEBUG
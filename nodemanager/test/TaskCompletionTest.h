@@ -0,0 +1,25 @@
+#ifndef TASKCOMPLETIONTEST_H
+#define TASKCOMPLETIONTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class TaskCompletionTest
+        {
+            public:
+                TaskCompletionTest() { }
+
+                static bool BatchedCompletions();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // TASKCOMPLETIONTEST_H
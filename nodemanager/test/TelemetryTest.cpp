@@ -0,0 +1,194 @@
+#include "TelemetryTest.h"
+
+#ifdef DEBUG
+
+#include <atomic>
+#include <chrono>
+#include <pthread.h>
+
+#include "../utils/Logger.h"
+#include "../utils/SampleRing.h"
+#include "../core/CGroupController.h"
+#include "../core/TaskTelemetry.h"
+
+using namespace hpc::tests;
+using namespace hpc::utils;
+using namespace hpc::core;
+
+namespace
+{
+    typedef struct _Value
+    {
+        uint64_t Index;
+        uint64_t Check[7];
+    } Value;
+
+    typedef struct _Context
+    {
+        SampleRing<Value> Ring { 64 };
+        std::atomic<bool> Writing { true };
+        std::atomic<uint64_t> Snapshots { 0 };
+        std::atomic<uint64_t> Errors { 0 };
+    } Context;
+
+    void* Reader(void* arg)
+    {
+        Context* c = static_cast<Context*>(arg);
+
+        while (c->Writing)
+        {
+            auto values = c->Ring.Snapshot(16);
+
+            // no value is torn and the values kept are in order.
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                for (auto check : values[i].Check)
+                {
+                    if (check != values[i].Index * 3) c->Errors++;
+                }
+
+                if (i > 0 && values[i].Index <= values[i - 1].Index) c->Errors++;
+            }
+
+            c->Snapshots++;
+        }
+
+        return nullptr;
+    }
+
+    bool Expect(bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            Logger::Error("CGroupUsageSummary: {0}", what);
+        }
+
+        return condition;
+    }
+
+    bool Near(double value, double expected)
+    {
+        return value > expected - 0.01 && value < expected + 0.01;
+    }
+}
+
+bool TelemetryTest::SampleRingReaders()
+{
+    const int ReaderCount = 3;
+    const uint64_t Count = 2000000;
+
+    Context context;
+
+    pthread_t readers[ReaderCount];
+    for (auto& reader : readers)
+    {
+        pthread_create(&reader, nullptr, Reader, &context);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 1; i <= Count; i++)
+    {
+        Value value;
+        value.Index = i;
+        for (auto& check : value.Check) { check = i * 3; }
+
+        context.Ring.Push(value);
+    }
+
+    double pushNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / Count;
+
+    context.Writing = false;
+    for (auto& reader : readers)
+    {
+        pthread_join(reader, nullptr);
+    }
+
+    auto last = context.Ring.Snapshot(100);
+
+    Logger::Info("SampleRing: {0} ns per push with {1} readers, {2} snapshots, {3} errors",
+        pushNs, ReaderCount, context.Snapshots.load(), context.Errors.load());
+
+    return context.Errors == 0 && last.size() == 64 && last.back().Index == Count && last.front().Index == Count - 63;
+}
+
+bool TelemetryTest::CGroupUsageSummary()
+{
+    const uint64_t MiB = 1024 * 1024;
+    const uint64_t StartTime = 1700000000000;
+    bool result = true;
+
+    // v2 cpu.stat, usage_usec is not confused with user_usec.
+    std::string cpuStat =
+        "usage_usec 2000000\n"
+        "user_usec 1500000\n"
+        "system_usec 500000\n"
+        "nr_periods 0\n";
+
+    uint64_t usageUsec = 0;
+    result &= Expect(CGroupController::ParseKeyValue(cpuStat, "usage_usec", usageUsec) && usageUsec == 2000000, "usage_usec is not parsed");
+
+    uint64_t missing = 7;
+    result &= Expect(!CGroupController::ParseKeyValue(cpuStat, "usage", missing) && missing == 7, "a missing key is parsed");
+
+    // v2 io.stat, the bytes of every device are added.
+    std::string ioStat =
+        "8:0 rbytes=4096 wbytes=8192 rios=1 wios=2 dbytes=0 dios=0\n"
+        "259:0 rbytes=1000 wbytes=0 rios=3 wios=0 dbytes=0 dios=0\n";
+
+    uint64_t readBytes = 0, writeBytes = 0;
+    CGroupController::ParseIoStat(ioStat, readBytes, writeBytes);
+    result &= Expect(readBytes == 5096 && writeBytes == 8192, "io.stat is not parsed");
+
+    // v1 blkio, the other operations and the Total line are skipped.
+    std::string blkioStat =
+        "8:0 Read 4096\n"
+        "8:0 Write 1024\n"
+        "8:0 Sync 5120\n"
+        "8:0 Total 5120\n"
+        "8:16 Read 100\n"
+        "Total 5220\n";
+
+    uint64_t blkioRead = 0, blkioWrite = 0;
+    CGroupController::ParseBlkioStat(blkioStat, blkioRead, blkioWrite);
+    result &= Expect(blkioRead == 4196 && blkioWrite == 1024, "blkio.throttle.io_service_bytes is not parsed");
+
+    // three samples a second apart, at 150% then 50% of one core, without memory.peak.
+    TaskTelemetry::Task task("hpc_test", 2, 8);
+
+    CGroupController::Usage usage;
+    usage.CpuUsec = usageUsec;
+    usage.MemoryBytes = 100 * MiB;
+    usage.IoReadBytes = readBytes;
+    usage.IoWriteBytes = writeBytes;
+    usage.ProcessCount = 3;
+    TaskTelemetry::Record(task, usage, StartTime);
+
+    usage.CpuUsec += 1500000;
+    usage.MemoryBytes = 300 * MiB;
+    usage.ProcessCount = 5;
+    TaskTelemetry::Record(task, usage, StartTime + 1000);
+
+    usage.CpuUsec += 500000;
+    usage.MemoryBytes = 200 * MiB;
+    usage.IoReadBytes += 4096;
+    usage.ProcessCount = 2;
+    TaskTelemetry::Record(task, usage, StartTime + 2000);
+
+    auto summary = TaskTelemetry::Summarize(task);
+    Logger::Info("CGroupUsageSummary: {0}", summary.serialize());
+
+    result &= Expect(summary.at("SampleCount").as_integer() == 3, "the samples are not counted");
+    result &= Expect(Near(summary.at("AverageCpuPercent").as_double(), 100.0), "the average cpu is not over the sampled period");
+    result &= Expect(Near(summary.at("MaxCpuPercent").as_double(), 150.0), "the cpu peak is not tracked");
+    result &= Expect(Near(summary.at("CpuEfficiency").as_double(), 0.5), "the efficiency is not of the allocated cores");
+    result &= Expect(summary.at("MemoryBytes").as_number().to_uint64() == 200 * MiB, "the memory is not the last sampled");
+    result &= Expect(summary.at("MemoryPeakBytes").as_number().to_uint64() == 300 * MiB, "the memory peak is not tracked");
+    result &= Expect(summary.at("IoReadBytes").as_number().to_uint64() == 5096 + 4096, "the read bytes are not the last sampled");
+    result &= Expect(summary.at("IoWriteBytes").as_number().to_uint64() == 8192, "the written bytes are not the last sampled");
+    result &= Expect(summary.at("MaxProcessCount").as_integer() == 5, "the process count peak is not tracked");
+
+    return result;
+}
+
+#endif // DEBUG
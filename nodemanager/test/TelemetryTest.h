@@ -0,0 +1,26 @@
+#ifndef TELEMETRYTEST_H
+#define TELEMETRYTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class TelemetryTest
+        {
+            public:
+                TelemetryTest() { }
+
+                static bool SampleRingReaders();
+                static bool CGroupUsageSummary();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // TELEMETRYTEST_H
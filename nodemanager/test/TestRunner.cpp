@@ -6,6 +6,15 @@
 #include "ProcessTest.h"
 #include "ExecutionFilterTest.h"
 #include "ProxyTest.h"
+#include "TaskCompletionTest.h"
+#include "LauncherTest.h"
+#include "RemoteExecutorTest.h"
+#include "JobTaskTableTest.h"
+#include "MetricPacketTest.h"
+#include "LoggerTest.h"
+#include "HostsFileTest.h"
+#include "TelemetryTest.h"
+#include "MetricHistoryTest.h"
 
 using namespace hpc::tests;
 using namespace hpc::utils;
@@ -15,9 +24,24 @@ TestRunner::TestRunner()
     this->tests["SimpleEcho"] = []() { return ProcessTest::SimpleEcho(); };
     this->tests["Affinity"] = []() { return ProcessTest::Affinity(); };
     this->tests["RemainingProcess"] = []() { return ProcessTest::RemainingProcess(); };
+    this->tests["WaitForExit"] = []() { return ProcessTest::WaitForExit(); };
     this->tests["ClusRun"] = []() { return ProcessTest::ClusRun(); };
     this->tests["FilterJobStart"] = []() { return ExecutionFilterTest::JobStart(); };
+    this->tests["FilterPersistentWorkers"] = []() { return ExecutionFilterTest::PersistentWorkers(); };
     this->tests["ProxyTest"] = []() { return ProxyTest::ProxyToLocal(); };
+    this->tests["ProxyThroughput"] = []() { return ProxyTest::ProxyThroughput(); };
+    this->tests["BatchedCompletions"] = []() { return TaskCompletionTest::BatchedCompletions(); };
+    this->tests["LaunchLatency"] = []() { return LauncherTest::LaunchLatency(); };
+    this->tests["ConcurrentJobs"] = []() { return RemoteExecutorTest::ConcurrentJobs(); };
+    this->tests["BatchedStart"] = []() { return RemoteExecutorTest::BatchedStart(); };
+    this->tests["DeltaReports"] = []() { return JobTaskTableTest::DeltaReports(); };
+    this->tests["MetricPacketRoundTrip"] = []() { return MetricPacketTest::RoundTrip(); };
+    this->tests["MetricPacketLostDatagram"] = []() { return MetricPacketTest::LostDatagram(); };
+    this->tests["LogLatency"] = []() { return LoggerTest::LogLatency(); };
+    this->tests["HostsFileUpdate"] = []() { return HostsFileTest::LargeUpdate(); };
+    this->tests["SampleRingReaders"] = []() { return TelemetryTest::SampleRingReaders(); };
+    this->tests["CGroupUsageSummary"] = []() { return TelemetryTest::CGroupUsageSummary(); };
+    this->tests["MetricHistoryRollups"] = []() { return MetricHistoryTest::Rollups(); };
 }
 
 bool TestRunner::Run()
@@ -1,8 +1,11 @@
 #include <fstream>
+#include <poll.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/inotify.h>
 
 #include "Configuration.h"
 #include "../common/ErrorCodes.h"
-#include "WriterLock.h"
 
 using namespace hpc::utils;
 using namespace hpc::common;
@@ -15,7 +18,7 @@ Configuration::Configuration(const std::string& configurationFile)
     if (ifs.good())
     {
         std::error_code error;
-        this->data = web::json::value::parse(ifs, error);
+        auto data = std::make_shared<web::json::value>(web::json::value::parse(ifs, error));
 
         if (error)
         {
@@ -24,6 +27,7 @@ Configuration::Configuration(const std::string& configurationFile)
         }
 
         ifs.close();
+        this->data = data;
     }
     else
     {
@@ -32,16 +36,32 @@ Configuration::Configuration(const std::string& configurationFile)
     }
 }
 
+Configuration::~Configuration()
+{
+    if (this->watchingThreadId != 0)
+    {
+        this->stopping = true;
+        pthread_join(this->watchingThreadId, nullptr);
+    }
+
+    if (this->inotifyFd != -1)
+    {
+        close(this->inotifyFd);
+    }
+
+    pthread_mutex_destroy(&this->writeMutex);
+}
+
 void Configuration::Save()
 {
-    WriterLock writerLock(&this->lock);
+    pthread_mutex_lock(&this->writeMutex);
 
     std::string tmpConfFile = confFile + ".tmp";
     std::ofstream ofs(tmpConfFile, std::ios::trunc);
 
     if (ofs.good())
     {
-        this->data.serialize(ofs);
+        this->GetData()->serialize(ofs);
 
         ofs.close();
 
@@ -57,4 +77,110 @@ void Configuration::Save()
         Logger::Error("Failed to save {0}", confFile);
         exit((int)ErrorCodes::ConfigurationFileError);
     }
+
+    pthread_mutex_unlock(&this->writeMutex);
+}
+
+void Configuration::Watch(std::function<void(const web::json::value&)> onLoaded)
+{
+    this->onLoaded = onLoaded;
+    this->onLoaded(*this->GetData());
+
+    this->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->inotifyFd == -1)
+    {
+        Logger::Warn("Failed to watch {0}, errno {1}, the changes take effect after restart", this->confFile, errno);
+        return;
+    }
+
+    // The directory is watched as the file is replaced by a rename when saved.
+    std::vector<char> path(this->confFile.begin(), this->confFile.end());
+    path.push_back('\0');
+
+    if (inotify_add_watch(this->inotifyFd, dirname(&path[0]), IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+    {
+        Logger::Warn("Failed to watch {0}, errno {1}, the changes take effect after restart", this->confFile, errno);
+        return;
+    }
+
+    pthread_create(&this->watchingThreadId, nullptr, Configuration::WatchingThread, this);
+}
+
+void Configuration::Publish(std::shared_ptr<const web::json::value> data)
+{
+    std::atomic_store(&this->data, data);
+
+    if (this->onLoaded)
+    {
+        this->onLoaded(*data);
+    }
+}
+
+void Configuration::Reload()
+{
+    std::ifstream ifs(this->confFile, std::ios::in);
+    if (!ifs.good())
+    {
+        Logger::Warn("Failed to open {0} to reload, keep the current configuration", this->confFile);
+        return;
+    }
+
+    std::error_code error;
+    auto data = std::make_shared<web::json::value>(web::json::value::parse(ifs, error));
+    if (error)
+    {
+        Logger::Warn("Failed to reload {0}: {1}, keep the current configuration", this->confFile, error.message());
+        return;
+    }
+
+    pthread_mutex_lock(&this->writeMutex);
+
+    if (*data != *this->GetData())
+    {
+        Logger::Info("Reloaded {0}", this->confFile);
+        this->Publish(data);
+    }
+
+    pthread_mutex_unlock(&this->writeMutex);
+}
+
+void* Configuration::WatchingThread(void* arg)
+{
+    pthread_setname_np(pthread_self(), "configWatcher");
+
+    Configuration* const c = static_cast<Configuration*>(arg);
+
+    std::vector<char> path(c->confFile.begin(), c->confFile.end());
+    path.push_back('\0');
+    std::string fileName = basename(&path[0]);
+
+    alignas(inotify_event) char buffer[4096];
+
+    while (!c->stopping)
+    {
+        pollfd fd = { c->inotifyFd, POLLIN, 0 };
+        if (poll(&fd, 1, 1000) <= 0)
+        {
+            continue;
+        }
+
+        bool changed = false;
+        ssize_t length;
+        while ((length = read(c->inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* p = buffer; p < buffer + length; )
+            {
+                auto* event = reinterpret_cast<inotify_event*>(p);
+                changed = changed || (event->len > 0 && fileName == event->name);
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+
+        if (changed)
+        {
+            c->Reload();
+        }
+    }
+
+    pthread_exit(nullptr);
 }
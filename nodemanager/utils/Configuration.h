@@ -2,6 +2,10 @@
 #define CONFIGURATION_H
 
 #include <string>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <pthread.h>
 #include <cpprest/json.h>
 
 #include "Logger.h"
@@ -11,33 +15,97 @@ namespace hpc
 {
     namespace utils
     {
+        /// A configuration item parsed from the json. The error of parsing it is
+        /// thrown when it is read, as reading it from the json did.
+        template <typename T>
+        class ConfigurationValue
+        {
+            public:
+                void Parse(const std::string& name, const web::json::value& data)
+                {
+                    try
+                    {
+                        this->value = JsonHelper<T>::Read(name, data);
+                        this->error = nullptr;
+                    }
+                    catch (...)
+                    {
+                        this->error = std::current_exception();
+                    }
+                }
+
+                const T& Get() const
+                {
+                    if (this->error)
+                    {
+                        std::rethrow_exception(this->error);
+                    }
+
+                    return this->value;
+                }
+
+                bool IsValid() const { return !this->error; }
+
+            protected:
+            private:
+                T value = T();
+                std::exception_ptr error;
+        };
+
         /// The Configuration class is for general json configuration file.
         /// It shouldn't know anything about the actual configuration item.
         /// So it should be put under utils.
+        /// The json is immutable once published, a write publishes a copy.
         class Configuration
         {
             public:
                 Configuration(const std::string& configurationFile);
-                ~Configuration() { pthread_rwlock_destroy(&this->lock); }
+                virtual ~Configuration();
                 void Save();
 
                 template <typename T>
                 T ReadValue(const std::string& name)
                 {
-                    return JsonHelper<T>::Read(name, this->data);
+                    return JsonHelper<T>::Read(name, *this->GetData());
                 }
 
                 template <typename T>
                 void WriteValue(const std::string& name, const T& v)
                 {
-                    JsonHelper<T>::Write(name, this->data, v);
+                    pthread_mutex_lock(&this->writeMutex);
+
+                    auto data = std::make_shared<web::json::value>(*this->GetData());
+                    JsonHelper<T>::Write(name, *data, v);
+                    this->Publish(data);
+
+                    pthread_mutex_unlock(&this->writeMutex);
                 }
 
             protected:
+                std::shared_ptr<const web::json::value> GetData() const
+                {
+                    return std::atomic_load(&this->data);
+                }
+
+                // Calls onLoaded with the current json and whenever it is written or
+                // the file is changed by others. It runs in the order of the changes
+                // under the write lock, so it shouldn't write the configuration.
+                void Watch(std::function<void(const web::json::value&)> onLoaded);
+
             private:
+                void Publish(std::shared_ptr<const web::json::value> data);
+                void Reload();
+
+                static void* WatchingThread(void* arg);
+
                 std::string confFile;
-                web::json::value data;
-                pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
+                std::shared_ptr<const web::json::value> data;
+                std::function<void(const web::json::value&)> onLoaded;
+
+                pthread_mutex_t writeMutex = PTHREAD_MUTEX_INITIALIZER;
+                int inotifyFd = -1;
+                bool stopping = false;
+                pthread_t watchingThreadId = 0;
         };
     }
 }
@@ -0,0 +1,226 @@
+#include <set>
+#include <fstream>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include "CpuTopology.h"
+#include "ReaderLock.h"
+#include "WriterLock.h"
+#include "String.h"
+#include "Logger.h"
+
+using namespace hpc::utils;
+
+CpuTopology::CpuTopology()
+{
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd >= 0)
+    {
+        sockaddr_nl address = {};
+        address.nl_family = AF_NETLINK;
+        address.nl_groups = 1;
+
+        if (bind(fd, (sockaddr*)&address, sizeof(address)) == 0)
+        {
+            this->ueventSocket = fd;
+        }
+        else
+        {
+            close(fd);
+        }
+    }
+
+    if (this->ueventSocket < 0)
+    {
+        Logger::Warn("CpuTopology: uevent is unavailable, errno {0}, the online CPUs are checked instead", errno);
+    }
+
+    this->Parse();
+}
+
+CpuTopology::~CpuTopology()
+{
+    if (this->ueventSocket >= 0)
+    {
+        close(this->ueventSocket);
+    }
+
+    pthread_rwlock_destroy(&this->lock);
+}
+
+int CpuTopology::GetCoreCount()
+{
+    this->RefreshIfChanged();
+
+    ReaderLock readerLock(&this->lock);
+    return this->coreCount;
+}
+
+int CpuTopology::GetPhysicalCoreCount()
+{
+    this->RefreshIfChanged();
+
+    ReaderLock readerLock(&this->lock);
+    return this->physicalCoreCount;
+}
+
+int CpuTopology::GetSocketCount()
+{
+    this->RefreshIfChanged();
+
+    ReaderLock readerLock(&this->lock);
+    return this->socketCount;
+}
+
+int CpuTopology::GetNumaNodeCount()
+{
+    this->RefreshIfChanged();
+
+    ReaderLock readerLock(&this->lock);
+    return this->numaNodeCount;
+}
+
+std::vector<int> CpuTopology::GetSiblings(int cpu)
+{
+    this->RefreshIfChanged();
+
+    ReaderLock readerLock(&this->lock);
+    if (cpu < 0 || (size_t)cpu >= this->siblings.size())
+    {
+        return std::vector<int>();
+    }
+
+    return this->siblings[cpu];
+}
+
+std::vector<int> CpuTopology::ParseCpuList(const std::string& cpuList)
+{
+    // e.g. 0-3,8,10-11
+    std::vector<int> cpus;
+    for (const auto& range : String::Split(String::Trim(cpuList), ','))
+    {
+        if (range.empty()) continue;
+
+        auto bounds = String::Split(range, '-');
+        int first = String::ConvertTo<int>(bounds[0]);
+        int last = bounds.size() > 1 ? String::ConvertTo<int>(bounds[1]) : first;
+
+        for (int cpu = first; cpu <= last; cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return std::move(cpus);
+}
+
+void CpuTopology::RefreshIfChanged()
+{
+    bool changed;
+    if (this->ueventSocket >= 0)
+    {
+        changed = this->HasHotplugEvents();
+    }
+    else
+    {
+        std::string online = ReadString("/sys/devices/system/cpu/online");
+
+        ReaderLock readerLock(&this->lock);
+        changed = online != this->onlineCpus;
+    }
+
+    if (changed)
+    {
+        WriterLock writerLock(&this->lock);
+        this->Parse();
+    }
+}
+
+bool CpuTopology::HasHotplugEvents()
+{
+    // The uevents of all the devices are received, only the cpu ones matter.
+    bool changed = false;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = recv(this->ueventSocket, buffer, sizeof(buffer) - 1, 0)) > 0)
+    {
+        buffer[length] = '\0';
+        if (strstr(buffer, "/devices/system/cpu/cpu") != nullptr)
+        {
+            changed = true;
+        }
+    }
+
+    // the events overflowed the socket buffer.
+    return changed || (length < 0 && errno == ENOBUFS);
+}
+
+void CpuTopology::Parse()
+{
+    const std::string cpuRoot = "/sys/devices/system/cpu/";
+
+    this->onlineCpus = ReadString(cpuRoot + "online");
+    auto cpus = ParseCpuList(this->onlineCpus);
+
+    std::set<int> packages;
+    std::set<std::string> physicalCores;
+    this->siblings.clear();
+
+    for (int cpu : cpus)
+    {
+        std::string topology = String::Join("", cpuRoot, "cpu", cpu, "/topology/");
+        packages.insert(ReadInt(topology + "physical_package_id", 0));
+
+        std::string siblingList = String::Trim(ReadString(topology + "thread_siblings_list"));
+        if (siblingList.empty())
+        {
+            siblingList = std::to_string(cpu);
+        }
+
+        physicalCores.insert(siblingList);
+
+        if (this->siblings.size() <= (size_t)cpu)
+        {
+            this->siblings.resize(cpu + 1);
+        }
+
+        this->siblings[cpu] = ParseCpuList(siblingList);
+    }
+
+    if (cpus.empty())
+    {
+        // sysfs is not available.
+        this->coreCount = sysconf(_SC_NPROCESSORS_ONLN);
+        this->physicalCoreCount = this->coreCount;
+    }
+    else
+    {
+        this->coreCount = cpus.size();
+        this->physicalCoreCount = physicalCores.size();
+    }
+
+    this->socketCount = packages.empty() ? 1 : packages.size();
+
+    int numaNodes = ParseCpuList(ReadString("/sys/devices/system/node/online")).size();
+    this->numaNodeCount = numaNodes > 0 ? numaNodes : 1;
+
+    Logger::Info("CpuTopology: {0} cores, {1} physical cores, {2} sockets, {3} NUMA nodes",
+        this->coreCount, this->physicalCoreCount, this->socketCount, this->numaNodeCount);
+}
+
+int CpuTopology::ReadInt(const std::string& path, int defaultValue)
+{
+    std::ifstream fs(path, std::ios::in);
+    int value;
+    return (fs >> value) ? value : defaultValue;
+}
+
+std::string CpuTopology::ReadString(const std::string& path)
+{
+    std::ifstream fs(path, std::ios::in);
+    std::string value;
+    getline(fs, value);
+    return value;
+}
@@ -0,0 +1,61 @@
+#ifndef CPUTOPOLOGY_H
+#define CPUTOPOLOGY_H
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+namespace hpc
+{
+    namespace utils
+    {
+        // The CPU topology parsed from /sys/devices/system/cpu, it is parsed again
+        // only when a CPU hotplug uevent is received.
+        class CpuTopology
+        {
+            public:
+                static CpuTopology& GetInstance()
+                {
+                    static CpuTopology instance;
+                    return instance;
+                }
+
+                ~CpuTopology();
+
+                // The number of the online logical CPUs.
+                int GetCoreCount();
+                int GetPhysicalCoreCount();
+                int GetSocketCount();
+                int GetNumaNodeCount();
+
+                // The logical CPUs sharing the same physical core with the cpu, including itself.
+                std::vector<int> GetSiblings(int cpu);
+
+                static std::vector<int> ParseCpuList(const std::string& cpuList);
+
+            protected:
+            private:
+                CpuTopology();
+
+                void RefreshIfChanged();
+                bool HasHotplugEvents();
+                void Parse();
+
+                static int ReadInt(const std::string& path, int defaultValue);
+                static std::string ReadString(const std::string& path);
+
+                int coreCount = 1;
+                int physicalCoreCount = 1;
+                int socketCount = 1;
+                int numaNodeCount = 1;
+                std::vector<std::vector<int>> siblings;
+
+                int ueventSocket = -1;
+                std::string onlineCpus;
+
+                pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
+        };
+    }
+}
+
+#endif // CPUTOPOLOGY_H
@@ -0,0 +1,100 @@
+#ifndef LOCKFREERING_H
+#define LOCKFREERING_H
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+namespace hpc
+{
+    namespace utils
+    {
+        // A bounded queue of many producers and a single consumer without locks,
+        // after the bounded queue of Dmitry Vyukov. The values live in the cells,
+        // a producer claims a cell, fills the value in place and publishes it.
+        // The capacity must be a power of 2.
+        template <typename T>
+        class LockFreeRing
+        {
+            public:
+                LockFreeRing(size_t capacity) : capacity(capacity), mask(capacity - 1), cells(new Cell[capacity])
+                {
+                    for (size_t i = 0; i < capacity; i++)
+                    {
+                        this->cells[i].Sequence.store(i, std::memory_order_relaxed);
+                    }
+                }
+
+                // Returns nullptr when the ring is full.
+                T* TryClaim(uint64_t& position)
+                {
+                    position = this->enqueuePosition.load(std::memory_order_relaxed);
+
+                    while (true)
+                    {
+                        Cell& cell = this->cells[position & this->mask];
+                        uint64_t sequence = cell.Sequence.load(std::memory_order_acquire);
+                        int64_t diff = (int64_t)(sequence - position);
+
+                        if (diff == 0)
+                        {
+                            if (this->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                            {
+                                return &cell.Value;
+                            }
+                        }
+                        else if (diff < 0)
+                        {
+                            return nullptr;
+                        }
+                        else
+                        {
+                            position = this->enqueuePosition.load(std::memory_order_relaxed);
+                        }
+                    }
+                }
+
+                void Publish(uint64_t position)
+                {
+                    this->cells[position & this->mask].Sequence.store(position + 1, std::memory_order_release);
+                }
+
+                // The oldest published value, only called by the consumer.
+                T* TryPeek()
+                {
+                    uint64_t position = this->dequeuePosition.load(std::memory_order_relaxed);
+                    Cell& cell = this->cells[position & this->mask];
+
+                    return cell.Sequence.load(std::memory_order_acquire) == position + 1 ? &cell.Value : nullptr;
+                }
+
+                void Pop()
+                {
+                    uint64_t position = this->dequeuePosition.load(std::memory_order_relaxed);
+                    this->cells[position & this->mask].Sequence.store(position + this->capacity, std::memory_order_release);
+                    this->dequeuePosition.store(position + 1, std::memory_order_release);
+                }
+
+                uint64_t GetEnqueuePosition() const { return this->enqueuePosition.load(std::memory_order_acquire); }
+                uint64_t GetDequeuePosition() const { return this->dequeuePosition.load(std::memory_order_acquire); }
+
+            protected:
+            private:
+                struct Cell
+                {
+                    std::atomic<uint64_t> Sequence;
+                    T Value;
+                };
+
+                const size_t capacity;
+                const size_t mask;
+                std::unique_ptr<Cell[]> cells;
+
+                // on separate cache lines, the producers contend on the first only.
+                alignas(64) std::atomic<uint64_t> enqueuePosition { 0 };
+                alignas(64) std::atomic<uint64_t> dequeuePosition { 0 };
+        };
+    }
+}
+
+#endif // LOCKFREERING_H
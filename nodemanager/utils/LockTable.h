@@ -0,0 +1,87 @@
+#ifndef LOCKTABLE_H
+#define LOCKTABLE_H
+
+#include <map>
+#include <memory>
+#include <pthread.h>
+
+namespace hpc
+{
+    namespace utils
+    {
+        // A mutex per key, e.g. per job or per user, created on demand and removed
+        // when no one holds or waits for it, so unrelated keys don't contend.
+        template <typename Key>
+        class LockTable
+        {
+            public:
+                LockTable() { }
+                ~LockTable() { pthread_mutex_destroy(&this->mutex); }
+
+                class Guard
+                {
+                    public:
+                        Guard(LockTable<Key>& table, const Key& key) : table(table), key(key)
+                        {
+                            this->entry = table.Acquire(key);
+                        }
+
+                        ~Guard() { this->table.Release(this->key, this->entry); }
+
+                    protected:
+                    private:
+                        LockTable<Key>& table;
+                        const Key key;
+                        std::shared_ptr<pthread_mutex_t> entry;
+                };
+
+            protected:
+            private:
+                std::shared_ptr<pthread_mutex_t> Acquire(const Key& key)
+                {
+                    pthread_mutex_lock(&this->mutex);
+
+                    auto& entry = this->entries[key];
+                    if (!entry.first)
+                    {
+                        entry.first = std::shared_ptr<pthread_mutex_t>(new pthread_mutex_t, [](pthread_mutex_t* m)
+                        {
+                            pthread_mutex_destroy(m);
+                            delete m;
+                        });
+
+                        pthread_mutex_init(entry.first.get(), nullptr);
+                    }
+
+                    entry.second++;
+                    auto m = entry.first;
+
+                    pthread_mutex_unlock(&this->mutex);
+
+                    pthread_mutex_lock(m.get());
+                    return m;
+                }
+
+                void Release(const Key& key, const std::shared_ptr<pthread_mutex_t>& m)
+                {
+                    pthread_mutex_unlock(m.get());
+
+                    pthread_mutex_lock(&this->mutex);
+
+                    auto it = this->entries.find(key);
+                    if (it != this->entries.end() && --it->second.second == 0)
+                    {
+                        this->entries.erase(it);
+                    }
+
+                    pthread_mutex_unlock(&this->mutex);
+                }
+
+                // the mutex and the count of the holders and waiters.
+                std::map<Key, std::pair<std::shared_ptr<pthread_mutex_t>, int>> entries;
+                pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        };
+    }
+}
+
+#endif // LOCKTABLE_H
@@ -1,15 +1,205 @@
+#include <time.h>
+#include <unistd.h>
+
 #include "Logger.h"
 
 using namespace hpc::utils;
 
-Logger::Logger()
+Logger::Logger() : ring(RingCapacity)
 {
     loggers.push_back(spdlog::stdout_color_mt("console"));
     loggers.push_back(spdlog::rotating_logger_mt("nodemanager", "logs/nodemanager", 1048576 * 5, 100));
 
     spdlog::set_level(spdlog::level::debug);
     spdlog::set_pattern("[%m/%d %T.%e] %t %l: %v");
+
+    sem_init(&this->wakeup, 0, 0);
+    pthread_create(&this->writerThreadId, nullptr, Logger::WriterThread, this);
+}
+
+Logger::~Logger()
+{
+    this->stopping = true;
+    sem_post(&this->wakeup);
+    pthread_join(this->writerThreadId, nullptr);
+
+    sem_destroy(&this->wakeup);
 }
 
 Logger Logger::instance;
 
+void Logger::SetLevel(spdlog::level::level_enum l)
+{
+    spdlog::set_level(l);
+
+    int level;
+    switch (l)
+    {
+        case spdlog::level::trace: level = (int)LogLevel::Trace; break;
+        case spdlog::level::debug: level = (int)LogLevel::Debug; break;
+        case spdlog::level::info: level = (int)LogLevel::Info; break;
+        case spdlog::level::warn: level = (int)LogLevel::Warning; break;
+        case spdlog::level::err: level = (int)LogLevel::Error; break;
+        case spdlog::level::critical: level = (int)LogLevel::Critical; break;
+        default: level = -1;
+    }
+
+    instance.maxLevel = level;
+}
+
+spdlog::level::level_enum Logger::GetLevel()
+{
+    switch (instance.maxLevel.load(std::memory_order_relaxed))
+    {
+        case (int)LogLevel::Trace: return spdlog::level::trace;
+        case (int)LogLevel::Debug: return spdlog::level::debug;
+        case (int)LogLevel::Info: return spdlog::level::info;
+        case (int)LogLevel::Warning: return spdlog::level::warn;
+        case (int)LogLevel::Error: return spdlog::level::err;
+        case (int)LogLevel::Critical: return spdlog::level::critical;
+        default: return spdlog::level::off;
+    }
+}
+
+bool Logger::Flush()
+{
+    uint64_t position = instance.ring.GetEnqueuePosition();
+
+    if (instance.writerSleeping.exchange(false))
+    {
+        sem_post(&instance.wakeup);
+    }
+
+    // a record claimed but not published yet blocks the writer, so the wait is bounded.
+    for (int i = 0; i < 1000 && instance.ring.GetDequeuePosition() < position; i++)
+    {
+        usleep(1000);
+    }
+
+    return instance.ring.GetDequeuePosition() >= position;
+}
+
+void Logger::Write(const Record& record)
+{
+    spdlog::level::level_enum level;
+    switch (record.Level)
+    {
+        case LogLevel::Critical: level = spdlog::level::critical; break;
+        case LogLevel::Error: level = spdlog::level::err; break;
+        case LogLevel::Warning: level = spdlog::level::warn; break;
+        case LogLevel::Info: level = spdlog::level::info; break;
+        case LogLevel::Debug: level = spdlog::level::debug; break;
+        default: level = spdlog::level::trace;
+    }
+
+    this->line.clear();
+
+    if (record.HasContext)
+    {
+        fmt::format_to(std::back_inserter(this->line), "Job {}, Task {}.{}: ", record.JobId, record.TaskId, record.Requeue);
+    }
+
+    if (record.LongText.empty())
+    {
+        this->line.append(record.Text, record.Text + std::min(record.Length, (size_t)InlineTextBytes));
+    }
+    else
+    {
+        this->line.append(record.LongText.data(), record.LongText.data() + record.LongText.size());
+    }
+
+    for (auto& logger : this->loggers)
+    {
+        spdlog::details::log_msg msg(record.Time, spdlog::source_loc{}, logger->name(), level, spdlog::string_view_t(this->line.data(), this->line.size()));
+        msg.thread_id = record.ThreadId;
+
+        for (auto& sink : logger->sinks())
+        {
+            if (sink->should_log(level))
+            {
+                sink->log(msg);
+            }
+        }
+    }
+}
+
+void Logger::WriteDropped()
+{
+    uint64_t dropped = this->dropped.load(std::memory_order_relaxed);
+    if (dropped == this->reportedDropped)
+    {
+        return;
+    }
+
+    Record record;
+    record.Level = LogLevel::Warning;
+    record.HasContext = false;
+    record.Time = spdlog::log_clock::now();
+    record.ThreadId = spdlog::details::os::thread_id();
+    record.Length = snprintf(record.Text, InlineTextBytes, "Logger: dropped %lu records, %lu in total, the log ring is full",
+        (unsigned long)(dropped - this->reportedDropped), (unsigned long)dropped);
+
+    this->reportedDropped = dropped;
+    this->Write(record);
+}
+
+void* Logger::WriterThread(void* arg)
+{
+    pthread_setname_np(pthread_self(), "logger");
+
+    Logger* const l = static_cast<Logger*>(arg);
+
+    while (true)
+    {
+        // the records logged before stopping are still written.
+        bool stopping = l->stopping;
+        bool written = false;
+
+        Record* record;
+        while ((record = l->ring.TryPeek()) != nullptr)
+        {
+            try
+            {
+                l->Write(*record);
+            }
+            catch (const std::exception& ex)
+            {
+                fprintf(stderr, "Logger: failed to write a record, %s\n", ex.what());
+            }
+
+            l->ring.Pop();
+            written = true;
+        }
+
+        if (written)
+        {
+            l->WriteDropped();
+
+            // flush once per batch instead of per warning.
+            for (auto& logger : l->loggers)
+            {
+                logger->flush();
+            }
+        }
+
+        if (stopping)
+        {
+            break;
+        }
+
+        l->writerSleeping = true;
+
+        // a record published before the flag was set doesn't wake the writer.
+        if (l->ring.TryPeek() == nullptr)
+        {
+            timespec timeout;
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_sec += 1;
+            sem_timedwait(&l->wakeup, &timeout);
+        }
+
+        l->writerSleeping = false;
+    }
+
+    pthread_exit(nullptr);
+}
@@ -7,8 +7,12 @@
 #include <iostream>
 #include <spdlog/spdlog.h>
 #include <spdlog/fmt/ostr.h>
+#include <atomic>
+#include <pthread.h>
+#include <semaphore.h>
 
 #include "String.h"
+#include "LockFreeRing.h"
 
 namespace hpc
 {
@@ -24,6 +28,10 @@ namespace hpc
             Trace = 5	/* the most verbose messages */
         };
 
+        // Formats the records in place into a lock free ring, a background thread
+        // writes them to the sinks. The level is checked before anything else, the
+        // job and task of a record are kept as fields and prefixed when written.
+        // A record is dropped and counted when the ring is full.
         class Logger
         {
             public:
@@ -54,74 +62,148 @@ namespace hpc
                 template <typename ...Args>
                 static void Info(int jobId, int taskId, int requeue, const char* fmt, Args ...args)
                 {
-                    auto f = String::Join("", "Job ", jobId, ", Task ", taskId, ".", requeue, ": ", fmt);
-                    Log(LogLevel::Info, f.c_str(), args...);
+                    Log(LogLevel::Info, jobId, taskId, requeue, fmt, args...);
                 }
 
                 template <typename ...Args>
                 static void Error(int jobId, int taskId, int requeue, const char* fmt, Args ...args)
                 {
-                    auto f = String::Join("", "Job ", jobId, ", Task ", taskId, ".", requeue, ": ", fmt);
-                    Log(LogLevel::Error, f.c_str(), args...);
+                    Log(LogLevel::Error, jobId, taskId, requeue, fmt, args...);
                 }
 
                 template <typename ...Args>
                 static void Warn(int jobId, int taskId, int requeue, const char* fmt, Args ...args)
                 {
-                    auto f = String::Join("", "Job ", jobId, ", Task ", taskId, ".", requeue, ": ", fmt);
-                    Log(LogLevel::Warning, f.c_str(), args...);
+                    Log(LogLevel::Warning, jobId, taskId, requeue, fmt, args...);
                 }
 
                 template <typename ...Args>
                 static void Debug(int jobId, int taskId, int requeue, const char* fmt, Args ...args)
                 {
-                    auto f = String::Join("", "Job ", jobId, ", Task ", taskId, ".", requeue, ": ", fmt);
-                    Log(LogLevel::Debug, f.c_str(), args...);
+                    Log(LogLevel::Debug, jobId, taskId, requeue, fmt, args...);
                 }
 
-                static void SetLevel(spdlog::level::level_enum l)
+                static void SetLevel(spdlog::level::level_enum l);
+                static spdlog::level::level_enum GetLevel();
+
+                static bool IsEnabled(LogLevel level)
+                {
+                    return (int)level <= instance.maxLevel.load(std::memory_order_relaxed);
+                }
+
+                // The records dropped because the ring was full.
+                static uint64_t GetDroppedCount()
                 {
-                    spdlog::set_level(l);
+                    return instance.dropped.load(std::memory_order_relaxed);
                 }
 
+                // Waits until the records logged so far are written, returns false
+                // when they are not written in a second.
+                static bool Flush();
+
                 template <typename ...Args>
                 static void Log(LogLevel level, const char* fmt, Args ...args)
                 {
-                    for (auto logger : instance.loggers)
+                    if (IsEnabled(level))
                     {
-                        switch (level)
-                        {
-                            case LogLevel::Critical:
-                                logger->critical(fmt, args...);
-                                break;
-                            case LogLevel::Error:
-                                logger->error(fmt, args...);
-                                break;
-                            case LogLevel::Warning:
-                                logger->warn(fmt, args...);
-                                break;
-                            case LogLevel::Info:
-                                logger->info(fmt, args...);
-                                break;
-                            case LogLevel::Debug:
-                                logger->debug(fmt, args...);
-                                break;
-                            default:
-                                logger->trace(fmt, args...);
-                        }
+                        instance.Enqueue(level, false, 0, 0, 0, fmt, args...);
+                    }
+                }
 
-                        if (level <= LogLevel::Warning)
-                        {
-                            logger->flush();
-                        }
+                template <typename ...Args>
+                static void Log(LogLevel level, int jobId, int taskId, int requeue, const char* fmt, Args ...args)
+                {
+                    if (IsEnabled(level))
+                    {
+                        instance.Enqueue(level, true, jobId, taskId, requeue, fmt, args...);
                     }
                 }
 
+                static const size_t RingCapacity = 4096;
+                static const size_t InlineTextBytes = 480;
+
             private:
+                typedef struct _Record
+                {
+                    LogLevel Level;
+                    bool HasContext;
+                    int JobId;
+                    int TaskId;
+                    int Requeue;
+                    spdlog::log_clock::time_point Time;
+                    size_t ThreadId;
+                    size_t Length;
+                    char Text[InlineTextBytes];
+                    // only used when the text doesn't fit inline.
+                    std::string LongText;
+                } Record;
+
                 Logger();
+                ~Logger();
+
+                template <typename ...Args>
+                void Enqueue(LogLevel level, bool hasContext, int jobId, int taskId, int requeue, const char* fmt, const Args& ...args)
+                {
+                    uint64_t position;
+                    Record* record = this->ring.TryClaim(position);
+                    if (record == nullptr)
+                    {
+                        this->dropped.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+
+                    record->Level = level;
+                    record->HasContext = hasContext;
+                    record->JobId = jobId;
+                    record->TaskId = taskId;
+                    record->Requeue = requeue;
+                    record->Time = spdlog::log_clock::now();
+                    record->ThreadId = spdlog::details::os::thread_id();
+                    record->LongText.clear();
+
+                    try
+                    {
+                        auto result = fmt::vformat_to_n(record->Text, InlineTextBytes, fmt::string_view(fmt), fmt::make_format_args(args...));
+                        record->Length = result.size;
+
+                        if (result.size > InlineTextBytes)
+                        {
+                            record->LongText = fmt::vformat(fmt::string_view(fmt), fmt::make_format_args(args...));
+                        }
+                    }
+                    catch (const std::exception& ex)
+                    {
+                        int length = snprintf(record->Text, InlineTextBytes, "Failed to format '%s': %s", fmt, ex.what());
+                        record->Length = std::min((size_t)std::max(length, 0), InlineTextBytes - 1);
+                    }
+
+                    this->ring.Publish(position);
+
+                    if (this->writerSleeping.load(std::memory_order_acquire) && this->writerSleeping.exchange(false))
+                    {
+                        sem_post(&this->wakeup);
+                    }
+                }
+
+                void Write(const Record& record);
+                void WriteDropped();
+
+                static void* WriterThread(void* arg);
 
                 static Logger instance;
                 std::vector<std::shared_ptr<spdlog::logger>> loggers;
+
+                std::atomic<int> maxLevel { (int)LogLevel::Debug };
+                std::atomic<uint64_t> dropped { 0 };
+                uint64_t reportedDropped = 0;
+
+                LockFreeRing<Record> ring;
+                fmt::memory_buffer line;
+
+                std::atomic<bool> writerSleeping { false };
+                std::atomic<bool> stopping { false };
+                sem_t wakeup;
+                pthread_t writerThreadId = 0;
         };
     }
 }
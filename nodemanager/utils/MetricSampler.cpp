@@ -0,0 +1,403 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/statvfs.h>
+
+#include "MetricSampler.h"
+#include "Logger.h"
+
+using namespace hpc::utils;
+
+MetricSampler::MetricSampler(const std::string& networkName, const std::string& mountPoint) :
+    networkName(networkName), mountPoint(mountPoint)
+{
+    // Only the whole disks are counted, the partitions, loop and ram devices
+    // and the stacked devices would count the same I/O more than once.
+    DIR* dir = opendir("/sys/block");
+    if (dir != nullptr)
+    {
+        const std::vector<std::string> excluded = { "loop", "ram", "zram", "dm-", "md" };
+
+        while (dirent* entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (name[0] == '.') continue;
+
+            bool isExcluded = false;
+            for (const auto& prefix : excluded)
+            {
+                isExcluded = isExcluded || name.compare(0, prefix.size(), prefix) == 0;
+            }
+
+            if (!isExcluded)
+            {
+                this->disks.push_back(name);
+            }
+        }
+
+        closedir(dir);
+    }
+
+    for (auto* file : { &this->stat, &this->meminfo, &this->vmstat, &this->diskstats, &this->netDev })
+    {
+        file->Fd = open(file->Path, O_RDONLY | O_CLOEXEC);
+        if (file->Fd < 0)
+        {
+            Logger::Error("MetricSampler: failed to open {0}, errno {1}", file->Path, errno);
+        }
+
+        file->Buffer.resize(4096);
+    }
+
+    Sample sample;
+    this->ReadCounters(this->last, sample);
+
+    Logger::Info("MetricSampler: {0} disks, network {1}, mount point {2}", this->disks.size(), this->networkName, this->mountPoint);
+}
+
+MetricSampler::~MetricSampler()
+{
+    for (auto* file : { &this->stat, &this->meminfo, &this->vmstat, &this->diskstats, &this->netDev })
+    {
+        if (file->Fd >= 0)
+        {
+            close(file->Fd);
+        }
+    }
+}
+
+int MetricSampler::Collect(Sample& sample)
+{
+    Counters current;
+    int ret = this->ReadCounters(current, sample);
+
+    double elapsed = (current.Time.tv_sec - this->last.Time.tv_sec) + (current.Time.tv_nsec - this->last.Time.tv_nsec) / 1e9;
+    if (elapsed <= 0)
+    {
+        return ret;
+    }
+
+    uint64_t totalDiff = current.CpuTotal - this->last.CpuTotal;
+    uint64_t idleDiff = current.CpuIdle - this->last.CpuIdle;
+    sample.CpuUsage = totalDiff == 0 ? 0.0f : (float)(100.0 * (totalDiff - idleDiff) / totalDiff);
+
+    sample.ContextSwitchesPerSec = (float)((current.ContextSwitches - this->last.ContextSwitches) / elapsed);
+    sample.PagesPerSec = (float)((current.SwapPages - this->last.SwapPages) / elapsed);
+    sample.DiskBytesPerSec = (float)((current.DiskSectors - this->last.DiskSectors) * 512 / elapsed);
+    sample.DiskQueueLength = (float)((current.DiskWeightedMs - this->last.DiskWeightedMs) / (elapsed * 1000));
+    sample.NetworkBytesPerSec = (float)((current.NetworkBytes - this->last.NetworkBytes) / elapsed);
+
+    this->last = current;
+
+    return ret;
+}
+
+int MetricSampler::ReadCounters(Counters& counters, Sample& sample)
+{
+    clock_gettime(CLOCK_MONOTONIC, &counters.Time);
+
+    int ret = 0;
+    for (int r : {
+        this->ReadStat(counters),
+        this->ReadMeminfo(sample),
+        this->ReadVmstat(counters),
+        this->ReadDiskstats(counters),
+        this->ReadNetDev(counters),
+        this->ReadFreeSpace(sample) })
+    {
+        if (r != 0) ret = r;
+    }
+
+    return ret;
+}
+
+int MetricSampler::ReadStat(Counters& counters)
+{
+    int ret = Read(this->stat);
+    if (ret != 0) return ret;
+
+    const char* p = this->stat.Buffer.data();
+    const char* end = p + this->stat.Length;
+
+    while (p < end)
+    {
+        const char* token;
+        size_t length;
+        const char* q = ParseToken(p, end, token, length);
+
+        if (Equals(token, length, "cpu"))
+        {
+            uint64_t user = 0, nice = 0, sys = 0, idle = 0, iowait = 0, irq = 0, softirq = 0;
+            q = ParseUInt(q, end, user);
+            q = ParseUInt(q, end, nice);
+            q = ParseUInt(q, end, sys);
+            q = ParseUInt(q, end, idle);
+            q = ParseUInt(q, end, iowait);
+            q = ParseUInt(q, end, irq);
+            q = ParseUInt(q, end, softirq);
+
+            counters.CpuTotal = user + nice + sys + idle + iowait + irq + softirq;
+            counters.CpuIdle = idle;
+        }
+        else if (Equals(token, length, "ctxt"))
+        {
+            ParseUInt(q, end, counters.ContextSwitches);
+            break;
+        }
+
+        p = NextLine(q, end);
+    }
+
+    return 0;
+}
+
+int MetricSampler::ReadMeminfo(Sample& sample)
+{
+    int ret = Read(this->meminfo);
+    if (ret != 0) return ret;
+
+    const char* p = this->meminfo.Buffer.data();
+    const char* end = p + this->meminfo.Length;
+
+    uint64_t totalKb = 0, freeKb = 0, availableKb = 0;
+    bool hasAvailable = false;
+
+    while (p < end)
+    {
+        const char* token;
+        size_t length;
+        const char* q = ParseToken(p, end, token, length);
+
+        if (Equals(token, length, "MemTotal:"))
+        {
+            ParseUInt(q, end, totalKb);
+        }
+        else if (Equals(token, length, "MemFree:"))
+        {
+            ParseUInt(q, end, freeKb);
+        }
+        else if (Equals(token, length, "MemAvailable:"))
+        {
+            ParseUInt(q, end, availableKb);
+            hasAvailable = true;
+            break;
+        }
+
+        p = NextLine(q, end);
+    }
+
+    // MemAvailable is missing before kernel 3.14.
+    sample.AvailableMemoryMb = (float)(hasAvailable ? availableKb : freeKb) / 1024.0f;
+    sample.TotalMemoryMb = (float)totalKb / 1024.0f;
+
+    return 0;
+}
+
+int MetricSampler::ReadVmstat(Counters& counters)
+{
+    int ret = Read(this->vmstat);
+    if (ret != 0) return ret;
+
+    const char* p = this->vmstat.Buffer.data();
+    const char* end = p + this->vmstat.Length;
+
+    uint64_t swapIn = 0, swapOut = 0;
+    while (p < end)
+    {
+        const char* token;
+        size_t length;
+        const char* q = ParseToken(p, end, token, length);
+
+        if (Equals(token, length, "pswpin"))
+        {
+            ParseUInt(q, end, swapIn);
+        }
+        else if (Equals(token, length, "pswpout"))
+        {
+            ParseUInt(q, end, swapOut);
+            break;
+        }
+
+        p = NextLine(q, end);
+    }
+
+    counters.SwapPages = swapIn + swapOut;
+
+    return 0;
+}
+
+int MetricSampler::ReadDiskstats(Counters& counters)
+{
+    int ret = Read(this->diskstats);
+    if (ret != 0) return ret;
+
+    const char* p = this->diskstats.Buffer.data();
+    const char* end = p + this->diskstats.Length;
+
+    counters.DiskSectors = 0;
+    counters.DiskWeightedMs = 0;
+
+    while (p < end)
+    {
+        uint64_t major, minor;
+        const char* name;
+        size_t length;
+        const char* q = ParseUInt(p, end, major);
+        q = ParseUInt(q, end, minor);
+        q = ParseToken(q, end, name, length);
+
+        if (this->IsDisk(name, length))
+        {
+            // reads, merged, sectors, ms, writes, merged, sectors, ms, in progress, ms, weighted ms
+            uint64_t fields[11] = { 0 };
+            for (auto& field : fields)
+            {
+                q = ParseUInt(q, end, field);
+            }
+
+            counters.DiskSectors += fields[2] + fields[6];
+            counters.DiskWeightedMs += fields[10];
+        }
+
+        p = NextLine(q, end);
+    }
+
+    return 0;
+}
+
+int MetricSampler::ReadNetDev(Counters& counters)
+{
+    int ret = Read(this->netDev);
+    if (ret != 0) return ret;
+
+    const char* p = this->netDev.Buffer.data();
+    const char* end = p + this->netDev.Length;
+
+    // skip the 2 header lines.
+    p = NextLine(NextLine(p, end), end);
+
+    ret = ENOENT;
+    counters.NetworkBytes = 0;
+
+    while (p < end)
+    {
+        p = SkipSpaces(p, end);
+        const char* name = p;
+        while (p < end && *p != ':' && *p != '\n') p++;
+        size_t length = p - name;
+
+        if (p < end && *p == ':' &&
+            (this->networkName.empty() || (length == this->networkName.size() && memcmp(name, this->networkName.data(), length) == 0)))
+        {
+            // receive bytes, packets, errs, drop, fifo, frame, compressed, multicast, transmit bytes
+            uint64_t fields[9] = { 0 };
+            const char* q = p + 1;
+            for (auto& field : fields)
+            {
+                q = ParseUInt(q, end, field);
+            }
+
+            counters.NetworkBytes += fields[0] + fields[8];
+            ret = 0;
+        }
+
+        p = NextLine(p, end);
+    }
+
+    return ret;
+}
+
+int MetricSampler::ReadFreeSpace(Sample& sample)
+{
+    struct statvfs fs;
+    if (statvfs(this->mountPoint.c_str(), &fs) != 0)
+    {
+        return errno;
+    }
+
+    // same as the Use% of df, the reserved blocks are not available to the users.
+    uint64_t used = fs.f_blocks - fs.f_bfree;
+    uint64_t total = used + fs.f_bavail;
+    sample.FreeSpacePercent = total == 0 ? 0.0f : (float)(100.0 * fs.f_bavail / total);
+
+    return 0;
+}
+
+bool MetricSampler::IsDisk(const char* name, size_t length) const
+{
+    for (const auto& disk : this->disks)
+    {
+        if (disk.size() == length && memcmp(disk.data(), name, length) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int MetricSampler::Read(ProcFile& file)
+{
+    if (file.Fd < 0) return EBADF;
+
+    while (true)
+    {
+        ssize_t bytesRead = pread(file.Fd, file.Buffer.data(), file.Buffer.size(), 0);
+        if (bytesRead < 0)
+        {
+            return errno;
+        }
+
+        // The buffer only grows when the file does not fit, the steady state reads
+        // don't allocate.
+        if ((size_t)bytesRead < file.Buffer.size())
+        {
+            file.Length = bytesRead;
+            return 0;
+        }
+
+        file.Buffer.resize(file.Buffer.size() * 2);
+    }
+}
+
+const char* MetricSampler::NextLine(const char* p, const char* end)
+{
+    const char* newLine = static_cast<const char*>(memchr(p, '\n', end - p));
+    return newLine == nullptr ? end : newLine + 1;
+}
+
+const char* MetricSampler::SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+const char* MetricSampler::ParseToken(const char* p, const char* end, const char*& token, size_t& length)
+{
+    p = SkipSpaces(p, end);
+    token = p;
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\n') p++;
+    length = p - token;
+
+    return p;
+}
+
+const char* MetricSampler::ParseUInt(const char* p, const char* end, uint64_t& value)
+{
+    p = SkipSpaces(p, end);
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+
+    return p;
+}
+
+bool MetricSampler::Equals(const char* token, size_t length, const char* expected)
+{
+    return strncmp(token, expected, length) == 0 && expected[length] == '\0';
+}
@@ -0,0 +1,90 @@
+#ifndef METRICSAMPLER_H
+#define METRICSAMPLER_H
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include <time.h>
+
+namespace hpc
+{
+    namespace utils
+    {
+        // Samples the node counters from /proc and statvfs through persistent file
+        // descriptors, the rates are computed from the deltas between two samples.
+        class MetricSampler
+        {
+            public:
+                typedef struct _Sample
+                {
+                    float CpuUsage = 0.0f;
+                    float AvailableMemoryMb = 0.0f;
+                    float TotalMemoryMb = 0.0f;
+                    float PagesPerSec = 0.0f;
+                    float ContextSwitchesPerSec = 0.0f;
+                    float DiskBytesPerSec = 0.0f;
+                    float DiskQueueLength = 0.0f;
+                    float FreeSpacePercent = 0.0f;
+                    float NetworkBytesPerSec = 0.0f;
+                } Sample;
+
+                MetricSampler(const std::string& networkName, const std::string& mountPoint = "/");
+                ~MetricSampler();
+
+                int Collect(Sample& sample);
+
+            protected:
+            private:
+                typedef struct _Counters
+                {
+                    uint64_t CpuTotal = 0;
+                    uint64_t CpuIdle = 0;
+                    uint64_t ContextSwitches = 0;
+                    uint64_t SwapPages = 0;
+                    uint64_t DiskSectors = 0;
+                    uint64_t DiskWeightedMs = 0;
+                    uint64_t NetworkBytes = 0;
+                    timespec Time = { 0, 0 };
+                } Counters;
+
+                typedef struct _ProcFile
+                {
+                    const char* Path;
+                    int Fd = -1;
+                    std::vector<char> Buffer;
+                    size_t Length = 0;
+                } ProcFile;
+
+                int ReadCounters(Counters& counters, Sample& sample);
+                int ReadStat(Counters& counters);
+                int ReadMeminfo(Sample& sample);
+                int ReadVmstat(Counters& counters);
+                int ReadDiskstats(Counters& counters);
+                int ReadNetDev(Counters& counters);
+                int ReadFreeSpace(Sample& sample);
+                bool IsDisk(const char* name, size_t length) const;
+
+                static int Read(ProcFile& file);
+
+                static const char* NextLine(const char* p, const char* end);
+                static const char* SkipSpaces(const char* p, const char* end);
+                static const char* ParseToken(const char* p, const char* end, const char*& token, size_t& length);
+                static const char* ParseUInt(const char* p, const char* end, uint64_t& value);
+                static bool Equals(const char* token, size_t length, const char* expected);
+
+                const std::string networkName;
+                const std::string mountPoint;
+                std::vector<std::string> disks;
+
+                ProcFile stat = { "/proc/stat" };
+                ProcFile meminfo = { "/proc/meminfo" };
+                ProcFile vmstat = { "/proc/vmstat" };
+                ProcFile diskstats = { "/proc/diskstats" };
+                ProcFile netDev = { "/proc/net/dev" };
+
+                Counters last;
+        };
+    }
+}
+
+#endif // METRICSAMPLER_H
@@ -0,0 +1,315 @@
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "Reactor.h"
+#include "Logger.h"
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+using namespace hpc::utils;
+
+Reactor::Reactor() : workers(WorkerCount), blockingWorkers(BlockingWorkerCount)
+{
+    this->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    this->wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    // id 0 is the wakeup event.
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = 0;
+    if (this->epollFd < 0 || this->wakeupFd < 0 || epoll_ctl(this->epollFd, EPOLL_CTL_ADD, this->wakeupFd, &event) != 0)
+    {
+        Logger::Error("Reactor: failed to create the epoll, errno {0}", errno);
+    }
+
+    pthread_create(&this->threadId, nullptr, ReactorThread, this);
+}
+
+Reactor::~Reactor()
+{
+    pthread_mutex_lock(&this->mutex);
+    this->isRunning = false;
+    pthread_mutex_unlock(&this->mutex);
+
+    this->Wakeup();
+    pthread_join(this->threadId, nullptr);
+
+    for (auto& entry : this->entries)
+    {
+        close(entry.second->Fd);
+    }
+
+    close(this->wakeupFd);
+    close(this->epollFd);
+
+    pthread_mutex_destroy(&this->mutex);
+}
+
+uint64_t Reactor::Watch(int fd, const std::shared_ptr<WorkerPool::Strand>& strand, std::function<WatchAction()> handler)
+{
+    pthread_mutex_lock(&this->mutex);
+
+    uint64_t id = this->nextId++;
+    auto entry = std::make_shared<Entry>(Entry { id, fd, strand, std::move(handler), true });
+    this->entries[id] = entry;
+
+    // One shot, the fd is watched again only after the handler completes, so a
+    // handler never runs concurrently with itself.
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = id;
+    if (epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        Logger::Error("Reactor: failed to watch fd {0}, errno {1}", fd, errno);
+        this->entries.erase(id);
+        close(fd);
+        id = 0;
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+
+    return id;
+}
+
+uint64_t Reactor::WatchProcess(pid_t pid, const std::shared_ptr<WorkerPool::Strand>& strand, std::function<void()> exited)
+{
+    if (this->pidfdSupported)
+    {
+        int fd = syscall(SYS_pidfd_open, pid, 0);
+        if (fd >= 0)
+        {
+            return this->Watch(fd, strand, [exited]() { exited(); return WatchAction::Stop; });
+        }
+
+        if (errno == ENOSYS)
+        {
+            Logger::Warn("Reactor: pidfd is unavailable, the processes are polled every {0} ms", (int)PollIntervalMilliseconds);
+            this->pidfdSupported = false;
+        }
+        else
+        {
+            Logger::Warn("Reactor: pidfd_open for process {0} failed, errno {1}, poll it instead", pid, errno);
+        }
+    }
+
+    pthread_mutex_lock(&this->mutex);
+    uint64_t id = this->nextId++;
+    this->polledProcesses.push_back({ id, pid, strand, std::move(exited) });
+    pthread_mutex_unlock(&this->mutex);
+
+    // the reactor thread starts polling.
+    this->Wakeup();
+
+    return id;
+}
+
+uint64_t Reactor::AddTimer(int milliseconds, std::function<void()> handler)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0)
+    {
+        Logger::Error("Reactor: failed to create timer, errno {0}", errno);
+        return 0;
+    }
+
+    // a zero value disarms the timer.
+    itimerspec spec = {};
+    spec.it_value.tv_sec = milliseconds > 0 ? milliseconds / 1000 : 0;
+    spec.it_value.tv_nsec = milliseconds > 0 ? (milliseconds % 1000) * 1000000L : 1;
+    timerfd_settime(fd, 0, &spec, nullptr);
+
+    return this->Watch(fd, nullptr, [handler]() { handler(); return WatchAction::Stop; });
+}
+
+void Reactor::Cancel(uint64_t id)
+{
+    pthread_mutex_lock(&this->mutex);
+
+    auto it = this->entries.find(id);
+    if (it != this->entries.end())
+    {
+        it->second->Active = false;
+        epoll_ctl(this->epollFd, EPOLL_CTL_DEL, it->second->Fd, nullptr);
+        close(it->second->Fd);
+        this->entries.erase(it);
+    }
+    else
+    {
+        for (auto p = this->polledProcesses.begin(); p != this->polledProcesses.end(); p++)
+        {
+            if (p->Id == id)
+            {
+                this->polledProcesses.erase(p);
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+}
+
+void Reactor::Dispatch(uint64_t id)
+{
+    pthread_mutex_lock(&this->mutex);
+    auto it = this->entries.find(id);
+    std::shared_ptr<Entry> entry = it == this->entries.end() ? nullptr : it->second;
+    pthread_mutex_unlock(&this->mutex);
+
+    if (!entry) return;
+
+    auto job = [this, entry]()
+    {
+        pthread_mutex_lock(&this->mutex);
+        bool active = entry->Active;
+        pthread_mutex_unlock(&this->mutex);
+
+        if (active)
+        {
+            this->Complete(entry, entry->Handler());
+        }
+    };
+
+    if (entry->Strand)
+    {
+        this->workers.Post(entry->Strand, std::move(job));
+    }
+    else
+    {
+        this->workers.Post(std::move(job));
+    }
+}
+
+void Reactor::Resume(uint64_t id)
+{
+    pthread_mutex_lock(&this->mutex);
+
+    auto it = this->entries.find(id);
+    if (it != this->entries.end())
+    {
+        this->Arm(it->second);
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+}
+
+void Reactor::Arm(const std::shared_ptr<Entry>& entry)
+{
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = entry->Id;
+    epoll_ctl(this->epollFd, EPOLL_CTL_MOD, entry->Fd, &event);
+}
+
+void Reactor::Complete(const std::shared_ptr<Entry>& entry, WatchAction action)
+{
+    pthread_mutex_lock(&this->mutex);
+
+    if (entry->Active)
+    {
+        if (action == WatchAction::Continue)
+        {
+            this->Arm(entry);
+        }
+        else if (action == WatchAction::Stop)
+        {
+            entry->Active = false;
+            epoll_ctl(this->epollFd, EPOLL_CTL_DEL, entry->Fd, nullptr);
+            close(entry->Fd);
+            this->entries.erase(entry->Id);
+        }
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+}
+
+void Reactor::PollProcesses()
+{
+    pthread_mutex_lock(&this->mutex);
+
+    for (auto p = this->polledProcesses.begin(); p != this->polledProcesses.end();)
+    {
+        // WNOWAIT leaves the process to be reaped by the handler.
+        siginfo_t info = {};
+        int ret = waitid(P_PID, p->Pid, &info, WEXITED | WNOHANG | WNOWAIT);
+
+        if ((ret == 0 && info.si_pid == p->Pid) || (ret != 0 && errno == ECHILD))
+        {
+            if (p->Strand)
+            {
+                this->workers.Post(p->Strand, p->Exited);
+            }
+            else
+            {
+                this->workers.Post(p->Exited);
+            }
+
+            p = this->polledProcesses.erase(p);
+        }
+        else
+        {
+            p++;
+        }
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+}
+
+void Reactor::Wakeup()
+{
+    uint64_t one = 1;
+    ssize_t ret = write(this->wakeupFd, &one, sizeof(one));
+    (void)ret;
+}
+
+void* Reactor::ReactorThread(void* arg)
+{
+    Reactor* r = static_cast<Reactor*>(arg);
+    epoll_event events[64];
+
+    while (true)
+    {
+        pthread_mutex_lock(&r->mutex);
+        bool isRunning = r->isRunning;
+        int timeout = r->polledProcesses.empty() ? -1 : PollIntervalMilliseconds;
+        pthread_mutex_unlock(&r->mutex);
+
+        if (!isRunning) break;
+
+        int count = epoll_wait(r->epollFd, events, sizeof(events) / sizeof(events[0]), timeout);
+        if (count < 0)
+        {
+            if (errno != EINTR)
+            {
+                Logger::Error("Reactor: epoll_wait failed, errno {0}", errno);
+                usleep(PollIntervalMilliseconds * 1000);
+            }
+
+            continue;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            if (events[i].data.u64 == 0)
+            {
+                uint64_t value;
+                ssize_t ret = read(r->wakeupFd, &value, sizeof(value));
+                (void)ret;
+            }
+            else
+            {
+                r->Dispatch(events[i].data.u64);
+            }
+        }
+
+        r->PollProcesses();
+    }
+
+    pthread_exit(nullptr);
+}
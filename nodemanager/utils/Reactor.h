@@ -0,0 +1,114 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <map>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "WorkerPool.h"
+
+namespace hpc
+{
+    namespace utils
+    {
+        enum class WatchAction
+        {
+            Continue,
+            // keeps the fd until Resume is called.
+            Pause,
+            Stop
+        };
+
+        // One epoll thread watching the child processes (through pidfd), the pipes
+        // and the timers, the handlers are dispatched to a small worker pool so the
+        // thread count doesn't grow with the number of tasks. The handlers must not
+        // block, the work waiting on the processes or the scripts is posted to a
+        // separate pool, so it doesn't hold up the pipes and the exits of the other
+        // tasks.
+        class Reactor
+        {
+            public:
+                static Reactor& GetInstance()
+                {
+                    static Reactor instance;
+                    return instance;
+                }
+
+                ~Reactor();
+
+                // Watches the readable events of the fd until the handler returns Stop.
+                // The fd is owned by the reactor and closed afterwards.
+                uint64_t Watch(int fd, const std::shared_ptr<WorkerPool::Strand>& strand, std::function<WatchAction()> handler);
+
+                // The handler is called once when the process exits, it should reap
+                // the process. The processes are polled when pidfd is unavailable.
+                uint64_t WatchProcess(pid_t pid, const std::shared_ptr<WorkerPool::Strand>& strand, std::function<void()> exited);
+
+                uint64_t AddTimer(int milliseconds, std::function<void()> handler);
+
+                // Stops the watch, a handler already dispatched may still run.
+                void Cancel(uint64_t id);
+
+                // Watches the fd paused by its handler again.
+                void Resume(uint64_t id);
+
+                void Post(std::function<void()> job) { this->workers.Post(std::move(job)); }
+                void Post(const std::shared_ptr<WorkerPool::Strand>& strand, std::function<void()> job) { this->workers.Post(strand, std::move(job)); }
+
+                void PostBlocking(std::function<void()> job) { this->blockingWorkers.Post(std::move(job)); }
+
+                static const int WorkerCount = 8;
+                static const int BlockingWorkerCount = 16;
+                static const int PollIntervalMilliseconds = 100;
+
+            protected:
+            private:
+                Reactor();
+
+                typedef struct _Entry
+                {
+                    uint64_t Id;
+                    int Fd;
+                    std::shared_ptr<WorkerPool::Strand> Strand;
+                    std::function<WatchAction()> Handler;
+                    bool Active;
+                } Entry;
+
+                typedef struct _PolledProcess
+                {
+                    uint64_t Id;
+                    pid_t Pid;
+                    std::shared_ptr<WorkerPool::Strand> Strand;
+                    std::function<void()> Exited;
+                } PolledProcess;
+
+                static void* ReactorThread(void* arg);
+
+                void Dispatch(uint64_t id);
+                void Complete(const std::shared_ptr<Entry>& entry, WatchAction action);
+                void Arm(const std::shared_ptr<Entry>& entry);
+                void PollProcesses();
+                void Wakeup();
+
+                int epollFd = -1;
+                int wakeupFd = -1;
+                bool isRunning = true;
+                std::atomic<bool> pidfdSupported { true };
+                uint64_t nextId = 1;
+
+                std::map<uint64_t, std::shared_ptr<Entry>> entries;
+                std::vector<PolledProcess> polledProcesses;
+
+                WorkerPool workers;
+                WorkerPool blockingWorkers;
+                pthread_t threadId = 0;
+                pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        };
+    }
+}
+
+#endif // REACTOR_H
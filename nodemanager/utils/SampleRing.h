@@ -0,0 +1,90 @@
+#ifndef SAMPLERING_H
+#define SAMPLERING_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+namespace hpc
+{
+    namespace utils
+    {
+        // The latest samples of a single writer read by many readers without locks.
+        // The writer overwrites the oldest cell, each cell carries a sequence which
+        // is odd while being written, so a reader drops a cell overwritten during
+        // the copy. T is copied as a plain value. The capacity must be a power of 2.
+        template <typename T>
+        class SampleRing
+        {
+            public:
+                SampleRing(size_t capacity) : capacity(capacity), mask(capacity - 1), cells(new Cell[capacity])
+                {
+                }
+
+                // Only called by the writer.
+                void Push(const T& value)
+                {
+                    uint64_t position = this->count.load(std::memory_order_relaxed);
+                    Cell& cell = this->cells[position & this->mask];
+
+                    cell.Sequence.store(position * 2 + 1, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_release);
+
+                    cell.Value = value;
+
+                    cell.Sequence.store(position * 2 + 2, std::memory_order_release);
+                    this->count.store(position + 1, std::memory_order_release);
+                }
+
+                // The last maxCount samples at most, the oldest first.
+                std::vector<T> Snapshot(size_t maxCount) const
+                {
+                    uint64_t end = this->count.load(std::memory_order_acquire);
+                    uint64_t length = std::min<uint64_t>(std::min<uint64_t>(end, this->capacity), maxCount);
+
+                    std::vector<T> values;
+                    values.reserve(length);
+
+                    for (uint64_t position = end - length; position < end; position++)
+                    {
+                        const Cell& cell = this->cells[position & this->mask];
+
+                        uint64_t sequence = cell.Sequence.load(std::memory_order_acquire);
+                        if (sequence != position * 2 + 2)
+                        {
+                            continue;
+                        }
+
+                        T value = cell.Value;
+                        std::atomic_thread_fence(std::memory_order_acquire);
+
+                        if (cell.Sequence.load(std::memory_order_relaxed) == sequence)
+                        {
+                            values.push_back(value);
+                        }
+                    }
+
+                    return std::move(values);
+                }
+
+                uint64_t GetCount() const { return this->count.load(std::memory_order_acquire); }
+
+            protected:
+            private:
+                struct Cell
+                {
+                    std::atomic<uint64_t> Sequence { 0 };
+                    T Value;
+                };
+
+                const size_t capacity;
+                const size_t mask;
+                std::unique_ptr<Cell[]> cells;
+
+                std::atomic<uint64_t> count { 0 };
+        };
+    }
+}
+
+#endif // SAMPLERING_H
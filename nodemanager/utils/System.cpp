@@ -8,12 +8,28 @@
 #include <fstream>
 #include <unistd.h>
 #include <set>
+#include <map>
+#include <iomanip>
+#include <net/if_arp.h>
+#include <netpacket/packet.h>
+#include <ftw.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <signal.h>
+#include <chrono>
 
 #include "System.h"
+#include "CpuTopology.h"
 #include "String.h"
 #include "Logger.h"
 #include "../common/ErrorCodes.h"
 
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
 using namespace hpc::utils;
 using namespace hpc::common;
 
@@ -21,67 +37,79 @@ std::vector<System::NetInfo> System::GetNetworkInfo()
 {
     std::vector<System::NetInfo> info;
 
-    std::string rawData;
-
-    int ret = System::ExecuteCommandOut(rawData, "ip", "addr");
-    if (ret == 0)
+    ifaddrs *ifAddr = nullptr;
+    if (getifaddrs(&ifAddr) != 0)
     {
-        std::string name, mac, ipV4, ipV6;
-        bool isIB = false;
+        Logger::Error("getifaddrs error {0}", errno);
+        return std::move(info);
+    }
 
-        std::istringstream iss(rawData);
-        std::string line;
-        while (getline(iss, line))
+    // The names keep the format of 'ip addr', e.g. 'eth0:'.
+    std::map<std::string, size_t> indexes;
+    auto getInfo = [&info, &indexes](const std::string& ifName) -> System::NetInfo&
+    {
+        std::string name = ifName + ":";
+        auto index = indexes.find(name);
+        if (index == indexes.end())
         {
-            std::istringstream lineStream(line);
-            if (line.empty()) continue;
+            // temporarily identify IB
+            index = indexes.emplace(name, info.size()).first;
+            info.push_back(System::NetInfo(name, std::string(), std::string(), std::string(), name == "eth1:"));
+        }
 
-            if (line[0] >= '0' && line[0] <= '9')
-            {
-                if (!name.empty())
-                {
-                    info.push_back(System::NetInfo(name, mac, ipV4, ipV6, isIB));
-                    name.clear();
-                    mac.clear();
-                    ipV4.clear();
-                    ipV6.clear();
-                    isIB = false;
-                }
+        return info[index->second];
+    };
 
-                lineStream >> name >> name;
+    for (ifaddrs *i = ifAddr; i != nullptr; i = i->ifa_next)
+    {
+        if (!i->ifa_addr) continue;
 
-                // temporarily identify IB
-                if (name == "eth1:")
-                {
-                    isIB = true;
-                }
+        int family = i->ifa_addr->sa_family;
+        if (family == AF_PACKET)
+        {
+            const auto* link = reinterpret_cast<const sockaddr_ll*>(i->ifa_addr);
+            auto& netInfo = getInfo(i->ifa_name);
 
-                continue;
+            std::ostringstream mac;
+            mac << std::hex << std::setfill('0');
+            for (int b = 0; b < link->sll_halen; b++)
+            {
+                mac << (b == 0 ? "" : ":") << std::setw(2) << (int)link->sll_addr[b];
             }
 
-            std::string head, value;
-            lineStream >> head >> value;
+            std::get<1>(netInfo) = mac.str();
+            std::get<4>(netInfo) = std::get<4>(netInfo) || link->sll_hatype == ARPHRD_INFINIBAND;
+        }
+        else if (family == AF_INET || family == AF_INET6)
+        {
+            bool isV4 = family == AF_INET;
+            const void* address = isV4 ?
+                (const void*)&((const sockaddr_in*)i->ifa_addr)->sin_addr :
+                (const void*)&((const sockaddr_in6*)i->ifa_addr)->sin6_addr;
 
-            if (head.compare(0, 4, "link") == 0)
-            {
-                mac = value;
-            }
-            else if (head == "inet")
-            {
-                ipV4 = value;
-            }
-            else if (head == "inet6")
+            char buffer[INET6_ADDRSTRLEN];
+            inet_ntop(family, address, buffer, sizeof(buffer));
+
+            int prefixLength = 0;
+            if (i->ifa_netmask)
             {
-                ipV6 = value;
+                const unsigned char* mask = isV4 ?
+                    (const unsigned char*)&((const sockaddr_in*)i->ifa_netmask)->sin_addr :
+                    (const unsigned char*)&((const sockaddr_in6*)i->ifa_netmask)->sin6_addr;
+
+                for (int b = 0; b < (isV4 ? 4 : 16); b++)
+                {
+                    prefixLength += __builtin_popcount(mask[b]);
+                }
             }
-        }
 
-        if (!name.empty())
-        {
-            info.push_back(System::NetInfo(name, mac, ipV4, ipV6, isIB));
+            auto& netInfo = getInfo(i->ifa_name);
+            (isV4 ? std::get<2>(netInfo) : std::get<3>(netInfo)) = String::Join("/", buffer, prefixLength);
         }
     }
 
+    freeifaddrs(ifAddr);
+
     return std::move(info);
 }
 
@@ -125,213 +153,11 @@ std::string System::GetIpAddress(IpAddressVersion version, const std::string& na
     return std::move(ip);
 }
 
-void System::CPUUsage(uint64_t &total, uint64_t &idle)
-{
-    try
-    {
-        std::ifstream fs("/proc/stat", std::ios::in);
-        std::string cpu;
-        uint64_t user, nice, sys, iowait, irq, softirq;
-
-        fs >> cpu >> user >> nice >> sys >> idle >> iowait >> irq >> softirq;
-        fs.close();
-
-        total = user + nice + sys + idle + iowait + irq + softirq;
-    }
-    catch (std::exception& ex)
-    {
-        Logger::Error("CPUUsage get exception {0}", ex.what());
-    }
-}
-
-void System::Memory(uint64_t &availableKb, uint64_t &totalKb)
-{
-    std::ifstream fs("/proc/meminfo", std::ios::in);
-    std::string name, unit;
-
-    fs >> name >> totalKb >> unit;
-    fs >> name >> availableKb >> unit;
-
-    fs.close();
-}
-
 void System::CPU(int &cores, int &sockets)
 {
-    std::ifstream fs("/proc/cpuinfo", std::ios::in);
-    std::string name, unit;
-
-    std::set<std::string> physicalIds;
-    std::set<std::string> coreIds;
-
-    std::string line;
-    while (getline(fs, line))
-    {
-        auto tokens = String::Split(line, ':');
-
-        if (tokens.size() >= 2)
-        {
-            if (String::Trim(tokens[0]) == "physical id")
-            {
-                physicalIds.insert(tokens[1]);
-            }
-            else if (String::Trim(tokens[0]) == "processor")
-            {
-                coreIds.insert(tokens[1]);
-            }
-        }
-    }
-
-    cores = coreIds.size();
-    sockets = physicalIds.size();
-    sockets = (sockets > 0)? sockets : 1;
-
-   // Logger::Debug("Detected core count {0}, socket count {1}", cores, sockets);
-
-    fs.close();
-}
-
-int System::Vmstat(float &pagesPerSec, float &contextSwitchesPerSec)
-{
-    std::string output;
-
-    int ret = System::ExecuteCommandOut(output, "vmstat");
-
-    if (ret == 0)
-    {
-        std::istringstream iss(output);
-
-        iss.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        iss.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-        int r, b, swpd, free, buff, cache, si, so, bi, bo, in, cs, us, sy, id, wa, st;
-        iss >> r >> b >> swpd >> free >> buff >> cache >> si >> so >> bi >> bo
-            >> in >> cs >> us >> sy >> id >> wa >> st;
-
-        pagesPerSec = si + so;
-        contextSwitchesPerSec = cs;
-    }
-
-    return ret;
-}
-
-int System::Iostat(float &bytesPerSecond)
-{
-    std::string output;
-
-    int ret = System::ExecuteCommandOut(output, "iostat -dk");
-
-    if (ret == 0)
-    {
-        std::istringstream iss(output);
-
-        std::string device;
-
-        while (device != "Device:" && iss.good())
-        {
-            iss >> device;
-            iss.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        }
-
-        float tps, read, write;
-
-        iss >> device >> tps >> read >> write;
-
-        bytesPerSecond = (read + write) * 1024;
-    }
-
-    return ret;
-}
-
-int System::IostatX(float &queueLength)
-{
-    std::string output;
-
-    int ret = System::ExecuteCommandOut(output, "iostat -x");
-
-    if (ret == 0)
-    {
-        std::istringstream iss(output);
-
-        std::string device;
-
-        while (device != "Device:" && iss.good())
-        {
-            iss >> device;
-            iss.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        }
-
-        float rrqm, wrqm, r, w, rkb, wkb, avgrq, avgqu;
-
-        iss >> device >> rrqm >> wrqm >> r >> w >> rkb >> wkb >> avgrq >> avgqu;
-
-        queueLength = avgqu;
-    }
-
-    return ret;
-}
-
-int System::FreeSpace(float &freeSpacePercent)
-{
-    std::string output;
-
-    int ret = System::ExecuteCommandOut(output, "df -k");
-
-    if (ret == 0)
-    {
-        std::istringstream iss(output);
-        iss.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-        std::string mountPoint;
-
-        while (mountPoint != "/" && iss.good())
-        {
-            std::string tmp;
-            iss >> tmp >> tmp >> tmp >> tmp >> freeSpacePercent >> tmp >> mountPoint;
-        }
-
-        if (mountPoint != "/")
-        {
-            ret = 1;
-        }
-        else
-        {
-            freeSpacePercent = 100 - freeSpacePercent;
-        }
-    }
-
-    return ret;
-}
-
-int System::NetworkUsage(uint64_t &network, const std::string& netName)
-{
-    int ret = 1;
-    std::ifstream fs("/proc/net/dev", std::ios::in);
-    std::string name;
-    uint64_t receive, send, tmp;
-
-    fs.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    fs.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-    network = 0;
-
-    while (fs.good())
-    {
-        std::getline(fs, name, ':');
-        name = String::Trim(name);
-
-        if (netName.empty() || netName == name)
-        {
-            fs >> receive >> tmp >> tmp >> tmp >> tmp >> tmp >> tmp >> tmp >> send;
-            network += receive + send;
-            ret = 0;
-        }
-
-        fs.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    }
-
-    fs.close();
-
-    return ret;
+    auto& topology = CpuTopology::GetInstance();
+    cores = topology.GetCoreCount();
+    sockets = topology.GetSocketCount();
 }
 
 const std::string& System::GetNodeName()
@@ -682,6 +508,27 @@ int System::CreateTempFolder(char* folderTemplate, const std::string& userName)
     }
 }
 
+int System::RemoveFolder(const std::string& folder)
+{
+    auto removeEntry = [](const char* path, const struct stat*, int, struct FTW*)
+    {
+        return remove(path) == 0 ? 0 : errno;
+    };
+
+    int ret = nftw(folder.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    if (ret == -1)
+    {
+        ret = errno;
+    }
+
+    if (ret != 0)
+    {
+        Logger::Error("Remove folder {0} error code {1}", folder, ret);
+    }
+
+    return ret;
+}
+
 int System::WriteStringToFile(const std::string& fileName, const std::string& contents)
 {
     std::ofstream os(fileName, std::ios::trunc);
@@ -695,3 +542,110 @@ int System::WriteStringToFile(const std::string& fileName, const std::string& co
 
     return 0;
 }
+
+int System::ReadFileHead(const std::string& fileName, size_t length, std::string& contents)
+{
+    return ReadFileRange(fileName, length, false, contents);
+}
+
+int System::ReadFileTail(const std::string& fileName, size_t length, std::string& contents)
+{
+    return ReadFileRange(fileName, length, true, contents);
+}
+
+int System::ReadFileRange(const std::string& fileName, size_t length, bool fromEnd, std::string& contents)
+{
+    contents.clear();
+
+    int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return errno;
+    }
+
+    int ret = 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ret = errno;
+    }
+    else
+    {
+        size_t size = std::min(length, (size_t)st.st_size);
+        off_t offset = fromEnd ? st.st_size - size : 0;
+
+        contents.resize(size);
+        ssize_t bytesRead = pread(fd, &contents[0], size, offset);
+        if (bytesRead < 0)
+        {
+            ret = errno;
+            bytesRead = 0;
+        }
+
+        // the file may be truncated in between.
+        contents.resize(bytesRead);
+    }
+
+    close(fd);
+    return ret;
+}
+
+int System::WaitForExit(const std::vector<int>& pids, int timeoutMs)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    auto remainingMs = [&deadline]()
+    {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        return ms > 0 ? (int)ms : 0;
+    };
+
+    std::vector<pollfd> fds;
+    std::vector<int> polled;
+    for (int pid : pids)
+    {
+        int fd = syscall(SYS_pidfd_open, pid, 0);
+        if (fd >= 0)
+        {
+            fds.push_back({ fd, POLLIN, 0 });
+        }
+        else if (errno != ESRCH)
+        {
+            polled.push_back(pid);
+        }
+    }
+
+    int ret = 0;
+    while (!fds.empty() || !polled.empty())
+    {
+        int timeout = remainingMs();
+        if (timeout == 0) { ret = ETIMEDOUT; break; }
+
+        // without pidfd the processes are checked every 10 ms.
+        if (!polled.empty()) { timeout = std::min(timeout, 10); }
+
+        int n = poll(fds.data(), fds.size(), timeout);
+        if (n < 0 && errno != EINTR) { ret = errno; break; }
+
+        for (size_t i = 0; n > 0 && i < fds.size(); )
+        {
+            if (fds[i].revents != 0)
+            {
+                close(fds[i].fd);
+                fds[i] = fds.back();
+                fds.pop_back();
+            }
+            else { i++; }
+        }
+
+        polled.erase(
+            std::remove_if(polled.begin(), polled.end(), [](int pid) { return kill(pid, 0) != 0 && errno == ESRCH; }),
+            polled.end());
+    }
+
+    for (auto& fd : fds)
+    {
+        close(fd.fd);
+    }
+
+    return ret;
+}
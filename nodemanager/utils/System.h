@@ -85,14 +85,7 @@ namespace hpc
 
                 static std::vector<NetInfo> GetNetworkInfo();
                 static std::string GetIpAddress(IpAddressVersion version, const std::string& name);
-                static void CPUUsage(uint64_t &total, uint64_t &idle);
-                static void Memory(uint64_t &available, uint64_t &total);
                 static void CPU(int &cores, int &sockets);
-                static int NetworkUsage(uint64_t &network, const std::string& netName);
-                static int Vmstat(float &pagesPerSec, float &contextSwitchesPerSec);
-                static int Iostat(float &bytesPerSec);
-                static int IostatX(float &queueLength);
-                static int FreeSpace(float &freeSpaceKB);
                 static const std::string& GetNodeName();
                 static bool IsCGroupInstalled();
 
@@ -128,10 +121,21 @@ namespace hpc
 
                 static int DeleteUser(const std::string& userName);
                 static int CreateTempFolder(char* folderTemplate, const std::string& userName);
+                static int RemoveFolder(const std::string& folder);
                 static int WriteStringToFile(const std::string& fileName, const std::string& contents);
 
+                // Reads at most length bytes from the start or the end of the file with
+                // a single pread, returns 0 or the errno.
+                static int ReadFileHead(const std::string& fileName, size_t length, std::string& contents);
+                static int ReadFileTail(const std::string& fileName, size_t length, std::string& contents);
+
                 static int QueryGpuInfo(GpuInfoList& gpuInfo);
 
+                // Waits for the processes to exit through their pidfds, they don't have
+                // to be children. Returns 0 or ETIMEDOUT, the processes are polled when
+                // pidfd is unavailable.
+                static int WaitForExit(const std::vector<int>& pids, int timeoutMs);
+
                 template <typename ... Args>
                 static int ExecuteCommandIn(const std::string& input, const std::string& cmd, const Args& ... args)
                 {
@@ -198,6 +202,7 @@ namespace hpc
 
             protected:
             private:
+                static int ReadFileRange(const std::string& fileName, size_t length, bool fromEnd, std::string& contents);
         };
     }
 }
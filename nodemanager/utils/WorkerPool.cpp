@@ -0,0 +1,132 @@
+#include "WorkerPool.h"
+#include "Logger.h"
+
+using namespace hpc::utils;
+
+WorkerPool::WorkerPool(int threadCount)
+{
+    // The jobs don't recurse deeply, a smaller stack than the default 8MB is enough.
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 1024 * 1024);
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        pthread_t threadId;
+        int ret = pthread_create(&threadId, &attr, WorkerThread, this);
+        if (ret == 0)
+        {
+            this->threads.push_back(threadId);
+        }
+        else
+        {
+            Logger::Error("WorkerPool: failed to create the worker thread, ret {0}", ret);
+        }
+    }
+
+    pthread_attr_destroy(&attr);
+}
+
+WorkerPool::~WorkerPool()
+{
+    pthread_mutex_lock(&this->mutex);
+    this->isRunning = false;
+    pthread_cond_broadcast(&this->cond);
+    pthread_mutex_unlock(&this->mutex);
+
+    for (auto threadId : this->threads)
+    {
+        pthread_join(threadId, nullptr);
+    }
+
+    pthread_cond_destroy(&this->cond);
+    pthread_mutex_destroy(&this->mutex);
+}
+
+void WorkerPool::Post(std::function<void()> job)
+{
+    pthread_mutex_lock(&this->mutex);
+    this->jobs.push_back(std::move(job));
+    pthread_cond_signal(&this->cond);
+    pthread_mutex_unlock(&this->mutex);
+}
+
+void WorkerPool::Post(const std::shared_ptr<Strand>& strand, std::function<void()> job)
+{
+    pthread_mutex_lock(&this->mutex);
+    strand->Jobs.push_back(std::move(job));
+
+    // Only one worker drains a strand at a time.
+    if (!strand->Running)
+    {
+        strand->Running = true;
+        this->jobs.push_back([this, strand]() { this->RunStrand(strand); });
+        pthread_cond_signal(&this->cond);
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+}
+
+void WorkerPool::RunStrand(const std::shared_ptr<Strand>& strand)
+{
+    while (true)
+    {
+        pthread_mutex_lock(&this->mutex);
+        if (strand->Jobs.empty())
+        {
+            strand->Running = false;
+            pthread_mutex_unlock(&this->mutex);
+            return;
+        }
+
+        auto job = std::move(strand->Jobs.front());
+        strand->Jobs.pop_front();
+        pthread_mutex_unlock(&this->mutex);
+
+        RunJob(job);
+    }
+}
+
+void* WorkerPool::WorkerThread(void* arg)
+{
+    WorkerPool* pool = static_cast<WorkerPool*>(arg);
+
+    while (true)
+    {
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->isRunning && pool->jobs.empty())
+        {
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        }
+
+        if (!pool->isRunning)
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+
+        auto job = std::move(pool->jobs.front());
+        pool->jobs.pop_front();
+        pthread_mutex_unlock(&pool->mutex);
+
+        RunJob(job);
+    }
+
+    pthread_exit(nullptr);
+}
+
+void WorkerPool::RunJob(const std::function<void()>& job)
+{
+    try
+    {
+        job();
+    }
+    catch (const std::exception& ex)
+    {
+        Logger::Error("WorkerPool: exception in the job, ex {0}", ex.what());
+    }
+    catch (...)
+    {
+        Logger::Error("WorkerPool: unknown exception in the job");
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <pthread.h>
+
+namespace hpc
+{
+    namespace utils
+    {
+        // A fixed number of threads running the posted jobs. The jobs posted to
+        // the same strand run one at a time in the posting order.
+        class WorkerPool
+        {
+            public:
+                typedef struct _Strand
+                {
+                    std::deque<std::function<void()>> Jobs;
+                    bool Running = false;
+                } Strand;
+
+                WorkerPool(int threadCount);
+                ~WorkerPool();
+
+                void Post(std::function<void()> job);
+                void Post(const std::shared_ptr<Strand>& strand, std::function<void()> job);
+
+            protected:
+            private:
+                static void* WorkerThread(void* arg);
+                static void RunJob(const std::function<void()>& job);
+
+                void RunStrand(const std::shared_ptr<Strand>& strand);
+
+                std::vector<pthread_t> threads;
+                std::deque<std::function<void()>> jobs;
+                bool isRunning = true;
+
+                pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+                pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+        };
+    }
+}
+
+#endif // WORKERPOOL_H